@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2018, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -30,8 +30,8 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 /*
- * map_bench.cpp -- benchmarks for: ctree, btree, rtree, rbtree, hashmap_atomic
- * and hashmap_tx from examples.
+ * map_bench.cpp -- benchmarks for: ctree, btree, rtree, rbtree, art,
+ * hashmap_atomic, hashmap_tx, hashmap_rp and hashmap_act from examples.
  */
 #include <cassert>
 
@@ -41,9 +41,12 @@
 #include "os_thread.h"
 #include "poolset_util.hpp"
 
+#include "hashmap.h"
 #include "map.h"
+#include "map_art.h"
 #include "map_btree.h"
 #include "map_ctree.h"
+#include "map_hashmap_act.h"
 #include "map_hashmap_atomic.h"
 #include "map_hashmap_rp.h"
 #include "map_hashmap_tx.h"
@@ -79,7 +82,8 @@ static const struct {
 	{"ctree", MAP_CTREE},		{"btree", MAP_BTREE},
 	{"rtree", MAP_RTREE},		{"rbtree", MAP_RBTREE},
 	{"hashmap_tx", MAP_HASHMAP_TX}, {"hashmap_atomic", MAP_HASHMAP_ATOMIC},
-	{"hashmap_rp", MAP_HASHMAP_RP}};
+	{"hashmap_rp", MAP_HASHMAP_RP}, {"hashmap_act", MAP_HASHMAP_ACT},
+	{"art", MAP_ART}};
 
 #define MAP_TYPES_NUM (sizeof(map_types) / sizeof(map_types[0]))
 
@@ -89,6 +93,7 @@ struct map_bench_args {
 	char *type;
 	bool ext_tx;
 	bool alloc;
+	unsigned rehash_step;
 };
 
 struct map_bench_worker {
@@ -594,7 +599,11 @@ map_common_init(struct benchmark *bench, struct benchmark_args *args)
 
 	map_bench->root_oid = map_bench->root.oid;
 
-	if (map_create(map_bench->mapc, &D_RW(map_bench->root)->map, nullptr)) {
+	struct hashmap_args hargs;
+	hargs.seed = map_bench->margs->seed;
+	hargs.rehash_step = map_bench->margs->rehash_step;
+
+	if (map_create(map_bench->mapc, &D_RW(map_bench->root)->map, &hargs)) {
 		perror("map_new");
 		goto err_free_map;
 	}
@@ -762,7 +771,7 @@ map_get_exit(struct benchmark *bench, struct benchmark_args *args)
 	return map_common_exit(bench, args);
 }
 
-static struct benchmark_clo map_bench_clos[5];
+static struct benchmark_clo map_bench_clos[6];
 
 static struct benchmark_info map_insert_info;
 static struct benchmark_info map_remove_info;
@@ -775,8 +784,8 @@ map_bench_constructor(void)
 	map_bench_clos[0].opt_short = 'T';
 	map_bench_clos[0].opt_long = "type";
 	map_bench_clos[0].descr =
-		"Type of container "
-		"[ctree|btree|rtree|rbtree|hashmap_tx|hashmap_atomic]";
+		"Type of container [ctree|btree|rtree|rbtree|hashmap_tx|"
+		"hashmap_atomic|hashmap_rp|hashmap_act|art]";
 
 	map_bench_clos[0].off = clo_field_offset(struct map_bench_args, type);
 	map_bench_clos[0].type = CLO_TYPE_STR;
@@ -822,6 +831,21 @@ map_bench_constructor(void)
 	map_bench_clos[4].off = clo_field_offset(struct map_bench_args, alloc);
 	map_bench_clos[4].type = CLO_TYPE_FLAG;
 
+	map_bench_clos[5].opt_short = 'R';
+	map_bench_clos[5].opt_long = "rehash-step";
+	map_bench_clos[5].descr = "Number of buckets moved by every operation "
+				  "during incremental rehash of hashmap_tx "
+				  "and hashmap_act (0 means rebuild at once)";
+	map_bench_clos[5].off =
+		clo_field_offset(struct map_bench_args, rehash_step);
+	map_bench_clos[5].type = CLO_TYPE_UINT;
+	map_bench_clos[5].def = "0";
+	map_bench_clos[5].type_uint.size =
+		clo_field_size(struct map_bench_args, rehash_step);
+	map_bench_clos[5].type_uint.base = CLO_INT_BASE_DEC;
+	map_bench_clos[5].type_uint.min = 0;
+	map_bench_clos[5].type_uint.max = UINT_MAX;
+
 	map_insert_info.name = "map_insert";
 	map_insert_info.brief = "Inserting to tree map";
 	map_insert_info.init = map_common_init;
@@ -1,5 +1,5 @@
 /*
- * Copyright 2018, Intel Corporation
+ * Copyright 2018-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -38,12 +38,19 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "file.h"
 #include "os.h"
 #include "out.h"
 #include "extent.h"
 #include "os_badblock.h"
+#include "os_dimm.h"
+#include "os_thread.h"
+#include "sys_util.h"
+#include "util.h"
 #include "badblock.h"
 
 /*
@@ -77,58 +84,384 @@ badblocks_delete(struct badblocks *bbs)
 	Free(bbs);
 }
 
-/* helper structure for badblocks_check_file_cb() */
-struct check_file_cb {
-	int n_files_bbs;	/* number of files with bad blocks */
-	int create;		/* poolset is just being created */
+/* maximal number of threads checking or clearing bad blocks of a pool set */
+#define BADBLOCKS_MAX_THREADS 16
+
+/* number of devices the results of the bad blocks checks are cached for */
+#define BADBLOCKS_CACHE_SIZE 64
+
+/* the part has no device the result of the check could be cached for */
+#define BADBLOCKS_NO_DEV UINT_MAX
+
+/* a device which was found to contain no bad blocks */
+struct badblocks_cache_entry {
+	uint64_t dev;	/* device ID */
+	uint64_t usc;	/* unsafe shutdown count at the time of the check */
+};
+
+/*
+ * The devices which contained no bad blocks, until their unsafe shutdown
+ * counts change or bad blocks are cleared by this process. New bad blocks
+ * do not change the unsafe shutdown count, so only the devices whose list
+ * of bad blocks can be read cheaply (see os_dimm_badblocks_empty()) are
+ * cached, and the list is read again on every lookup.
+ */
+static struct {
+	os_mutex_t lock;
+	unsigned nentries;
+	unsigned next;		/* the entry to be replaced next */
+	struct badblocks_cache_entry entries[BADBLOCKS_CACHE_SIZE];
+} Badblocks_cache;
+
+static os_once_t Badblocks_cache_once = OS_ONCE_INIT;
+
+/* a device of the parts of a pool set */
+struct badblocks_dev {
+	uint64_t id;		/* device ID */
+	const char *path;	/* path of the first part on the device */
+	int clean;		/* the device contains no bad blocks */
+};
+
+/* a local part of a pool set */
+struct badblocks_part {
+	struct pool_set_part *part;
+	unsigned dev;		/* index of the device of the part */
+	int ret;		/* result of the check or clear */
+	int oerrno;		/* errno set by the check or clear */
+};
+
+/* the parts (and their devices) checked or cleared in parallel */
+struct badblocks_parts {
+	struct badblocks_part *parts;
+	unsigned nparts;
+	struct badblocks_dev *devs;
+	unsigned ndevs;
+	unsigned next;		/* the first item not taken by any thread */
+	void (*func)(struct badblocks_parts *bp, unsigned idx);
+	unsigned nitems;
 };
 
 /*
- * badblocks_check_file_cb -- (internal) callback checking bad blocks
- *                               in the given file
+ * badblocks_cache_init -- (internal) initializes the cache lock
+ */
+static void
+badblocks_cache_init(void)
+{
+	util_mutex_init(&Badblocks_cache.lock);
+}
+
+/*
+ * badblocks_cache_lookup -- (internal) checks if the device was found to
+ *                           contain no bad blocks at the given unsafe
+ *                           shutdown count
  */
 static int
-badblocks_check_file_cb(struct part_file *pf, void *arg)
+badblocks_cache_lookup(uint64_t dev, uint64_t usc)
 {
-	LOG(3, "part_file %p arg %p", pf, arg);
+	os_once(&Badblocks_cache_once, badblocks_cache_init);
 
-	struct check_file_cb *pcfcb = arg;
+	int found = 0;
 
-	if (pf->is_remote) {
-		/*
-		 * Remote replicas are checked for bad blocks
-		 * while opening in util_pool_open_remote().
-		 */
-		return 0;
+	util_mutex_lock(&Badblocks_cache.lock);
+	for (unsigned i = 0; i < Badblocks_cache.nentries; i++) {
+		struct badblocks_cache_entry *e = &Badblocks_cache.entries[i];
+		if (e->dev == dev && e->usc == usc) {
+			found = 1;
+			break;
+		}
 	}
+	util_mutex_unlock(&Badblocks_cache.lock);
 
-	int exists = util_file_exists(pf->part->path);
-	if (exists < 0)
-		return -1;
+	return found;
+}
+
+/*
+ * badblocks_cache_insert -- (internal) remembers the device contains no bad
+ *                           blocks at the given unsafe shutdown count
+ */
+static void
+badblocks_cache_insert(uint64_t dev, uint64_t usc)
+{
+	os_once(&Badblocks_cache_once, badblocks_cache_init);
+
+	util_mutex_lock(&Badblocks_cache.lock);
+
+	struct badblocks_cache_entry *e = NULL;
+	for (unsigned i = 0; i < Badblocks_cache.nentries; i++) {
+		if (Badblocks_cache.entries[i].dev == dev) {
+			e = &Badblocks_cache.entries[i];
+			break;
+		}
+	}
+
+	if (e == NULL && Badblocks_cache.nentries < BADBLOCKS_CACHE_SIZE) {
+		e = &Badblocks_cache.entries[Badblocks_cache.nentries++];
+	} else if (e == NULL) {
+		e = &Badblocks_cache.entries[Badblocks_cache.next];
+		Badblocks_cache.next =
+			(Badblocks_cache.next + 1) % BADBLOCKS_CACHE_SIZE;
+	}
+
+	e->dev = dev;
+	e->usc = usc;
+
+	util_mutex_unlock(&Badblocks_cache.lock);
+}
+
+/*
+ * badblocks_cache_remove -- (internal) forgets the device
+ */
+static void
+badblocks_cache_remove(uint64_t dev)
+{
+	os_once(&Badblocks_cache_once, badblocks_cache_init);
+
+	util_mutex_lock(&Badblocks_cache.lock);
+
+	for (unsigned i = 0; i < Badblocks_cache.nentries; i++) {
+		if (Badblocks_cache.entries[i].dev != dev)
+			continue;
+
+		Badblocks_cache.entries[i] =
+			Badblocks_cache.entries[--Badblocks_cache.nentries];
+		if (Badblocks_cache.next >= Badblocks_cache.nentries)
+			Badblocks_cache.next = 0;
+		break;
+	}
 
-	if (!exists)
-		/* the part does not exist, so it has no bad blocks */
+	util_mutex_unlock(&Badblocks_cache.lock);
+}
+
+/*
+ * badblocks_cache_invalidate -- (internal) forgets all devices
+ */
+static void
+badblocks_cache_invalidate(void)
+{
+	os_once(&Badblocks_cache_once, badblocks_cache_init);
+
+	util_mutex_lock(&Badblocks_cache.lock);
+	Badblocks_cache.nentries = 0;
+	Badblocks_cache.next = 0;
+	util_mutex_unlock(&Badblocks_cache.lock);
+}
+
+/*
+ * badblocks_parts_dev -- (internal) returns the index of the device of
+ *                        the part, adding it to the devices if needed
+ */
+static unsigned
+badblocks_parts_dev(struct badblocks_parts *bp, const char *path)
+{
+	os_stat_t st;
+	if (os_stat(path, &st))
+		return BADBLOCKS_NO_DEV;
+
+	/* Device DAX is a device on its own */
+	uint64_t id = (uint64_t)(S_ISCHR(st.st_mode) ? st.st_rdev : st.st_dev);
+
+	for (unsigned d = 0; d < bp->ndevs; d++)
+		if (bp->devs[d].id == id)
+			return d;
+
+	struct badblocks_dev *dev = &bp->devs[bp->ndevs];
+	dev->id = id;
+	dev->path = path;
+	dev->clean = 0;
+
+	return bp->ndevs++;
+}
+
+/*
+ * badblocks_parts_new -- (internal) collects the local parts of the pool set
+ *                        and their devices
+ *
+ * Parts which do not exist are skipped if skip_missing is set.
+ */
+static int
+badblocks_parts_new(struct pool_set *set, int skip_missing,
+	struct badblocks_parts *bp)
+{
+	unsigned nparts = 0;
+	for (unsigned r = 0; r < set->nreplicas; r++)
+		nparts += set->replica[r]->nparts;
+
+	memset(bp, 0, sizeof(*bp));
+
+	if (nparts == 0)
 		return 0;
 
-	int ret = os_badblocks_check_file(pf->part->path);
-	if (ret < 0) {
-		ERR("checking the pool file for bad blocks failed -- '%s'",
-			pf->part->path);
-		return -1;
+	bp->parts = Malloc(nparts * sizeof(*bp->parts));
+	bp->devs = Malloc(nparts * sizeof(*bp->devs));
+	if (bp->parts == NULL || bp->devs == NULL) {
+		ERR("!Malloc");
+		goto err;
 	}
 
-	if (ret > 0) {
-		ERR("part file contains bad blocks -- '%s'", pf->part->path);
-		pcfcb->n_files_bbs++;
-		pf->part->has_bad_blocks = 1;
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+
+		if (rep->remote) {
+			/*
+			 * Remote replicas are checked for bad blocks
+			 * while opening in util_pool_open_remote().
+			 */
+			continue;
+		}
+
+		for (unsigned p = 0; p < rep->nparts; p++) {
+			struct pool_set_part *part = PART(rep, p);
+
+			int exists = util_file_exists(part->path);
+			if (exists < 0)
+				goto err;
+
+			if (!exists && skip_missing)
+				continue;
+
+			struct badblocks_part *bpart = &bp->parts[bp->nparts++];
+			bpart->part = part;
+			bpart->dev = exists ? badblocks_parts_dev(bp,
+					part->path) : BADBLOCKS_NO_DEV;
+			bpart->ret = 0;
+			bpart->oerrno = 0;
+		}
 	}
 
 	return 0;
+
+err:
+	Free(bp->parts);
+	Free(bp->devs);
+	return -1;
+}
+
+/*
+ * badblocks_parts_delete -- (internal) frees the collected parts
+ */
+static void
+badblocks_parts_delete(struct badblocks_parts *bp)
+{
+	Free(bp->parts);
+	Free(bp->devs);
+}
+
+/*
+ * badblocks_parts_worker -- (internal) processes the items until none is left
+ */
+static void *
+badblocks_parts_worker(void *arg)
+{
+	struct badblocks_parts *bp = arg;
+
+	unsigned idx;
+	while ((idx = util_fetch_and_add32(&bp->next, 1)) < bp->nitems)
+		bp->func(bp, idx);
+
+	return NULL;
+}
+
+/*
+ * badblocks_parts_run -- (internal) calls func for nitems items using
+ *                        a pool of threads
+ *
+ * The calling thread takes part in the work, so all items are processed
+ * even if none of the threads can be created.
+ */
+static void
+badblocks_parts_run(struct badblocks_parts *bp, unsigned nitems,
+	void (*func)(struct badblocks_parts *bp, unsigned idx))
+{
+	bp->next = 0;
+	bp->nitems = nitems;
+	bp->func = func;
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned nthreads = cpus > 1 ? (unsigned)cpus : 1;
+	if (nthreads > nitems)
+		nthreads = nitems;
+	if (nthreads > BADBLOCKS_MAX_THREADS)
+		nthreads = BADBLOCKS_MAX_THREADS;
+
+	os_thread_t threads[BADBLOCKS_MAX_THREADS];
+	unsigned created = 1;
+	for (; created < nthreads; created++) {
+		if (os_thread_create(&threads[created], NULL,
+				badblocks_parts_worker, bp) != 0) {
+			LOG(2, "!os_thread_create");
+			break;
+		}
+	}
+
+	badblocks_parts_worker(bp);
+
+	for (unsigned i = 1; i < created; i++)
+		os_thread_join(&threads[i], NULL);
+}
+
+/*
+ * badblocks_dev_check -- (internal) checks if the whole device contains
+ *                        no bad blocks, consulting the cache first
+ *
+ * A device which cannot be checked as a whole is left not clean, so all its
+ * parts are checked one by one.
+ */
+static void
+badblocks_dev_check(struct badblocks_parts *bp, unsigned idx)
+{
+	struct badblocks_dev *dev = &bp->devs[idx];
+
+	uint64_t usc;
+	if (os_dimm_usc(dev->path, &usc))
+		return;
+
+	if (badblocks_cache_lookup(dev->id, usc)) {
+		if (os_dimm_badblocks_empty(dev->path) == 1) {
+			LOG(4, "no bad blocks (cached) -- '%s'", dev->path);
+			dev->clean = 1;
+			return;
+		}
+
+		LOG(4, "new bad blocks -- '%s'", dev->path);
+		badblocks_cache_remove(dev->id);
+	}
+
+	struct badblocks *bbs = badblocks_new();
+	if (bbs == NULL)
+		return;
+
+	if (os_dimm_files_namespace_badblocks(dev->path, bbs) == 0 &&
+			bbs->bb_cnt == 0) {
+		dev->clean = 1;
+		if (os_dimm_badblocks_empty(dev->path) == 1)
+			badblocks_cache_insert(dev->id, usc);
+	}
+
+	badblocks_delete(bbs);
+}
+
+/*
+ * badblocks_part_check -- (internal) checks if the part contains bad blocks
+ */
+static void
+badblocks_part_check(struct badblocks_parts *bp, unsigned idx)
+{
+	struct badblocks_part *bpart = &bp->parts[idx];
+
+	if (bpart->dev != BADBLOCKS_NO_DEV && bp->devs[bpart->dev].clean)
+		return;
+
+	bpart->ret = os_badblocks_check_file(bpart->part->path);
+	bpart->oerrno = errno;
 }
 
 /*
  * badblocks_check_poolset -- checks if the pool set contains bad blocks
  *
+ * The devices of the parts are checked as a whole first, each by one of
+ * a pool of threads. The parts on devices which contain bad blocks are
+ * checked one by one, also in parallel.
+ *
  * Return value:
  * -1 error
  *  0 pool set does not contain bad blocks
@@ -139,81 +472,119 @@ badblocks_check_poolset(struct pool_set *set, int create)
 {
 	LOG(3, "set %p create %i", set, create);
 
-	struct check_file_cb cfcb;
+	struct badblocks_parts bp;
+	if (badblocks_parts_new(set, 1, &bp))
+		return -1;
 
-	cfcb.n_files_bbs = 0;
-	cfcb.create = create;
+	if (bp.ndevs)
+		badblocks_parts_run(&bp, bp.ndevs, badblocks_dev_check);
+	if (bp.nparts)
+		badblocks_parts_run(&bp, bp.nparts, badblocks_part_check);
 
-	if (util_poolset_foreach_part_struct(set, badblocks_check_file_cb,
-						&cfcb)) {
-		return -1;
+	int n_files_bbs = 0;
+	int ret = 0;
+
+	for (unsigned i = 0; i < bp.nparts; i++) {
+		struct badblocks_part *bpart = &bp.parts[i];
+
+		if (bpart->ret < 0) {
+			errno = bpart->oerrno;
+			ERR(
+				"checking the pool file for bad blocks failed -- '%s'",
+				bpart->part->path);
+			ret = -1;
+			break;
+		}
+
+		if (bpart->ret > 0) {
+			ERR("part file contains bad blocks -- '%s'",
+				bpart->part->path);
+			n_files_bbs++;
+			bpart->part->has_bad_blocks = 1;
+		}
 	}
 
-	if (cfcb.n_files_bbs) {
-		LOG(1, "%i pool file(s) contain bad blocks", cfcb.n_files_bbs);
+	badblocks_parts_delete(&bp);
+
+	if (ret)
+		return ret;
+
+	if (n_files_bbs) {
+		LOG(1, "%i pool file(s) contain bad blocks", n_files_bbs);
 		set->has_bad_blocks = 1;
 	}
 
-	return (cfcb.n_files_bbs > 0);
+	return (n_files_bbs > 0);
 }
 
 /*
- * badblocks_clear_poolset_cb -- (internal) callback clearing bad blocks
- *                                  in the given file
+ * badblocks_part_clear -- (internal) clears bad blocks in the part
  */
-static int
-badblocks_clear_poolset_cb(struct part_file *pf, void *arg)
+static void
+badblocks_part_clear(struct badblocks_parts *bp, unsigned idx)
 {
-	LOG(3, "part_file %p arg %p", pf, arg);
-
-	int *create = arg;
-
-	if (pf->is_remote) { /* XXX not supported yet */
-		LOG(1,
-			"WARNING: clearing bad blocks in remote replicas is not supported yet -- '%s:%s'",
-			pf->remote->node_addr, pf->remote->pool_desc);
-		return 0;
-	}
-
-	if (*create) {
-		/*
-		 * Poolset is just being created - check if file exists
-		 * and if we can read it.
-		 */
-		int exists = util_file_exists(pf->part->path);
-		if (exists < 0)
-			return -1;
-
-		if (!exists)
-			return 0;
-	}
+	struct badblocks_part *bpart = &bp->parts[idx];
 
-	int ret = os_badblocks_clear_all(pf->part->path);
-	if (ret < 0) {
-		ERR("clearing bad blocks in the pool file failed -- '%s'",
-			pf->part->path);
-		errno = EIO;
-		return -1;
-	}
-
-	pf->part->has_bad_blocks = 0;
-
-	return 0;
+	bpart->ret = os_badblocks_clear_all(bpart->part->path);
+	bpart->oerrno = errno;
 }
 
 /*
  * badblocks_clear_poolset -- clears bad blocks in the pool set
+ *
+ * The parts are cleared in parallel by a pool of threads.
  */
 int
 badblocks_clear_poolset(struct pool_set *set, int create)
 {
 	LOG(3, "set %p create %i", set, create);
 
-	if (util_poolset_foreach_part_struct(set, badblocks_clear_poolset_cb,
-						&create)) {
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct remote_replica *remote = set->replica[r]->remote;
+		if (remote == NULL)
+			continue;
+
+		/* XXX not supported yet */
+		LOG(1,
+			"WARNING: clearing bad blocks in remote replicas is not supported yet -- '%s:%s'",
+			remote->node_addr, remote->pool_desc);
+	}
+
+	/*
+	 * If the pool set is just being created, the parts which do not
+	 * exist yet are skipped.
+	 */
+	struct badblocks_parts bp;
+	if (badblocks_parts_new(set, create, &bp))
 		return -1;
+
+	if (bp.nparts)
+		badblocks_parts_run(&bp, bp.nparts, badblocks_part_clear);
+
+	/* the devices have to be checked again */
+	badblocks_cache_invalidate();
+
+	int ret = 0;
+	for (unsigned i = 0; i < bp.nparts; i++) {
+		struct badblocks_part *bpart = &bp.parts[i];
+
+		if (bpart->ret < 0) {
+			ERR(
+				"clearing bad blocks in the pool file failed -- '%s'",
+				bpart->part->path);
+			errno = EIO;
+			ret = -1;
+			break;
+		}
+
+		bpart->part->has_bad_blocks = 0;
 	}
 
+	badblocks_parts_delete(&bp);
+
+	if (ret)
+		return ret;
+
 	set->has_bad_blocks = 0;
 
 	return 0;
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2019, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -81,12 +81,41 @@ CTL_WRITE_HANDLER(at_open)(void *ctx, enum ctl_query_source source,
 	return 0;
 }
 
+static int
+CTL_READ_HANDLER(threads)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int *arg_out = arg;
+	*arg_out = Prefault_threads;
+
+	return 0;
+}
+
+static int
+CTL_WRITE_HANDLER(threads)(void *ctx, enum ctl_query_source source,
+	void *arg, struct ctl_indexes *indexes)
+{
+	int arg_in = *(int *)arg;
+
+	if (arg_in < 0) {
+		ERR("prefault.threads cannot be negative");
+		errno = EINVAL;
+		return -1;
+	}
+
+	Prefault_threads = arg_in;
+
+	return 0;
+}
+
 static const struct ctl_argument CTL_ARG(at_create) = CTL_ARG_BOOLEAN;
 static const struct ctl_argument CTL_ARG(at_open) = CTL_ARG_BOOLEAN;
+static const struct ctl_argument CTL_ARG(threads) = CTL_ARG_INT;
 
 static const struct ctl_node CTL_NODE(prefault)[] = {
 	CTL_LEAF_RW(at_create),
 	CTL_LEAF_RW(at_open),
+	CTL_LEAF_RW(threads),
 
 	CTL_NODE_END
 };
@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2018, Intel Corporation
+ * Copyright 2017-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -49,6 +49,7 @@ extern "C" {
 int os_dimm_uid(const char *path, char *uid, size_t *len);
 int os_dimm_usc(const char *path, uint64_t *usc);
 int os_dimm_files_namespace_badblocks(const char *path, struct badblocks *bbs);
+int os_dimm_badblocks_empty(const char *path);
 int os_dimm_devdax_clear_badblocks_all(const char *path);
 int os_dimm_devdax_clear_badblocks(const char *path, struct badblocks *bbs);
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2019, Intel Corporation
+ * Copyright 2017-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -52,6 +52,7 @@
 #include "os_dimm.h"
 #include "os_badblock.h"
 #include "badblock.h"
+#include "util.h"
 #include "vec.h"
 
 #define FOREACH_BUS_REGION_NAMESPACE(ctx, bus, region, ndns)	\
@@ -707,6 +708,65 @@ os_dimm_files_namespace_badblocks(const char *path, struct badblocks *bbs)
 	return ret;
 }
 
+/*
+ * os_dimm_badblocks_empty -- checks if the kernel list of bad blocks of
+ *                            the block device where the given file is
+ *                            located is empty, without walking the buses
+ *
+ * Returns 1 if the list is empty, 0 if it is not and -1 if it cannot be
+ * read, e.g. for Device DAX.
+ */
+int
+os_dimm_badblocks_empty(const char *path)
+{
+	LOG(3, "path %s", path);
+
+	os_stat_t st;
+	if (os_stat(path, &st)) {
+		ERR("!stat %s", path);
+		return -1;
+	}
+
+	if (S_ISCHR(st.st_mode))
+		return -1;
+
+	/* a partition shares the list of the whole disk */
+	static const char * const fmts[] = {
+		"/sys/dev/block/%u:%u/badblocks",
+		"/sys/dev/block/%u:%u/../badblocks",
+	};
+
+	char spath[PATH_MAX];
+	int fd = -1;
+	for (unsigned i = 0; i < ARRAY_SIZE(fmts) && fd < 0; i++) {
+		int ret = snprintf(spath, PATH_MAX, fmts[i],
+				major(st.st_dev), minor(st.st_dev));
+		if (ret < 0) {
+			ERR("snprintf: %d", ret);
+			return -1;
+		}
+
+		fd = os_open(spath, O_RDONLY);
+	}
+
+	if (fd < 0) {
+		LOG(2, "!open \"%s\"", spath);
+		return -1;
+	}
+
+	char c;
+	ssize_t nread = read(fd, &c, 1);
+	if (nread < 0) {
+		ERR("!read");
+		os_close(fd);
+		return -1;
+	}
+
+	os_close(fd);
+
+	return nread == 0;
+}
+
 /*
  * os_dimm_devdax_clear_one_badblock -- (internal) clear one bad block
  *                                      in the dax device
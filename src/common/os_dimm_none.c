@@ -1,5 +1,5 @@
 /*
- * Copyright 2018, Intel Corporation
+ * Copyright 2018-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -81,6 +81,17 @@ os_dimm_files_namespace_badblocks(const char *path, struct badblocks *bbs)
 	return 0;
 }
 
+/*
+ * os_dimm_badblocks_empty -- the list of bad blocks cannot be read
+ */
+int
+os_dimm_badblocks_empty(const char *path)
+{
+	LOG(3, "path %s", path);
+
+	return -1;
+}
+
 /*
  * os_dimm_devdax_clear_badblocks -- fake bad block clearing routine
  */
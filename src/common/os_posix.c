@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2019, Intel Corporation
+ * Copyright 2017-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -316,6 +316,15 @@ os_clock_gettime(int id, struct timespec *ts)
 	return clock_gettime(id, ts);
 }
 
+/*
+ * os_nanosleep -- nanosleep abstraction layer
+ */
+int
+os_nanosleep(const struct timespec *req)
+{
+	return nanosleep(req, NULL);
+}
+
 /*
  * os_rand_r -- rand_r abstraction layer
  */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2019, Intel Corporation
+ * Copyright 2017-2020, Intel Corporation
  * Copyright (c) 2016, Microsoft Corporation. All rights reserved.
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -490,6 +490,21 @@ os_clock_gettime(int id, struct timespec *ts)
 	return 0;
 }
 
+/*
+ * os_nanosleep -- suspends the thread for at least the given time, rounded
+ * up to milliseconds
+ */
+int
+os_nanosleep(const struct timespec *req)
+{
+	uint64_t ms = (uint64_t)req->tv_sec * 1000 +
+		((uint64_t)req->tv_nsec + 999999) / 1000000;
+
+	Sleep((DWORD)ms);
+
+	return 0;
+}
+
 /*
  * os_setenv -- change or add an environment variable
  */
@@ -59,6 +59,8 @@ static const char *Log_prefix;
 static int Log_level;
 static FILE *Out_fp;
 static unsigned Log_alignment;
+static __thread char *Err_defer_buf;	/* errors of the thread go here */
+static __thread size_t Err_defer_size;
 
 #ifndef NO_LIBPTHREAD
 #define MAXPRINT 8192	/* maximum expected log line */
@@ -502,7 +504,13 @@ out_error(const char *file, int line, const char *func,
 		out_snprintf(&buf[cc], MAXPRINT - cc, "%s%s", errormsg,
 				suffix);
 
-		Print(buf);
+		if (Err_defer_buf) {
+			size_t len = strlen(Err_defer_buf);
+			out_snprintf(&Err_defer_buf[len], Err_defer_size - len,
+					"%s", buf);
+		} else {
+			Print(buf);
+		}
 	}
 #endif
 
@@ -594,6 +602,36 @@ out_err(const char *file, int line, const char *func,
 	va_end(ap);
 }
 
+/*
+ * out_err_defer -- keep the errors of the calling thread in buf instead of
+ *                  logging them, until called with NULL
+ */
+void
+out_err_defer(char *buf, size_t size)
+{
+	if (buf)
+		buf[0] = '\0';
+
+	Err_defer_buf = buf;
+	Err_defer_size = size;
+}
+
+/*
+ * out_err_restore -- set the error message of the calling thread and log
+ *                    the errors deferred by another thread
+ */
+void
+out_err_restore(const char *errormsg, const char *deferred)
+{
+	char *msg = (char *)out_get_errormsg();
+	out_snprintf(msg, MAXPRINT, "%s", errormsg);
+
+#ifdef DEBUG
+	if (Log_level >= 1 && deferred[0] != '\0')
+		Print(deferred);
+#endif
+}
+
 /*
  * out_get_errormsg -- get the last error message
  */
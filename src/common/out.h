@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2018, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -238,6 +238,9 @@ void out_set_print_func(void (*print_func)(const char *s));
 void out_set_vsnprintf_func(int (*vsnprintf_func)(char *str, size_t size,
 	const char *format, va_list ap));
 
+void out_err_defer(char *buf, size_t size);
+void out_err_restore(const char *errormsg, const char *deferred);
+
 #ifdef _WIN32
 #ifndef PMDK_UTF8_API
 #define out_get_errormsg out_get_errormsgW
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2019, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  * Copyright (c) 2016, Microsoft Corporation. All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -70,6 +70,7 @@
 #include "fs.h"
 #include "os_deep.h"
 #include "badblock.h"
+#include "os_thread.h"
 
 #define LIBRARY_REMOTE "librpmem.so.1"
 #define SIZE_AUTODETECT_STR "AUTO"
@@ -102,6 +103,7 @@ static void *Rpmem_handle_remote;
 
 int Prefault_at_open = 0;
 int Prefault_at_create = 0;
+int Prefault_threads = 0;
 int SDS_at_create = POOL_FEAT_INCOMPAT_DEFAULT & POOL_E_FEAT_SDS ? 1 : 0;
 int Fallocate_at_create = 1;
 int COW_at_open = 0;
@@ -340,19 +342,190 @@ static const char *parser_errstr[PARSER_MAX_CODE] = {
 	"" /* format correct */
 };
 
+/* minimal size of a replica prefaulted by one thread */
+#define PREFAULT_MIN_PER_THREAD (64 << 20) /* 64 MiB */
+
+/* a part of a pool set processed by one of a pool of threads */
+struct part_task {
+	struct pool_set_part *part;
+	unsigned repidx;
+	unsigned partidx;
+	int ret;		/* value returned by the task */
+	int oerrno;		/* errno set by the failed task */
+	char *errmsg;		/* error message set by the failed task */
+	char *errlog;		/* errors logged by the failed task */
+};
+
+/* the tasks run by a pool of threads, see util_parts_run() */
+struct part_tasks {
+	struct part_task *tasks;
+	unsigned ntasks;
+	unsigned next;		/* the first task not taken by any thread */
+	int (*func)(struct part_task *task, void *arg);
+	void *arg;
+};
+
+/* arguments of util_header_create_task() */
+struct header_create_args {
+	struct pool_set *set;
+	const struct pool_attr *attr;
+};
+
+/* arguments of util_replica_check_task() */
+struct replica_check_args {
+	struct pool_set *set;
+	const struct pool_attr *attr;
+	struct part_task *tasks;
+	struct shutdown_state *sds;	/* shutdown state of each task */
+};
+
+/* arguments of util_part_open_task() */
+struct part_open_args {
+	size_t minpartsize;
+	int create;
+};
+
+struct prefault_arg {
+	struct pool_replica *rep;
+	unsigned idx;
+	unsigned nthreads;
+};
+
+/*
+ * util_part_prefault_stride -- (internal) returns the distance between
+ * the bytes that have to be touched to fault in every page of the part
+ *
+ * Device DAX is always mapped with pages of its internal alignment,
+ * so touching one byte per such page is enough.
+ */
+static size_t
+util_part_prefault_stride(struct pool_set_part *part)
+{
+	if (part->is_dev_dax && part->alignment > Pagesize &&
+			part->size % part->alignment == 0)
+		return part->alignment;
+
+	return Pagesize;
+}
+
+/*
+ * util_replica_prefault_worker -- (internal) touches the idx-th of
+ * nthreads slices of every part of the replica
+ */
+static void *
+util_replica_prefault_worker(void *arg)
+{
+	struct prefault_arg *pa = arg;
+	struct pool_replica *rep = pa->rep;
+
+	for (unsigned p = 0; p < rep->nparts; p++) {
+		struct pool_set_part *part = &rep->part[p];
+		size_t stride = util_part_prefault_stride(part);
+		size_t npages = (part->size + stride - 1) / stride;
+		size_t per_thread = (npages + pa->nthreads - 1) / pa->nthreads;
+		size_t first = per_thread * pa->idx;
+		size_t last = first + per_thread;
+
+		if (last > npages)
+			last = npages;
+
+		for (size_t pg = first; pg < last; pg++) {
+			volatile char *cur_addr =
+				(char *)part->addr + pg * stride;
+			*cur_addr = *cur_addr;
+			VALGRIND_SET_CLEAN(cur_addr, 1);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * util_prefault_nthreads -- (internal) returns the number of threads to
+ * prefault the replica with
+ */
+static unsigned
+util_prefault_nthreads(struct pool_replica *rep)
+{
+	if (Prefault_threads > 0)
+		return (unsigned)Prefault_threads;
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		cpus = 1;
+
+	size_t nthreads = rep->repsize / PREFAULT_MIN_PER_THREAD;
+	if (nthreads > (size_t)cpus)
+		nthreads = (size_t)cpus;
+
+	return nthreads ? (unsigned)nthreads : 1;
+}
+
 /*
  * util_replica_force_page_allocation - (internal) forces page allocation for
  * replica
+ *
+ * The parts are split between prefault.threads threads (the number of
+ * online CPUs by default, for replicas of at least 64 MiB per thread).
+ * If a thread cannot be created its slice is prefaulted by the calling
+ * thread.
  */
 static void
 util_replica_force_page_allocation(struct pool_replica *rep)
 {
-	volatile char *cur_addr = rep->part[0].addr;
-	char *addr_end = (char *)cur_addr + rep->resvsize;
-	for (; cur_addr < addr_end; cur_addr += Pagesize) {
-		*cur_addr = *cur_addr;
-		VALGRIND_SET_CLEAN(cur_addr, 1);
+	unsigned nthreads = util_prefault_nthreads(rep);
+
+	LOG(3, "rep %p nthreads %u", rep, nthreads);
+
+	struct prefault_arg *args = NULL;
+	os_thread_t *threads = NULL;
+	if (nthreads > 1) {
+		args = Malloc(nthreads * sizeof(*args));
+		threads = Malloc(nthreads * sizeof(*threads));
+		if (args == NULL || threads == NULL) {
+			LOG(2, "!Malloc");
+			Free(args);
+			Free(threads);
+			args = NULL;
+			threads = NULL;
+			nthreads = 1;
+		}
+	}
+
+	if (nthreads == 1) {
+		struct prefault_arg arg = {rep, 0, 1};
+		util_replica_prefault_worker(&arg);
+		return;
+	}
+
+	for (unsigned i = 0; i < nthreads; i++) {
+		args[i].rep = rep;
+		args[i].idx = i;
+		args[i].nthreads = nthreads;
+	}
+
+	/* the calling thread takes the first slice */
+	unsigned created = 1;
+	for (; created < nthreads; created++) {
+		if (os_thread_create(&threads[created], NULL,
+				util_replica_prefault_worker,
+				&args[created]) != 0) {
+			LOG(2, "!os_thread_create");
+			break;
+		}
 	}
+
+	util_replica_prefault_worker(&args[0]);
+
+	/* the slices of the threads which failed to start */
+	for (unsigned i = created; i < nthreads; i++)
+		util_replica_prefault_worker(&args[i]);
+
+	for (unsigned i = 1; i < created; i++)
+		os_thread_join(&threads[i], NULL);
+
+	Free(args);
+	Free(threads);
 }
 
 /*
@@ -1998,27 +2171,162 @@ util_poolset_remote_open(struct pool_replica *rep, unsigned repidx,
 	return 0;
 }
 
+/* maximal number of threads working on the parts of a pool set */
+#define PARTS_MAX_THREADS 16
+
+/* maximal length of the errors logged by one task */
+#define PARTS_ERRLOG_MAX 8192
+
+/*
+ * util_parts_task_worker -- (internal) runs the tasks until none is left
+ */
+static void *
+util_parts_task_worker(void *arg)
+{
+	struct part_tasks *pt = arg;
+	char errlog[PARTS_ERRLOG_MAX];
+
+	unsigned idx;
+	while ((idx = util_fetch_and_add32(&pt->next, 1)) < pt->ntasks) {
+		struct part_task *task = &pt->tasks[idx];
+
+		/* only the errors of the first failed task get logged */
+		out_err_defer(errlog, sizeof(errlog));
+		task->ret = pt->func(task, pt->arg);
+		out_err_defer(NULL, 0);
+
+		if (task->ret) {
+			/* both are thread-local, keep them for the caller */
+			task->oerrno = errno;
+			task->errmsg = Strdup(out_get_errormsg());
+			task->errlog = Strdup(errlog);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * util_parts_run -- (internal) runs func for every task using a pool of
+ *                  threads
+ *
+ * The calling thread takes part in the work, so all the tasks are run even
+ * if no thread can be created. If any task fails, the errno and the error
+ * message of the first failed task are restored in the calling thread and
+ * -1 is returned. Only the errors of that task are logged, as if the tasks
+ * were run one after another.
+ */
+static int
+util_parts_run(struct part_task *tasks, unsigned ntasks,
+	int (*func)(struct part_task *task, void *arg), void *arg)
+{
+	LOG(3, "tasks %p ntasks %u func %p arg %p", tasks, ntasks, func, arg);
+
+	struct part_tasks pt = {tasks, ntasks, 0, func, arg};
+
+	for (unsigned i = 0; i < ntasks; i++) {
+		tasks[i].ret = 0;
+		tasks[i].oerrno = 0;
+		tasks[i].errmsg = NULL;
+		tasks[i].errlog = NULL;
+	}
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned nthreads = cpus > 1 ? (unsigned)cpus : 1;
+	if (nthreads > ntasks)
+		nthreads = ntasks;
+	if (nthreads > PARTS_MAX_THREADS)
+		nthreads = PARTS_MAX_THREADS;
+
+	os_thread_t threads[PARTS_MAX_THREADS];
+	unsigned created = 1;
+	for (; created < nthreads; created++) {
+		if (os_thread_create(&threads[created], NULL,
+				util_parts_task_worker, &pt) != 0) {
+			LOG(2, "!os_thread_create");
+			break;
+		}
+	}
+
+	util_parts_task_worker(&pt);
+
+	for (unsigned i = 1; i < created; i++)
+		os_thread_join(&threads[i], NULL);
+
+	int ret = 0;
+	for (unsigned i = 0; i < ntasks; i++) {
+		if (tasks[i].ret && ret == 0) {
+			if (tasks[i].errmsg && tasks[i].errlog)
+				out_err_restore(tasks[i].errmsg,
+					tasks[i].errlog);
+			errno = tasks[i].oerrno;
+			ret = -1;
+		}
+		Free(tasks[i].errmsg);
+		Free(tasks[i].errlog);
+	}
+
+	return ret;
+}
+
+/*
+ * util_part_open_task -- (internal) opens or creates the part of the task
+ */
+static int
+util_part_open_task(struct part_task *task, void *arg)
+{
+	struct part_open_args *args = arg;
+
+	return util_part_open(task->part, args->minpartsize, args->create);
+}
+
 /*
  * util_poolset_files_local -- (internal) open or create all the local
  *                              part files of a pool set and replica sets
+ *
+ * The parts are opened (and, when created, allocated) by a pool of threads.
  */
 static int
 util_poolset_files_local(struct pool_set *set, size_t minpartsize, int create)
 {
 	LOG(3, "set %p minpartsize %zu create %d", set, minpartsize, create);
 
+	unsigned ntasks = 0;
 	for (unsigned r = 0; r < set->nreplicas; r++) {
 		struct pool_replica *rep = set->replica[r];
-		if (!rep->remote) {
-			for (unsigned p = 0; p < rep->nparts; p++) {
-				if (util_part_open(&rep->part[p], minpartsize,
-						create))
-					return -1;
-			}
+		if (!rep->remote)
+			ntasks += rep->nparts;
+	}
+
+	if (ntasks == 0)
+		return 0;
+
+	struct part_task *tasks = Malloc(ntasks * sizeof(*tasks));
+	if (tasks == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	unsigned t = 0;
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+		if (rep->remote)
+			continue;
+
+		for (unsigned p = 0; p < rep->nparts; p++) {
+			tasks[t].part = &rep->part[p];
+			tasks[t].repidx = r;
+			tasks[t].partidx = p;
+			t++;
 		}
 	}
 
-	return 0;
+	struct part_open_args args = {minpartsize, create};
+	int ret = util_parts_run(tasks, ntasks, util_part_open_task, &args);
+
+	Free(tasks);
+
+	return ret;
 }
 
 /*
@@ -2329,6 +2637,9 @@ util_header_create(struct pool_set *set, unsigned repidx, unsigned partidx,
 
 /*
  * util_header_check -- (internal) validate header of a single pool set file
+ *
+ * The linkage of the parts is not checked here - it is verified by
+ * util_replica_check() once the headers of all the parts are validated.
  */
 static int
 util_header_check(struct pool_set *set, unsigned repidx, unsigned partidx,
@@ -2418,16 +2729,6 @@ util_header_check(struct pool_set *set, unsigned repidx, unsigned partidx,
 		return -1;
 	}
 
-	/* check pool set linkage */
-	if (memcmp(HDRP(rep, partidx)->uuid, hdr.prev_part_uuid,
-						POOL_HDR_UUID_LEN) ||
-	    memcmp(HDRN(rep, partidx)->uuid, hdr.next_part_uuid,
-						POOL_HDR_UUID_LEN)) {
-		ERR("wrong part UUID");
-		errno = EINVAL;
-		return -1;
-	}
-
 	/* check format version */
 	if (HDR(rep, 0)->major != hdrp->major) {
 		ERR("incompatible pool format");
@@ -2752,8 +3053,28 @@ err:
 	return -1;
 }
 
+/*
+ * util_header_create_task -- (internal) creates the header of the part
+ *                            of the task
+ */
+static int
+util_header_create_task(struct part_task *task, void *arg)
+{
+	struct header_create_args *args = arg;
+
+	if (util_header_create(args->set, task->repidx, task->partidx,
+			args->attr, 0) != 0) {
+		LOG(2, "header creation failed - part #%u", task->partidx);
+		return -1;
+	}
+
+	return 0;
+}
+
 /*
  * util_replica_init_headers_local -- (internal) initialize pool headers
+ *
+ * The headers are created, checksummed and persisted by a pool of threads.
  */
 static int
 util_replica_init_headers_local(struct pool_set *set, unsigned repidx,
@@ -2762,6 +3083,7 @@ util_replica_init_headers_local(struct pool_set *set, unsigned repidx,
 	LOG(3, "set %p repidx %u flags %d attr %p", set, repidx, flags, attr);
 
 	struct pool_replica *rep = set->replica[repidx];
+	struct part_task *tasks = NULL;
 
 	/* map all headers - don't care about the address */
 	for (unsigned p = 0; p < rep->nhdrs; p++) {
@@ -2771,14 +3093,26 @@ util_replica_init_headers_local(struct pool_set *set, unsigned repidx,
 		}
 	}
 
-	/* create headers, set UUID's */
+	tasks = Malloc(rep->nhdrs * sizeof(*tasks));
+	if (tasks == NULL) {
+		ERR("!Malloc");
+		goto err;
+	}
+
 	for (unsigned p = 0; p < rep->nhdrs; p++) {
-		if (util_header_create(set, repidx, p, attr, 0) != 0) {
-			LOG(2, "header creation failed - part #%d", p);
-			goto err;
-		}
+		tasks[p].part = &rep->part[p];
+		tasks[p].repidx = repidx;
+		tasks[p].partidx = p;
 	}
 
+	/* create headers, set UUID's */
+	struct header_create_args args = {set, attr};
+	if (util_parts_run(tasks, rep->nhdrs, util_header_create_task,
+			&args) != 0)
+		goto err;
+
+	Free(tasks);
+
 	/* unmap all headers */
 	for (unsigned p = 0; p < rep->nhdrs; p++)
 		util_unmap_hdr(&rep->part[p]);
@@ -2788,6 +3122,7 @@ util_replica_init_headers_local(struct pool_set *set, unsigned repidx,
 err:
 	LOG(4, "error clean up");
 	int oerrno = errno;
+	Free(tasks);
 	for (unsigned p = 0; p < rep->nhdrs; p++) {
 		util_unmap_hdr(&rep->part[p]);
 	}
@@ -3674,8 +4009,40 @@ util_unmap_all_hdrs(struct pool_set *set)
 	}
 }
 
+/*
+ * util_replica_check_task -- (internal) validate the header and read
+ *                            the shutdown state of the part of the task
+ */
+static int
+util_replica_check_task(struct part_task *task, void *arg)
+{
+	struct replica_check_args *args = arg;
+	struct pool_set *set = args->set;
+	struct pool_replica *rep = set->replica[task->repidx];
+	unsigned p = task->partidx;
+
+	if (p < rep->nhdrs &&
+			util_header_check(set, task->repidx, p, args->attr)) {
+		LOG(2, "header check failed - part #%u", p);
+		return -1;
+	}
+
+	if (!set->ignore_sds && !rep->remote && rep->nhdrs) {
+		struct shutdown_state *sds = &args->sds[task - args->tasks];
+		shutdown_state_init(sds, NULL);
+		if (shutdown_state_add_part(sds, PART(rep, p)->path, NULL))
+			return -1;
+	}
+
+	return 0;
+}
+
 /*
  * util_replica_check -- check headers, check UUID's, check replicas linkage
+ *
+ * The headers are validated and the shutdown states of the parts are read
+ * by a pool of threads, the linkage of the parts and replicas is checked
+ * afterwards.
  */
 static int
 util_replica_check(struct pool_set *set, const struct pool_attr *attr)
@@ -3685,12 +4052,57 @@ util_replica_check(struct pool_set *set, const struct pool_attr *attr)
 	/* read shutdown state toggle from header */
 	set->ignore_sds |= IGNORE_SDS(HDR(REP(set, 0), 0));
 
+	unsigned ntasks = 0;
+	for (unsigned r = 0; r < set->nreplicas; r++)
+		ntasks += set->replica[r]->nparts;
+
+	struct part_task *tasks = Malloc(ntasks * sizeof(*tasks));
+	if (tasks == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	struct shutdown_state *sds = Malloc(ntasks * sizeof(*sds));
+	if (sds == NULL) {
+		ERR("!Malloc");
+		Free(tasks);
+		return -1;
+	}
+
+	unsigned t = 0;
+	for (unsigned r = 0; r < set->nreplicas; r++) {
+		struct pool_replica *rep = set->replica[r];
+		for (unsigned p = 0; p < rep->nparts; p++) {
+			tasks[t].part = &rep->part[p];
+			tasks[t].repidx = r;
+			tasks[t].partidx = p;
+			t++;
+		}
+	}
+
+	struct replica_check_args args = {set, attr, tasks, sds};
+	int oerrno;
+	int ret = util_parts_run(tasks, ntasks, util_replica_check_task,
+			&args);
+	if (ret)
+		goto out;
+
+	ret = -1;
+	t = 0;
 	for (unsigned r = 0; r < set->nreplicas; r++) {
 		struct pool_replica *rep = set->replica[r];
 		for (unsigned p = 0; p < rep->nhdrs; p++) {
-			if (util_header_check(set, r, p, attr) != 0) {
-				LOG(2, "header check failed - part #%d", p);
-				return -1;
+			struct pool_hdr *hdrp = HDR(rep, p);
+
+			/* check pool set linkage */
+			if (memcmp(HDRP(rep, p)->uuid, hdrp->prev_part_uuid,
+					POOL_HDR_UUID_LEN) ||
+			    memcmp(HDRN(rep, p)->uuid, hdrp->next_part_uuid,
+					POOL_HDR_UUID_LEN)) {
+				ERR("wrong part UUID");
+				errno = EINVAL;
+				LOG(2, "header check failed - part #%u", p);
+				goto out;
 			}
 			set->rdonly |= rep->part[p].rdonly;
 		}
@@ -3703,30 +4115,36 @@ util_replica_check(struct pool_set *set, const struct pool_attr *attr)
 					POOL_HDR_UUID_LEN)) {
 			ERR("wrong replica UUID");
 			errno = EINVAL;
-			return -1;
+			goto out;
 		}
 		if (!set->ignore_sds && !rep->remote && rep->nhdrs) {
-			struct shutdown_state sds;
-			shutdown_state_init(&sds, NULL);
-			for (unsigned p = 0; p < rep->nparts; p++) {
-				if (shutdown_state_add_part(&sds,
-						PART(rep, p)->path, NULL))
-					return -1;
-			}
+			struct shutdown_state rep_sds;
+			shutdown_state_init(&rep_sds, NULL);
+			for (unsigned p = 0; p < rep->nparts; p++)
+				shutdown_state_merge(&rep_sds, &sds[t + p],
+					NULL);
 
 			ASSERTne(rep->nhdrs, 0);
 			ASSERTne(rep->nparts, 0);
-			if (shutdown_state_check(&sds, &HDR(rep, 0)->sds,
+			if (shutdown_state_check(&rep_sds, &HDR(rep, 0)->sds,
 					rep)) {
 				LOG(2, "ADR failure detected");
 				errno = EINVAL;
-				return -1;
+				goto out;
 			}
 			shutdown_state_set_dirty(&HDR(rep, 0)->sds,
 				rep);
 		}
+		t += rep->nparts;
 	}
-	return 0;
+	ret = 0;
+
+out:
+	oerrno = errno;
+	Free(sds);
+	Free(tasks);
+	errno = oerrno;
+	return ret;
 }
 
 /*
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  * Copyright (c) 2016, Microsoft Corporation. All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -330,6 +330,7 @@ HDRP(struct pool_replica *rep, unsigned p)
 
 extern int Prefault_at_open;
 extern int Prefault_at_create;
+extern int Prefault_threads;
 extern int SDS_at_create;
 extern int Fallocate_at_create;
 extern int COW_at_open;
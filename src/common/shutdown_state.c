@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2019, Intel Corporation
+ * Copyright 2017-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -127,6 +127,26 @@ shutdown_state_add_part(struct shutdown_state *sds, const char *path,
 	return 0;
 }
 
+/*
+ * shutdown_state_merge -- adds file uuids and uscs gathered in part_sds
+ *                         to shutdown_state struct
+ *
+ * It allows the parts to be added to separate structs concurrently
+ * and summed up afterwards.
+ */
+void
+shutdown_state_merge(struct shutdown_state *sds,
+	const struct shutdown_state *part_sds, struct pool_replica *rep)
+{
+	LOG(3, "sds %p, part_sds %p", sds, part_sds);
+
+	sds->usc = htole64(le64toh(sds->usc) + le64toh(part_sds->usc));
+	sds->uuid = htole64(le64toh(sds->uuid) + le64toh(part_sds->uuid));
+
+	FLUSH_SDS(sds, rep);
+	shutdown_state_checksum(sds, rep);
+}
+
 /*
  * shutdown_state_set_dirty -- sets dirty pool flag
  */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2018, Intel Corporation
+ * Copyright 2017-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -55,6 +55,8 @@ struct shutdown_state {
 int shutdown_state_init(struct shutdown_state *sds, struct pool_replica *rep);
 int shutdown_state_add_part(struct shutdown_state *sds, const char *path,
 	struct pool_replica *rep);
+void shutdown_state_merge(struct shutdown_state *sds,
+	const struct shutdown_state *part_sds, struct pool_replica *rep);
 void shutdown_state_set_dirty(struct shutdown_state *sds,
 	struct pool_replica *rep);
 void shutdown_state_clear_dirty(struct shutdown_state *sds,
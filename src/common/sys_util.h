@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2018, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -198,6 +198,36 @@ util_rwlock_destroy(os_rwlock_t *m)
 	}
 }
 
+/*
+ * util_cond_init -- os_cond_init variant that never fails from
+ * caller perspective. If os_cond_init failed, this function aborts
+ * the program.
+ */
+static inline void
+util_cond_init(os_cond_t *cond)
+{
+	int tmp = os_cond_init(cond);
+	if (tmp) {
+		errno = tmp;
+		FATAL("!os_cond_init");
+	}
+}
+
+/*
+ * util_cond_destroy -- os_cond_destroy variant that never fails from
+ * caller perspective. If os_cond_destroy failed, this function aborts
+ * the program.
+ */
+static inline void
+util_cond_destroy(os_cond_t *cond)
+{
+	int tmp = os_cond_destroy(cond);
+	if (tmp) {
+		errno = tmp;
+		FATAL("!os_cond_destroy");
+	}
+}
+
 /*
  * util_spin_init -- os_spin_init variant that logs on fail and sets errno.
  */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2017, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -39,6 +39,12 @@
 
 struct hashmap_args {
 	uint32_t seed;
+
+	/*
+	 * Number of buckets moved to the new table by every operation during
+	 * incremental rehash. If 0, the whole table is rebuilt at once.
+	 */
+	uint32_t rehash_step;
 };
 
 enum hashmap_cmd {
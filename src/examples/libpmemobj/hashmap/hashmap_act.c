@@ -0,0 +1,647 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * integer hash set implementation which uses the action API (reserve/publish)
+ * for inserting and removing entries, no undo log snapshots are taken
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include <libpmemobj.h>
+#include "hashmap_act.h"
+#include "hashmap_internal.h"
+
+/* layout definition */
+TOID_DECLARE(struct buckets, HASHMAP_ACT_TYPE_OFFSET + 1);
+TOID_DECLARE(struct entry, HASHMAP_ACT_TYPE_OFFSET + 2);
+
+/* maximum number of actions published by a single operation */
+#define HASHMAP_ACT_MAX_ACTIONS 6
+
+struct entry {
+	uint64_t key;
+	PMEMoid value;
+
+	/* next entry list pointer */
+	TOID(struct entry) next;
+};
+
+struct buckets {
+	/* number of buckets */
+	size_t nbuckets;
+	/* array of lists */
+	TOID(struct entry) bucket[];
+};
+
+struct hashmap_act {
+	/* random number generator seed */
+	uint32_t seed;
+
+	/* hash function coefficients */
+	uint32_t hash_fun_a;
+	uint32_t hash_fun_b;
+	uint64_t hash_fun_p;
+
+	/* number of values inserted */
+	uint64_t count;
+
+	/* buckets */
+	TOID(struct buckets) buckets;
+
+	/* number of buckets moved by every operation, 0 - rebuild at once */
+	uint64_t rehash_step;
+
+	/* buckets being moved to the new table by incremental rehash */
+	TOID(struct buckets) buckets_old;
+
+	/* index of the next bucket of buckets_old to be moved */
+	uint64_t rehash_idx;
+};
+
+/*
+ * hash -- the simplest hashing function,
+ * see https://en.wikipedia.org/wiki/Universal_hashing#Hashing_integers
+ */
+static uint64_t
+hash(const TOID(struct hashmap_act) *hashmap,
+	const TOID(struct buckets) *buckets, uint64_t value)
+{
+	uint32_t a = D_RO(*hashmap)->hash_fun_a;
+	uint32_t b = D_RO(*hashmap)->hash_fun_b;
+	uint64_t p = D_RO(*hashmap)->hash_fun_p;
+	size_t len = D_RO(*buckets)->nbuckets;
+
+	return ((a * value + b) % p) % len;
+}
+
+/*
+ * set_entry_ptr -- appends actions which atomically (on publish) set the
+ * persistent list pointer to the given entry, returns number of actions used
+ */
+static size_t
+set_entry_ptr(PMEMobjpool *pop, struct pobj_action *actv,
+	TOID(struct entry) *ptr, TOID(struct entry) e)
+{
+	size_t cnt = 0;
+
+	/* pool uuid is the same for all the non-null pointers in the pool */
+	if (ptr->oid.pool_uuid_lo != e.oid.pool_uuid_lo &&
+			!TOID_IS_NULL(e))
+		pmemobj_set_value(pop, &actv[cnt++], &ptr->oid.pool_uuid_lo,
+			e.oid.pool_uuid_lo);
+
+	pmemobj_set_value(pop, &actv[cnt++], &ptr->oid.off, e.oid.off);
+
+	return cnt;
+}
+
+/*
+ * find_bucket -- returns the table and the index of the bucket which holds
+ * the given key
+ *
+ * During incremental rehash a key belongs to the old table until its bucket
+ * is moved to the new one.
+ */
+static uint64_t
+find_bucket(const TOID(struct hashmap_act) *hashmap, uint64_t key,
+	TOID(struct buckets) *buckets)
+{
+	TOID(struct buckets) buckets_old = D_RO(*hashmap)->buckets_old;
+	if (!TOID_IS_NULL(buckets_old)) {
+		uint64_t h = hash(hashmap, &buckets_old, key);
+		if (h >= D_RO(*hashmap)->rehash_idx) {
+			*buckets = buckets_old;
+			return h;
+		}
+	}
+
+	*buckets = D_RO(*hashmap)->buckets;
+	return hash(hashmap, buckets, key);
+}
+
+/*
+ * hm_act_rehash_step -- moves at most nbuckets buckets (all of them if 0)
+ * of the old table to the new one and frees the old table once all of its
+ * buckets are moved
+ *
+ * The head pointers of the moved buckets of the old table are not modified,
+ * they are never read again, so the transaction snapshots only the relinked
+ * entries, the heads of the new table and the rehash cursor. The progress is
+ * persistent, an interrupted rehash is simply continued after the pool
+ * is reopened.
+ */
+static void
+hm_act_rehash_step(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+	size_t nbuckets)
+{
+	TOID(struct buckets) buckets_old = D_RO(hashmap)->buckets_old;
+	if (TOID_IS_NULL(buckets_old))
+		return;
+
+	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	size_t len_old = D_RO(buckets_old)->nbuckets;
+	size_t first = D_RO(hashmap)->rehash_idx;
+	size_t last = len_old;
+	if (nbuckets != 0 && len_old - first > nbuckets)
+		last = first + nbuckets;
+
+	TX_BEGIN(pop) {
+		TX_ADD_FIELD(hashmap, rehash_idx);
+
+		for (size_t i = first; i < last; ++i) {
+			TOID(struct entry) en = D_RO(buckets_old)->bucket[i];
+			while (!TOID_IS_NULL(en)) {
+				TOID(struct entry) next = D_RO(en)->next;
+				uint64_t h = hash(&hashmap, &buckets,
+						D_RO(en)->key);
+
+				TX_ADD_FIELD(en, next);
+				TX_ADD_FIELD(buckets, bucket[h]);
+				D_RW(en)->next = D_RO(buckets)->bucket[h];
+				D_RW(buckets)->bucket[h] = en;
+
+				en = next;
+			}
+		}
+
+		if (last == len_old) {
+			TX_ADD_FIELD(hashmap, buckets_old);
+			D_RW(hashmap)->buckets_old = TOID_NULL(struct buckets);
+			D_RW(hashmap)->rehash_idx = 0;
+			TX_FREE(buckets_old);
+		} else {
+			D_RW(hashmap)->rehash_idx = last;
+		}
+	} TX_ONABORT {
+		fprintf(stderr, "%s: transaction aborted: %s\n", __func__,
+			pmemobj_errormsg());
+	} TX_END
+}
+
+/*
+ * hm_act_rebuild -- rebuilds the hashmap with a new number of buckets
+ *
+ * Moving all the entries between the lists requires modification of
+ * an arbitrary number of persistent pointers, which does not fit in a single
+ * redo log, so the rebuild (and every step of the incremental rehash) is done
+ * in a transaction.
+ *
+ * If the incremental rehash is enabled, only the new table is allocated here
+ * and the entries are moved by the subsequent operations.
+ */
+static void
+hm_act_rebuild(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+	size_t new_len)
+{
+	/* finish the rehash which is already in progress */
+	hm_act_rehash_step(pop, hashmap, 0);
+
+	TOID(struct buckets) buckets_old = D_RO(hashmap)->buckets;
+
+	if (new_len == 0)
+		new_len = D_RO(buckets_old)->nbuckets;
+
+	size_t sz_old = sizeof(struct buckets) +
+			D_RO(buckets_old)->nbuckets *
+			sizeof(TOID(struct entry));
+	size_t sz_new = sizeof(struct buckets) +
+			new_len * sizeof(TOID(struct entry));
+
+	TX_BEGIN(pop) {
+		TX_ADD_FIELD(hashmap, buckets);
+		TOID(struct buckets) buckets_new =
+				TX_ZALLOC(struct buckets, sz_new);
+		D_RW(buckets_new)->nbuckets = new_len;
+
+		if (D_RO(hashmap)->rehash_step != 0) {
+			TX_ADD_FIELD(hashmap, buckets_old);
+			TX_ADD_FIELD(hashmap, rehash_idx);
+			D_RW(hashmap)->buckets_old = buckets_old;
+			D_RW(hashmap)->rehash_idx = 0;
+			D_RW(hashmap)->buckets = buckets_new;
+		} else {
+			pmemobj_tx_add_range(buckets_old.oid, 0, sz_old);
+
+			for (size_t i = 0; i < D_RO(buckets_old)->nbuckets;
+					++i) {
+				while (!TOID_IS_NULL(
+						D_RO(buckets_old)->bucket[i])) {
+					TOID(struct entry) en =
+						D_RO(buckets_old)->bucket[i];
+					uint64_t h = hash(&hashmap,
+						&buckets_new, D_RO(en)->key);
+
+					D_RW(buckets_old)->bucket[i] =
+						D_RO(en)->next;
+
+					TX_ADD_FIELD(en, next);
+					D_RW(en)->next =
+						D_RO(buckets_new)->bucket[h];
+					D_RW(buckets_new)->bucket[h] = en;
+				}
+			}
+
+			D_RW(hashmap)->buckets = buckets_new;
+			TX_FREE(buckets_old);
+		}
+	} TX_ONABORT {
+		fprintf(stderr, "%s: transaction aborted: %s\n", __func__,
+			pmemobj_errormsg());
+		/*
+		 * We don't need to do anything here, because everything is
+		 * consistent. The only thing affected is performance.
+		 */
+	} TX_END
+}
+
+/*
+ * hm_act_insert -- inserts specified value into the hashmap,
+ * returns:
+ * - 0 if successful,
+ * - 1 if value already existed,
+ * - -1 if something bad happened
+ *
+ * The new entry is reserved, initialized and persisted outside of the pool's
+ * visible state, then the allocation, the bucket pointer and the counter are
+ * published together in a single redo log.
+ */
+int
+hm_act_insert(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+	uint64_t key, PMEMoid value)
+{
+	hm_act_rehash_step(pop, hashmap, D_RO(hashmap)->rehash_step);
+
+	TOID(struct buckets) buckets;
+	TOID(struct entry) var;
+
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
+	int num = 0;
+
+	for (var = D_RO(buckets)->bucket[h];
+			!TOID_IS_NULL(var);
+			var = D_RO(var)->next) {
+		if (D_RO(var)->key == key)
+			return 1;
+		num++;
+	}
+
+	struct pobj_action actv[HASHMAP_ACT_MAX_ACTIONS];
+	size_t actv_cnt = 0;
+
+	TOID(struct entry) e = POBJ_RESERVE_NEW(pop, struct entry,
+		&actv[actv_cnt]);
+	if (TOID_IS_NULL(e)) {
+		fprintf(stderr, "reserve failed: %s\n", pmemobj_errormsg());
+		return -1;
+	}
+	actv_cnt++;
+
+	D_RW(e)->key = key;
+	D_RW(e)->value = value;
+	D_RW(e)->next = D_RO(buckets)->bucket[h];
+	pmemobj_persist(pop, D_RW(e), sizeof(struct entry));
+
+	actv_cnt += set_entry_ptr(pop, &actv[actv_cnt],
+		&D_RW(buckets)->bucket[h], e);
+	pmemobj_set_value(pop, &actv[actv_cnt++], &D_RW(hashmap)->count,
+		D_RO(hashmap)->count + 1);
+
+	if (pmemobj_publish(pop, actv, actv_cnt)) {
+		fprintf(stderr, "publish failed: %s\n", pmemobj_errormsg());
+		pmemobj_cancel(pop, actv, actv_cnt);
+		return -1;
+	}
+	num++;
+
+	/* don't start a new rehash until the current one is finished */
+	if (!TOID_IS_NULL(D_RO(hashmap)->buckets_old))
+		return 0;
+
+	if (num > MAX_HASHSET_THRESHOLD ||
+			(num > MIN_HASHSET_THRESHOLD &&
+			D_RO(hashmap)->count > 2 * D_RO(buckets)->nbuckets))
+		hm_act_rebuild(pop, hashmap, D_RO(buckets)->nbuckets * 2);
+
+	return 0;
+}
+
+/*
+ * hm_act_remove -- removes specified value from the hashmap,
+ * returns:
+ * - key's value if successful,
+ * - OID_NULL if value didn't exist or if something bad happened
+ *
+ * Unlinking of the entry, its deallocation and the counter update are
+ * published together in a single redo log.
+ */
+PMEMoid
+hm_act_remove(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+	uint64_t key)
+{
+	hm_act_rehash_step(pop, hashmap, D_RO(hashmap)->rehash_step);
+
+	TOID(struct buckets) buckets;
+	TOID(struct entry) var, prev = TOID_NULL(struct entry);
+
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
+	for (var = D_RO(buckets)->bucket[h];
+			!TOID_IS_NULL(var);
+			prev = var, var = D_RO(var)->next) {
+		if (D_RO(var)->key == key)
+			break;
+	}
+
+	if (TOID_IS_NULL(var))
+		return OID_NULL;
+
+	struct pobj_action actv[HASHMAP_ACT_MAX_ACTIONS];
+	size_t actv_cnt = 0;
+
+	TOID(struct entry) *ptr = TOID_IS_NULL(prev) ?
+		&D_RW(buckets)->bucket[h] : &D_RW(prev)->next;
+
+	actv_cnt += set_entry_ptr(pop, &actv[actv_cnt], ptr, D_RO(var)->next);
+	pmemobj_set_value(pop, &actv[actv_cnt++], &D_RW(hashmap)->count,
+		D_RO(hashmap)->count - 1);
+	pmemobj_defer_free(pop, var.oid, &actv[actv_cnt++]);
+
+	PMEMoid retoid = D_RO(var)->value;
+	if (pmemobj_publish(pop, actv, actv_cnt)) {
+		fprintf(stderr, "publish failed: %s\n", pmemobj_errormsg());
+		pmemobj_cancel(pop, actv, actv_cnt);
+		return OID_NULL;
+	}
+
+	if (!TOID_IS_NULL(D_RO(hashmap)->buckets_old))
+		return retoid;
+
+	if (D_RO(hashmap)->count < D_RO(buckets)->nbuckets)
+		hm_act_rebuild(pop, hashmap, D_RO(buckets)->nbuckets / 2);
+
+	return retoid;
+}
+
+/*
+ * hm_act_foreach -- prints all values from the hashmap
+ */
+int
+hm_act_foreach(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	TOID(struct entry) var;
+
+	int ret = 0;
+	for (size_t i = 0; i < D_RO(buckets)->nbuckets; ++i) {
+		if (TOID_IS_NULL(D_RO(buckets)->bucket[i]))
+			continue;
+
+		for (var = D_RO(buckets)->bucket[i]; !TOID_IS_NULL(var);
+				var = D_RO(var)->next) {
+			ret = cb(D_RO(var)->key, D_RO(var)->value, arg);
+			if (ret)
+				break;
+		}
+	}
+
+	/* buckets of the old table which were not moved yet */
+	buckets = D_RO(hashmap)->buckets_old;
+	if (ret || TOID_IS_NULL(buckets))
+		return ret;
+
+	for (size_t i = D_RO(hashmap)->rehash_idx;
+			i < D_RO(buckets)->nbuckets; ++i) {
+		for (var = D_RO(buckets)->bucket[i]; !TOID_IS_NULL(var);
+				var = D_RO(var)->next) {
+			ret = cb(D_RO(var)->key, D_RO(var)->value, arg);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * hm_act_debug -- prints complete hashmap state
+ */
+static void
+hm_act_debug(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap, FILE *out)
+{
+	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	TOID(struct entry) var;
+
+	fprintf(out, "a: %u b: %u p: %" PRIu64 "\n", D_RO(hashmap)->hash_fun_a,
+		D_RO(hashmap)->hash_fun_b, D_RO(hashmap)->hash_fun_p);
+	fprintf(out, "count: %" PRIu64 ", buckets: %zu\n",
+		D_RO(hashmap)->count, D_RO(buckets)->nbuckets);
+	if (!TOID_IS_NULL(D_RO(hashmap)->buckets_old))
+		fprintf(out, "rehash: %" PRIu64 "/%zu\n",
+			D_RO(hashmap)->rehash_idx,
+			D_RO(D_RO(hashmap)->buckets_old)->nbuckets);
+
+	for (size_t i = 0; i < D_RO(buckets)->nbuckets; ++i) {
+		if (TOID_IS_NULL(D_RO(buckets)->bucket[i]))
+			continue;
+
+		int num = 0;
+		fprintf(out, "%zu: ", i);
+		for (var = D_RO(buckets)->bucket[i]; !TOID_IS_NULL(var);
+				var = D_RO(var)->next) {
+			fprintf(out, "%" PRIu64 " ", D_RO(var)->key);
+			num++;
+		}
+		fprintf(out, "(%d)\n", num);
+	}
+}
+
+/*
+ * hm_act_get -- checks whether specified value is in the hashmap
+ */
+PMEMoid
+hm_act_get(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap, uint64_t key)
+{
+	hm_act_rehash_step(pop, hashmap, D_RO(hashmap)->rehash_step);
+
+	TOID(struct buckets) buckets;
+	TOID(struct entry) var;
+
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
+
+	for (var = D_RO(buckets)->bucket[h];
+			!TOID_IS_NULL(var);
+			var = D_RO(var)->next)
+		if (D_RO(var)->key == key)
+			return D_RO(var)->value;
+
+	return OID_NULL;
+}
+
+/*
+ * hm_act_lookup -- checks whether specified value exists
+ */
+int
+hm_act_lookup(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+	uint64_t key)
+{
+	hm_act_rehash_step(pop, hashmap, D_RO(hashmap)->rehash_step);
+
+	TOID(struct buckets) buckets;
+	TOID(struct entry) var;
+
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
+
+	for (var = D_RO(buckets)->bucket[h];
+			!TOID_IS_NULL(var);
+			var = D_RO(var)->next)
+		if (D_RO(var)->key == key)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * hm_act_count -- returns number of elements
+ */
+size_t
+hm_act_count(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap)
+{
+	return D_RO(hashmap)->count;
+}
+
+/*
+ * hm_act_init -- recovers hashmap state, called after pmemobj_open
+ */
+int
+hm_act_init(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap)
+{
+	srand(D_RO(hashmap)->seed);
+	return 0;
+}
+
+/*
+ * hm_act_create -- allocates new hashmap
+ */
+int
+hm_act_create(PMEMobjpool *pop, TOID(struct hashmap_act) *map, void *arg)
+{
+	struct hashmap_args *args = (struct hashmap_args *)arg;
+	struct pobj_action actv[HASHMAP_ACT_MAX_ACTIONS];
+	size_t actv_cnt = 0;
+
+	TOID(struct hashmap_act) hashmap =
+		POBJ_RESERVE_NEW(pop, struct hashmap_act, &actv[actv_cnt]);
+	if (TOID_IS_NULL(hashmap))
+		goto reserve_err;
+	actv_cnt++;
+
+	size_t len = INIT_BUCKETS_NUM;
+	size_t sz = sizeof(struct buckets) +
+			len * sizeof(TOID(struct entry));
+
+	TOID(struct buckets) buckets = POBJ_XRESERVE_ALLOC(pop, struct buckets,
+		sz, &actv[actv_cnt], POBJ_XALLOC_ZERO);
+	if (TOID_IS_NULL(buckets))
+		goto reserve_err;
+	actv_cnt++;
+
+	D_RW(buckets)->nbuckets = len;
+	pmemobj_persist(pop, &D_RW(buckets)->nbuckets,
+		sizeof(D_RW(buckets)->nbuckets));
+
+	struct hashmap_act *h = D_RW(hashmap);
+	h->seed = args ? args->seed : 0;
+	do {
+		h->hash_fun_a = (uint32_t)rand();
+	} while (h->hash_fun_a == 0);
+	h->hash_fun_b = (uint32_t)rand();
+	h->hash_fun_p = HASH_FUNC_COEFF_P;
+	h->count = 0;
+	h->buckets = buckets;
+	h->rehash_step = args ? args->rehash_step : 0;
+	h->buckets_old = TOID_NULL(struct buckets);
+	h->rehash_idx = 0;
+	pmemobj_persist(pop, h, sizeof(*h));
+
+	pmemobj_set_value(pop, &actv[actv_cnt++], &map->oid.pool_uuid_lo,
+		hashmap.oid.pool_uuid_lo);
+	pmemobj_set_value(pop, &actv[actv_cnt++], &map->oid.off,
+		hashmap.oid.off);
+
+	if (pmemobj_publish(pop, actv, actv_cnt)) {
+		fprintf(stderr, "publish failed: %s\n", pmemobj_errormsg());
+		pmemobj_cancel(pop, actv, actv_cnt);
+		return -1;
+	}
+
+	return 0;
+
+reserve_err:
+	fprintf(stderr, "hashmap alloc failed: %s\n", pmemobj_errormsg());
+	pmemobj_cancel(pop, actv, actv_cnt);
+	return -1;
+}
+
+/*
+ * hm_act_check -- checks if specified persistent object is an
+ * instance of hashmap
+ */
+int
+hm_act_check(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap)
+{
+	return TOID_IS_NULL(hashmap) || !TOID_VALID(hashmap);
+}
+
+/*
+ * hm_act_cmd -- execute cmd for hashmap
+ */
+int
+hm_act_cmd(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+		unsigned cmd, uint64_t arg)
+{
+	switch (cmd) {
+		case HASHMAP_CMD_REBUILD:
+			hm_act_rebuild(pop, hashmap, arg);
+			return 0;
+		case HASHMAP_CMD_DEBUG:
+			if (!arg)
+				return -EINVAL;
+			hm_act_debug(pop, hashmap, (FILE *)arg);
+			return 0;
+		default:
+			return -EINVAL;
+	}
+}
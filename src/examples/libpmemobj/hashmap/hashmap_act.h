@@ -0,0 +1,64 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef HASHMAP_ACT_H
+#define HASHMAP_ACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <hashmap.h>
+#include <libpmemobj.h>
+
+#ifndef HASHMAP_ACT_TYPE_OFFSET
+#define HASHMAP_ACT_TYPE_OFFSET 1024
+#endif
+
+struct hashmap_act;
+TOID_DECLARE(struct hashmap_act, HASHMAP_ACT_TYPE_OFFSET + 0);
+
+int hm_act_check(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap);
+int hm_act_create(PMEMobjpool *pop, TOID(struct hashmap_act) *map, void *arg);
+int hm_act_init(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap);
+int hm_act_insert(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+		uint64_t key, PMEMoid value);
+PMEMoid hm_act_remove(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+		uint64_t key);
+PMEMoid hm_act_get(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+		uint64_t key);
+int hm_act_lookup(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+		uint64_t key);
+int hm_act_foreach(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg);
+size_t hm_act_count(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap);
+int hm_act_cmd(PMEMobjpool *pop, TOID(struct hashmap_act) hashmap,
+		unsigned cmd, uint64_t arg);
+
+#endif /* HASHMAP_ACT_H */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2019, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -44,6 +44,7 @@
 /* layout definition */
 TOID_DECLARE(struct buckets, HASHMAP_TX_TYPE_OFFSET + 1);
 TOID_DECLARE(struct entry, HASHMAP_TX_TYPE_OFFSET + 2);
+TOID_DECLARE(struct hashmap_tx_rehash, HASHMAP_TX_TYPE_OFFSET + 3);
 
 struct entry {
 	uint64_t key;
@@ -74,13 +75,63 @@ struct hashmap_tx {
 
 	/* buckets */
 	TOID(struct buckets) buckets;
+
+	/*
+	 * incremental rehash state, null - rebuild at once
+	 *
+	 * The hashmaps created before the incremental rehash was added end
+	 * before this field, see hm_tx_rehash_state().
+	 */
+	TOID(struct hashmap_tx_rehash) rehash;
+};
+
+struct hashmap_tx_rehash {
+	/* number of buckets moved by every operation */
+	uint64_t step;
+
+	/* buckets being moved to the new table */
+	TOID(struct buckets) buckets_old;
+
+	/* index of the next bucket of buckets_old to be moved */
+	uint64_t idx;
 };
 
+/*
+ * hm_tx_rehash_state -- returns the incremental rehash state of the hashmap
+ *
+ * The object of a hashmap created before the rehash field was added is too
+ * small to hold it, such a hashmap is always rebuilt at once. The rest of
+ * the object is zeroed by the allocator, so the field reads as null.
+ */
+static TOID(struct hashmap_tx_rehash)
+hm_tx_rehash_state(TOID(struct hashmap_tx) hashmap)
+{
+	if (pmemobj_alloc_usable_size(hashmap.oid) < sizeof(struct hashmap_tx))
+		return TOID_NULL(struct hashmap_tx_rehash);
+
+	return D_RO(hashmap)->rehash;
+}
+
+/*
+ * hm_tx_buckets_old -- returns the table being moved by the incremental
+ * rehash, null if there is none
+ */
+static TOID(struct buckets)
+hm_tx_buckets_old(TOID(struct hashmap_tx) hashmap)
+{
+	TOID(struct hashmap_tx_rehash) rehash = hm_tx_rehash_state(hashmap);
+	if (TOID_IS_NULL(rehash))
+		return TOID_NULL(struct buckets);
+
+	return D_RO(rehash)->buckets_old;
+}
+
 /*
  * create_hashmap -- hashmap initializer
  */
 static void
-create_hashmap(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint32_t seed)
+create_hashmap(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap,
+	uint32_t seed, uint32_t rehash_step)
 {
 	size_t len = INIT_BUCKETS_NUM;
 	size_t sz = sizeof(struct buckets) +
@@ -95,6 +146,11 @@ create_hashmap(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint32_t seed)
 		} while (D_RW(hashmap)->hash_fun_a == 0);
 		D_RW(hashmap)->hash_fun_b = (uint32_t)rand();
 		D_RW(hashmap)->hash_fun_p = HASH_FUNC_COEFF_P;
+		if (rehash_step != 0) {
+			D_RW(hashmap)->rehash =
+				TX_ZNEW(struct hashmap_tx_rehash);
+			D_RW(D_RW(hashmap)->rehash)->step = rehash_step;
+		}
 
 		D_RW(hashmap)->buckets = TX_ZALLOC(struct buckets, sz);
 		D_RW(D_RW(hashmap)->buckets)->nbuckets = len;
@@ -121,12 +177,104 @@ hash(const TOID(struct hashmap_tx) *hashmap,
 	return ((a * value + b) % p) % len;
 }
 
+/*
+ * find_bucket -- returns the table and the index of the bucket which holds
+ * the given key
+ *
+ * During incremental rehash a key belongs to the old table until its bucket
+ * is moved to the new one.
+ */
+static uint64_t
+find_bucket(const TOID(struct hashmap_tx) *hashmap, uint64_t key,
+	TOID(struct buckets) *buckets)
+{
+	TOID(struct buckets) buckets_old = hm_tx_buckets_old(*hashmap);
+	if (!TOID_IS_NULL(buckets_old)) {
+		uint64_t h = hash(hashmap, &buckets_old, key);
+		if (h >= D_RO(D_RO(*hashmap)->rehash)->idx) {
+			*buckets = buckets_old;
+			return h;
+		}
+	}
+
+	*buckets = D_RO(*hashmap)->buckets;
+	return hash(hashmap, buckets, key);
+}
+
+/*
+ * hm_tx_rehash_step -- moves the configured number of buckets (all of them
+ * if finish is set) of the old table to the new one and frees the old table
+ * once all of its buckets are moved
+ *
+ * The head pointers of the moved buckets of the old table are not modified,
+ * they are never read again, so the transaction snapshots only the relinked
+ * entries, the heads of the new table and the rehash cursor. The progress is
+ * persistent, an interrupted rehash is simply continued after the pool
+ * is reopened.
+ */
+static void
+hm_tx_rehash_step(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap,
+	int finish)
+{
+	TOID(struct buckets) buckets_old = hm_tx_buckets_old(hashmap);
+	if (TOID_IS_NULL(buckets_old))
+		return;
+
+	TOID(struct hashmap_tx_rehash) rehash = D_RO(hashmap)->rehash;
+	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	size_t nbuckets = D_RO(rehash)->step;
+	size_t len_old = D_RO(buckets_old)->nbuckets;
+	size_t first = D_RO(rehash)->idx;
+	size_t last = len_old;
+	if (!finish && len_old - first > nbuckets)
+		last = first + nbuckets;
+
+	TX_BEGIN(pop) {
+		TX_ADD_FIELD(rehash, idx);
+
+		for (size_t i = first; i < last; ++i) {
+			TOID(struct entry) en = D_RO(buckets_old)->bucket[i];
+			while (!TOID_IS_NULL(en)) {
+				TOID(struct entry) next = D_RO(en)->next;
+				uint64_t h = hash(&hashmap, &buckets,
+						D_RO(en)->key);
+
+				TX_ADD_FIELD(en, next);
+				TX_ADD_FIELD(buckets, bucket[h]);
+				D_RW(en)->next = D_RO(buckets)->bucket[h];
+				D_RW(buckets)->bucket[h] = en;
+
+				en = next;
+			}
+		}
+
+		if (last == len_old) {
+			TX_ADD_FIELD(rehash, buckets_old);
+			D_RW(rehash)->buckets_old = TOID_NULL(struct buckets);
+			D_RW(rehash)->idx = 0;
+			TX_FREE(buckets_old);
+		} else {
+			D_RW(rehash)->idx = last;
+		}
+	} TX_ONABORT {
+		fprintf(stderr, "%s: transaction aborted: %s\n", __func__,
+			pmemobj_errormsg());
+	} TX_END
+}
+
 /*
  * hm_tx_rebuild -- rebuilds the hashmap with a new number of buckets
+ *
+ * If the incremental rehash is enabled, only the new table is allocated here
+ * and the entries are moved by the subsequent operations.
  */
 static void
 hm_tx_rebuild(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, size_t new_len)
 {
+	/* finish the rehash which is already in progress */
+	hm_tx_rehash_step(pop, hashmap, 1);
+
+	TOID(struct hashmap_tx_rehash) rehash = hm_tx_rehash_state(hashmap);
 	TOID(struct buckets) buckets_old = D_RO(hashmap)->buckets;
 
 	if (new_len == 0)
@@ -143,25 +291,38 @@ hm_tx_rebuild(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, size_t new_len)
 		TOID(struct buckets) buckets_new =
 				TX_ZALLOC(struct buckets, sz_new);
 		D_RW(buckets_new)->nbuckets = new_len;
-		pmemobj_tx_add_range(buckets_old.oid, 0, sz_old);
-
-		for (size_t i = 0; i < D_RO(buckets_old)->nbuckets; ++i) {
-			while (!TOID_IS_NULL(D_RO(buckets_old)->bucket[i])) {
-				TOID(struct entry) en =
-					D_RO(buckets_old)->bucket[i];
-				uint64_t h = hash(&hashmap, &buckets_new,
-						D_RO(en)->key);
-
-				D_RW(buckets_old)->bucket[i] = D_RO(en)->next;
 
-				TX_ADD_FIELD(en, next);
-				D_RW(en)->next = D_RO(buckets_new)->bucket[h];
-				D_RW(buckets_new)->bucket[h] = en;
+		if (!TOID_IS_NULL(rehash)) {
+			TX_ADD_FIELD(rehash, buckets_old);
+			TX_ADD_FIELD(rehash, idx);
+			D_RW(rehash)->buckets_old = buckets_old;
+			D_RW(rehash)->idx = 0;
+			D_RW(hashmap)->buckets = buckets_new;
+		} else {
+			pmemobj_tx_add_range(buckets_old.oid, 0, sz_old);
+
+			for (size_t i = 0; i < D_RO(buckets_old)->nbuckets;
+					++i) {
+				while (!TOID_IS_NULL(
+						D_RO(buckets_old)->bucket[i])) {
+					TOID(struct entry) en =
+						D_RO(buckets_old)->bucket[i];
+					uint64_t h = hash(&hashmap,
+						&buckets_new, D_RO(en)->key);
+
+					D_RW(buckets_old)->bucket[i] =
+						D_RO(en)->next;
+
+					TX_ADD_FIELD(en, next);
+					D_RW(en)->next =
+						D_RO(buckets_new)->bucket[h];
+					D_RW(buckets_new)->bucket[h] = en;
+				}
 			}
-		}
 
-		D_RW(hashmap)->buckets = buckets_new;
-		TX_FREE(buckets_old);
+			D_RW(hashmap)->buckets = buckets_new;
+			TX_FREE(buckets_old);
+		}
 	} TX_ONABORT {
 		fprintf(stderr, "%s: transaction aborted: %s\n", __func__,
 			pmemobj_errormsg());
@@ -184,10 +345,12 @@ int
 hm_tx_insert(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap,
 	uint64_t key, PMEMoid value)
 {
-	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	hm_tx_rehash_step(pop, hashmap, 0);
+
+	TOID(struct buckets) buckets;
 	TOID(struct entry) var;
 
-	uint64_t h = hash(&hashmap, &buckets, key);
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
 	int num = 0;
 
 	for (var = D_RO(buckets)->bucket[h];
@@ -200,7 +363,7 @@ hm_tx_insert(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap,
 
 	int ret = 0;
 	TX_BEGIN(pop) {
-		TX_ADD_FIELD(D_RO(hashmap)->buckets, bucket[h]);
+		TX_ADD_FIELD(buckets, bucket[h]);
 		TX_ADD_FIELD(hashmap, count);
 
 		TOID(struct entry) e = TX_NEW(struct entry);
@@ -220,6 +383,10 @@ hm_tx_insert(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap,
 	if (ret)
 		return ret;
 
+	/* don't start a new rehash until the current one is finished */
+	if (!TOID_IS_NULL(hm_tx_buckets_old(hashmap)))
+		return 0;
+
 	if (num > MAX_HASHSET_THRESHOLD ||
 			(num > MIN_HASHSET_THRESHOLD &&
 			D_RO(hashmap)->count > 2 * D_RO(buckets)->nbuckets))
@@ -237,10 +404,12 @@ hm_tx_insert(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap,
 PMEMoid
 hm_tx_remove(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint64_t key)
 {
-	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	hm_tx_rehash_step(pop, hashmap, 0);
+
+	TOID(struct buckets) buckets;
 	TOID(struct entry) var, prev = TOID_NULL(struct entry);
 
-	uint64_t h = hash(&hashmap, &buckets, key);
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
 	for (var = D_RO(buckets)->bucket[h];
 			!TOID_IS_NULL(var);
 			prev = var, var = D_RO(var)->next) {
@@ -255,7 +424,7 @@ hm_tx_remove(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint64_t key)
 	PMEMoid retoid = D_RO(var)->value;
 	TX_BEGIN(pop) {
 		if (TOID_IS_NULL(prev))
-			TX_ADD_FIELD(D_RO(hashmap)->buckets, bucket[h]);
+			TX_ADD_FIELD(buckets, bucket[h]);
 		else
 			TX_ADD_FIELD(prev, next);
 		TX_ADD_FIELD(hashmap, count);
@@ -275,6 +444,9 @@ hm_tx_remove(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint64_t key)
 	if (ret)
 		return OID_NULL;
 
+	if (!TOID_IS_NULL(hm_tx_buckets_old(hashmap)))
+		return retoid;
+
 	if (D_RO(hashmap)->count < D_RO(buckets)->nbuckets)
 		hm_tx_rebuild(pop, hashmap, D_RO(buckets)->nbuckets / 2);
 
@@ -304,6 +476,21 @@ hm_tx_foreach(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap,
 		}
 	}
 
+	/* buckets of the old table which were not moved yet */
+	buckets = hm_tx_buckets_old(hashmap);
+	if (ret || TOID_IS_NULL(buckets))
+		return ret;
+
+	for (size_t i = D_RO(D_RO(hashmap)->rehash)->idx;
+			i < D_RO(buckets)->nbuckets; ++i) {
+		for (var = D_RO(buckets)->bucket[i]; !TOID_IS_NULL(var);
+				var = D_RO(var)->next) {
+			ret = cb(D_RO(var)->key, D_RO(var)->value, arg);
+			if (ret)
+				return ret;
+		}
+	}
+
 	return ret;
 }
 
@@ -320,6 +507,10 @@ hm_tx_debug(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, FILE *out)
 		D_RO(hashmap)->hash_fun_b, D_RO(hashmap)->hash_fun_p);
 	fprintf(out, "count: %" PRIu64 ", buckets: %zu\n",
 		D_RO(hashmap)->count, D_RO(buckets)->nbuckets);
+	if (!TOID_IS_NULL(hm_tx_buckets_old(hashmap)))
+		fprintf(out, "rehash: %" PRIu64 "/%zu\n",
+			D_RO(D_RO(hashmap)->rehash)->idx,
+			D_RO(hm_tx_buckets_old(hashmap))->nbuckets);
 
 	for (size_t i = 0; i < D_RO(buckets)->nbuckets; ++i) {
 		if (TOID_IS_NULL(D_RO(buckets)->bucket[i]))
@@ -342,10 +533,12 @@ hm_tx_debug(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, FILE *out)
 PMEMoid
 hm_tx_get(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint64_t key)
 {
-	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	hm_tx_rehash_step(pop, hashmap, 0);
+
+	TOID(struct buckets) buckets;
 	TOID(struct entry) var;
 
-	uint64_t h = hash(&hashmap, &buckets, key);
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
 
 	for (var = D_RO(buckets)->bucket[h];
 			!TOID_IS_NULL(var);
@@ -362,10 +555,12 @@ hm_tx_get(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint64_t key)
 int
 hm_tx_lookup(PMEMobjpool *pop, TOID(struct hashmap_tx) hashmap, uint64_t key)
 {
-	TOID(struct buckets) buckets = D_RO(hashmap)->buckets;
+	hm_tx_rehash_step(pop, hashmap, 0);
+
+	TOID(struct buckets) buckets;
 	TOID(struct entry) var;
 
-	uint64_t h = hash(&hashmap, &buckets, key);
+	uint64_t h = find_bucket(&hashmap, key, &buckets);
 
 	for (var = D_RO(buckets)->bucket[h];
 			!TOID_IS_NULL(var);
@@ -408,7 +603,8 @@ hm_tx_create(PMEMobjpool *pop, TOID(struct hashmap_tx) *map, void *arg)
 		*map = TX_ZNEW(struct hashmap_tx);
 
 		uint32_t seed = args ? args->seed : 0;
-		create_hashmap(pop, *map, seed);
+		uint32_t rehash_step = args ? args->rehash_step : 0;
+		create_hashmap(pop, *map, seed, rehash_step);
 	} TX_ONABORT {
 		ret = -1;
 	} TX_END
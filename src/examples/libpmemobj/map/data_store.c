@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2018, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -45,9 +45,11 @@
 #include "map_ctree.h"
 #include "map_btree.h"
 #include "map_rbtree.h"
+#include "map_art.h"
 #include "map_hashmap_atomic.h"
 #include "map_hashmap_tx.h"
 #include "map_hashmap_rp.h"
+#include "map_hashmap_act.h"
 #include "map_skiplist.h"
 
 POBJ_LAYOUT_BEGIN(data_store);
@@ -113,12 +115,16 @@ parse_map_type(const char *type)
 		return MAP_BTREE;
 	else if (strcmp(type, "rbtree") == 0)
 		return MAP_RBTREE;
+	else if (strcmp(type, "art") == 0)
+		return MAP_ART;
 	else if (strcmp(type, "hashmap_atomic") == 0)
 		return MAP_HASHMAP_ATOMIC;
 	else if (strcmp(type, "hashmap_tx") == 0)
 		return MAP_HASHMAP_TX;
 	else if (strcmp(type, "hashmap_rp") == 0)
 		return MAP_HASHMAP_RP;
+	else if (strcmp(type, "hashmap_act") == 0)
+		return MAP_HASHMAP_ACT;
 	else if (strcmp(type, "skiplist") == 0)
 		return MAP_SKIPLIST;
 	return NULL;
@@ -128,8 +134,9 @@ parse_map_type(const char *type)
 int main(int argc, const char *argv[]) {
 	if (argc < 3) {
 		printf("usage: %s "
-			"<ctree|btree|rbtree|hashmap_atomic|hashmap_rp|"
-			"hashmap_tx|skiplist> file-name [nops]\n", argv[0]);
+			"<ctree|btree|rbtree|art|hashmap_atomic|hashmap_rp|"
+			"hashmap_tx|hashmap_act|skiplist> file-name [nops]\n",
+			argv[0]);
 		return 1;
 	}
 
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * kv_load.c -- load generator for the kv_server example
+ *
+ * Each thread opens its own connection to the server and sends the INSERT
+ * messages in groups of pipeline-depth messages, waiting for all the responses
+ * of a group before sending the next one. Deeper pipelines let the server
+ * commit more messages in a single transaction when it runs in the batched
+ * mode.
+ */
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kv_protocol.h"
+
+#define MAX_MSG_LEN (MAX_KEY_LEN + 64)
+
+struct load_args {
+	struct sockaddr_in addr;
+	unsigned nthreads;
+	unsigned nops; /* number of INSERT messages per thread */
+	unsigned depth; /* number of messages sent before reading responses */
+	unsigned value_len;
+};
+
+struct load_thread {
+	pthread_t thread;
+	unsigned id;
+	const struct load_args *args;
+	unsigned nfailed;
+	int error;
+};
+
+/*
+ * send_all -- sends the whole buffer
+ */
+static int
+send_all(int fd, const char *buf, size_t len)
+{
+	while (len != 0) {
+		ssize_t ret = send(fd, buf, len, 0);
+		if (ret <= 0)
+			return -1;
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+/*
+ * recv_responses -- reads n newline terminated responses, counts the
+ *	unsuccessful ones
+ */
+static int
+recv_responses(int fd, unsigned n, unsigned *nfailed)
+{
+	char buf[4096];
+	size_t len = 0; /* length of the incomplete response in buf */
+
+	while (n != 0) {
+		ssize_t ret = recv(fd, buf + len, sizeof(buf) - len, 0);
+		if (ret <= 0)
+			return -1;
+		len += (size_t)ret;
+
+		char *start = buf;
+		char *end;
+		size_t left = len;
+		while (n != 0 && (end = memchr(start, '\n', left)) != NULL) {
+			const char *ok = resp_msg[RESP_MSG_SUCCESS];
+			if (strncmp(start, ok, strlen(ok)) != 0)
+				(*nfailed)++;
+			n--;
+			left -= (size_t)(end + 1 - start);
+			start = end + 1;
+		}
+
+		len -= (size_t)(start - buf);
+		memmove(buf, start, len);
+	}
+
+	return 0;
+}
+
+/*
+ * load_worker -- sends INSERT messages to the server
+ */
+static void *
+load_worker(void *arg)
+{
+	struct load_thread *t = arg;
+	const struct load_args *a = t->args;
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		t->error = 1;
+		return NULL;
+	}
+
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	if (connect(fd, (const struct sockaddr *)&a->addr,
+			sizeof(a->addr)) != 0) {
+		t->error = 1;
+		goto out;
+	}
+
+	char *value = malloc(a->value_len + 1);
+	char *buf = malloc((size_t)a->depth * (MAX_MSG_LEN + a->value_len));
+	if (value == NULL || buf == NULL) {
+		t->error = 1;
+		goto out_free;
+	}
+	memset(value, 'v', a->value_len);
+	value[a->value_len] = '\0';
+
+	for (unsigned i = 0; i < a->nops; ) {
+		unsigned n = a->nops - i < a->depth ? a->nops - i : a->depth;
+		size_t len = 0;
+		for (unsigned j = 0; j < n; ++j, ++i) {
+			len += (size_t)sprintf(buf + len,
+				"INSERT key-%u-%u %s\n", t->id, i, value);
+		}
+
+		if (send_all(fd, buf, len) ||
+				recv_responses(fd, n, &t->nfailed)) {
+			t->error = 1;
+			goto out_free;
+		}
+	}
+
+	const char *bye = kv_cmsg_token[CMSG_BYE];
+	send_all(fd, bye, strlen(bye));
+	send_all(fd, "\n", 1);
+
+out_free:
+	free(buf);
+	free(value);
+out:
+	close(fd);
+	return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		printf("usage: %s address port [threads] [ops-per-thread] "
+			"[pipeline-depth] [value-size]\n", argv[0]);
+		return 1;
+	}
+
+	struct load_args args;
+	memset(&args, 0, sizeof(args));
+	args.addr.sin_family = AF_INET;
+	args.addr.sin_port = htons((uint16_t)atoi(argv[2]));
+	if (inet_pton(AF_INET, argv[1], &args.addr.sin_addr) != 1) {
+		fprintf(stderr, "invalid address: %s\n", argv[1]);
+		return 1;
+	}
+
+	args.nthreads = argc > 3 ? (unsigned)atoi(argv[3]) : 1;
+	args.nops = argc > 4 ? (unsigned)atoi(argv[4]) : 10000;
+	args.depth = argc > 5 ? (unsigned)atoi(argv[5]) : 1;
+	args.value_len = argc > 6 ? (unsigned)atoi(argv[6]) : 16;
+
+	if (args.nthreads == 0 || args.depth == 0 || args.value_len == 0) {
+		fprintf(stderr, "threads, pipeline depth and value size "
+			"have to be greater than 0\n");
+		return 1;
+	}
+
+	struct load_thread *threads = calloc(args.nthreads, sizeof(*threads));
+	assert(threads != NULL);
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned i = 0; i < args.nthreads; ++i) {
+		threads[i].id = i;
+		threads[i].args = &args;
+		if (pthread_create(&threads[i].thread, NULL, load_worker,
+				&threads[i]) != 0) {
+			fprintf(stderr, "pthread_create failed\n");
+			return 1;
+		}
+	}
+
+	int error = 0;
+	unsigned nfailed = 0;
+	for (unsigned i = 0; i < args.nthreads; ++i) {
+		pthread_join(threads[i].thread, NULL);
+		error |= threads[i].error;
+		nfailed += threads[i].nfailed;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	free(threads);
+
+	if (error) {
+		fprintf(stderr, "connection to the server failed\n");
+		return 1;
+	}
+
+	double secs = (double)(end.tv_sec - start.tv_sec) +
+		(double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	double nops = (double)args.nthreads * args.nops;
+
+	printf("threads: %u, pipeline depth: %u, value size: %u\n",
+		args.nthreads, args.depth, args.value_len);
+	printf("ops: %.0f, failed: %u, time: %.3f s, throughput: %.0f ops/s, "
+		"latency: %.2f us/op\n", nops, nfailed, secs, nops / secs,
+		secs * 1e6 * args.nthreads / nops);
+
+	return 0;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2018, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -48,9 +48,11 @@
 #include "map_btree.h"
 #include "map_rtree.h"
 #include "map_rbtree.h"
+#include "map_art.h"
 #include "map_hashmap_atomic.h"
 #include "map_hashmap_tx.h"
 #include "map_hashmap_rp.h"
+#include "map_hashmap_act.h"
 #include "map_skiplist.h"
 
 #include "kv_protocol.h"
@@ -93,6 +95,27 @@ struct client_data {
 	size_t len; /* actual length of the message (while parsing) */
 };
 
+/*
+ * In the batched mode INSERT and REMOVE messages are not executed right away.
+ * Instead they are queued and all the messages received within a single event
+ * loop iteration are executed in one transaction, which amortizes the cost of
+ * the transaction commit (and its fences) across the whole group. Responses
+ * are sent only after the group commits.
+ */
+struct batch_entry {
+	uv_stream_t *client;
+	enum kv_cmsg type;
+	char *msg; /* copy of the client message */
+	size_t len;
+	int result;
+};
+
+static struct batch_entry *batch;
+static size_t batch_len; /* number of queued messages */
+static size_t batch_max; /* 0 means that the batched mode is disabled */
+
+static uv_check_t batch_check;
+
 /*
  * djb2_hash -- string hashing function by Dan Bernstein
  */
@@ -157,30 +180,124 @@ response_msg(uv_stream_t *client, enum resp_messages msg)
 }
 
 /*
- * cmsg_insert_handler -- handler of INSERT client message
+ * kv_insert -- allocates the value and inserts it into the map, has to be
+ *	called within a transaction
+ */
+static void
+kv_insert(const char *msg, size_t len)
+{
+	/*
+	 * For simplicity sake the length of the value buffer is just
+	 * a length of the message.
+	 */
+	TOID(struct map_value) val = TX_ZALLOC(struct map_value,
+		sizeof(struct map_value) + len);
+
+	char key[MAX_KEY_LEN];
+	int ret = sscanf(msg, "INSERT %254s %s\n", key, D_RW(val)->buf);
+	assert(ret == 2);
+
+	D_RW(val)->len = len;
+
+	/* properly terminate the value */
+	D_RW(val)->buf[strlen(D_RO(val)->buf)] = '\n';
+
+	map_insert(mapc, map, djb2_hash(key), val.oid);
+}
+
+/*
+ * kv_remove -- removes the key value pair described by the message
  */
 static int
-cmsg_insert_handler(uv_stream_t *client, const char *msg, size_t len)
+kv_remove(const char *msg)
+{
+	char key[MAX_KEY_LEN] = {0};
+
+	/* check if the constant used in sscanf() below has the correct value */
+	COMPILE_ERROR_ON(MAX_KEY_LEN - 1 != 254);
+	int ret = sscanf(msg, "REMOVE %254s\n", key);
+	assert(ret == 1);
+
+	return map_remove_free(mapc, map, djb2_hash(key));
+}
+
+/*
+ * batch_commit -- executes all queued messages in a single transaction
+ *	and sends the responses
+ */
+static void
+batch_commit(void)
 {
+	if (batch_len == 0)
+		return;
+
 	int result = 0;
 	TX_BEGIN(pop) {
-		/*
-		 * For simplicity sake the length of the value buffer is just
-		 * a length of the message.
-		 */
-		TOID(struct map_value) val = TX_ZALLOC(struct map_value,
-			sizeof(struct map_value) + len);
+		for (size_t i = 0; i < batch_len; ++i) {
+			struct batch_entry *e = &batch[i];
+			if (e->type == CMSG_INSERT) {
+				kv_insert(e->msg, e->len);
+				e->result = 0;
+			} else {
+				e->result = kv_remove(e->msg);
+			}
+		}
+	} TX_ONABORT {
+		result = 1;
+	} TX_END
 
-		char key[MAX_KEY_LEN];
-		int ret = sscanf(msg, "INSERT %254s %s\n", key, D_RW(val)->buf);
-		assert(ret == 2);
+	for (size_t i = 0; i < batch_len; ++i) {
+		struct batch_entry *e = &batch[i];
+		response_msg(e->client, result ? RESP_MSG_FAIL : e->result);
+		free(e->msg);
+	}
 
-		D_RW(val)->len = len;
+	batch_len = 0;
+}
 
-		/* properly terminate the value */
-		D_RW(val)->buf[strlen(D_RO(val)->buf)] = '\n';
+/*
+ * batch_add -- queues the message until the end of the event loop iteration
+ */
+static void
+batch_add(uv_stream_t *client, enum kv_cmsg type, const char *msg, size_t len)
+{
+	struct batch_entry *e = &batch[batch_len++];
+	e->client = client;
+	e->type = type;
+	e->len = len;
+	e->msg = malloc(len + 1);
+	assert(e->msg != NULL);
+	memcpy(e->msg, msg, len);
+	e->msg[len] = '\0';
+
+	if (batch_len == batch_max)
+		batch_commit();
+}
+
+/*
+ * batch_check_cb -- commits the batch after all pending reads of the current
+ *	event loop iteration have been processed
+ */
+static void
+batch_check_cb(uv_check_t *handle)
+{
+	batch_commit();
+}
+
+/*
+ * cmsg_insert_handler -- handler of INSERT client message
+ */
+static int
+cmsg_insert_handler(uv_stream_t *client, const char *msg, size_t len)
+{
+	if (batch_max != 0) {
+		batch_add(client, CMSG_INSERT, msg, len);
+		return 0;
+	}
 
-		map_insert(mapc, map, djb2_hash(key), val.oid);
+	int result = 0;
+	TX_BEGIN(pop) {
+		kv_insert(msg, len);
 	} TX_ONABORT {
 		result = 1;
 	} TX_END
@@ -196,14 +313,12 @@ cmsg_insert_handler(uv_stream_t *client, const char *msg, size_t len)
 static int
 cmsg_remove_handler(uv_stream_t *client, const char *msg, size_t len)
 {
-	char key[MAX_KEY_LEN] = {0};
-
-	/* check if the constant used in sscanf() below has the correct value */
-	COMPILE_ERROR_ON(MAX_KEY_LEN - 1 != 254);
-	int ret = sscanf(msg, "REMOVE %254s\n", key);
-	assert(ret == 1);
+	if (batch_max != 0) {
+		batch_add(client, CMSG_REMOVE, msg, len);
+		return 0;
+	}
 
-	int result = map_remove_free(mapc, map, djb2_hash(key));
+	int result = kv_remove(msg);
 
 	response_msg(client, result);
 
@@ -254,6 +369,8 @@ cmsg_kill_handler(uv_stream_t *client, const char *msg, size_t len)
 {
 	uv_close((uv_handle_t *)client, client_close_cb);
 	uv_close((uv_handle_t *)&server, NULL);
+	if (batch_max != 0)
+		uv_close((uv_handle_t *)&batch_check, NULL);
 
 	return 0;
 }
@@ -280,6 +397,14 @@ cmsg_handle(uv_stream_t *client, struct client_data *data)
 			strlen(kv_cmsg_token[i])) == 0)
 			break;
 
+	/*
+	 * Messages which are not batched have to observe the effects of all the
+	 * previously received ones and respond in order, so the pending batch
+	 * is committed first.
+	 */
+	if (i != CMSG_INSERT && i != CMSG_REMOVE)
+		batch_commit();
+
 	if (i == MAX_CMSG) {
 		response_msg(client, RESP_MSG_UNKNOWN);
 	} else {
@@ -347,6 +472,8 @@ static void
 read_cb(uv_stream_t *client, ssize_t nread, const uv_buf_t *buf)
 {
 	if (nread <= 0) {
+		/* respond to the messages queued by this client */
+		batch_commit();
 		printf("client connection closed\n");
 		uv_close((uv_handle_t *)client, client_close_cb);
 
@@ -367,6 +494,7 @@ read_cb(uv_stream_t *client, ssize_t nread, const uv_buf_t *buf)
 	}
 
 	if (cmsg_handle_stream(client, client->data, buf->base, nread)) {
+		batch_commit();
 		printf("client disconnect\n");
 		uv_close((uv_handle_t *)client, client_close_cb);
 	}
@@ -405,10 +533,12 @@ static const struct {
 	{MAP_HASHMAP_TX, "hashmap_tx"},
 	{MAP_HASHMAP_ATOMIC, "hashmap_atomic"},
 	{MAP_HASHMAP_RP, "hashmap_rp"},
+	{MAP_HASHMAP_ACT, "hashmap_act"},
 	{MAP_CTREE, "ctree"},
 	{MAP_BTREE, "btree"},
 	{MAP_RTREE, "rtree"},
 	{MAP_RBTREE, "rbtree"},
+	{MAP_ART, "art"},
 	{MAP_SKIPLIST, "skiplist"}
 };
 
@@ -434,7 +564,9 @@ main(int argc, char *argv[])
 {
 	if (argc < 4) {
 		printf("usage: %s hashmap_tx|hashmap_atomic|hashmap_rp|"
-				"ctree|btree|rtree|rbtree|skiplist file-name port\n",
+				"hashmap_act|"
+				"ctree|btree|rtree|rbtree|art|skiplist file-name "
+				"port [batch-size]\n",
 				argv[0]);
 		return 1;
 	}
@@ -443,6 +575,20 @@ main(int argc, char *argv[])
 	const char *type = argv[1];
 	int port = atoi(argv[3]);
 
+	if (argc > 4) {
+		int bsize = atoi(argv[4]);
+		if (bsize < 0) {
+			fprintf(stderr, "invalid batch size: %s\n", argv[4]);
+			return 1;
+		}
+		batch_max = (size_t)bsize;
+	}
+
+	if (batch_max != 0) {
+		batch = malloc(batch_max * sizeof(*batch));
+		assert(batch != NULL);
+	}
+
 	/* use only a single buffer for all incoming data */
 	void *read_buf = malloc(MAX_READ_LEN);
 	assert(read_buf != NULL);
@@ -495,6 +641,12 @@ main(int argc, char *argv[])
 	ret = uv_listen((uv_stream_t *)&server, SOMAXCONN, connection_cb);
 	assert(ret == 0);
 
+	if (batch_max != 0) {
+		/* check handles are run right after polling for i/o */
+		uv_check_init(loop, &batch_check);
+		uv_check_start(&batch_check, batch_check_cb);
+	}
+
 	ret = uv_run(loop, UV_RUN_DEFAULT);
 	assert(ret == 0);
 
@@ -504,6 +656,7 @@ main(int argc, char *argv[])
 	pmemobj_close(pop);
 
 	free(read_buf);
+	free(batch);
 
 	return 0;
 }
@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+#
+# Copyright 2020, Intel Corporation
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in
+#       the documentation and/or other materials provided with the
+#       distribution.
+#
+#     * Neither the name of the copyright holder nor the names of its
+#       contributors may be used to endorse or promote products derived
+#       from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+
+#
+# kv_server_bench.sh -- compares the throughput of kv_server with and without
+#	batching of the INSERT messages
+#
+# usage: kv_server_bench.sh pool-dir [map-type] [threads] [ops-per-thread]
+#
+
+set -euo pipefail
+
+DIR=$1
+MAP=${2:-hashmap_tx}
+THREADS=${3:-4}
+OPS=${4:-20000}
+PORT=9101
+VALUE_SIZE=64
+
+# batch size of the server, pipeline depth of the clients
+CONFIGS="0,1 0,32 64,1 64,32"
+
+for CONFIG in $CONFIGS; do
+	BATCH=${CONFIG%,*}
+	DEPTH=${CONFIG#*,}
+	POOL=$DIR/kv_server_bench.pool
+
+	rm -f $POOL
+	./kv_server $MAP $POOL $PORT $BATCH > /dev/null &
+	SERVER=$!
+
+	# wait for the server to properly start
+	sleep 1
+
+	echo "batch size: $BATCH"
+	./kv_load 127.0.0.1 $PORT $THREADS $OPS $DEPTH $VALUE_SIZE
+
+	echo "KILL" | nc -q 1 127.0.0.1 $PORT > /dev/null || true
+	wait $SERVER
+	rm -f $POOL
+done
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2017, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -201,6 +201,19 @@ map_foreach(struct map_ctx *mapc, TOID(struct map) map,
 	return mapc->ops->foreach(mapc->pop, map, cb, arg);
 }
 
+/*
+ * map_foreach_from -- iterate in key order through key value pairs with keys
+ * not less than the specified one
+ */
+int
+map_foreach_from(struct map_ctx *mapc, TOID(struct map) map, uint64_t key,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg)
+{
+	ABORT_NOT_IMPLEMENTED(mapc, foreach_from);
+	return mapc->ops->foreach_from(mapc->pop, map, key, cb, arg);
+}
+
 /*
  * map_is_empty -- check if map is empty
  */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2018, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -80,6 +80,10 @@ struct map_ops {
 	size_t(*count)(PMEMobjpool *pop, TOID(struct map) map);
 	int(*cmd)(PMEMobjpool *pop, TOID(struct map) map,
 		unsigned cmd, uint64_t arg);
+	int(*foreach_from)(PMEMobjpool *pop, TOID(struct map) map,
+		uint64_t key,
+		int(*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg);
 };
 
 struct map_ctx {
@@ -108,6 +112,10 @@ int map_lookup(struct map_ctx *mapc, TOID(struct map) map, uint64_t key);
 int map_foreach(struct map_ctx *mapc, TOID(struct map) map,
 	int(*cb)(uint64_t key, PMEMoid value, void *arg),
 	void *arg);
+int map_foreach_from(struct map_ctx *mapc, TOID(struct map) map,
+	uint64_t key,
+	int(*cb)(uint64_t key, PMEMoid value, void *arg),
+	void *arg);
 int map_is_empty(struct map_ctx *mapc, TOID(struct map) map);
 size_t map_count(struct map_ctx *mapc, TOID(struct map) map);
 int map_cmd(struct map_ctx *mapc, TOID(struct map) map,
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * map_art.c -- common interface for maps
+ */
+
+#include <art_map.h>
+
+#include "map_art.h"
+
+/*
+ * map_art_key -- (internal) encodes the key in big endian order, so that
+ * the lexicographic order of the tree is the numeric order of the keys
+ */
+static void
+map_art_key(uint64_t key, unsigned char buf[sizeof(uint64_t)])
+{
+	for (int i = (int)sizeof(uint64_t) - 1; i >= 0; i--) {
+		buf[i] = (unsigned char)key;
+		key >>= 8;
+	}
+}
+
+/*
+ * map_art_check -- wrapper for art_map_check
+ */
+static int
+map_art_check(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	return art_map_check(pop, art_map);
+}
+
+/*
+ * map_art_create -- wrapper for art_map_create
+ */
+static int
+map_art_create(PMEMobjpool *pop, TOID(struct map) *map, void *arg)
+{
+	TOID(struct art_map) *art_map =
+		(TOID(struct art_map) *)map;
+
+	return art_map_create(pop, art_map, arg);
+}
+
+/*
+ * map_art_destroy -- wrapper for art_map_destroy
+ */
+static int
+map_art_destroy(PMEMobjpool *pop, TOID(struct map) *map)
+{
+	TOID(struct art_map) *art_map =
+		(TOID(struct art_map) *)map;
+
+	return art_map_destroy(pop, art_map);
+}
+
+/*
+ * map_art_insert -- wrapper for art_map_insert
+ */
+static int
+map_art_insert(PMEMobjpool *pop, TOID(struct map) map,
+		uint64_t key, PMEMoid value)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	unsigned char k[sizeof(key)];
+	map_art_key(key, k);
+
+	return art_map_insert(pop, art_map, k, sizeof(k), value);
+}
+
+/*
+ * map_art_insert_new -- wrapper for art_map_insert_new
+ */
+static int
+map_art_insert_new(PMEMobjpool *pop, TOID(struct map) map,
+		uint64_t key, size_t size,
+		unsigned type_num,
+		void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg),
+		void *arg)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	unsigned char k[sizeof(key)];
+	map_art_key(key, k);
+
+	return art_map_insert_new(pop, art_map, k, sizeof(k), size,
+			type_num, constructor, arg);
+}
+
+/*
+ * map_art_remove -- wrapper for art_map_remove
+ */
+static PMEMoid
+map_art_remove(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	unsigned char k[sizeof(key)];
+	map_art_key(key, k);
+
+	return art_map_remove(pop, art_map, k, sizeof(k));
+}
+
+/*
+ * map_art_remove_free -- wrapper for art_map_remove_free
+ */
+static int
+map_art_remove_free(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	unsigned char k[sizeof(key)];
+	map_art_key(key, k);
+
+	return art_map_remove_free(pop, art_map, k, sizeof(k));
+}
+
+/*
+ * map_art_clear -- wrapper for art_map_clear
+ */
+static int
+map_art_clear(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	return art_map_clear(pop, art_map);
+}
+
+/*
+ * map_art_get -- wrapper for art_map_get
+ */
+static PMEMoid
+map_art_get(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	unsigned char k[sizeof(key)];
+	map_art_key(key, k);
+
+	return art_map_get(pop, art_map, k, sizeof(k));
+}
+
+/*
+ * map_art_lookup -- wrapper for art_map_lookup
+ */
+static int
+map_art_lookup(PMEMobjpool *pop, TOID(struct map) map, uint64_t key)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	unsigned char k[sizeof(key)];
+	map_art_key(key, k);
+
+	return art_map_lookup(pop, art_map, k, sizeof(k));
+}
+
+struct cb_arg2 {
+	int (*cb)(uint64_t key, PMEMoid value, void *arg);
+	void *arg;
+};
+
+/*
+ * map_art_foreach_cb -- wrapper for callback
+ */
+static int
+map_art_foreach_cb(const unsigned char *key,
+		uint64_t key_size, PMEMoid value, void *arg2)
+{
+	const struct cb_arg2 *const a2 = (const struct cb_arg2 *)arg2;
+	uint64_t k = 0;
+
+	for (uint64_t i = 0; i < key_size; i++)
+		k = (k << 8) | key[i];
+
+	return a2->cb(k, value, a2->arg);
+}
+
+/*
+ * map_art_foreach -- wrapper for art_map_foreach
+ */
+static int
+map_art_foreach(PMEMobjpool *pop, TOID(struct map) map,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg)
+{
+	struct cb_arg2 arg2 = {cb, arg};
+
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	return art_map_foreach(pop, art_map, map_art_foreach_cb, &arg2);
+}
+
+/*
+ * map_art_foreach_from -- wrapper for art_map_foreach_from
+ */
+static int
+map_art_foreach_from(PMEMobjpool *pop, TOID(struct map) map, uint64_t key,
+		int (*cb)(uint64_t key, PMEMoid value, void *arg),
+		void *arg)
+{
+	struct cb_arg2 arg2 = {cb, arg};
+
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	unsigned char k[sizeof(key)];
+	map_art_key(key, k);
+
+	return art_map_foreach_from(pop, art_map, k, sizeof(k),
+			map_art_foreach_cb, &arg2);
+}
+
+/*
+ * map_art_is_empty -- wrapper for art_map_is_empty
+ */
+static int
+map_art_is_empty(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	return art_map_is_empty(pop, art_map);
+}
+
+/*
+ * map_art_count -- wrapper for art_map_count
+ */
+static size_t
+map_art_count(PMEMobjpool *pop, TOID(struct map) map)
+{
+	TOID(struct art_map) art_map;
+	TOID_ASSIGN(art_map, map.oid);
+
+	return art_map_count(pop, art_map);
+}
+
+struct map_ops art_map_ops = {
+/*	.check		= */map_art_check,
+/*	.create		= */map_art_create,
+/*	.destroy	= */map_art_destroy,
+/*	.init		= */NULL,
+/*	.insert		= */map_art_insert,
+/*	.insert_new	= */map_art_insert_new,
+/*	.remove		= */map_art_remove,
+/*	.remove_free	= */map_art_remove_free,
+/*	.clear		= */map_art_clear,
+/*	.get		= */map_art_get,
+/*	.lookup		= */map_art_lookup,
+/*	.foreach	= */map_art_foreach,
+/*	.is_empty	= */map_art_is_empty,
+/*	.count		= */map_art_count,
+/*	.cmd		= */NULL,
+/*	.foreach_from	= */map_art_foreach_from,
+};
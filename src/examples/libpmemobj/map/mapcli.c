@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2019, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -45,9 +45,11 @@
 #include "map_btree.h"
 #include "map_rtree.h"
 #include "map_rbtree.h"
+#include "map_art.h"
 #include "map_hashmap_atomic.h"
 #include "map_hashmap_tx.h"
 #include "map_hashmap_rp.h"
+#include "map_hashmap_act.h"
 #include "map_skiplist.h"
 #include "hashmap/hashmap.h"
 
@@ -173,6 +175,7 @@ help(void)
 	printf("c $value - check $value, returns 0/1\n");
 	printf("n $value - insert $value random values\n");
 	printf("p - print all values\n");
+	printf("f $value - print values not less than $value in order\n");
 	printf("d - print debug info\n");
 	printf("b [$value] - rebuild $value (default: 1) times\n");
 	printf("q - quit\n");
@@ -200,15 +203,37 @@ print_all(void)
 	printf("\n");
 }
 
+/*
+ * str_print_from -- map_foreach_from wrapper which works on strings
+ */
+static void
+str_print_from(const char *str)
+{
+	uint64_t key;
+	if (sscanf(str, "%" PRIu64, &key) <= 0) {
+		fprintf(stderr, "print from: invalid syntax\n");
+		return;
+	}
+
+	if (mapc->ops->foreach_from == NULL) {
+		fprintf(stderr, "print from: not supported by this map\n");
+		return;
+	}
+
+	map_foreach_from(mapc, map, key, hashmap_print, NULL);
+	printf("\n");
+}
+
 #define INPUT_BUF_LEN 1000
 int
 main(int argc, char *argv[])
 {
-	if (argc < 3 || argc > 4) {
+	if (argc < 3 || argc > 5) {
 		printf("usage: %s "
-			"hashmap_tx|hashmap_atomic|hashmap_rp|"
-			"ctree|btree|rtree|rbtree|skiplist"
-				" file-name [<seed>]\n", argv[0]);
+			"hashmap_tx|hashmap_atomic|hashmap_rp|hashmap_act|"
+			"ctree|btree|rtree|rbtree|art|skiplist"
+				" file-name [<seed> [<rehash step>]]\n",
+				argv[0]);
 		return 1;
 	}
 
@@ -221,6 +246,8 @@ main(int argc, char *argv[])
 		ops = MAP_HASHMAP_ATOMIC;
 	} else if (strcmp(type, "hashmap_rp") == 0) {
 		ops = MAP_HASHMAP_RP;
+	} else if (strcmp(type, "hashmap_act") == 0) {
+		ops = MAP_HASHMAP_ACT;
 	} else if (strcmp(type, "ctree") == 0) {
 		ops = MAP_CTREE;
 	} else if (strcmp(type, "btree") == 0) {
@@ -229,6 +256,8 @@ main(int argc, char *argv[])
 		ops = MAP_RTREE;
 	} else if (strcmp(type, "rbtree") == 0) {
 		ops = MAP_RBTREE;
+	} else if (strcmp(type, "art") == 0) {
+		ops = MAP_ART;
 	} else if (strcmp(type, "skiplist") == 0) {
 		ops = MAP_SKIPLIST;
 	} else {
@@ -254,6 +283,11 @@ main(int argc, char *argv[])
 			args.seed = (uint32_t)time(NULL);
 		srand(args.seed);
 
+		if (argc > 4)
+			args.rehash_step = (uint32_t)atoi(argv[4]);
+		else
+			args.rehash_step = 0;
+
 		mapc = map_ctx_init(ops, pop);
 		if (!mapc) {
 			pmemobj_close(pop);
@@ -310,6 +344,9 @@ main(int argc, char *argv[])
 			case 'p':
 				print_all();
 				break;
+			case 'f':
+				str_print_from(buf + 1);
+				break;
 			case 'd':
 				map_cmd(mapc, map, HASHMAP_CMD_DEBUG,
 						(uint64_t)stdout);
@@ -0,0 +1,1423 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * art_map.c -- persistent adaptive radix tree map
+ *
+ * Inner nodes come in four sizes (4, 16, 48 and 256 children). A node which
+ * runs out of space (or becomes too sparse) is replaced by a node of the
+ * other size, built off-line in a reserved object and swapped in by
+ * publishing the new pointer together with the deferred free of the old
+ * node. All the in-place modifications are single 8-byte stores published
+ * with pmemobj_set_value, so a crash leaves either the old or the new tree
+ * and no undo log snapshots are taken.
+ *
+ * Keys are compared as byte strings, foreach visits them in lexicographic
+ * order and foreach_from starts the scan from the given key.
+ */
+
+#include <ex_common.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ART_NODE16_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "art_map.h"
+
+TOID_DECLARE(struct art_node, ART_MAP_TYPE_OFFSET + 1);
+TOID_DECLARE(struct art_leaf, ART_MAP_TYPE_OFFSET + 2);
+
+/* number of compressed path bytes stored in the node */
+#define ART_MAX_PREFIX_LEN 8
+
+/* maximum number of actions published by a single operation */
+#define ART_MAX_ACTIONS 10
+
+enum art_obj_type {
+	ART_LEAF,
+	ART_NODE4,
+	ART_NODE16,
+	ART_NODE48,
+	ART_NODE256,
+};
+
+/* every persistent object of the tree starts with its type */
+struct art_leaf {
+	uint64_t type;
+	PMEMoid value;
+	uint64_t key_size;
+	unsigned char key[];
+};
+
+struct art_node {
+	uint64_t type;
+	uint64_t num_children;
+
+	/*
+	 * length of the compressed path, only the first ART_MAX_PREFIX_LEN
+	 * bytes are stored, the rest is read from any leaf below the node
+	 */
+	uint64_t prefix_len;
+	unsigned char prefix[ART_MAX_PREFIX_LEN];
+
+	/* leaf of the key which ends at this node */
+	PMEMoid term;
+};
+
+/* keys of the small nodes are unordered and padded to full words */
+struct art_node4 {
+	struct art_node n;
+	unsigned char keys[8];
+	PMEMoid children[4];
+};
+
+struct art_node16 {
+	struct art_node n;
+	unsigned char keys[16];
+	PMEMoid children[16];
+};
+
+struct art_node48 {
+	struct art_node n;
+	/* slot of the child + 1, 0 means no child */
+	unsigned char index[256];
+	PMEMoid children[48];
+};
+
+struct art_node256 {
+	struct art_node n;
+	PMEMoid children[256];
+};
+
+struct art_map {
+	PMEMoid root;
+	uint64_t count;
+};
+
+/* state of a single operation -- actions to be published */
+struct art_ctx {
+	PMEMobjpool *pop;
+	struct pobj_action actv[ART_MAX_ACTIONS];
+	size_t actn;
+};
+
+/*
+ * art_type -- (internal) returns type of the tree object
+ */
+static uint64_t
+art_type(PMEMoid oid)
+{
+	return *(uint64_t *)pmemobj_direct(oid);
+}
+
+/*
+ * art_capacity -- (internal) returns maximum number of children of the node
+ */
+static uint64_t
+art_capacity(uint64_t type)
+{
+	switch (type) {
+		case ART_NODE4:
+			return 4;
+		case ART_NODE16:
+			return 16;
+		case ART_NODE48:
+			return 48;
+		default:
+			return 256;
+	}
+}
+
+/*
+ * art_node_size -- (internal) returns size of the node of the given type
+ */
+static size_t
+art_node_size(uint64_t type)
+{
+	switch (type) {
+		case ART_NODE4:
+			return sizeof(struct art_node4);
+		case ART_NODE16:
+			return sizeof(struct art_node16);
+		case ART_NODE48:
+			return sizeof(struct art_node48);
+		default:
+			return sizeof(struct art_node256);
+	}
+}
+
+/*
+ * art_set -- (internal) appends action which sets the persistent word
+ */
+static void
+art_set(struct art_ctx *ctx, uint64_t *ptr, uint64_t value)
+{
+	assert(ctx->actn < ART_MAX_ACTIONS);
+	pmemobj_set_value(ctx->pop, &ctx->actv[ctx->actn++], ptr, value);
+}
+
+/*
+ * art_set_ptr -- (internal) appends actions which set the persistent pointer
+ */
+static void
+art_set_ptr(struct art_ctx *ctx, PMEMoid *ptr, PMEMoid oid)
+{
+	/* pool uuid is the same for all the non-null pointers in the pool */
+	if (!OID_IS_NULL(oid) && ptr->pool_uuid_lo != oid.pool_uuid_lo)
+		art_set(ctx, &ptr->pool_uuid_lo, oid.pool_uuid_lo);
+
+	art_set(ctx, &ptr->off, oid.off);
+}
+
+/*
+ * art_set_byte -- (internal) appends action which sets a byte of the word
+ * aligned array
+ */
+static void
+art_set_byte(struct art_ctx *ctx, unsigned char *arr, unsigned idx,
+	unsigned char value)
+{
+	uint64_t *ptr = (uint64_t *)(arr + (idx & ~7U));
+	uint64_t word = *ptr;
+
+	((unsigned char *)&word)[idx & 7U] = value;
+	art_set(ctx, ptr, word);
+}
+
+/*
+ * art_defer_free -- (internal) appends action which frees the object
+ */
+static void
+art_defer_free(struct art_ctx *ctx, PMEMoid oid)
+{
+	assert(ctx->actn < ART_MAX_ACTIONS);
+	pmemobj_defer_free(ctx->pop, oid, &ctx->actv[ctx->actn++]);
+}
+
+/*
+ * art_reserve -- (internal) reserves a zeroed object
+ */
+static PMEMoid
+art_reserve(struct art_ctx *ctx, size_t size, uint64_t type_num)
+{
+	assert(ctx->actn < ART_MAX_ACTIONS);
+	PMEMoid oid = pmemobj_xreserve(ctx->pop, &ctx->actv[ctx->actn],
+			size, type_num, POBJ_XALLOC_ZERO);
+	if (!OID_IS_NULL(oid))
+		ctx->actn++;
+
+	return oid;
+}
+
+/*
+ * art_finish -- (internal) publishes or cancels actions of the operation
+ */
+static int
+art_finish(struct art_ctx *ctx, int ret)
+{
+	if (ret < 0) {
+		pmemobj_cancel(ctx->pop, ctx->actv, ctx->actn);
+		return ret;
+	}
+
+	if (ctx->actn && pmemobj_publish(ctx->pop, ctx->actv, ctx->actn))
+		return -1;
+
+	return ret;
+}
+
+/*
+ * art_new_leaf -- (internal) reserves and fills a new leaf
+ */
+static PMEMoid
+art_new_leaf(struct art_ctx *ctx, const unsigned char *key,
+	uint64_t key_size, PMEMoid value)
+{
+	PMEMoid oid = art_reserve(ctx, sizeof(struct art_leaf) + key_size,
+			TOID_TYPE_NUM(struct art_leaf));
+	if (OID_IS_NULL(oid))
+		return oid;
+
+	struct art_leaf *l = (struct art_leaf *)pmemobj_direct(oid);
+	l->type = ART_LEAF;
+	l->value = value;
+	l->key_size = key_size;
+	memcpy(l->key, key, key_size);
+	pmemobj_persist(ctx->pop, l, sizeof(*l) + key_size);
+
+	return oid;
+}
+
+/*
+ * art_leaf_matches -- (internal) checks whether the leaf holds the key
+ */
+static int
+art_leaf_matches(const struct art_leaf *l, const unsigned char *key,
+	uint64_t key_size)
+{
+	return l->key_size == key_size && memcmp(l->key, key, key_size) == 0;
+}
+
+/*
+ * art_key_cmp -- (internal) compares two keys in lexicographic order
+ */
+static int
+art_key_cmp(const unsigned char *k1, uint64_t s1,
+	const unsigned char *k2, uint64_t s2)
+{
+	int ret = memcmp(k1, k2, MIN(s1, s2));
+	if (ret != 0)
+		return ret;
+
+	return s1 < s2 ? -1 : (s1 > s2 ? 1 : 0);
+}
+
+/*
+ * art_ctz -- (internal) returns index of the lowest bit set
+ */
+static unsigned
+art_ctz(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return (unsigned)idx;
+#else
+	return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+/*
+ * art_find_child -- (internal) returns slot of the child under the given byte
+ */
+static PMEMoid *
+art_find_child(struct art_node *n, unsigned char b)
+{
+	switch (n->type) {
+		case ART_NODE4: {
+			struct art_node4 *n4 = (struct art_node4 *)n;
+			for (unsigned i = 0; i < n->num_children; i++) {
+				if (n4->keys[i] == b)
+					return &n4->children[i];
+			}
+			return NULL;
+		}
+		case ART_NODE16: {
+			struct art_node16 *n16 = (struct art_node16 *)n;
+#ifdef ART_NODE16_SSE2
+			/* compare all the keys at once */
+			__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char)b),
+				_mm_loadu_si128((const __m128i *)n16->keys));
+			unsigned mask = (unsigned)_mm_movemask_epi8(cmp);
+			mask &= (1U << n->num_children) - 1;
+#else
+			unsigned mask = 0;
+			for (unsigned i = 0; i < n->num_children; i++) {
+				if (n16->keys[i] == b)
+					mask |= 1U << i;
+			}
+#endif
+			if (mask == 0)
+				return NULL;
+
+			return &n16->children[art_ctz(mask)];
+		}
+		case ART_NODE48: {
+			struct art_node48 *n48 = (struct art_node48 *)n;
+			unsigned idx = n48->index[b];
+			return idx ? &n48->children[idx - 1] : NULL;
+		}
+		default: {
+			struct art_node256 *n256 = (struct art_node256 *)n;
+			return OID_IS_NULL(n256->children[b]) ?
+				NULL : &n256->children[b];
+		}
+	}
+}
+
+/*
+ * art_next_child -- (internal) returns slot of the child with the lowest key
+ * byte not less than 'from', NULL if there is no such child
+ */
+static PMEMoid *
+art_next_child(struct art_node *n, unsigned from, unsigned *b)
+{
+	switch (n->type) {
+		case ART_NODE4:
+		case ART_NODE16: {
+			/* node4 and node16 share the layout of the arrays */
+			struct art_node16 *n16 = (struct art_node16 *)n;
+			unsigned char *keys = n16->keys;
+			PMEMoid *children = n->type == ART_NODE4 ?
+				((struct art_node4 *)n)->children :
+				n16->children;
+			PMEMoid *ret = NULL;
+
+			for (unsigned i = 0; i < n->num_children; i++) {
+				if (keys[i] >= from && (ret == NULL ||
+						keys[i] < *b)) {
+					*b = keys[i];
+					ret = &children[i];
+				}
+			}
+			return ret;
+		}
+		case ART_NODE48: {
+			struct art_node48 *n48 = (struct art_node48 *)n;
+			for (unsigned i = from; i < 256; i++) {
+				if (n48->index[i]) {
+					*b = i;
+					return &n48->children[
+						n48->index[i] - 1];
+				}
+			}
+			return NULL;
+		}
+		default: {
+			struct art_node256 *n256 = (struct art_node256 *)n;
+			for (unsigned i = from; i < 256; i++) {
+				if (!OID_IS_NULL(n256->children[i])) {
+					*b = i;
+					return &n256->children[i];
+				}
+			}
+			return NULL;
+		}
+	}
+}
+
+/*
+ * art_min_leaf -- (internal) returns the leaf with the lowest key
+ */
+static struct art_leaf *
+art_min_leaf(PMEMoid oid)
+{
+	while (art_type(oid) != ART_LEAF) {
+		struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+		if (!OID_IS_NULL(n->term)) {
+			oid = n->term;
+			break;
+		}
+
+		unsigned b;
+		oid = *art_next_child(n, 0, &b);
+	}
+
+	return (struct art_leaf *)pmemobj_direct(oid);
+}
+
+/*
+ * art_full_prefix -- (internal) returns all the bytes of the compressed path
+ * of the node at the given depth
+ */
+static const unsigned char *
+art_full_prefix(PMEMoid oid, uint64_t depth)
+{
+	struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+	if (n->prefix_len <= ART_MAX_PREFIX_LEN)
+		return n->prefix;
+
+	return art_min_leaf(oid)->key + depth;
+}
+
+/*
+ * art_prefix_mismatch -- (internal) returns length of the common part of the
+ * compressed path and the key
+ */
+static uint64_t
+art_prefix_mismatch(PMEMoid oid, const unsigned char *key, uint64_t key_size,
+	uint64_t depth)
+{
+	struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+	uint64_t max = MIN(n->prefix_len, key_size - depth);
+	uint64_t stored = MIN(max, ART_MAX_PREFIX_LEN);
+	uint64_t i;
+
+	for (i = 0; i < stored; i++) {
+		if (n->prefix[i] != key[depth + i])
+			return i;
+	}
+
+	if (max > stored) {
+		const unsigned char *prefix = art_full_prefix(oid, depth);
+		for (; i < max; i++) {
+			if (prefix[i] != key[depth + i])
+				return i;
+		}
+	}
+
+	return i;
+}
+
+/*
+ * art_collect -- (internal) copies key bytes and children of the node
+ */
+static unsigned
+art_collect(struct art_node *n, unsigned char *keys, PMEMoid *children)
+{
+	unsigned cnt = 0;
+	unsigned b;
+	PMEMoid *c;
+
+	for (unsigned from = 0; from < 256 &&
+			(c = art_next_child(n, from, &b)) != NULL;
+			from = b + 1) {
+		keys[cnt] = (unsigned char)b;
+		children[cnt++] = *c;
+	}
+
+	return cnt;
+}
+
+/*
+ * art_build -- (internal) reserves and fills a new node with the given
+ * compressed path, terminating leaf and children
+ */
+static PMEMoid
+art_build(struct art_ctx *ctx, uint64_t type,
+	uint64_t prefix_len, const unsigned char *prefix, PMEMoid term,
+	unsigned cnt, const unsigned char *keys, const PMEMoid *children)
+{
+	size_t size = art_node_size(type);
+	PMEMoid oid = art_reserve(ctx, size, TOID_TYPE_NUM(struct art_node));
+	if (OID_IS_NULL(oid))
+		return oid;
+
+	struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+	n->type = type;
+	n->num_children = cnt;
+	n->prefix_len = prefix_len;
+	memcpy(n->prefix, prefix, MIN(prefix_len, ART_MAX_PREFIX_LEN));
+	n->term = term;
+
+	for (unsigned i = 0; i < cnt; i++) {
+		switch (type) {
+			case ART_NODE4: {
+				struct art_node4 *n4 = (struct art_node4 *)n;
+				n4->keys[i] = keys[i];
+				n4->children[i] = children[i];
+				break;
+			}
+			case ART_NODE16: {
+				struct art_node16 *n16 =
+					(struct art_node16 *)n;
+				n16->keys[i] = keys[i];
+				n16->children[i] = children[i];
+				break;
+			}
+			case ART_NODE48: {
+				struct art_node48 *n48 =
+					(struct art_node48 *)n;
+				n48->index[keys[i]] = (unsigned char)(i + 1);
+				n48->children[i] = children[i];
+				break;
+			}
+			default: {
+				struct art_node256 *n256 =
+					(struct art_node256 *)n;
+				n256->children[keys[i]] = children[i];
+				break;
+			}
+		}
+	}
+
+	pmemobj_persist(ctx->pop, n, size);
+
+	return oid;
+}
+
+/*
+ * art_replace -- (internal) replaces the node with a copy of the given type,
+ * with the child under byte 'b' added (if 'child' is not null) or removed
+ */
+static int
+art_replace(struct art_ctx *ctx, PMEMoid *slot, uint64_t type,
+	unsigned char b, PMEMoid child)
+{
+	struct art_node *n = (struct art_node *)pmemobj_direct(*slot);
+	unsigned char keys[256];
+	PMEMoid children[256];
+	unsigned cnt = art_collect(n, keys, children);
+
+	if (OID_IS_NULL(child)) {
+		unsigned i = 0;
+		while (keys[i] != b)
+			i++;
+		cnt--;
+		memmove(&keys[i], &keys[i + 1], cnt - i);
+		memmove(&children[i], &children[i + 1],
+			(cnt - i) * sizeof(PMEMoid));
+	} else {
+		keys[cnt] = b;
+		children[cnt++] = child;
+	}
+
+	PMEMoid oid = art_build(ctx, type, n->prefix_len, n->prefix, n->term,
+			cnt, keys, children);
+	if (OID_IS_NULL(oid))
+		return -1;
+
+	art_defer_free(ctx, *slot);
+	art_set_ptr(ctx, slot, oid);
+
+	return 0;
+}
+
+/*
+ * art_add_child -- (internal) adds the child to the node, grows the node if
+ * it is full
+ */
+static int
+art_add_child(struct art_ctx *ctx, PMEMoid *slot, unsigned char b,
+	PMEMoid child)
+{
+	struct art_node *n = (struct art_node *)pmemobj_direct(*slot);
+	uint64_t num = n->num_children;
+
+	if (num == art_capacity(n->type))
+		return art_replace(ctx, slot, n->type + 1, b, child);
+
+	/*
+	 * Slots past num_children (and node48 slots not referenced by the
+	 * index) are not reachable, so they are written directly and become
+	 * visible on publish.
+	 */
+	switch (n->type) {
+		case ART_NODE4:
+		case ART_NODE16: {
+			struct art_node16 *n16 = (struct art_node16 *)n;
+			PMEMoid *children = n->type == ART_NODE4 ?
+				((struct art_node4 *)n)->children :
+				n16->children;
+			n16->keys[num] = b;
+			children[num] = child;
+			pmemobj_persist(ctx->pop, &n16->keys[num], 1);
+			pmemobj_persist(ctx->pop, &children[num],
+				sizeof(PMEMoid));
+			break;
+		}
+		case ART_NODE48: {
+			struct art_node48 *n48 = (struct art_node48 *)n;
+			int used[48] = {0};
+			unsigned i;
+			for (i = 0; i < 256; i++) {
+				if (n48->index[i])
+					used[n48->index[i] - 1] = 1;
+			}
+			for (i = 0; used[i]; i++)
+				;
+			n48->children[i] = child;
+			pmemobj_persist(ctx->pop, &n48->children[i],
+				sizeof(PMEMoid));
+			art_set_byte(ctx, n48->index, b,
+				(unsigned char)(i + 1));
+			break;
+		}
+		default: {
+			struct art_node256 *n256 = (struct art_node256 *)n;
+			art_set_ptr(ctx, &n256->children[b], child);
+			break;
+		}
+	}
+
+	art_set(ctx, &n->num_children, num + 1);
+
+	return 0;
+}
+
+/*
+ * art_collapse -- (internal) replaces the node with its only child, the
+ * compressed path of the node and the key byte are prepended to the path
+ * of the child
+ */
+static void
+art_collapse(struct art_ctx *ctx, PMEMoid *slot, unsigned char b,
+	PMEMoid child)
+{
+	struct art_node *n = (struct art_node *)pmemobj_direct(*slot);
+
+	if (art_type(child) != ART_LEAF) {
+		struct art_node *c = (struct art_node *)pmemobj_direct(child);
+		uint64_t len = n->prefix_len;
+		unsigned char prefix[ART_MAX_PREFIX_LEN];
+		uint64_t word;
+
+		memcpy(prefix, n->prefix, MIN(len, ART_MAX_PREFIX_LEN));
+		if (len < ART_MAX_PREFIX_LEN)
+			prefix[len++] = b;
+		if (len < ART_MAX_PREFIX_LEN)
+			memcpy(prefix + len, c->prefix,
+				MIN(c->prefix_len, ART_MAX_PREFIX_LEN - len));
+
+		memcpy(&word, prefix, sizeof(word));
+		art_set(ctx, (uint64_t *)c->prefix, word);
+		art_set(ctx, &c->prefix_len,
+			n->prefix_len + 1 + c->prefix_len);
+	}
+
+	art_defer_free(ctx, *slot);
+	art_set_ptr(ctx, slot, child);
+}
+
+/*
+ * art_remove_child -- (internal) removes the child from the node, shrinks or
+ * collapses the node if it becomes too sparse
+ */
+static int
+art_remove_child(struct art_ctx *ctx, PMEMoid *slot, unsigned char b)
+{
+	struct art_node *n = (struct art_node *)pmemobj_direct(*slot);
+	uint64_t num = n->num_children - 1;
+
+	if (num == 0) {
+		/* only the terminating leaf is left */
+		assert(!OID_IS_NULL(n->term));
+		art_defer_free(ctx, *slot);
+		art_set_ptr(ctx, slot, n->term);
+		return 0;
+	}
+
+	if (num == 1 && OID_IS_NULL(n->term)) {
+		unsigned c;
+		PMEMoid *other = art_next_child(n, 0, &c);
+		if (c == b)
+			other = art_next_child(n, c + 1U, &c);
+		art_collapse(ctx, slot, (unsigned char)c, *other);
+		return 0;
+	}
+
+	switch (n->type) {
+		case ART_NODE4:
+		case ART_NODE16: {
+			if (n->type == ART_NODE16 && num <= 3)
+				return art_replace(ctx, slot, ART_NODE4, b,
+					OID_NULL);
+
+			/* move the last child into the slot being freed */
+			struct art_node16 *n16 = (struct art_node16 *)n;
+			PMEMoid *children = n->type == ART_NODE4 ?
+				((struct art_node4 *)n)->children :
+				n16->children;
+			unsigned i = 0;
+			while (n16->keys[i] != b)
+				i++;
+			if (i != num) {
+				art_set_byte(ctx, n16->keys, i,
+					n16->keys[num]);
+				art_set_ptr(ctx, &children[i], children[num]);
+			}
+			break;
+		}
+		case ART_NODE48: {
+			if (num <= 12)
+				return art_replace(ctx, slot, ART_NODE16, b,
+					OID_NULL);
+
+			struct art_node48 *n48 = (struct art_node48 *)n;
+			art_set_byte(ctx, n48->index, b, 0);
+			break;
+		}
+		default: {
+			if (num <= 37)
+				return art_replace(ctx, slot, ART_NODE48, b,
+					OID_NULL);
+
+			struct art_node256 *n256 = (struct art_node256 *)n;
+			art_set(ctx, &n256->children[b].off, 0);
+			break;
+		}
+	}
+
+	art_set(ctx, &n->num_children, num);
+
+	return 0;
+}
+
+/*
+ * art_split_leaf -- (internal) replaces the leaf with a node holding both
+ * the leaf and the new key
+ */
+static int
+art_split_leaf(struct art_ctx *ctx, PMEMoid *slot, uint64_t depth,
+	const unsigned char *key, uint64_t key_size, PMEMoid value)
+{
+	struct art_leaf *l = (struct art_leaf *)pmemobj_direct(*slot);
+	uint64_t max = MIN(l->key_size, key_size);
+	uint64_t i = depth;
+
+	while (i < max && l->key[i] == key[i])
+		i++;
+
+	PMEMoid leaf = art_new_leaf(ctx, key, key_size, value);
+	if (OID_IS_NULL(leaf))
+		return -1;
+
+	PMEMoid term = OID_NULL;
+	unsigned char keys[2];
+	PMEMoid children[2];
+	unsigned cnt = 0;
+
+	if (l->key_size == i) {
+		term = *slot;
+	} else {
+		keys[cnt] = l->key[i];
+		children[cnt++] = *slot;
+	}
+
+	if (key_size == i) {
+		term = leaf;
+	} else {
+		keys[cnt] = key[i];
+		children[cnt++] = leaf;
+	}
+
+	PMEMoid oid = art_build(ctx, ART_NODE4, i - depth, key + depth, term,
+			cnt, keys, children);
+	if (OID_IS_NULL(oid))
+		return -1;
+
+	art_set_ptr(ctx, slot, oid);
+
+	return 0;
+}
+
+/*
+ * art_split_prefix -- (internal) splits the compressed path of the node at
+ * the first byte which does not match the new key
+ */
+static int
+art_split_prefix(struct art_ctx *ctx, PMEMoid *slot, uint64_t depth,
+	uint64_t p, const unsigned char *key, uint64_t key_size, PMEMoid value)
+{
+	struct art_node *n = (struct art_node *)pmemobj_direct(*slot);
+	const unsigned char *prefix = art_full_prefix(*slot, depth);
+
+	PMEMoid leaf = art_new_leaf(ctx, key, key_size, value);
+	if (OID_IS_NULL(leaf))
+		return -1;
+
+	PMEMoid term = OID_NULL;
+	unsigned char keys[2];
+	PMEMoid children[2];
+	unsigned cnt = 0;
+
+	keys[cnt] = prefix[p];
+	children[cnt++] = *slot;
+
+	if (key_size == depth + p) {
+		term = leaf;
+	} else {
+		keys[cnt] = key[depth + p];
+		children[cnt++] = leaf;
+	}
+
+	PMEMoid oid = art_build(ctx, ART_NODE4, p, key + depth, term,
+			cnt, keys, children);
+	if (OID_IS_NULL(oid))
+		return -1;
+
+	/* the rest of the path stays in the old node */
+	uint64_t len = n->prefix_len - p - 1;
+	unsigned char rest[ART_MAX_PREFIX_LEN] = {0};
+	uint64_t word;
+
+	memcpy(rest, prefix + p + 1, MIN(len, ART_MAX_PREFIX_LEN));
+	memcpy(&word, rest, sizeof(word));
+	art_set(ctx, (uint64_t *)n->prefix, word);
+	art_set(ctx, &n->prefix_len, len);
+	art_set_ptr(ctx, slot, oid);
+
+	return 0;
+}
+
+/*
+ * art_insert_key -- (internal) inserts the key, returns 1 if a new leaf was
+ * added, 0 if the value of the existing key was replaced
+ */
+static int
+art_insert_key(struct art_ctx *ctx, TOID(struct art_map) map,
+	const unsigned char *key, uint64_t key_size, PMEMoid value)
+{
+	PMEMoid *slot = &D_RW(map)->root;
+	uint64_t depth = 0;
+
+	while (!OID_IS_NULL(*slot)) {
+		if (art_type(*slot) == ART_LEAF) {
+			struct art_leaf *l =
+				(struct art_leaf *)pmemobj_direct(*slot);
+			if (art_leaf_matches(l, key, key_size)) {
+				art_set_ptr(ctx, &l->value, value);
+				return 0;
+			}
+
+			if (art_split_leaf(ctx, slot, depth, key, key_size,
+					value))
+				return -1;
+			return 1;
+		}
+
+		struct art_node *n = (struct art_node *)pmemobj_direct(*slot);
+		uint64_t p = art_prefix_mismatch(*slot, key, key_size, depth);
+		if (p < n->prefix_len) {
+			if (art_split_prefix(ctx, slot, depth, p, key,
+					key_size, value))
+				return -1;
+			return 1;
+		}
+
+		depth += n->prefix_len;
+
+		if (depth == key_size) {
+			if (!OID_IS_NULL(n->term)) {
+				struct art_leaf *l = (struct art_leaf *)
+					pmemobj_direct(n->term);
+				art_set_ptr(ctx, &l->value, value);
+				return 0;
+			}
+
+			slot = &n->term;
+			break;
+		}
+
+		PMEMoid *child = art_find_child(n, key[depth]);
+		if (child == NULL) {
+			PMEMoid leaf = art_new_leaf(ctx, key, key_size, value);
+			if (OID_IS_NULL(leaf))
+				return -1;
+			if (art_add_child(ctx, slot, key[depth], leaf))
+				return -1;
+			return 1;
+		}
+
+		slot = child;
+		depth++;
+	}
+
+	PMEMoid leaf = art_new_leaf(ctx, key, key_size, value);
+	if (OID_IS_NULL(leaf))
+		return -1;
+
+	art_set_ptr(ctx, slot, leaf);
+
+	return 1;
+}
+
+/*
+ * art_insert -- (internal) inserts the key and updates the counter
+ */
+static int
+art_insert(struct art_ctx *ctx, TOID(struct art_map) map,
+	const unsigned char *key, uint64_t key_size, PMEMoid value)
+{
+	int ret = art_insert_key(ctx, map, key, key_size, value);
+	if (ret == 1)
+		art_set(ctx, &D_RW(map)->count, D_RO(map)->count + 1);
+
+	return ret < 0 ? ret : 0;
+}
+
+/*
+ * art_remove_key -- (internal) removes the key, returns 1 and the value if
+ * the key was found
+ */
+static int
+art_remove_key(struct art_ctx *ctx, TOID(struct art_map) map,
+	const unsigned char *key, uint64_t key_size, PMEMoid *value)
+{
+	PMEMoid *slot = &D_RW(map)->root;
+	uint64_t depth = 0;
+
+	if (OID_IS_NULL(*slot))
+		return 0;
+
+	if (art_type(*slot) == ART_LEAF) {
+		struct art_leaf *l = (struct art_leaf *)pmemobj_direct(*slot);
+		if (!art_leaf_matches(l, key, key_size))
+			return 0;
+
+		*value = l->value;
+		art_defer_free(ctx, *slot);
+		art_set_ptr(ctx, slot, OID_NULL);
+		return 1;
+	}
+
+	while (1) {
+		struct art_node *n = (struct art_node *)pmemobj_direct(*slot);
+		uint64_t p = art_prefix_mismatch(*slot, key, key_size, depth);
+		if (p < n->prefix_len)
+			return 0;
+
+		depth += n->prefix_len;
+
+		if (depth == key_size) {
+			if (OID_IS_NULL(n->term))
+				return 0;
+
+			PMEMoid term = n->term;
+			*value = ((struct art_leaf *)
+				pmemobj_direct(term))->value;
+
+			if (n->num_children == 1) {
+				unsigned b;
+				PMEMoid *c = art_next_child(n, 0, &b);
+				art_collapse(ctx, slot, (unsigned char)b, *c);
+			} else {
+				art_set_ptr(ctx, &n->term, OID_NULL);
+			}
+
+			art_defer_free(ctx, term);
+			return 1;
+		}
+
+		PMEMoid *child = art_find_child(n, key[depth]);
+		if (child == NULL)
+			return 0;
+
+		if (art_type(*child) == ART_LEAF) {
+			PMEMoid leaf = *child;
+			struct art_leaf *l =
+				(struct art_leaf *)pmemobj_direct(leaf);
+			if (!art_leaf_matches(l, key, key_size))
+				return 0;
+
+			*value = l->value;
+			if (art_remove_child(ctx, slot, key[depth]))
+				return -1;
+
+			art_defer_free(ctx, leaf);
+			return 1;
+		}
+
+		slot = child;
+		depth++;
+	}
+}
+
+/*
+ * art_remove -- (internal) removes the key and updates the counter
+ */
+static int
+art_remove(struct art_ctx *ctx, TOID(struct art_map) map,
+	const unsigned char *key, uint64_t key_size, PMEMoid *value)
+{
+	int ret = art_remove_key(ctx, map, key, key_size, value);
+	if (ret == 1)
+		art_set(ctx, &D_RW(map)->count, D_RO(map)->count - 1);
+
+	return ret;
+}
+
+/*
+ * art_search -- (internal) returns the leaf of the key, NULL if not found
+ */
+static struct art_leaf *
+art_search(TOID(struct art_map) map, const unsigned char *key,
+	uint64_t key_size)
+{
+	PMEMoid oid = D_RO(map)->root;
+	uint64_t depth = 0;
+
+	while (!OID_IS_NULL(oid)) {
+		if (art_type(oid) == ART_LEAF) {
+			struct art_leaf *l =
+				(struct art_leaf *)pmemobj_direct(oid);
+			return art_leaf_matches(l, key, key_size) ? l : NULL;
+		}
+
+		struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+
+		/* only the stored part of the path, the leaf holds the key */
+		uint64_t stored = MIN(n->prefix_len, ART_MAX_PREFIX_LEN);
+		if (n->prefix_len > key_size - depth ||
+				memcmp(n->prefix, key + depth, stored) != 0)
+			return NULL;
+
+		depth += n->prefix_len;
+
+		if (depth == key_size) {
+			oid = n->term;
+			continue;
+		}
+
+		PMEMoid *child = art_find_child(n, key[depth]);
+		if (child == NULL)
+			return NULL;
+
+		oid = *child;
+		depth++;
+	}
+
+	return NULL;
+}
+
+/*
+ * art_map_create -- allocates a new art map instance
+ */
+int
+art_map_create(PMEMobjpool *pop, TOID(struct art_map) *map, void *arg)
+{
+	struct art_ctx ctx;
+	ctx.pop = pop;
+	ctx.actn = 0;
+
+	PMEMoid oid = art_reserve(&ctx, sizeof(struct art_map),
+			TOID_TYPE_NUM(struct art_map));
+	if (OID_IS_NULL(oid))
+		return -1;
+
+	pmemobj_persist(pop, pmemobj_direct(oid), sizeof(struct art_map));
+	art_set_ptr(&ctx, &map->oid, oid);
+
+	return art_finish(&ctx, 0);
+}
+
+/*
+ * art_clear_node -- (internal) frees the subtree
+ */
+static void
+art_clear_node(PMEMoid oid)
+{
+	if (OID_IS_NULL(oid))
+		return;
+
+	if (art_type(oid) != ART_LEAF) {
+		struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+		unsigned b;
+		PMEMoid *c;
+
+		art_clear_node(n->term);
+		for (unsigned from = 0; from < 256 &&
+				(c = art_next_child(n, from, &b)) != NULL;
+				from = b + 1)
+			art_clear_node(*c);
+	}
+
+	pmemobj_tx_free(oid);
+}
+
+/*
+ * art_map_clear -- removes all elements from the map
+ */
+int
+art_map_clear(PMEMobjpool *pop, TOID(struct art_map) map)
+{
+	int ret = 0;
+
+	/* the number of objects is unbounded, so a transaction is used */
+	TX_BEGIN(pop) {
+		art_clear_node(D_RO(map)->root);
+
+		TX_ADD(map);
+		D_RW(map)->root = OID_NULL;
+		D_RW(map)->count = 0;
+	} TX_ONABORT {
+		ret = 1;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * art_map_destroy -- cleanups and frees art map instance
+ */
+int
+art_map_destroy(PMEMobjpool *pop, TOID(struct art_map) *map)
+{
+	int ret = 0;
+
+	TX_BEGIN(pop) {
+		art_map_clear(pop, *map);
+		TX_ADD_DIRECT(map);
+		TX_FREE(*map);
+		*map = TOID_NULL(struct art_map);
+	} TX_ONABORT {
+		ret = 1;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * art_map_insert -- inserts a new key-value pair into the map, the value of
+ * an existing key is replaced
+ */
+int
+art_map_insert(PMEMobjpool *pop, TOID(struct art_map) map,
+	const unsigned char *key, uint64_t key_size, PMEMoid value)
+{
+	struct art_ctx ctx;
+	ctx.pop = pop;
+	ctx.actn = 0;
+
+	return art_finish(&ctx, art_insert(&ctx, map, key, key_size, value));
+}
+
+/*
+ * art_map_insert_new -- allocates a new object and inserts it into the map
+ */
+int
+art_map_insert_new(PMEMobjpool *pop, TOID(struct art_map) map,
+		const unsigned char *key, uint64_t key_size,
+		size_t size, unsigned type_num,
+		void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg),
+		void *arg)
+{
+	struct art_ctx ctx;
+	ctx.pop = pop;
+	ctx.actn = 1;
+
+	PMEMoid n = pmemobj_reserve(pop, &ctx.actv[0], size, type_num);
+	if (OID_IS_NULL(n))
+		return -1;
+
+	constructor(pop, pmemobj_direct(n), arg);
+
+	return art_finish(&ctx, art_insert(&ctx, map, key, key_size, n));
+}
+
+/*
+ * art_map_remove -- removes key-value pair from the map
+ */
+PMEMoid
+art_map_remove(PMEMobjpool *pop, TOID(struct art_map) map,
+		const unsigned char *key, uint64_t key_size)
+{
+	struct art_ctx ctx;
+	ctx.pop = pop;
+	ctx.actn = 0;
+
+	PMEMoid value = OID_NULL;
+	if (art_finish(&ctx, art_remove(&ctx, map, key, key_size,
+			&value)) != 1)
+		return OID_NULL;
+
+	return value;
+}
+
+/*
+ * art_map_remove_free -- removes and frees an object from the map
+ */
+int
+art_map_remove_free(PMEMobjpool *pop, TOID(struct art_map) map,
+		const unsigned char *key, uint64_t key_size)
+{
+	struct art_ctx ctx;
+	ctx.pop = pop;
+	ctx.actn = 0;
+
+	PMEMoid value = OID_NULL;
+	int ret = art_remove(&ctx, map, key, key_size, &value);
+	if (ret == 1 && !OID_IS_NULL(value))
+		art_defer_free(&ctx, value);
+
+	ret = art_finish(&ctx, ret);
+
+	return ret < 0 ? ret : !ret;
+}
+
+/*
+ * art_map_get -- searches for a value of the key
+ */
+PMEMoid
+art_map_get(PMEMobjpool *pop, TOID(struct art_map) map,
+		const unsigned char *key, uint64_t key_size)
+{
+	struct art_leaf *l = art_search(map, key, key_size);
+
+	return l ? l->value : OID_NULL;
+}
+
+/*
+ * art_map_lookup -- searches if key exists
+ */
+int
+art_map_lookup(PMEMobjpool *pop, TOID(struct art_map) map,
+		const unsigned char *key, uint64_t key_size)
+{
+	return art_search(map, key, key_size) != NULL;
+}
+
+/*
+ * art_foreach_node -- (internal) traverses the subtree in key order
+ */
+static int
+art_foreach_node(PMEMoid oid,
+	int (*cb)(const unsigned char *key, uint64_t key_size,
+		PMEMoid value, void *arg),
+	void *arg)
+{
+	if (OID_IS_NULL(oid))
+		return 0;
+
+	if (art_type(oid) == ART_LEAF) {
+		struct art_leaf *l = (struct art_leaf *)pmemobj_direct(oid);
+		return cb(l->key, l->key_size, l->value, arg) != 0;
+	}
+
+	struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+	unsigned b;
+	PMEMoid *c;
+
+	if (art_foreach_node(n->term, cb, arg))
+		return 1;
+
+	for (unsigned from = 0; from < 256 &&
+			(c = art_next_child(n, from, &b)) != NULL;
+			from = b + 1) {
+		if (art_foreach_node(*c, cb, arg))
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * art_foreach_from_node -- (internal) traverses the part of the subtree
+ * with keys not less than the given key
+ */
+static int
+art_foreach_from_node(PMEMoid oid, uint64_t depth,
+	const unsigned char *key, uint64_t key_size,
+	int (*cb)(const unsigned char *key, uint64_t key_size,
+		PMEMoid value, void *arg),
+	void *arg)
+{
+	if (OID_IS_NULL(oid))
+		return 0;
+
+	if (art_type(oid) == ART_LEAF) {
+		struct art_leaf *l = (struct art_leaf *)pmemobj_direct(oid);
+		if (art_key_cmp(l->key, l->key_size, key, key_size) < 0)
+			return 0;
+		return cb(l->key, l->key_size, l->value, arg) != 0;
+	}
+
+	struct art_node *n = (struct art_node *)pmemobj_direct(oid);
+	const unsigned char *prefix = art_full_prefix(oid, depth);
+
+	for (uint64_t i = 0; i < n->prefix_len; i++) {
+		/* the key ends within the path, whole subtree is greater */
+		if (depth + i == key_size)
+			return art_foreach_node(oid, cb, arg);
+
+		if (prefix[i] != key[depth + i]) {
+			if (prefix[i] < key[depth + i])
+				return 0;
+			return art_foreach_node(oid, cb, arg);
+		}
+	}
+
+	depth += n->prefix_len;
+
+	if (depth == key_size)
+		return art_foreach_node(oid, cb, arg);
+
+	/* the terminating leaf is a prefix of the key, so it is less */
+	unsigned b;
+	PMEMoid *c;
+
+	for (unsigned from = key[depth]; from < 256 &&
+			(c = art_next_child(n, from, &b)) != NULL;
+			from = b + 1) {
+		int ret = b == key[depth] ?
+			art_foreach_from_node(*c, depth + 1, key, key_size,
+				cb, arg) :
+			art_foreach_node(*c, cb, arg);
+		if (ret)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * art_map_foreach -- calls the callback for every key in lexicographic order
+ */
+int
+art_map_foreach(PMEMobjpool *pop, TOID(struct art_map) map,
+	int (*cb)(const unsigned char *key, uint64_t key_size,
+		PMEMoid value, void *arg),
+	void *arg)
+{
+	return art_foreach_node(D_RO(map)->root, cb, arg);
+}
+
+/*
+ * art_map_foreach_from -- calls the callback for every key not less than the
+ * given one, in lexicographic order
+ */
+int
+art_map_foreach_from(PMEMobjpool *pop, TOID(struct art_map) map,
+	const unsigned char *key, uint64_t key_size,
+	int (*cb)(const unsigned char *key, uint64_t key_size,
+		PMEMoid value, void *arg),
+	void *arg)
+{
+	return art_foreach_from_node(D_RO(map)->root, 0, key, key_size,
+			cb, arg);
+}
+
+/*
+ * art_map_is_empty -- checks whether the map is empty
+ */
+int
+art_map_is_empty(PMEMobjpool *pop, TOID(struct art_map) map)
+{
+	return OID_IS_NULL(D_RO(map)->root);
+}
+
+/*
+ * art_map_count -- returns number of elements in the map
+ */
+size_t
+art_map_count(PMEMobjpool *pop, TOID(struct art_map) map)
+{
+	return D_RO(map)->count;
+}
+
+/*
+ * art_map_check -- check if given persistent object is an art map
+ */
+int
+art_map_check(PMEMobjpool *pop, TOID(struct art_map) map)
+{
+	return TOID_IS_NULL(map) || !TOID_VALID(map);
+}
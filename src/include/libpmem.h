@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -128,6 +128,15 @@ void *pmem_memmove(void *pmemdest, const void *src, size_t len, unsigned flags);
 void *pmem_memcpy(void *pmemdest, const void *src, size_t len, unsigned flags);
 void *pmem_memset(void *pmemdest, int c, size_t len, unsigned flags);
 
+struct pmem_vec {
+	void *pmemdest;
+	const void *src;
+	size_t len;
+};
+
+void pmem_memcpy_v(const struct pmem_vec *vec, size_t vcnt, unsigned flags);
+void pmem_memcpy_persist_v(const struct pmem_vec *vec, size_t vcnt);
+
 /*
  * PMEM_MAJOR_VERSION and PMEM_MINOR_VERSION provide the current version of the
  * libpmem API as provided by this header file.  Applications can verify that
@@ -80,6 +80,8 @@ extern "C" {
 #define PMEM2_E_INVALID_SIZE_FORMAT		(-100014)
 #define PMEM2_E_LENGTH_UNALIGNED		(-100015)
 #define PMEM2_E_MAPPING_NOT_FOUND		(-100016)
+#define PMEM2_E_VM_RESERVATION_NOT_EMPTY	(-100017)
+#define PMEM2_E_ADDRESS_UNALIGNED		(-100018)
 
 /* config setup */
 
@@ -134,6 +136,30 @@ int pmem2_config_get_file_size(const struct pmem2_config *cfg, size_t *size);
 int pmem2_config_get_alignment(const struct pmem2_config *cfg,
 		size_t *alignment);
 
+#define PMEM2_MOVNT_THRESHOLD_DEFAULT	0 /* default */
+#define PMEM2_MOVNT_THRESHOLD_CALIBRATE	SIZE_MAX
+
+int pmem2_config_set_movnt_threshold(struct pmem2_config *cfg,
+		size_t threshold);
+
+int pmem2_config_set_async_flush(struct pmem2_config *cfg, unsigned on);
+
+#define PMEM2_PAGE_SIZE_DEFAULT	0 /* default */
+
+int pmem2_config_set_page_size(struct pmem2_config *cfg, size_t page_size);
+
+#define PMEM2_MAP_HINT_POPULATE		(1U << 0)
+#define PMEM2_MAP_HINT_WILLNEED		(1U << 1)
+#define PMEM2_MAP_HINT_SEQUENTIAL	(1U << 2)
+#define PMEM2_MAP_HINT_RANDOM		(1U << 3)
+
+int pmem2_config_set_map_hints(struct pmem2_config *cfg, unsigned hints);
+
+struct pmem2_vm_reservation;
+
+int pmem2_config_set_vm_reservation(struct pmem2_config *cfg,
+		struct pmem2_vm_reservation *rsv, size_t offset);
+
 /* mapping */
 
 struct pmem2_map;
@@ -148,6 +174,23 @@ size_t pmem2_map_get_size(struct pmem2_map *map);
 
 enum pmem2_granularity pmem2_map_get_store_granularity(struct pmem2_map *map);
 
+size_t pmem2_map_get_movnt_threshold(struct pmem2_map *map);
+
+size_t pmem2_map_get_page_size(struct pmem2_map *map);
+
+/* virtual address reservation */
+
+int pmem2_vm_reservation_new(struct pmem2_vm_reservation **rsv_ptr,
+		void *addr, size_t size);
+
+int pmem2_vm_reservation_delete(struct pmem2_vm_reservation **rsv_ptr);
+
+void *pmem2_vm_reservation_get_address(struct pmem2_vm_reservation *rsv);
+
+size_t pmem2_vm_reservation_get_size(struct pmem2_vm_reservation *rsv);
+
+int pmem2_vm_reservation_extend(struct pmem2_vm_reservation *rsv, size_t size);
+
 /* flushing */
 
 typedef void (*pmem2_persist_fn)(const void *ptr, size_t size);
@@ -162,6 +205,17 @@ pmem2_flush_fn pmem2_get_flush_fn(struct pmem2_map *map);
 
 pmem2_drain_fn pmem2_get_drain_fn(struct pmem2_map *map);
 
+struct pmem2_flush_set;
+
+int pmem2_flush_set_new(struct pmem2_flush_set **set, struct pmem2_map *map);
+
+int pmem2_flush_set_delete(struct pmem2_flush_set **set);
+
+int pmem2_flush_set_add(struct pmem2_flush_set *set, const void *ptr,
+		size_t size);
+
+int pmem2_flush_set_persist(struct pmem2_flush_set *set);
+
 #define PMEM2_F_MEM_NODRAIN	(1U << 0)
 
 #define PMEM2_F_MEM_NONTEMPORAL	(1U << 1)
@@ -194,6 +248,36 @@ pmem2_memcpy_fn pmem2_get_memcpy_fn(struct pmem2_map *map);
 
 pmem2_memset_fn pmem2_get_memset_fn(struct pmem2_map *map);
 
+struct pmem2_vec {
+	void *pmemdest;
+	const void *src;
+	size_t len;
+};
+
+typedef void (*pmem2_memcpy_v_fn)(const struct pmem2_vec *vec, size_t vcnt,
+		unsigned flags);
+
+pmem2_memcpy_v_fn pmem2_get_memcpy_v_fn(struct pmem2_map *map);
+
+/* asynchronous data movement */
+
+struct pmem2_mover;
+
+struct pmem2_future;
+
+int pmem2_mover_new(struct pmem2_mover **mover, struct pmem2_map *map,
+		unsigned nthreads);
+
+int pmem2_mover_delete(struct pmem2_mover **mover);
+
+int pmem2_memcpy_async(struct pmem2_mover *mover, void *pmemdest,
+		const void *src, size_t len, unsigned flags,
+		struct pmem2_future **future);
+
+int pmem2_future_poll(struct pmem2_future *future);
+
+int pmem2_future_wait(struct pmem2_future **future);
+
 /* RAS */
 
 #ifndef _WIN32
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -61,6 +61,22 @@ PMEMoid pmemobj_first(PMEMobjpool *pop);
  */
 PMEMoid pmemobj_next(PMEMoid oid);
 
+/*
+ * Visit only the objects of the type number passed to pmemobj_foreach_parallel.
+ */
+#define POBJ_ITER_TYPE_NUM	((uint64_t)1 << 0)
+
+#define POBJ_ITER_VALID_FLAGS	(POBJ_ITER_TYPE_NUM)
+
+/*
+ * Calls the callback for every object in the pool, on nthreads threads and in
+ * no particular order. Non-zero value returned by the callback stops the
+ * iteration and is returned by the function.
+ */
+int pmemobj_foreach_parallel(PMEMobjpool *pop, unsigned nthreads,
+	uint64_t type_num, uint64_t flags,
+	int (*cb)(PMEMoid oid, void *arg), void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2019, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -53,8 +53,10 @@
 #define pmempool_check_init pmempool_check_initW
 #define pmempool_check pmempool_checkW
 #define pmempool_sync pmempool_syncW
+#define pmempool_sync_with_args pmempool_sync_with_argsW
 #define pmempool_transform pmempool_transformW
 #define pmempool_rm pmempool_rmW
+#define pmempool_clone pmempool_cloneW
 #define pmempool_check_version pmempool_check_versionW
 #define pmempool_errormsg pmempool_errormsgW
 #define pmempool_feature_enable pmempool_feature_enableW
@@ -67,8 +69,10 @@
 #define pmempool_check_init pmempool_check_initU
 #define pmempool_check pmempool_checkU
 #define pmempool_sync pmempool_syncU
+#define pmempool_sync_with_args pmempool_sync_with_argsU
 #define pmempool_transform pmempool_transformU
 #define pmempool_rm pmempool_rmU
+#define pmempool_clone pmempool_cloneU
 #define pmempool_check_version pmempool_check_versionU
 #define pmempool_errormsg pmempool_errormsgU
 #define pmempool_feature_enable pmempool_feature_enableU
@@ -170,6 +174,30 @@ enum pmempool_check_result pmempool_check_end(PMEMpoolcheck *ppc);
  * do not apply changes, only check if operation is viable
  */
 #define PMEMPOOL_SYNC_DRY_RUN		(1U << 1)
+/*
+ * copy only the regions which differ from the healthy replica
+ */
+#define PMEMPOOL_SYNC_INCREMENTAL	(1U << 2)
+
+/*
+ * progress callback of pmempool_sync_with_args(), done and skipped are
+ * the numbers of bytes of the current copy processed so far and found
+ * identical in the replicas, total is the size of the copy
+ */
+typedef void (*pmempool_sync_progress_fn)(size_t done, size_t skipped,
+	size_t total, void *arg);
+
+/*
+ * arguments of pmempool_sync_with_args()
+ */
+struct pmempool_sync_args {
+	unsigned flags;		/* PMEMPOOL_SYNC_* flags */
+	unsigned nthreads;	/* number of copying threads, 0 - default */
+	size_t bandwidth;	/* bytes per second, 0 - unlimited */
+	unsigned progress_interval; /* ms between progress reports */
+	pmempool_sync_progress_fn progress; /* NULL - no progress reports */
+	void *progress_arg;	/* passed to the progress callback */
+};
 
 /*
  * LIBPMEMPOOL TRANSFORM
@@ -180,6 +208,15 @@ enum pmempool_check_result pmempool_check_end(PMEMpoolcheck *ppc);
  */
 #define PMEMPOOL_TRANSFORM_DRY_RUN	(1U << 1)
 
+/*
+ * LIBPMEMPOOL CLONE
+ */
+
+/*
+ * always copy the data, do not share the extents of the source files
+ */
+#define PMEMPOOL_CLONE_NO_REFLINK	(1U << 0)
+
 /*
  * PMEMPOOL_MAJOR_VERSION and PMEMPOOL_MINOR_VERSION provide the current version
  * of the libpmempool API as provided by this header file.  Applications can
@@ -272,6 +309,22 @@ int pmempool_syncU(const char *poolset_file, unsigned flags);
 int pmempool_syncW(const wchar_t *poolset_file, unsigned flags);
 #endif
 
+/*
+ * Synchronize data between replicas within a poolset with the copying
+ * threads, bandwidth and progress reporting set by args.
+ *
+ * EXPERIMENTAL
+ */
+#ifndef _WIN32
+int pmempool_sync_with_args(const char *poolset_file,
+	const struct pmempool_sync_args *args, size_t args_size);
+#else
+int pmempool_sync_with_argsU(const char *poolset_file,
+	const struct pmempool_sync_args *args, size_t args_size);
+int pmempool_sync_with_argsW(const wchar_t *poolset_file,
+	const struct pmempool_sync_args *args, size_t args_size);
+#endif
+
 /*
  * Modify internal structure of a poolset.
  *
@@ -340,6 +393,16 @@ int pmempool_rmU(const char *path, unsigned flags);
 int pmempool_rmW(const wchar_t *path, unsigned flags);
 #endif
 
+/*
+ * Make a point-in-time copy of a closed pool with its own identity.
+ */
+#ifndef _WIN32
+int pmempool_clone(const char *src, const char *dst, unsigned flags);
+#else
+int pmempool_cloneU(const char *src, const char *dst, unsigned flags);
+int pmempool_cloneW(const wchar_t *src, const wchar_t *dst, unsigned flags);
+#endif
+
 #ifndef _WIN32
 const char *pmempool_check_version(unsigned major_required,
 	unsigned minor_required);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -665,6 +665,29 @@ pmem_memcpy(void *pmemdest, const void *src, size_t len, unsigned flags)
 	return pmemdest;
 }
 
+/*
+ * pmem_memcpy_v -- memcpy vcnt ranges to pmem, with a single drain
+ */
+void
+pmem_memcpy_v(const struct pmem_vec *vec, size_t vcnt, unsigned flags)
+{
+	LOG(15, "vec %p vcnt %zu flags 0x%x", vec, vcnt, flags);
+
+#ifdef DEBUG
+	if (flags & ~PMEM_F_MEM_VALID_FLAGS)
+		ERR("invalid flags 0x%x", flags);
+#endif
+	PMEM_API_START();
+	for (size_t i = 0; i < vcnt; ++i)
+		Funcs.memmove_nodrain(vec[i].pmemdest, vec[i].src, vec[i].len,
+				flags & ~PMEM_F_MEM_NODRAIN, Funcs.flush);
+
+	if ((flags & (PMEM_F_MEM_NODRAIN | PMEM_F_MEM_NOFLUSH)) == 0)
+		pmem_drain();
+
+	PMEM_API_END();
+}
+
 /*
  * pmem_memset -- memset to pmem
  */
@@ -756,6 +779,24 @@ pmem_memcpy_persist(void *pmemdest, const void *src, size_t len)
 	return pmemdest;
 }
 
+/*
+ * pmem_memcpy_persist_v -- memcpy vcnt ranges to pmem and persist them
+ */
+void
+pmem_memcpy_persist_v(const struct pmem_vec *vec, size_t vcnt)
+{
+	LOG(15, "vec %p vcnt %zu", vec, vcnt);
+
+	PMEM_API_START();
+
+	for (size_t i = 0; i < vcnt; ++i)
+		Funcs.memmove_nodrain(vec[i].pmemdest, vec[i].src, vec[i].len,
+				0, Funcs.flush);
+	pmem_drain();
+
+	PMEM_API_END();
+}
+
 /*
  * pmem_memset_nodrain -- memset to pmem without hw drain
  */
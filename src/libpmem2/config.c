@@ -41,6 +41,7 @@
 #include "out.h"
 #include "pmem2.h"
 #include "pmem2_utils.h"
+#include "util.h"
 
 /*
  * pmem2_config_init -- initialize cfg structure.
@@ -57,6 +58,12 @@ pmem2_config_init(struct pmem2_config *cfg)
 	cfg->length = 0;
 	cfg->alignment = 0;
 	cfg->requested_max_granularity = PMEM2_GRANULARITY_INVALID;
+	cfg->movnt_threshold = PMEM2_MOVNT_THRESHOLD_DEFAULT;
+	cfg->async_flush = 0;
+	cfg->page_size = PMEM2_PAGE_SIZE_DEFAULT;
+	cfg->map_hints = 0;
+	cfg->reserv = NULL;
+	cfg->reserv_offset = 0;
 }
 
 /*
@@ -139,6 +146,89 @@ pmem2_config_set_length(struct pmem2_config *cfg, size_t length)
 	return 0;
 }
 
+/*
+ * pmem2_config_set_movnt_threshold -- set the size from which memmove and
+ * memset functions of the mapping use non-temporal stores
+ */
+int
+pmem2_config_set_movnt_threshold(struct pmem2_config *cfg, size_t threshold)
+{
+	cfg->movnt_threshold = threshold;
+
+	return 0;
+}
+
+/*
+ * pmem2_config_set_async_flush -- enable or disable syncing flushes of
+ * mappings with page granularity in the background
+ */
+int
+pmem2_config_set_async_flush(struct pmem2_config *cfg, unsigned on)
+{
+	cfg->async_flush = on ? 1 : 0;
+
+	return 0;
+}
+
+/*
+ * pmem2_config_set_page_size -- set the page size the mapping should be
+ * backed with
+ */
+int
+pmem2_config_set_page_size(struct pmem2_config *cfg, size_t page_size)
+{
+	if (page_size != PMEM2_PAGE_SIZE_DEFAULT &&
+			(!util_is_pow2(page_size) || page_size < Pagesize)) {
+		ERR("invalid page size %zu", page_size);
+		return PMEM2_E_INVALID_ARG;
+	}
+
+	cfg->page_size = page_size;
+
+	return 0;
+}
+
+#define PMEM2_MAP_HINT_VALID_FLAGS (PMEM2_MAP_HINT_POPULATE | \
+	PMEM2_MAP_HINT_WILLNEED | PMEM2_MAP_HINT_SEQUENTIAL | \
+	PMEM2_MAP_HINT_RANDOM)
+
+/*
+ * pmem2_config_set_map_hints -- set hints on how the mapping will be
+ * accessed
+ */
+int
+pmem2_config_set_map_hints(struct pmem2_config *cfg, unsigned hints)
+{
+	if (hints & ~PMEM2_MAP_HINT_VALID_FLAGS) {
+		ERR("invalid map hints 0x%x", hints);
+		return PMEM2_E_INVALID_ARG;
+	}
+
+	if ((hints & PMEM2_MAP_HINT_SEQUENTIAL) &&
+			(hints & PMEM2_MAP_HINT_RANDOM)) {
+		ERR("sequential and random access hints are exclusive");
+		return PMEM2_E_INVALID_ARG;
+	}
+
+	cfg->map_hints = hints;
+
+	return 0;
+}
+
+/*
+ * pmem2_config_set_vm_reservation -- place the mapping in the virtual memory
+ * reservation at the given offset, or anywhere if rsv is NULL
+ */
+int
+pmem2_config_set_vm_reservation(struct pmem2_config *cfg,
+		struct pmem2_vm_reservation *rsv, size_t offset)
+{
+	cfg->reserv = rsv;
+	cfg->reserv_offset = offset;
+
+	return 0;
+}
+
 /*
  * pmem2_config_validate_length -- validate that length in the pmem2_config
  * structure is consistent with the file length
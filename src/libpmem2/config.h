@@ -54,6 +54,15 @@ struct pmem2_config {
 	size_t alignment; /* required alignment of the mapping */
 	/* persistence granularity requested by user */
 	enum pmem2_granularity requested_max_granularity;
+	/* size from which non-temporal stores are used */
+	size_t movnt_threshold;
+	/* sync flushes of page granularity mappings in the background */
+	unsigned async_flush;
+	size_t page_size; /* requested page size, 0 - library default */
+	unsigned map_hints; /* PMEM2_MAP_HINT_* flags */
+	/* virtual memory reservation to place the mapping in */
+	struct pmem2_vm_reservation *reserv;
+	size_t reserv_offset; /* offset of the mapping in the reservation */
 };
 
 void pmem2_config_init(struct pmem2_config *cfg);
@@ -72,6 +72,7 @@ libpmem2_fini(void)
 {
 	LOG(3, NULL);
 
+	pmem2_persist_fini();
 	pmem2_map_fini();
 	out_fini();
 }
@@ -81,6 +81,30 @@ pmem2_map_get_store_granularity(struct pmem2_map *map)
 	return map->effective_granularity;
 }
 
+/*
+ * pmem2_map_get_movnt_threshold -- returns the size from which non-temporal
+ * stores are used by memmove and memset functions of the mapping
+ */
+size_t
+pmem2_map_get_movnt_threshold(struct pmem2_map *map)
+{
+	LOG(3, "map %p", map);
+
+	return map->movnt_threshold;
+}
+
+/*
+ * pmem2_map_get_page_size -- returns the largest page size the mapping
+ * is eligible for
+ */
+size_t
+pmem2_map_get_page_size(struct pmem2_map *map)
+{
+	LOG(3, "map %p", map);
+
+	return map->page_size;
+}
+
 /*
  * parse_force_granularity -- parse PMEM2_FORCE_GRANULARITY environment variable
  */
@@ -59,6 +59,26 @@ struct pmem2_map {
 	pmem2_flush_fn flush_fn;
 	pmem2_drain_fn drain_fn;
 
+	pmem2_memmove_fn memmove_fn;
+	pmem2_memcpy_fn memcpy_fn;
+	pmem2_memset_fn memset_fn;
+	pmem2_memcpy_v_fn memcpy_v_fn;
+
+	/* size from which non-temporal stores are used, 0 - library default */
+	size_t movnt_threshold;
+
+	/* threshold slot, valid only with a custom movnt_threshold */
+	unsigned movnt_slot;
+
+	/* flushes are synced by the background worker */
+	bool async_flush;
+
+	/* largest page size the mapping is eligible for */
+	size_t page_size;
+
+	/* reservation the mapping is placed in, if any */
+	struct pmem2_vm_reservation *reserv;
+
 #ifdef _WIN32
 	HANDLE handle;
 #endif
@@ -50,6 +50,7 @@
 #include "persist.h"
 #include "pmem2_utils.h"
 #include "valgrind_internal.h"
+#include "vm_reservation.h"
 
 #ifndef MAP_SYNC
 #define MAP_SYNC 0x80000
@@ -59,6 +60,10 @@
 #define MAP_SHARED_VALIDATE 0x03
 #endif
 
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+
 #define MEGABYTE ((uintptr_t)1 << 20)
 #define GIGABYTE ((uintptr_t)1 << 30)
 
@@ -112,10 +117,10 @@ static const char *granularity_err_msg[3][3] = {
  * layout change.
  *
  * Use 1GB page alignment only if the mapping length is at least
- * twice as big as the page size.
+ * twice as big as the page size, unless 1GB pages are explicitly requested.
  */
 static inline size_t
-get_map_alignment(size_t len, size_t req_align)
+get_map_alignment(size_t len, size_t req_align, size_t page_size)
 {
 	size_t align = 2 * MEGABYTE;
 	if (req_align)
@@ -123,6 +128,9 @@ get_map_alignment(size_t len, size_t req_align)
 	else if (len >= 2 * GIGABYTE)
 		align = GIGABYTE;
 
+	if (page_size > align)
+		align = page_size;
+
 	return align;
 }
 
@@ -272,6 +280,110 @@ unmap(void *addr, size_t len)
 	return 0;
 }
 
+/*
+ * advise -- (internal) pass the hint to the kernel, failures are not fatal
+ */
+static void
+advise(void *addr, size_t len, int advice, const char *name)
+{
+	if (madvise(addr, len, advice))
+		LOG(2, "!madvise %s", name);
+}
+
+/*
+ * map_advise -- (internal) apply the page size policy and the access hints
+ * from the config to the mapping
+ */
+static void
+map_advise(const struct pmem2_config *cfg, void *addr, size_t len)
+{
+#ifdef MADV_HUGEPAGE
+	if (cfg->page_size > Pagesize)
+		advise(addr, len, MADV_HUGEPAGE, "MADV_HUGEPAGE");
+	else if (cfg->page_size == Pagesize)
+		advise(addr, len, MADV_NOHUGEPAGE, "MADV_NOHUGEPAGE");
+#endif
+
+	/* without MAP_POPULATE ask at least for reading the pages ahead */
+	if ((cfg->map_hints & PMEM2_MAP_HINT_WILLNEED) ||
+			((cfg->map_hints & PMEM2_MAP_HINT_POPULATE) &&
+			MAP_POPULATE == 0))
+		advise(addr, len, MADV_WILLNEED, "MADV_WILLNEED");
+
+	if (cfg->map_hints & PMEM2_MAP_HINT_SEQUENTIAL)
+		advise(addr, len, MADV_SEQUENTIAL, "MADV_SEQUENTIAL");
+	else if (cfg->map_hints & PMEM2_MAP_HINT_RANDOM)
+		advise(addr, len, MADV_RANDOM, "MADV_RANDOM");
+}
+
+/*
+ * map_get_page_size -- (internal) get the largest page size the mapping
+ * is eligible for
+ *
+ * Device DAX is always mapped with pages of the device alignment. Filesystem
+ * DAX can be mapped with 2MB pages if the mapping is aligned, which doesn't
+ * apply to the page cache.
+ */
+static int
+map_get_page_size(const struct pmem2_config *cfg, enum pmem2_file_type type,
+		bool map_sync, void *addr, size_t len, size_t *page_size)
+{
+	if (type == PMEM2_FTYPE_DEVDAX)
+		return pmem2_config_get_alignment(cfg, page_size);
+
+	*page_size = Pagesize;
+	if (map_sync && cfg->page_size != Pagesize &&
+			(uintptr_t)addr % (2 * MEGABYTE) == 0 &&
+			len >= 2 * MEGABYTE)
+		*page_size = 2 * MEGABYTE;
+
+	return 0;
+}
+
+/*
+ * unmap_range -- (internal) unmap a memory range, or cover it with
+ * the placeholder again if it belongs to a reservation
+ */
+static int
+unmap_range(struct pmem2_vm_reservation *rsv, void *addr, size_t len)
+{
+	if (rsv)
+		return vm_reservation_restore_memory(addr, len);
+
+	return unmap(addr, len);
+}
+
+/*
+ * map_claim_reservation -- (internal) claim the range of the reservation
+ * requested in the config for the mapping
+ */
+static int
+map_claim_reservation(const struct pmem2_config *cfg, size_t content_length,
+		struct pmem2_map *map)
+{
+	size_t alignment;
+	int ret = pmem2_config_get_alignment(cfg, &alignment);
+	if (ret)
+		return ret;
+
+	struct pmem2_vm_reservation *rsv = cfg->reserv;
+	if (cfg->reserv_offset >= pmem2_vm_reservation_get_size(rsv)) {
+		ERR("offset %zu is out of the reservation", cfg->reserv_offset);
+		return PMEM2_E_MAP_RANGE;
+	}
+
+	map->addr = (char *)rsv->addr + cfg->reserv_offset;
+	map->reserved_length = roundup(content_length, Pagesize);
+
+	if ((uintptr_t)map->addr % alignment) {
+		ERR("address in the reservation is not a multiple of %zu",
+				alignment);
+		return PMEM2_E_OFFSET_UNALIGNED;
+	}
+
+	return vm_reservation_map_register(rsv, map);
+}
+
 /*
  * pmem2_map -- map memory according to provided config
  */
@@ -351,14 +463,34 @@ pmem2_map(const struct pmem2_config *cfg, struct pmem2_map **map_ptr)
 		content_length = file_len - cfg->offset;
 
 	const size_t alignment = get_map_alignment(content_length,
-			cfg->alignment);
+			cfg->alignment, cfg->page_size);
 
-	/* find a hint for the mapping */
-	void *reserv = NULL;
-	ret = map_reserve(content_length, alignment, &reserv, &reserved_length);
-	if (ret != 0) {
-		LOG(1, "cannot find a contiguous region of given size");
+	if (cfg->map_hints & PMEM2_MAP_HINT_POPULATE)
+		flags |= MAP_POPULATE;
+
+	/* prepare pmem2_map structure */
+	map = (struct pmem2_map *)pmem2_malloc(sizeof(*map), &ret);
+	if (!map)
 		return ret;
+
+	void *reserv = NULL;
+	map->reserv = cfg->reserv;
+	if (map->reserv) {
+		/* claim the range at the requested offset of the reservation */
+		ret = map_claim_reservation(cfg, content_length, map);
+		if (ret)
+			goto err_free;
+
+		reserv = map->addr;
+		reserved_length = map->reserved_length;
+	} else {
+		/* find a hint for the mapping */
+		ret = map_reserve(content_length, alignment, &reserv,
+				&reserved_length);
+		if (ret != 0) {
+			LOG(1, "cannot find a contiguous region of given size");
+			goto err_free;
+		}
 	}
 	ASSERTne(reserv, NULL);
 
@@ -370,14 +502,13 @@ pmem2_map(const struct pmem2_config *cfg, struct pmem2_map **map_ptr)
 				off, &map_sync, &addr);
 	}
 
-	if (ret) {
-		/* unmap the reservation mapping */
-		munmap(reserv, reserved_length);
-		return ret;
-	}
+	if (ret)
+		goto err_unmap;
 
 	LOG(3, "mapped at %p", addr);
 
+	map_advise(cfg, addr, content_length);
+
 	bool eADR = (pmem2_auto_flush() == 1);
 	enum pmem2_granularity available_min_granularity =
 		get_min_granularity(eADR, map_sync);
@@ -394,19 +525,33 @@ pmem2_map(const struct pmem2_config *cfg, struct pmem2_map **map_ptr)
 				cfg->requested_max_granularity);
 		ERR("%s", err);
 		ret = PMEM2_E_GRANULARITY_NOT_SUPPORTED;
-		goto err;
+		goto err_unmap;
 	}
 
-	/* prepare pmem2_map structure */
-	map = (struct pmem2_map *)pmem2_malloc(sizeof(*map), &ret);
-	if (!map)
-		goto err;
+	ret = map_get_page_size(cfg, file_type, map_sync, addr, content_length,
+			&map->page_size);
+	if (ret)
+		goto err_unmap;
 
 	map->addr = addr;
 	map->reserved_length = reserved_length;
 	map->content_length = content_length;
 	map->effective_granularity = available_min_granularity;
+	map->async_flush = false;
 	pmem2_set_flush_fns(map);
+	pmem2_set_mem_fns(map);
+
+	ret = pmem2_set_movnt_threshold(map, cfg->movnt_threshold,
+			proto & PROT_WRITE);
+	if (ret)
+		goto err_unmap;
+
+	if (cfg->async_flush &&
+			map->effective_granularity == PMEM2_GRANULARITY_PAGE) {
+		ret = pmem2_async_flush_acquire(map);
+		if (ret)
+			goto err_async;
+	}
 
 	ret = pmem2_register_mapping(map);
 	if (ret)
@@ -420,11 +565,16 @@ pmem2_map(const struct pmem2_config *cfg, struct pmem2_map **map_ptr)
 	return 0;
 
 err_register:
-	free(map);
-err:
-	unmap(addr, reserved_length);
+	pmem2_async_flush_release(map);
+err_async:
+	pmem2_clear_movnt_threshold(map);
+err_unmap:
+	unmap_range(map->reserv, reserv, reserved_length);
+	if (map->reserv)
+		vm_reservation_map_unregister(map->reserv, map);
+err_free:
+	Free(map);
 	return ret;
-
 }
 
 /*
@@ -438,14 +588,22 @@ pmem2_unmap(struct pmem2_map **map_ptr)
 	int ret = 0;
 	struct pmem2_map *map = *map_ptr;
 
+	/* the worker has to find the mapping to sync its queued ranges */
+	pmem2_async_flush_release(map);
+
 	ret = pmem2_unregister_mapping(map);
 	if (ret)
 		return ret;
 
-	ret = unmap(map->addr, map->reserved_length);
+	pmem2_clear_movnt_threshold(map);
+
+	ret = unmap_range(map->reserv, map->addr, map->reserved_length);
 	if (ret)
 		return ret;
 
+	if (map->reserv)
+		vm_reservation_map_unregister(map->reserv, map);
+
 	VALGRIND_REMOVE_PMEM_MAPPING(map->addr, map->content_length);
 
 	Free(map);
@@ -152,6 +152,11 @@ pmem2_map(const struct pmem2_config *cfg, struct pmem2_map **map_ptr)
 		return PMEM2_E_GRANULARITY_NOT_SET;
 	}
 
+	if (cfg->reserv) {
+		ERR("virtual memory reservations are not supported on Windows");
+		return PMEM2_E_NOSUPP;
+	}
+
 	ret = pmem2_config_get_file_size(cfg, &file_size);
 	if (ret)
 		return ret;
@@ -251,7 +256,24 @@ pmem2_map(const struct pmem2_config *cfg, struct pmem2_map **map_ptr)
 	map->content_length = length;
 	map->effective_granularity = available_min_granularity;
 	map->handle = cfg->handle;
+	map->async_flush = false;
+	map->reserv = NULL;
+	/* XXX page size and access hints are not supported on Windows */
+	map->page_size = Pagesize;
 	pmem2_set_flush_fns(map);
+	pmem2_set_mem_fns(map);
+
+	ret = pmem2_set_movnt_threshold(map, cfg->movnt_threshold,
+			access == FILE_MAP_ALL_ACCESS);
+	if (ret)
+		goto err_threshold;
+
+	if (cfg->async_flush &&
+			map->effective_granularity == PMEM2_GRANULARITY_PAGE) {
+		ret = pmem2_async_flush_acquire(map);
+		if (ret)
+			goto err_async;
+	}
 
 	ret = pmem2_register_mapping(map);
 	if (ret)
@@ -263,6 +285,10 @@ pmem2_map(const struct pmem2_config *cfg, struct pmem2_map **map_ptr)
 	return ret;
 
 err_register:
+	pmem2_async_flush_release(map);
+err_async:
+	pmem2_clear_movnt_threshold(map);
+err_threshold:
 	free(map);
 
 err_unmap_base:
@@ -284,10 +310,15 @@ pmem2_unmap(struct pmem2_map **map_ptr)
 
 	struct pmem2_map *map = *map_ptr;
 
+	/* the worker has to find the mapping to sync its queued ranges */
+	pmem2_async_flush_release(map);
+
 	int ret = pmem2_unregister_mapping(map);
 	if (ret)
 		return ret;
 
+	pmem2_clear_movnt_threshold(map);
+
 	if (!UnmapViewOfFile(map->addr)) {
 		ERR("!!UnmapViewOfFile");
 		return pmem2_lasterror_to_err();
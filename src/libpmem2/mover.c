@@ -0,0 +1,388 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * mover.c -- asynchronous data movement for libpmem2
+ */
+
+#include <errno.h>
+
+#include "alloc.h"
+#include "libpmem2.h"
+#include "map.h"
+#include "mover.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "sys_util.h"
+#include "util.h"
+
+/* minimal size of a chunk copied by one worker of the software engine */
+#define MOVER_MIN_CHUNK (1 << 20) /* 1 MiB */
+
+/*
+ * mover_complete_chunks -- (internal) mark nchunks chunks of the future as
+ * completed, must be called with the mover lock held
+ */
+static void
+mover_complete_chunks(struct pmem2_mover *mover, struct pmem2_future *future,
+		unsigned nchunks)
+{
+	/* the counter is read without the lock by pmem2_future_poll */
+	if (util_fetch_and_sub32(&future->remaining, nchunks) == nchunks)
+		os_cond_broadcast(&mover->done_cond);
+}
+
+/*
+ * mover_sw_worker -- (internal) copy the queued chunks until stopped
+ *
+ * A drain covers only the stores of the thread which issues it, so every
+ * worker drains its own stores, but only once for all the chunks of
+ * a future it has copied one after another.
+ */
+static void *
+mover_sw_worker(void *arg)
+{
+	struct pmem2_mover *mover = arg;
+	pmem2_memcpy_fn memcpy_fn = pmem2_get_memcpy_fn(mover->map);
+	pmem2_drain_fn drain_fn = pmem2_get_drain_fn(mover->map);
+
+	/* chunks copied, but not drained yet */
+	struct pmem2_future *copied = NULL;
+	unsigned ncopied = 0;
+
+	util_mutex_lock(&mover->lock);
+	while (1) {
+		while (PMDK_TAILQ_EMPTY(&mover->queue) && !mover->stop)
+			os_cond_wait(&mover->work_cond, &mover->lock);
+
+		if (PMDK_TAILQ_EMPTY(&mover->queue))
+			break;
+
+		struct mover_chunk *chunk = PMDK_TAILQ_FIRST(&mover->queue);
+		PMDK_TAILQ_REMOVE(&mover->queue, chunk, next);
+		util_mutex_unlock(&mover->lock);
+
+		struct pmem2_future *future = chunk->future;
+		memcpy_fn((char *)future->dest + chunk->offset,
+			(const char *)future->src + chunk->offset,
+			chunk->len, future->flags | PMEM2_F_MEM_NODRAIN);
+
+		copied = future;
+		ncopied++;
+
+		util_mutex_lock(&mover->lock);
+		struct mover_chunk *next = PMDK_TAILQ_FIRST(&mover->queue);
+		if (next && next->future == copied)
+			continue;
+
+		/*
+		 * The worker cannot leave its stores for anyone else to
+		 * drain, so it drains them even if the caller asked for
+		 * PMEM2_F_MEM_NODRAIN.
+		 */
+		util_mutex_unlock(&mover->lock);
+		drain_fn();
+		util_mutex_lock(&mover->lock);
+
+		mover_complete_chunks(mover, copied, ncopied);
+		copied = NULL;
+		ncopied = 0;
+	}
+	util_mutex_unlock(&mover->lock);
+
+	return NULL;
+}
+
+/*
+ * mover_sw_nchunks -- (internal) split the copy between the workers,
+ * but don't make the chunks smaller than MOVER_MIN_CHUNK
+ */
+static unsigned
+mover_sw_nchunks(struct pmem2_mover *mover, size_t len)
+{
+	size_t nchunks = len / MOVER_MIN_CHUNK;
+
+	if (nchunks > mover->nthreads)
+		nchunks = mover->nthreads;
+
+	return nchunks ? (unsigned)nchunks : 1;
+}
+
+/*
+ * mover_sw_submit -- (internal) queue the chunks of the future
+ */
+static void
+mover_sw_submit(struct pmem2_mover *mover, struct pmem2_future *future)
+{
+	/*
+	 * Chunks, except the first one, start at cache line boundaries of
+	 * the destination, so no cache line is written by two workers.
+	 */
+	uintptr_t dest = (uintptr_t)future->dest;
+	size_t chunk_len = future->len / future->nchunks;
+	size_t offset = 0;
+
+	for (unsigned i = 0; i < future->nchunks; ++i) {
+		size_t end = future->len;
+		if (i != future->nchunks - 1) {
+			end = ALIGN_UP(dest + (i + 1) * chunk_len,
+				CACHELINE_SIZE) - dest;
+			if (end > future->len)
+				end = future->len;
+		}
+
+		struct mover_chunk *chunk = &future->chunks[i];
+		chunk->future = future;
+		chunk->offset = offset;
+		chunk->len = end - offset;
+		offset = end;
+	}
+
+	util_mutex_lock(&mover->lock);
+	for (unsigned i = 0; i < future->nchunks; ++i)
+		PMDK_TAILQ_INSERT_TAIL(&mover->queue, &future->chunks[i], next);
+	os_cond_broadcast(&mover->work_cond);
+	util_mutex_unlock(&mover->lock);
+}
+
+/*
+ * mover_sw_fini -- (internal) stop the workers once the queue is empty
+ */
+static void
+mover_sw_fini(struct pmem2_mover *mover)
+{
+	util_mutex_lock(&mover->lock);
+	mover->stop = 1;
+	os_cond_broadcast(&mover->work_cond);
+	util_mutex_unlock(&mover->lock);
+
+	for (unsigned i = 0; i < mover->nthreads; ++i)
+		os_thread_join(&mover->threads[i], NULL);
+}
+
+static const struct mover_ops Mover_sw_ops = {
+	.nchunks = mover_sw_nchunks,
+	.submit = mover_sw_submit,
+	.fini = mover_sw_fini,
+};
+
+/*
+ * pmem2_mover_new -- create a mover which copies data to the mapping
+ * with nthreads threads
+ */
+int
+pmem2_mover_new(struct pmem2_mover **mover_ptr, struct pmem2_map *map,
+		unsigned nthreads)
+{
+	LOG(3, "mover_ptr %p map %p nthreads %u", mover_ptr, map, nthreads);
+
+	int ret;
+	*mover_ptr = NULL;
+
+	if (nthreads == 0) {
+		ERR("number of threads cannot be 0");
+		return PMEM2_E_INVALID_ARG;
+	}
+
+	struct pmem2_mover *mover = pmem2_malloc(sizeof(*mover), &ret);
+	if (!mover)
+		return ret;
+
+	mover->threads = pmem2_malloc(nthreads * sizeof(*mover->threads),
+		&ret);
+	if (!mover->threads)
+		goto err_free_mover;
+
+	mover->map = map;
+	mover->ops = &Mover_sw_ops;
+	mover->stop = 0;
+	mover->nfutures = 0;
+	mover->nthreads = 0;
+	PMDK_TAILQ_INIT(&mover->queue);
+	util_mutex_init(&mover->lock);
+	util_cond_init(&mover->work_cond);
+	util_cond_init(&mover->done_cond);
+
+	for (unsigned i = 0; i < nthreads; ++i) {
+		ret = os_thread_create(&mover->threads[i], NULL,
+			mover_sw_worker, mover);
+		if (ret) {
+			errno = ret;
+			ERR("!os_thread_create");
+			ret = PMEM2_E_ERRNO;
+			goto err_stop;
+		}
+		mover->nthreads++;
+	}
+
+	*mover_ptr = mover;
+
+	return 0;
+
+err_stop:
+	mover->ops->fini(mover);
+	util_cond_destroy(&mover->done_cond);
+	util_cond_destroy(&mover->work_cond);
+	util_mutex_destroy(&mover->lock);
+	Free(mover->threads);
+err_free_mover:
+	Free(mover);
+	return ret;
+}
+
+/*
+ * pmem2_mover_delete -- stop the threads and delete the mover, unless
+ * some of its futures were not waited for yet
+ */
+int
+pmem2_mover_delete(struct pmem2_mover **mover_ptr)
+{
+	LOG(3, "mover_ptr %p", mover_ptr);
+
+	struct pmem2_mover *mover = *mover_ptr;
+
+	util_mutex_lock(&mover->lock);
+	unsigned nfutures = mover->nfutures;
+	util_mutex_unlock(&mover->lock);
+
+	if (nfutures != 0) {
+		ERR("%u futures of the mover were not waited for", nfutures);
+		return -EBUSY;
+	}
+
+	mover->ops->fini(mover);
+
+	util_cond_destroy(&mover->done_cond);
+	util_cond_destroy(&mover->work_cond);
+	util_mutex_destroy(&mover->lock);
+	Free(mover->threads);
+	Free(mover);
+
+	*mover_ptr = NULL;
+
+	return 0;
+}
+
+/*
+ * pmem2_memcpy_async -- start copying len bytes from src to the mapping
+ * of the mover
+ */
+int
+pmem2_memcpy_async(struct pmem2_mover *mover, void *pmemdest, const void *src,
+		size_t len, unsigned flags, struct pmem2_future **future_ptr)
+{
+	LOG(15, "mover %p pmemdest %p src %p len %zu flags 0x%x", mover,
+		pmemdest, src, len, flags);
+
+	int ret;
+	*future_ptr = NULL;
+
+	if (flags & ~PMEM2_F_MEM_VALID_FLAGS) {
+		ERR("invalid flags 0x%x", flags);
+		return PMEM2_E_INVALID_ARG;
+	}
+
+	uintptr_t map_begin = (uintptr_t)mover->map->addr;
+	uintptr_t map_end = map_begin + mover->map->content_length;
+	uintptr_t begin = (uintptr_t)pmemdest;
+
+	if (begin < map_begin || begin > map_end || len > map_end - begin) {
+		ERR("range %p-%p is outside of the mapping", pmemdest,
+			(char *)pmemdest + len);
+		return PMEM2_E_INVALID_ARG;
+	}
+
+	unsigned nchunks = len ? mover->ops->nchunks(mover, len) : 0;
+
+	struct pmem2_future *future = pmem2_malloc(sizeof(*future) +
+		nchunks * sizeof(future->chunks[0]), &ret);
+	if (!future)
+		return ret;
+
+	future->mover = mover;
+	future->dest = pmemdest;
+	future->src = src;
+	future->len = len;
+	future->flags = flags;
+	future->remaining = nchunks;
+	future->nchunks = nchunks;
+
+	util_mutex_lock(&mover->lock);
+	mover->nfutures++;
+	util_mutex_unlock(&mover->lock);
+
+	if (nchunks)
+		mover->ops->submit(mover, future);
+
+	*future_ptr = future;
+
+	return 0;
+}
+
+/*
+ * pmem2_future_poll -- check if the copy is completed
+ */
+int
+pmem2_future_poll(struct pmem2_future *future)
+{
+	LOG(15, "future %p", future);
+
+	unsigned remaining;
+	util_atomic_load_explicit32(&future->remaining, &remaining,
+		memory_order_acquire);
+
+	return remaining == 0;
+}
+
+/*
+ * pmem2_future_wait -- wait until the copy is completed and free the future
+ */
+int
+pmem2_future_wait(struct pmem2_future **future_ptr)
+{
+	LOG(15, "future_ptr %p", future_ptr);
+
+	struct pmem2_future *future = *future_ptr;
+	struct pmem2_mover *mover = future->mover;
+
+	util_mutex_lock(&mover->lock);
+	while (future->remaining != 0)
+		os_cond_wait(&mover->done_cond, &mover->lock);
+	mover->nfutures--;
+	util_mutex_unlock(&mover->lock);
+
+	Free(future);
+	*future_ptr = NULL;
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * mover.h -- internal definitions for libpmem2 asynchronous data movement
+ */
+#ifndef PMEM2_MOVER_H
+#define PMEM2_MOVER_H
+
+#include <stddef.h>
+
+#include "libpmem2.h"
+#include "os_thread.h"
+#include "queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* part of a future executed by one worker of the software engine */
+struct mover_chunk {
+	PMDK_TAILQ_ENTRY(mover_chunk) next;
+	struct pmem2_future *future;
+	size_t offset;
+	size_t len;
+};
+
+struct pmem2_future {
+	struct pmem2_mover *mover;
+	void *dest;
+	const void *src;
+	size_t len;
+	unsigned flags;
+
+	unsigned remaining; /* number of chunks not completed yet */
+	unsigned nchunks;
+	struct mover_chunk chunks[];
+};
+
+/*
+ * Data movement engine backing a mover. The software engine, which copies
+ * the data with a pool of threads, is the only one for now; an engine
+ * offloading the copies to hardware has to implement the same operations.
+ */
+struct mover_ops {
+	/* splits the future into chunks, called before its allocation */
+	unsigned (*nchunks)(struct pmem2_mover *mover, size_t len);
+	/* starts executing the future */
+	void (*submit)(struct pmem2_mover *mover, struct pmem2_future *future);
+	/* stops the engine once all submitted futures are completed */
+	void (*fini)(struct pmem2_mover *mover);
+};
+
+struct pmem2_mover {
+	struct pmem2_map *map;
+	const struct mover_ops *ops;
+
+	os_mutex_t lock;
+	os_cond_t work_cond; /* signaled when chunks are queued or on stop */
+	os_cond_t done_cond; /* signaled when a future is completed */
+	int stop;
+	unsigned nfutures; /* number of futures not waited for yet */
+	PMDK_TAILQ_HEAD(mover_queue, mover_chunk) queue;
+
+	unsigned nthreads;
+	os_thread_t *threads;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PMEM2_MOVER_H */
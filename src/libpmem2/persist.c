@@ -31,21 +31,55 @@
  */
 
 /*
- * persist.c -- pmem2_get_[persist|flush|drain]_fn
+ * persist.c -- pmem2_get_[persist|flush|drain|memmove|memcpy|memset]_fn
  */
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include "alloc.h"
 #include "libpmem2.h"
 #include "map.h"
+#include "os.h"
 #include "out.h"
 #include "persist.h"
 #include "pmem2_arch.h"
+#include "pmem2_utils.h"
+#include "sys_util.h"
 #include "valgrind_internal.h"
 
+/*
+ * Range of copy sizes tried by the calibration of the non-temporal stores
+ * threshold and the number of bytes of the mapping rewritten for each size.
+ */
+#define MOVNT_CALIBRATE_MIN	128
+#define MOVNT_CALIBRATE_MAX	(64 * 1024)
+#define MOVNT_CALIBRATE_LEN	(1 << 20)
+#define MOVNT_CALIBRATE_PASSES	3
+
 static struct pmem2_arch_info Info;
 
+/*
+ * The public memmove/memset signatures carry no mapping, so a custom
+ * non-temporal stores threshold is bound to the function pointers instead
+ * of being looked up on every call.
+ */
+#define MOVNT_SLOTS 16
+
+struct movnt_slot {
+	size_t threshold;
+	unsigned nmaps;
+};
+
+static struct movnt_slot Movnt_slots[MOVNT_SLOTS];
+static os_mutex_t Movnt_slots_lock;
+
+static void pmem2_async_flush_init(void);
+static void pmem2_async_flush_fini(void);
+
 /*
  * pmem2_persist_init -- initialize persist module
  */
@@ -59,6 +93,21 @@ pmem2_persist_init(void)
 	Info.flush_has_builtin_fence = 0;
 
 	pmem2_arch_init(&Info);
+
+	util_mutex_init(&Movnt_slots_lock);
+
+	pmem2_async_flush_init();
+}
+
+/*
+ * pmem2_persist_fini -- finalize persist module
+ */
+void
+pmem2_persist_fini(void)
+{
+	pmem2_async_flush_fini();
+
+	util_mutex_destroy(&Movnt_slots_lock);
 }
 
 /*
@@ -237,6 +286,476 @@ pmem2_drain_nop(void)
 	LOG(15, NULL);
 }
 
+/*
+ * flush_empty -- (internal) do not flush the CPU cache
+ */
+static void
+flush_empty(const void *addr, size_t len)
+{
+	flush_empty_nolog(addr, len);
+}
+
+/*
+ * pmem2_movnt_flags -- (internal) choose between temporal and non-temporal
+ * stores using the threshold of the mapping, 0 means the library default
+ */
+static inline unsigned
+pmem2_movnt_flags(size_t len, unsigned flags, size_t threshold)
+{
+	if (threshold == PMEM2_MOVNT_THRESHOLD_DEFAULT)
+		return flags;
+
+	/* the caller has already chosen the instructions */
+	if (flags & (PMEM2_F_MEM_NONTEMPORAL | PMEM2_F_MEM_TEMPORAL |
+			PMEM2_F_MEM_WC | PMEM2_F_MEM_WB | PMEM2_F_MEM_NOFLUSH))
+		return flags;
+
+	if (len < threshold)
+		return flags | PMEM2_F_MEM_TEMPORAL;
+
+	return flags | PMEM2_F_MEM_NONTEMPORAL;
+}
+
+#ifdef DEBUG
+/*
+ * pmem2_check_mem_flags -- (internal) report unknown memmove/memset flags
+ */
+static inline void
+pmem2_check_mem_flags(unsigned flags)
+{
+	if (flags & ~PMEM2_F_MEM_VALID_FLAGS)
+		ERR("invalid flags 0x%x", flags);
+}
+#else
+#define pmem2_check_mem_flags(flags) do {} while (0)
+#endif
+
+/*
+ * memmove_page -- (internal) memmove to memory which is flushed by the OS
+ */
+static inline void
+memmove_page(void *pmemdest, const void *src, size_t len, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "pmemdest %p src %p len %zu flags 0x%x",
+		pmemdest, src, len, flags);
+	pmem2_check_mem_flags(flags);
+
+	flags = pmem2_movnt_flags(len, flags, threshold);
+	Info.memmove_nodrain(pmemdest, src, len,
+		flags & ~PMEM2_F_MEM_NODRAIN, flush_empty);
+
+	pmem2_persist_pages(pmemdest, len);
+}
+
+/*
+ * memmove_cache_line -- (internal) memmove to memory which requires flushing
+ * CPU caches
+ */
+static inline void
+memmove_cache_line(void *pmemdest, const void *src, size_t len,
+		unsigned flags, size_t threshold)
+{
+	LOG(15, "pmemdest %p src %p len %zu flags 0x%x",
+		pmemdest, src, len, flags);
+	pmem2_check_mem_flags(flags);
+
+	flags = pmem2_movnt_flags(len, flags, threshold);
+	Info.memmove_nodrain(pmemdest, src, len,
+		flags & ~PMEM2_F_MEM_NODRAIN, Info.flush);
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+/*
+ * memmove_byte -- (internal) memmove to memory with CPU caches in
+ * the persistence domain
+ */
+static inline void
+memmove_byte(void *pmemdest, const void *src, size_t len, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "pmemdest %p src %p len %zu flags 0x%x",
+		pmemdest, src, len, flags);
+	pmem2_check_mem_flags(flags);
+
+	flags = pmem2_movnt_flags(len, flags, threshold);
+	Info.memmove_nodrain(pmemdest, src, len,
+		flags & ~PMEM2_F_MEM_NODRAIN, flush_empty);
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+/*
+ * memset_page -- (internal) memset to memory which is flushed by the OS
+ */
+static inline void
+memset_page(void *pmemdest, int c, size_t len, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "pmemdest %p c 0x%x len %zu flags 0x%x",
+		pmemdest, c, len, flags);
+	pmem2_check_mem_flags(flags);
+
+	flags = pmem2_movnt_flags(len, flags, threshold);
+	Info.memset_nodrain(pmemdest, c, len,
+		flags & ~PMEM2_F_MEM_NODRAIN, flush_empty);
+
+	pmem2_persist_pages(pmemdest, len);
+}
+
+/*
+ * memset_cache_line -- (internal) memset to memory which requires flushing
+ * CPU caches
+ */
+static inline void
+memset_cache_line(void *pmemdest, int c, size_t len, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "pmemdest %p c 0x%x len %zu flags 0x%x",
+		pmemdest, c, len, flags);
+	pmem2_check_mem_flags(flags);
+
+	flags = pmem2_movnt_flags(len, flags, threshold);
+	Info.memset_nodrain(pmemdest, c, len,
+		flags & ~PMEM2_F_MEM_NODRAIN, Info.flush);
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+/*
+ * memset_byte -- (internal) memset to memory with CPU caches in
+ * the persistence domain
+ */
+static inline void
+memset_byte(void *pmemdest, int c, size_t len, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "pmemdest %p c 0x%x len %zu flags 0x%x",
+		pmemdest, c, len, flags);
+	pmem2_check_mem_flags(flags);
+
+	flags = pmem2_movnt_flags(len, flags, threshold);
+	Info.memset_nodrain(pmemdest, c, len,
+		flags & ~PMEM2_F_MEM_NODRAIN, flush_empty);
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+struct pmem2_flush_range {
+	uintptr_t begin;
+	uintptr_t end;
+};
+
+/*
+ * flush_range_compare -- (internal) compare flush ranges by start address
+ */
+static int
+flush_range_compare(const void *lhs, const void *rhs)
+{
+	const struct pmem2_flush_range *l = lhs;
+	const struct pmem2_flush_range *r = rhs;
+
+	if (l->begin < r->begin)
+		return -1;
+	if (l->begin > r->begin)
+		return 1;
+	return 0;
+}
+
+/*
+ * flush_ranges_merge -- (internal) sort the ranges and merge the ones
+ * which overlap or touch each other, returns the new number of ranges
+ */
+static size_t
+flush_ranges_merge(struct pmem2_flush_range *ranges, size_t nranges)
+{
+	if (nranges < 2)
+		return nranges;
+
+	qsort(ranges, nranges, sizeof(*ranges), flush_range_compare);
+
+	size_t n = 0;
+	for (size_t i = 1; i < nranges; ++i) {
+		struct pmem2_flush_range *cur = &ranges[n];
+		struct pmem2_flush_range *next = &ranges[i];
+
+		if (next->begin <= cur->end) {
+			cur->end = MAX(cur->end, next->end);
+		} else {
+			ranges[++n] = *next;
+		}
+	}
+
+	return n + 1;
+}
+
+/* number of ranges sorted and merged at once by memcpy_v_page */
+#define MEMCPY_V_PAGE_RANGES 64
+
+/*
+ * memcpy_v_page -- (internal) memcpy vcnt ranges to memory which is flushed
+ * by the OS, syncing every page touched by neighbouring ranges once
+ */
+static inline void
+memcpy_v_page(const struct pmem2_vec *vec, size_t vcnt, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "vec %p vcnt %zu flags 0x%x", vec, vcnt, flags);
+	pmem2_check_mem_flags(flags);
+
+	struct pmem2_flush_range ranges[MEMCPY_V_PAGE_RANGES];
+
+	for (size_t i = 0; i < vcnt; i += MEMCPY_V_PAGE_RANGES) {
+		size_t n = 0;
+		for (size_t j = i; j < vcnt && j < i + MEMCPY_V_PAGE_RANGES;
+				++j) {
+			if (vec[j].len == 0)
+				continue;
+
+			unsigned f = pmem2_movnt_flags(vec[j].len, flags,
+				threshold);
+			Info.memmove_nodrain(vec[j].pmemdest, vec[j].src,
+				vec[j].len, f & ~PMEM2_F_MEM_NODRAIN,
+				flush_empty);
+
+			uintptr_t begin = (uintptr_t)vec[j].pmemdest;
+			ranges[n].begin = ALIGN_DOWN(begin, Pagesize);
+			ranges[n].end = ALIGN_UP(begin + vec[j].len, Pagesize);
+			n++;
+		}
+
+		n = flush_ranges_merge(ranges, n);
+		for (size_t j = 0; j < n; ++j)
+			pmem2_persist_pages((const void *)ranges[j].begin,
+				ranges[j].end - ranges[j].begin);
+	}
+}
+
+/*
+ * memcpy_v_cache_line -- (internal) memcpy vcnt ranges to memory which
+ * requires flushing CPU caches, with a single drain
+ */
+static inline void
+memcpy_v_cache_line(const struct pmem2_vec *vec, size_t vcnt, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "vec %p vcnt %zu flags 0x%x", vec, vcnt, flags);
+	pmem2_check_mem_flags(flags);
+
+	for (size_t i = 0; i < vcnt; ++i) {
+		unsigned f = pmem2_movnt_flags(vec[i].len, flags, threshold);
+		Info.memmove_nodrain(vec[i].pmemdest, vec[i].src, vec[i].len,
+			f & ~PMEM2_F_MEM_NODRAIN, Info.flush);
+	}
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+/*
+ * memcpy_v_byte -- (internal) memcpy vcnt ranges to memory with CPU caches
+ * in the persistence domain, with a single drain
+ */
+static inline void
+memcpy_v_byte(const struct pmem2_vec *vec, size_t vcnt, unsigned flags,
+		size_t threshold)
+{
+	LOG(15, "vec %p vcnt %zu flags 0x%x", vec, vcnt, flags);
+	pmem2_check_mem_flags(flags);
+
+	for (size_t i = 0; i < vcnt; ++i) {
+		unsigned f = pmem2_movnt_flags(vec[i].len, flags, threshold);
+		Info.memmove_nodrain(vec[i].pmemdest, vec[i].src, vec[i].len,
+			f & ~PMEM2_F_MEM_NODRAIN, flush_empty);
+	}
+
+	if ((flags & (PMEM2_F_MEM_NODRAIN | PMEM2_F_MEM_NOFLUSH)) == 0)
+		pmem2_drain();
+}
+
+/*
+ * pmem2_memmove_nonpmem -- memmove to memory which is flushed by the OS
+ */
+static void
+pmem2_memmove_nonpmem(void *pmemdest, const void *src, size_t len,
+		unsigned flags)
+{
+	memmove_page(pmemdest, src, len, flags,
+		PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memmove -- memmove to memory which requires flushing CPU caches
+ */
+static void
+pmem2_memmove(void *pmemdest, const void *src, size_t len, unsigned flags)
+{
+	memmove_cache_line(pmemdest, src, len, flags,
+		PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memmove_eadr -- memmove to memory with CPU caches in the persistence
+ * domain
+ */
+static void
+pmem2_memmove_eadr(void *pmemdest, const void *src, size_t len,
+		unsigned flags)
+{
+	memmove_byte(pmemdest, src, len, flags,
+		PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memset_nonpmem -- memset to memory which is flushed by the OS
+ */
+static void
+pmem2_memset_nonpmem(void *pmemdest, int c, size_t len, unsigned flags)
+{
+	memset_page(pmemdest, c, len, flags, PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memset -- memset to memory which requires flushing CPU caches
+ */
+static void
+pmem2_memset(void *pmemdest, int c, size_t len, unsigned flags)
+{
+	memset_cache_line(pmemdest, c, len, flags,
+		PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memset_eadr -- memset to memory with CPU caches in the persistence
+ * domain
+ */
+static void
+pmem2_memset_eadr(void *pmemdest, int c, size_t len, unsigned flags)
+{
+	memset_byte(pmemdest, c, len, flags, PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memcpy_v_nonpmem -- memcpy vcnt ranges to memory which is flushed
+ * by the OS
+ */
+static void
+pmem2_memcpy_v_nonpmem(const struct pmem2_vec *vec, size_t vcnt,
+		unsigned flags)
+{
+	memcpy_v_page(vec, vcnt, flags, PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memcpy_v -- memcpy vcnt ranges to memory which requires flushing
+ * CPU caches, with a single drain
+ */
+static void
+pmem2_memcpy_v(const struct pmem2_vec *vec, size_t vcnt, unsigned flags)
+{
+	memcpy_v_cache_line(vec, vcnt, flags, PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * pmem2_memcpy_v_eadr -- memcpy vcnt ranges to memory with CPU caches in
+ * the persistence domain, with a single drain
+ */
+static void
+pmem2_memcpy_v_eadr(const struct pmem2_vec *vec, size_t vcnt, unsigned flags)
+{
+	memcpy_v_byte(vec, vcnt, flags, PMEM2_MOVNT_THRESHOLD_DEFAULT);
+}
+
+/*
+ * Each slot holds one custom threshold value, shared by all mappings using
+ * it, and has its own set of memmove/memset functions reading it.
+ */
+#define MOVNT_SLOT_GRAN_FNS(gran, k)\
+static void \
+pmem2_memmove_##gran##_##k(void *pmemdest, const void *src, size_t len,\
+		unsigned flags)\
+{\
+	memmove_##gran(pmemdest, src, len, flags, Movnt_slots[k].threshold);\
+}\
+static void \
+pmem2_memset_##gran##_##k(void *pmemdest, int c, size_t len, unsigned flags)\
+{\
+	memset_##gran(pmemdest, c, len, flags, Movnt_slots[k].threshold);\
+}\
+static void \
+pmem2_memcpy_v_##gran##_##k(const struct pmem2_vec *vec, size_t vcnt,\
+		unsigned flags)\
+{\
+	memcpy_v_##gran(vec, vcnt, flags, Movnt_slots[k].threshold);\
+}
+
+#define MOVNT_SLOT_FNS(k)\
+MOVNT_SLOT_GRAN_FNS(page, k)\
+MOVNT_SLOT_GRAN_FNS(cache_line, k)\
+MOVNT_SLOT_GRAN_FNS(byte, k)
+
+MOVNT_SLOT_FNS(0)
+MOVNT_SLOT_FNS(1)
+MOVNT_SLOT_FNS(2)
+MOVNT_SLOT_FNS(3)
+MOVNT_SLOT_FNS(4)
+MOVNT_SLOT_FNS(5)
+MOVNT_SLOT_FNS(6)
+MOVNT_SLOT_FNS(7)
+MOVNT_SLOT_FNS(8)
+MOVNT_SLOT_FNS(9)
+MOVNT_SLOT_FNS(10)
+MOVNT_SLOT_FNS(11)
+MOVNT_SLOT_FNS(12)
+MOVNT_SLOT_FNS(13)
+MOVNT_SLOT_FNS(14)
+MOVNT_SLOT_FNS(15)
+
+struct movnt_mem_fns {
+	pmem2_memmove_fn memmove_fn;
+	pmem2_memset_fn memset_fn;
+	pmem2_memcpy_v_fn memcpy_v_fn;
+};
+
+struct movnt_slot_fns {
+	struct movnt_mem_fns page;
+	struct movnt_mem_fns cache_line;
+	struct movnt_mem_fns byte;
+};
+
+#define MOVNT_SLOT_GRAN_ENTRY(gran, k)\
+	{pmem2_memmove_##gran##_##k, pmem2_memset_##gran##_##k,\
+		pmem2_memcpy_v_##gran##_##k}
+
+#define MOVNT_SLOT_ENTRY(k) {\
+	MOVNT_SLOT_GRAN_ENTRY(page, k),\
+	MOVNT_SLOT_GRAN_ENTRY(cache_line, k),\
+	MOVNT_SLOT_GRAN_ENTRY(byte, k)}
+
+static const struct movnt_slot_fns Movnt_slot_fns[MOVNT_SLOTS] = {
+	MOVNT_SLOT_ENTRY(0),
+	MOVNT_SLOT_ENTRY(1),
+	MOVNT_SLOT_ENTRY(2),
+	MOVNT_SLOT_ENTRY(3),
+	MOVNT_SLOT_ENTRY(4),
+	MOVNT_SLOT_ENTRY(5),
+	MOVNT_SLOT_ENTRY(6),
+	MOVNT_SLOT_ENTRY(7),
+	MOVNT_SLOT_ENTRY(8),
+	MOVNT_SLOT_ENTRY(9),
+	MOVNT_SLOT_ENTRY(10),
+	MOVNT_SLOT_ENTRY(11),
+	MOVNT_SLOT_ENTRY(12),
+	MOVNT_SLOT_ENTRY(13),
+	MOVNT_SLOT_ENTRY(14),
+	MOVNT_SLOT_ENTRY(15),
+};
+
 /*
  * pmem2_set_flush_fns -- set function pointers related to flushing
  */
@@ -265,6 +784,227 @@ pmem2_set_flush_fns(struct pmem2_map *map)
 
 }
 
+/*
+ * pmem2_set_mem_fns -- set function pointers related to memmove and memset
+ */
+void
+pmem2_set_mem_fns(struct pmem2_map *map)
+{
+	switch (map->effective_granularity) {
+		case PMEM2_GRANULARITY_PAGE:
+			map->memmove_fn = pmem2_memmove_nonpmem;
+			map->memcpy_fn = pmem2_memmove_nonpmem;
+			map->memset_fn = pmem2_memset_nonpmem;
+			map->memcpy_v_fn = pmem2_memcpy_v_nonpmem;
+			break;
+		case PMEM2_GRANULARITY_CACHE_LINE:
+			map->memmove_fn = pmem2_memmove;
+			map->memcpy_fn = pmem2_memmove;
+			map->memset_fn = pmem2_memset;
+			map->memcpy_v_fn = pmem2_memcpy_v;
+			break;
+		case PMEM2_GRANULARITY_BYTE:
+			map->memmove_fn = pmem2_memmove_eadr;
+			map->memcpy_fn = pmem2_memmove_eadr;
+			map->memset_fn = pmem2_memset_eadr;
+			map->memcpy_v_fn = pmem2_memcpy_v_eadr;
+			break;
+		default:
+			abort();
+	}
+}
+
+/*
+ * pmem2_movnt_measure -- (internal) measure the time (in nanoseconds) of
+ * rewriting the range in pieces of the given size
+ */
+static uint64_t
+pmem2_movnt_measure(char *dest, const char *src, size_t len, size_t piece,
+		unsigned flags, flush_func flush)
+{
+	struct timespec start;
+	struct timespec end;
+
+	os_clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (size_t off = 0; off + piece <= len; off += piece)
+		Info.memmove_nodrain(dest + off, src + off, piece, flags,
+			flush);
+	Info.fence();
+
+	os_clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL +
+		(uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+}
+
+/*
+ * pmem2_movnt_calibrate -- (internal) find the smallest copy size from which
+ * non-temporal stores are not slower than temporal ones
+ *
+ * The measurement is done on private buffers flushed the same way as
+ * the mapping, so the content of the mapping is never touched.
+ */
+static int
+pmem2_movnt_calibrate(struct pmem2_map *map, size_t *threshold)
+{
+	size_t len = MOVNT_CALIBRATE_LEN;
+
+	int ret;
+	char *src = pmem2_malloc(len, &ret);
+	if (!src)
+		return ret;
+
+	char *dest = pmem2_malloc(len, &ret);
+	if (!dest) {
+		Free(src);
+		return ret;
+	}
+
+	/* fault in both buffers before anything is measured */
+	memset(src, 0xc5, len);
+	memset(dest, 0, len);
+
+	flush_func flush = flush_empty;
+	if (map->effective_granularity == PMEM2_GRANULARITY_CACHE_LINE)
+		flush = Info.flush;
+
+	/* if temporal stores always win, use them up to twice the max size */
+	*threshold = 2 * MOVNT_CALIBRATE_MAX;
+
+	for (size_t piece = MOVNT_CALIBRATE_MAX; piece >= MOVNT_CALIBRATE_MIN;
+			piece /= 2) {
+		uint64_t t = UINT64_MAX;
+		uint64_t nt = UINT64_MAX;
+		for (int pass = 0; pass < MOVNT_CALIBRATE_PASSES; ++pass) {
+			uint64_t time = pmem2_movnt_measure(dest, src, len,
+				piece, PMEM2_F_MEM_TEMPORAL, flush);
+			if (time < t)
+				t = time;
+
+			time = pmem2_movnt_measure(dest, src, len, piece,
+				PMEM2_F_MEM_NONTEMPORAL, flush);
+			if (time < nt)
+				nt = time;
+		}
+
+		LOG(4, "size %zu temporal %" PRIu64 "ns non-temporal %" PRIu64
+			"ns", piece, t, nt);
+
+		if (nt > t)
+			break;
+
+		*threshold = piece;
+	}
+
+	Free(dest);
+	Free(src);
+
+	return 0;
+}
+
+/*
+ * pmem2_movnt_slot_fns -- (internal) return the functions of the slot
+ * matching the granularity of the mapping
+ */
+static const struct movnt_mem_fns *
+pmem2_movnt_slot_fns(struct pmem2_map *map, unsigned slot)
+{
+	switch (map->effective_granularity) {
+		case PMEM2_GRANULARITY_PAGE:
+			return &Movnt_slot_fns[slot].page;
+		case PMEM2_GRANULARITY_CACHE_LINE:
+			return &Movnt_slot_fns[slot].cache_line;
+		case PMEM2_GRANULARITY_BYTE:
+			return &Movnt_slot_fns[slot].byte;
+		default:
+			abort();
+	}
+}
+
+/*
+ * pmem2_set_movnt_threshold -- set (or calibrate) the size from which
+ * memmove and memset functions of the mapping use non-temporal stores
+ */
+int
+pmem2_set_movnt_threshold(struct pmem2_map *map, size_t threshold,
+		int writable)
+{
+	map->movnt_threshold = PMEM2_MOVNT_THRESHOLD_DEFAULT;
+
+	if (threshold == PMEM2_MOVNT_THRESHOLD_CALIBRATE) {
+		if (!writable) {
+			LOG(2, "read-only mapping, "
+				"movnt threshold calibration skipped");
+			return 0;
+		}
+
+		int ret = pmem2_movnt_calibrate(map, &threshold);
+		if (ret)
+			return ret;
+	}
+
+	if (threshold == PMEM2_MOVNT_THRESHOLD_DEFAULT)
+		return 0;
+
+	util_mutex_lock(&Movnt_slots_lock);
+
+	unsigned slot = MOVNT_SLOTS;
+	for (unsigned i = 0; i < MOVNT_SLOTS; ++i) {
+		if (Movnt_slots[i].nmaps == 0) {
+			if (slot == MOVNT_SLOTS)
+				slot = i;
+		} else if (Movnt_slots[i].threshold == threshold) {
+			slot = i;
+			break;
+		}
+	}
+
+	if (slot == MOVNT_SLOTS) {
+		util_mutex_unlock(&Movnt_slots_lock);
+		ERR("mappings use more than %d different movnt thresholds",
+			MOVNT_SLOTS);
+		return PMEM2_E_NOSUPP;
+	}
+
+	Movnt_slots[slot].threshold = threshold;
+	Movnt_slots[slot].nmaps++;
+
+	util_mutex_unlock(&Movnt_slots_lock);
+
+	LOG(3, "map %p movnt threshold %zu slot %u", map, threshold, slot);
+
+	const struct movnt_mem_fns *fns = pmem2_movnt_slot_fns(map, slot);
+	map->memmove_fn = fns->memmove_fn;
+	map->memcpy_fn = fns->memmove_fn;
+	map->memset_fn = fns->memset_fn;
+	map->memcpy_v_fn = fns->memcpy_v_fn;
+
+	map->movnt_threshold = threshold;
+	map->movnt_slot = slot;
+
+	return 0;
+}
+
+/*
+ * pmem2_clear_movnt_threshold -- release the threshold slot of the mapping
+ * which is going to be unmapped
+ */
+void
+pmem2_clear_movnt_threshold(struct pmem2_map *map)
+{
+	if (map->movnt_threshold == PMEM2_MOVNT_THRESHOLD_DEFAULT)
+		return;
+
+	util_mutex_lock(&Movnt_slots_lock);
+	ASSERT(Movnt_slots[map->movnt_slot].nmaps > 0);
+	Movnt_slots[map->movnt_slot].nmaps--;
+	util_mutex_unlock(&Movnt_slots_lock);
+
+	map->movnt_threshold = PMEM2_MOVNT_THRESHOLD_DEFAULT;
+	pmem2_set_mem_fns(map);
+}
+
 /*
  * pmem2_get_persist_fn - return a pointer to a function responsible for
  * persisting data in range owned by pmem2_map
@@ -294,3 +1034,465 @@ pmem2_get_drain_fn(struct pmem2_map *map)
 {
 	return map->drain_fn;
 }
+
+/*
+ * pmem2_get_memmove_fn - return a pointer to a function responsible for
+ * copying data in range owned by pmem2_map
+ */
+pmem2_memmove_fn
+pmem2_get_memmove_fn(struct pmem2_map *map)
+{
+	return map->memmove_fn;
+}
+
+/*
+ * pmem2_get_memcpy_fn - return a pointer to a function responsible for
+ * copying data in range owned by pmem2_map
+ */
+pmem2_memcpy_fn
+pmem2_get_memcpy_fn(struct pmem2_map *map)
+{
+	return map->memcpy_fn;
+}
+
+/*
+ * pmem2_get_memset_fn - return a pointer to a function responsible for
+ * filling data in range owned by pmem2_map
+ */
+pmem2_memset_fn
+pmem2_get_memset_fn(struct pmem2_map *map)
+{
+	return map->memset_fn;
+}
+
+/*
+ * pmem2_get_memcpy_v_fn - return a pointer to a function responsible for
+ * copying many ranges of data to pmem2_map at once
+ */
+pmem2_memcpy_v_fn
+pmem2_get_memcpy_v_fn(struct pmem2_map *map)
+{
+	return map->memcpy_v_fn;
+}
+
+/* initial number of ranges of a flush set */
+#define FLUSH_SET_INIT_RANGES 64
+
+struct pmem2_flush_set {
+	struct pmem2_map *map;
+	size_t granule; /* ranges are aligned to this size */
+	struct pmem2_flush_range *ranges;
+	size_t nranges;
+	size_t capacity;
+};
+
+/*
+ * pmem2_flush_set_new -- allocate an empty set of ranges to be flushed
+ */
+int
+pmem2_flush_set_new(struct pmem2_flush_set **set_ptr, struct pmem2_map *map)
+{
+	LOG(3, "set_ptr %p map %p", set_ptr, map);
+
+	int ret;
+	*set_ptr = NULL;
+
+	struct pmem2_flush_set *set = pmem2_malloc(sizeof(*set), &ret);
+	if (!set)
+		return ret;
+
+	set->map = map;
+	if (map->effective_granularity == PMEM2_GRANULARITY_PAGE)
+		set->granule = Pagesize;
+	else
+		set->granule = CACHELINE_SIZE;
+	set->ranges = NULL;
+	set->nranges = 0;
+	set->capacity = 0;
+
+	*set_ptr = set;
+
+	return 0;
+}
+
+/*
+ * pmem2_flush_set_delete -- free the set, without flushing its ranges
+ */
+int
+pmem2_flush_set_delete(struct pmem2_flush_set **set_ptr)
+{
+	LOG(3, "set_ptr %p", set_ptr);
+
+	struct pmem2_flush_set *set = *set_ptr;
+	if (set == NULL)
+		return 0;
+
+	Free(set->ranges);
+	Free(set);
+	*set_ptr = NULL;
+
+	return 0;
+}
+
+/*
+ * pmem2_flush_set_add -- remember the range to be flushed by the next
+ * pmem2_flush_set_persist call
+ */
+int
+pmem2_flush_set_add(struct pmem2_flush_set *set, const void *addr,
+		size_t len)
+{
+	LOG(15, "set %p addr %p len %zu", set, addr, len);
+
+	uintptr_t map_begin = (uintptr_t)set->map->addr;
+	uintptr_t map_end = map_begin + set->map->content_length;
+	uintptr_t begin = (uintptr_t)addr;
+
+	if (begin < map_begin || begin > map_end || len > map_end - begin) {
+		ERR("range %p-%p is outside of the mapping", addr,
+			(char *)addr + len);
+		return PMEM2_E_INVALID_ARG;
+	}
+
+	if (len == 0)
+		return 0;
+
+	uintptr_t end = ALIGN_UP(begin + len, set->granule);
+	begin = ALIGN_DOWN(begin, set->granule);
+
+	/* the common case of growing the previous range in place */
+	if (set->nranges != 0) {
+		struct pmem2_flush_range *last = &set->ranges[set->nranges - 1];
+		if (begin <= last->end && end >= last->begin) {
+			last->begin = MIN(last->begin, begin);
+			last->end = MAX(last->end, end);
+			return 0;
+		}
+	}
+
+	if (set->nranges == set->capacity) {
+		size_t capacity = set->capacity ?
+			set->capacity * 2 : FLUSH_SET_INIT_RANGES;
+		struct pmem2_flush_range *ranges = Realloc(set->ranges,
+			capacity * sizeof(*ranges));
+		if (ranges == NULL) {
+			ERR("!realloc");
+			return PMEM2_E_ERRNO;
+		}
+
+		set->ranges = ranges;
+		set->capacity = capacity;
+	}
+
+	set->ranges[set->nranges].begin = begin;
+	set->ranges[set->nranges].end = end;
+	set->nranges++;
+
+	return 0;
+}
+
+/*
+ * pmem2_flush_set_persist -- flush every unique cache line (or page) of
+ * the ranges in the set once and wait for the flushes to complete
+ *
+ * The set is emptied on success.
+ */
+int
+pmem2_flush_set_persist(struct pmem2_flush_set *set)
+{
+	LOG(15, "set %p", set);
+
+	int ret = 0;
+
+	set->nranges = flush_ranges_merge(set->ranges, set->nranges);
+
+	struct pmem2_map *map = set->map;
+	for (size_t i = 0; i < set->nranges; ++i) {
+		const void *addr = (const void *)set->ranges[i].begin;
+		size_t len = set->ranges[i].end - set->ranges[i].begin;
+
+		switch (map->effective_granularity) {
+			case PMEM2_GRANULARITY_PAGE:
+				pmem2_log_flush(addr, len);
+				ret = pmem2_flush_file_buffers_os(map, addr,
+					len, 1);
+				if (ret)
+					return ret;
+				break;
+			case PMEM2_GRANULARITY_CACHE_LINE:
+				pmem2_flush_cpu_cache(addr, len);
+				break;
+			case PMEM2_GRANULARITY_BYTE:
+				pmem2_flush_nop(addr, len);
+				break;
+			default:
+				abort();
+		}
+	}
+
+	if (map->effective_granularity != PMEM2_GRANULARITY_PAGE)
+		pmem2_drain();
+
+	set->nranges = 0;
+
+	return ret;
+}
+
+/*
+ * Background flushing of mappings with page granularity. Flushes of such
+ * mappings only queue the page ranges, which are merged and synced by
+ * a worker thread shared by all the mappings. Drain waits until every range
+ * queued before the call is synced.
+ */
+struct pmem2_async_flush {
+	os_mutex_t lock;
+	os_cond_t work_cond; /* signaled when ranges are queued or on stop */
+	os_cond_t done_cond; /* signaled when a batch of ranges is synced */
+	int stop;
+
+	struct pmem2_flush_range *ranges;
+	size_t nranges;
+	size_t capacity;
+
+	uint64_t queued; /* number of flushes queued so far */
+	uint64_t synced; /* number of flushes synced so far */
+
+	/* protects the worker thread and the number of its users */
+	os_mutex_t users_lock;
+	unsigned users;
+	os_thread_t worker;
+};
+
+static struct pmem2_async_flush Async;
+
+/*
+ * pmem2_async_flush_worker -- (internal) sync the queued ranges until stopped
+ */
+static void *
+pmem2_async_flush_worker(void *arg)
+{
+	struct pmem2_flush_range *spare = NULL;
+	size_t spare_capacity = 0;
+
+	util_mutex_lock(&Async.lock);
+	while (1) {
+		while (Async.nranges == 0 && !Async.stop)
+			os_cond_wait(&Async.work_cond, &Async.lock);
+
+		if (Async.nranges == 0)
+			break;
+
+		/* take the queued ranges and leave the spare buffer instead */
+		struct pmem2_flush_range *ranges = Async.ranges;
+		size_t nranges = Async.nranges;
+		size_t capacity = Async.capacity;
+		uint64_t queued = Async.queued;
+
+		Async.ranges = spare;
+		Async.capacity = spare_capacity;
+		Async.nranges = 0;
+		util_mutex_unlock(&Async.lock);
+
+		nranges = flush_ranges_merge(ranges, nranges);
+		for (size_t i = 0; i < nranges; ++i)
+			pmem2_persist_pages((const void *)ranges[i].begin,
+				ranges[i].end - ranges[i].begin);
+
+		spare = ranges;
+		spare_capacity = capacity;
+
+		util_mutex_lock(&Async.lock);
+		Async.synced = queued;
+		os_cond_broadcast(&Async.done_cond);
+	}
+	util_mutex_unlock(&Async.lock);
+
+	Free(spare);
+
+	return NULL;
+}
+
+/*
+ * pmem2_flush_pages_async -- queue the page range to be synced by the worker
+ */
+static void
+pmem2_flush_pages_async(const void *addr, size_t len)
+{
+	pmem2_log_flush(addr, len);
+
+	if (len == 0)
+		return;
+
+	uintptr_t begin = ALIGN_DOWN((uintptr_t)addr, Pagesize);
+	uintptr_t end = ALIGN_UP((uintptr_t)addr + len, Pagesize);
+
+	util_mutex_lock(&Async.lock);
+
+	/* the common case of growing the previous range in place */
+	if (Async.nranges != 0) {
+		struct pmem2_flush_range *last =
+			&Async.ranges[Async.nranges - 1];
+		if (begin <= last->end && end >= last->begin) {
+			last->begin = MIN(last->begin, begin);
+			last->end = MAX(last->end, end);
+			Async.queued++;
+			util_mutex_unlock(&Async.lock);
+			return;
+		}
+	}
+
+	if (Async.nranges == Async.capacity) {
+		size_t capacity = Async.capacity ?
+			Async.capacity * 2 : FLUSH_SET_INIT_RANGES;
+		struct pmem2_flush_range *ranges = Realloc(Async.ranges,
+			capacity * sizeof(*ranges));
+		if (ranges == NULL) {
+			util_mutex_unlock(&Async.lock);
+
+			/* no memory to queue the range, sync it right away */
+			LOG(2, "!realloc");
+			pmem2_persist_pages(addr, len);
+			return;
+		}
+
+		Async.ranges = ranges;
+		Async.capacity = capacity;
+	}
+
+	Async.ranges[Async.nranges].begin = begin;
+	Async.ranges[Async.nranges].end = end;
+	Async.nranges++;
+	Async.queued++;
+
+	if (Async.nranges == 1)
+		os_cond_signal(&Async.work_cond);
+
+	util_mutex_unlock(&Async.lock);
+}
+
+/*
+ * pmem2_drain_pages_async -- wait until all the ranges queued so far
+ * are synced
+ */
+static void
+pmem2_drain_pages_async(void)
+{
+	LOG(15, NULL);
+
+	util_mutex_lock(&Async.lock);
+
+	uint64_t queued = Async.queued;
+	while (Async.synced < queued)
+		os_cond_wait(&Async.done_cond, &Async.lock);
+
+	util_mutex_unlock(&Async.lock);
+}
+
+/*
+ * pmem2_async_flush_stop -- (internal) stop the worker thread once it syncs
+ * all the queued ranges, must be called with users_lock held
+ */
+static void
+pmem2_async_flush_stop(void)
+{
+	util_mutex_lock(&Async.lock);
+	Async.stop = 1;
+	os_cond_signal(&Async.work_cond);
+	util_mutex_unlock(&Async.lock);
+
+	os_thread_join(&Async.worker, NULL);
+}
+
+/*
+ * pmem2_async_flush_acquire -- switch the mapping with page granularity
+ * to background flushing, start the worker thread if needed
+ */
+int
+pmem2_async_flush_acquire(struct pmem2_map *map)
+{
+	ASSERTeq(map->effective_granularity, PMEM2_GRANULARITY_PAGE);
+
+	int ret = 0;
+
+	util_mutex_lock(&Async.users_lock);
+	if (Async.users == 0) {
+		Async.stop = 0;
+
+		ret = os_thread_create(&Async.worker, NULL,
+			pmem2_async_flush_worker, NULL);
+		if (ret) {
+			errno = ret;
+			ERR("!os_thread_create");
+			ret = PMEM2_E_ERRNO;
+		}
+	}
+
+	if (ret == 0) {
+		Async.users++;
+		map->async_flush = true;
+		map->flush_fn = pmem2_flush_pages_async;
+		map->drain_fn = pmem2_drain_pages_async;
+	}
+	util_mutex_unlock(&Async.users_lock);
+
+	return ret;
+}
+
+/*
+ * pmem2_async_flush_release -- sync the ranges queued for the mapping
+ * and stop the worker thread if no other mapping uses it
+ *
+ * Has to be called before the mapping is unregistered.
+ */
+void
+pmem2_async_flush_release(struct pmem2_map *map)
+{
+	if (!map->async_flush)
+		return;
+
+	pmem2_drain_pages_async();
+
+	util_mutex_lock(&Async.users_lock);
+	map->async_flush = false;
+	pmem2_set_flush_fns(map);
+	if (--Async.users == 0)
+		pmem2_async_flush_stop();
+	util_mutex_unlock(&Async.users_lock);
+}
+
+/*
+ * pmem2_async_flush_init -- (internal) initialize background flushing
+ */
+static void
+pmem2_async_flush_init(void)
+{
+	util_mutex_init(&Async.lock);
+	util_mutex_init(&Async.users_lock);
+	util_cond_init(&Async.work_cond);
+	util_cond_init(&Async.done_cond);
+}
+
+/*
+ * pmem2_async_flush_fini -- (internal) finalize background flushing
+ */
+static void
+pmem2_async_flush_fini(void)
+{
+	/* the application didn't unmap some of the mappings */
+	util_mutex_lock(&Async.users_lock);
+	if (Async.users != 0) {
+		Async.users = 0;
+		pmem2_async_flush_stop();
+	}
+	util_mutex_unlock(&Async.users_lock);
+
+	Free(Async.ranges);
+	Async.ranges = NULL;
+	Async.nranges = 0;
+	Async.capacity = 0;
+
+	util_cond_destroy(&Async.done_cond);
+	util_cond_destroy(&Async.work_cond);
+	util_mutex_destroy(&Async.users_lock);
+	util_mutex_destroy(&Async.lock);
+}
@@ -45,10 +45,17 @@ extern "C" {
 #endif
 
 void pmem2_persist_init(void);
+void pmem2_persist_fini(void);
 
 int pmem2_flush_file_buffers_os(struct pmem2_map *map, const void *addr,
 		size_t len, int autorestart);
 void pmem2_set_flush_fns(struct pmem2_map *map);
+void pmem2_set_mem_fns(struct pmem2_map *map);
+int pmem2_set_movnt_threshold(struct pmem2_map *map, size_t threshold,
+		int writable);
+void pmem2_clear_movnt_threshold(struct pmem2_map *map);
+int pmem2_async_flush_acquire(struct pmem2_map *map);
+void pmem2_async_flush_release(struct pmem2_map *map);
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright 2019, Intel Corporation
+ * Copyright 2019-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -60,24 +60,6 @@ pmem2_config_set_address(struct pmem2_config *cfg, unsigned type, void *addr)
 	return PMEM2_E_NOSUPP;
 }
 
-pmem2_memmove_fn
-pmem2_get_memmove_fn(struct pmem2_map *map)
-{
-	return NULL;
-}
-
-pmem2_memcpy_fn
-pmem2_get_memcpy_fn(struct pmem2_map *map)
-{
-	return NULL;
-}
-
-pmem2_memset_fn
-pmem2_get_memset_fn(struct pmem2_map *map)
-{
-	return NULL;
-}
-
 #ifndef _WIN32
 int
 pmem2_get_device_id(const struct pmem2_config *cfg, char *id, size_t *len)
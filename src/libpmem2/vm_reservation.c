@@ -0,0 +1,286 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vm_reservation.c -- implementation of virtual memory reservations
+ *
+ * A reservation is a range of virtual address space taken from the system
+ * once, into which files can be mapped at chosen offsets. Parts of the
+ * range not backed by any mapping are covered by an inaccessible
+ * placeholder, so the address space cannot be taken over by other
+ * mappings of the process. The reservation can be extended at its end
+ * without moving the mappings already placed in it.
+ */
+
+#include "alloc.h"
+#include "map.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "ravl.h"
+#include "sys_util.h"
+#include "util.h"
+#include "vm_reservation.h"
+
+/*
+ * mappings_compare -- (internal) compare pmem2_maps by starting address
+ */
+static int
+mappings_compare(const void *lhs, const void *rhs)
+{
+	const struct pmem2_map *l = lhs;
+	const struct pmem2_map *r = rhs;
+
+	if (l->addr < r->addr)
+		return -1;
+	if (l->addr > r->addr)
+		return 1;
+	return 0;
+}
+
+/*
+ * vm_reservation_validate_size -- (internal) check if the size is a non-zero
+ * multiple of the mapping alignment
+ */
+static int
+vm_reservation_validate_size(size_t size)
+{
+	if (size == 0 || !IS_MMAP_ALIGNED(size)) {
+		ERR("size %zu is not a multiple of %llu", size, Mmap_align);
+		return PMEM2_E_LENGTH_UNALIGNED;
+	}
+
+	return 0;
+}
+
+/*
+ * pmem2_vm_reservation_new -- reserve a range of virtual address space
+ */
+int
+pmem2_vm_reservation_new(struct pmem2_vm_reservation **rsv_ptr,
+		void *addr, size_t size)
+{
+	LOG(3, "rsv_ptr %p addr %p size %zu", rsv_ptr, addr, size);
+
+	*rsv_ptr = NULL;
+
+	int ret = vm_reservation_validate_size(size);
+	if (ret)
+		return ret;
+
+	if (!IS_MMAP_ALIGNED((uintptr_t)addr)) {
+		ERR("address %p is not a multiple of %llu", addr, Mmap_align);
+		return PMEM2_E_ADDRESS_UNALIGNED;
+	}
+
+	struct pmem2_vm_reservation *rsv = pmem2_malloc(sizeof(*rsv), &ret);
+	if (!rsv)
+		return ret;
+
+	rsv->mappings = ravl_new(mappings_compare);
+	if (!rsv->mappings) {
+		ERR("!ravl_new");
+		ret = PMEM2_E_ERRNO;
+		goto err_free;
+	}
+
+	ret = vm_reservation_reserve_memory(addr, size, &rsv->addr);
+	if (ret)
+		goto err_ravl;
+
+	rsv->size = size;
+	os_rwlock_init(&rsv->lock);
+
+	*rsv_ptr = rsv;
+
+	return 0;
+
+err_ravl:
+	ravl_delete(rsv->mappings);
+err_free:
+	Free(rsv);
+	return ret;
+}
+
+/*
+ * pmem2_vm_reservation_delete -- release the reservation, which must not
+ * contain any mappings
+ */
+int
+pmem2_vm_reservation_delete(struct pmem2_vm_reservation **rsv_ptr)
+{
+	LOG(3, "rsv_ptr %p", rsv_ptr);
+
+	struct pmem2_vm_reservation *rsv = *rsv_ptr;
+
+	if (!ravl_empty(rsv->mappings)) {
+		ERR("the reservation still contains mappings");
+		return PMEM2_E_VM_RESERVATION_NOT_EMPTY;
+	}
+
+	int ret = vm_reservation_release_memory(rsv->addr, rsv->size);
+	if (ret)
+		return ret;
+
+	ravl_delete(rsv->mappings);
+	os_rwlock_destroy(&rsv->lock);
+	Free(rsv);
+	*rsv_ptr = NULL;
+
+	return 0;
+}
+
+/*
+ * pmem2_vm_reservation_get_address -- get the reservation base address
+ */
+void *
+pmem2_vm_reservation_get_address(struct pmem2_vm_reservation *rsv)
+{
+	LOG(3, "rsv %p", rsv);
+
+	return rsv->addr;
+}
+
+/*
+ * pmem2_vm_reservation_get_size -- get the reservation size
+ */
+size_t
+pmem2_vm_reservation_get_size(struct pmem2_vm_reservation *rsv)
+{
+	LOG(3, "rsv %p", rsv);
+
+	util_rwlock_rdlock(&rsv->lock);
+	size_t size = rsv->size;
+	util_rwlock_unlock(&rsv->lock);
+
+	return size;
+}
+
+/*
+ * pmem2_vm_reservation_extend -- grow the reservation at its end, fails if
+ * the address space right after it is already taken
+ */
+int
+pmem2_vm_reservation_extend(struct pmem2_vm_reservation *rsv, size_t size)
+{
+	LOG(3, "rsv %p size %zu", rsv, size);
+
+	int ret = vm_reservation_validate_size(size);
+	if (ret)
+		return ret;
+
+	util_rwlock_wrlock(&rsv->lock);
+
+	void *end = (char *)rsv->addr + rsv->size;
+	void *raddr;
+	ret = vm_reservation_reserve_memory(end, size, &raddr);
+	if (ret == 0) {
+		ASSERTeq(raddr, end);
+		rsv->size += size;
+	}
+
+	util_rwlock_unlock(&rsv->lock);
+
+	return ret;
+}
+
+/*
+ * vm_reservation_map_register -- claim the range of the mapping in
+ * the reservation, fails if it exceeds the reservation or overlaps with
+ * another mapping placed there
+ */
+int
+vm_reservation_map_register(struct pmem2_vm_reservation *rsv,
+		struct pmem2_map *map)
+{
+	int ret = 0;
+	char *begin = map->addr;
+	char *end = begin + map->reserved_length;
+
+	util_rwlock_wrlock(&rsv->lock);
+
+	if (begin < (char *)rsv->addr || end < begin ||
+			end > (char *)rsv->addr + rsv->size) {
+		ERR("mapping does not fit in the reservation");
+		ret = PMEM2_E_MAP_RANGE;
+		goto out;
+	}
+
+	struct ravl_node *n = ravl_find(rsv->mappings, map,
+			RAVL_PREDICATE_LESS_EQUAL);
+	if (n) {
+		struct pmem2_map *prev = ravl_data(n);
+		if ((char *)prev->addr + prev->reserved_length > begin) {
+			ERR("the range is occupied by another mapping");
+			ret = PMEM2_E_MAPPING_EXISTS;
+			goto out;
+		}
+	}
+
+	n = ravl_find(rsv->mappings, map, RAVL_PREDICATE_GREATER);
+	if (n) {
+		struct pmem2_map *next = ravl_data(n);
+		if ((char *)next->addr < end) {
+			ERR("the range is occupied by another mapping");
+			ret = PMEM2_E_MAPPING_EXISTS;
+			goto out;
+		}
+	}
+
+	if (ravl_insert(rsv->mappings, map)) {
+		ERR("!ravl_insert");
+		ret = PMEM2_E_ERRNO;
+	}
+
+out:
+	util_rwlock_unlock(&rsv->lock);
+
+	return ret;
+}
+
+/*
+ * vm_reservation_map_unregister -- release the range of the mapping in
+ * the reservation
+ */
+void
+vm_reservation_map_unregister(struct pmem2_vm_reservation *rsv,
+		struct pmem2_map *map)
+{
+	util_rwlock_wrlock(&rsv->lock);
+
+	struct ravl_node *n = ravl_find(rsv->mappings, map,
+			RAVL_PREDICATE_EQUAL);
+	ASSERTne(n, NULL);
+	ravl_remove(rsv->mappings, n);
+
+	util_rwlock_unlock(&rsv->lock);
+}
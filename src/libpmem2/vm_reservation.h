@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vm_reservation.h -- internal definitions for virtual memory reservations
+ */
+#ifndef PMEM2_VM_RESERVATION_H
+#define PMEM2_VM_RESERVATION_H
+
+#include <stddef.h>
+
+#include "libpmem2.h"
+#include "os_thread.h"
+#include "ravl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pmem2_map;
+
+struct pmem2_vm_reservation {
+	void *addr; /* base address */
+	size_t size; /* length of the reservation */
+	struct ravl *mappings; /* mappings placed in the reservation */
+	os_rwlock_t lock;
+};
+
+int vm_reservation_map_register(struct pmem2_vm_reservation *rsv,
+		struct pmem2_map *map);
+void vm_reservation_map_unregister(struct pmem2_vm_reservation *rsv,
+		struct pmem2_map *map);
+
+/* OS-specific */
+int vm_reservation_reserve_memory(void *addr, size_t size, void **raddr);
+int vm_reservation_release_memory(void *addr, size_t size);
+int vm_reservation_restore_memory(void *addr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PMEM2_VM_RESERVATION_H */
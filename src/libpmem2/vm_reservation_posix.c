@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vm_reservation_posix.c -- implementation of virtual memory reservations
+ * (POSIX)
+ */
+
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "libpmem2.h"
+#include "out.h"
+#include "pmem2_utils.h"
+#include "vm_reservation.h"
+
+/*
+ * Use MAP_PRIVATE with no access to simulate zero cost for overcommit
+ * accounting. Note: MAP_NORESERVE flag is ignored if overcommit is disabled
+ * (mode 2).
+ */
+#define PLACEHOLDER_PROT PROT_NONE
+#define PLACEHOLDER_FLAGS (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE)
+
+/*
+ * vm_reservation_reserve_memory -- create a placeholder mapping at exactly
+ * the given address or, if the address is NULL, wherever the system finds
+ * enough free address space
+ */
+int
+vm_reservation_reserve_memory(void *addr, size_t size, void **raddr)
+{
+	LOG(15, "addr %p size %zu", addr, size);
+
+	int flags = PLACEHOLDER_FLAGS;
+#ifdef MAP_FIXED_NOREPLACE
+	if (addr)
+		flags |= MAP_FIXED_NOREPLACE;
+#endif
+
+	char *daddr = mmap(addr, size, PLACEHOLDER_PROT, flags, -1, 0);
+	if (daddr == MAP_FAILED) {
+		if (errno == EEXIST) {
+			ERR("!mmap MAP_FIXED_NOREPLACE");
+			return PMEM2_E_MAPPING_EXISTS;
+		}
+		ERR("!mmap MAP_ANONYMOUS");
+		return PMEM2_E_ERRNO;
+	}
+
+	/*
+	 * Kernels which don't know MAP_FIXED_NOREPLACE (or don't have it at
+	 * all) treat the address as a hint only.
+	 */
+	if (addr && daddr != addr) {
+		munmap(daddr, size);
+		ERR("address range %p-%p is occupied", addr,
+				(char *)addr + size);
+		return PMEM2_E_MAPPING_EXISTS;
+	}
+
+	*raddr = daddr;
+
+	return 0;
+}
+
+/*
+ * vm_reservation_release_memory -- remove the placeholder mapping
+ */
+int
+vm_reservation_release_memory(void *addr, size_t size)
+{
+	LOG(15, "addr %p size %zu", addr, size);
+
+	if (munmap(addr, size)) {
+		ERR("!munmap");
+		return PMEM2_E_ERRNO;
+	}
+
+	return 0;
+}
+
+/*
+ * vm_reservation_restore_memory -- cover the range of a removed mapping
+ * with the placeholder again
+ */
+int
+vm_reservation_restore_memory(void *addr, size_t size)
+{
+	LOG(15, "addr %p size %zu", addr, size);
+
+	void *daddr = mmap(addr, size, PLACEHOLDER_PROT,
+			PLACEHOLDER_FLAGS | MAP_FIXED, -1, 0);
+	if (daddr == MAP_FAILED) {
+		ERR("!mmap MAP_FIXED");
+		return PMEM2_E_ERRNO;
+	}
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vm_reservation_windows.c -- implementation of virtual memory reservations
+ * (Windows)
+ *
+ * Mapping a file view into a reserved range requires the placeholder API
+ * (VirtualAlloc2/MapViewOfFile3), which is not available on all supported
+ * versions of Windows, so reservations are not supported yet.
+ */
+
+#include "libpmem2.h"
+#include "out.h"
+#include "vm_reservation.h"
+
+/*
+ * vm_reservation_reserve_memory -- not supported
+ */
+int
+vm_reservation_reserve_memory(void *addr, size_t size, void **raddr)
+{
+	ERR("virtual memory reservations are not supported on Windows");
+	return PMEM2_E_NOSUPP;
+}
+
+/*
+ * vm_reservation_release_memory -- not supported
+ */
+int
+vm_reservation_release_memory(void *addr, size_t size)
+{
+	return PMEM2_E_NOSUPP;
+}
+
+/*
+ * vm_reservation_restore_memory -- not supported
+ */
+int
+vm_reservation_restore_memory(void *addr, size_t size)
+{
+	return PMEM2_E_NOSUPP;
+}
@@ -113,70 +113,6 @@ memmove_movnt32x64b(char *dest, const char *src)
 	VALGRIND_DO_FLUSH(dest, 32 * 64);
 }
 
-static force_inline void
-memmove_movnt16x64b(char *dest, const char *src)
-{
-	__m512i zmm0 = _mm512_loadu_si512((__m512i *)src + 0);
-	__m512i zmm1 = _mm512_loadu_si512((__m512i *)src + 1);
-	__m512i zmm2 = _mm512_loadu_si512((__m512i *)src + 2);
-	__m512i zmm3 = _mm512_loadu_si512((__m512i *)src + 3);
-	__m512i zmm4 = _mm512_loadu_si512((__m512i *)src + 4);
-	__m512i zmm5 = _mm512_loadu_si512((__m512i *)src + 5);
-	__m512i zmm6 = _mm512_loadu_si512((__m512i *)src + 6);
-	__m512i zmm7 = _mm512_loadu_si512((__m512i *)src + 7);
-	__m512i zmm8 = _mm512_loadu_si512((__m512i *)src + 8);
-	__m512i zmm9 = _mm512_loadu_si512((__m512i *)src + 9);
-	__m512i zmm10 = _mm512_loadu_si512((__m512i *)src + 10);
-	__m512i zmm11 = _mm512_loadu_si512((__m512i *)src + 11);
-	__m512i zmm12 = _mm512_loadu_si512((__m512i *)src + 12);
-	__m512i zmm13 = _mm512_loadu_si512((__m512i *)src + 13);
-	__m512i zmm14 = _mm512_loadu_si512((__m512i *)src + 14);
-	__m512i zmm15 = _mm512_loadu_si512((__m512i *)src + 15);
-
-	_mm512_stream_si512((__m512i *)dest + 0, zmm0);
-	_mm512_stream_si512((__m512i *)dest + 1, zmm1);
-	_mm512_stream_si512((__m512i *)dest + 2, zmm2);
-	_mm512_stream_si512((__m512i *)dest + 3, zmm3);
-	_mm512_stream_si512((__m512i *)dest + 4, zmm4);
-	_mm512_stream_si512((__m512i *)dest + 5, zmm5);
-	_mm512_stream_si512((__m512i *)dest + 6, zmm6);
-	_mm512_stream_si512((__m512i *)dest + 7, zmm7);
-	_mm512_stream_si512((__m512i *)dest + 8, zmm8);
-	_mm512_stream_si512((__m512i *)dest + 9, zmm9);
-	_mm512_stream_si512((__m512i *)dest + 10, zmm10);
-	_mm512_stream_si512((__m512i *)dest + 11, zmm11);
-	_mm512_stream_si512((__m512i *)dest + 12, zmm12);
-	_mm512_stream_si512((__m512i *)dest + 13, zmm13);
-	_mm512_stream_si512((__m512i *)dest + 14, zmm14);
-	_mm512_stream_si512((__m512i *)dest + 15, zmm15);
-
-	VALGRIND_DO_FLUSH(dest, 16 * 64);
-}
-
-static force_inline void
-memmove_movnt8x64b(char *dest, const char *src)
-{
-	__m512i zmm0 = _mm512_loadu_si512((__m512i *)src + 0);
-	__m512i zmm1 = _mm512_loadu_si512((__m512i *)src + 1);
-	__m512i zmm2 = _mm512_loadu_si512((__m512i *)src + 2);
-	__m512i zmm3 = _mm512_loadu_si512((__m512i *)src + 3);
-	__m512i zmm4 = _mm512_loadu_si512((__m512i *)src + 4);
-	__m512i zmm5 = _mm512_loadu_si512((__m512i *)src + 5);
-	__m512i zmm6 = _mm512_loadu_si512((__m512i *)src + 6);
-	__m512i zmm7 = _mm512_loadu_si512((__m512i *)src + 7);
-
-	_mm512_stream_si512((__m512i *)dest + 0, zmm0);
-	_mm512_stream_si512((__m512i *)dest + 1, zmm1);
-	_mm512_stream_si512((__m512i *)dest + 2, zmm2);
-	_mm512_stream_si512((__m512i *)dest + 3, zmm3);
-	_mm512_stream_si512((__m512i *)dest + 4, zmm4);
-	_mm512_stream_si512((__m512i *)dest + 5, zmm5);
-	_mm512_stream_si512((__m512i *)dest + 6, zmm6);
-	_mm512_stream_si512((__m512i *)dest + 7, zmm7);
-
-	VALGRIND_DO_FLUSH(dest, 8 * 64);
-}
-
 static force_inline void
 memmove_movnt4x64b(char *dest, const char *src)
 {
@@ -251,6 +187,17 @@ memmove_movnt1x4b(char *dest, const char *src)
 	VALGRIND_DO_FLUSH(dest, 4);
 }
 
+/*
+ * memmove_prefetch32x64b -- prefetches the source of the next iteration of
+ * the main copying loop
+ */
+static force_inline void
+memmove_prefetch32x64b(const char *src)
+{
+	for (unsigned i = 0; i < 32; ++i)
+		_mm_prefetch(src + i * 64, _MM_HINT_NTA);
+}
+
 static force_inline void
 memmove_movnt_avx512f_fw(char *dest, const char *src, size_t len)
 {
@@ -268,28 +215,27 @@ memmove_movnt_avx512f_fw(char *dest, const char *src, size_t len)
 		len -= cnt;
 	}
 
+	/* write only whole, aligned XPLines once there is more than one */
+	if (len >= 2 * XPLINE_SIZE) {
+		while ((uint64_t)dest & (XPLINE_SIZE - 1)) {
+			memmove_movnt1x64b(dest, src);
+			dest += 64;
+			src += 64;
+			len -= 64;
+		}
+	}
+
 	while (len >= 32 * 64) {
+		if (len >= 2 * 32 * 64)
+			memmove_prefetch32x64b(src + 32 * 64);
 		memmove_movnt32x64b(dest, src);
 		dest += 32 * 64;
 		src += 32 * 64;
 		len -= 32 * 64;
 	}
 
-	if (len >= 16 * 64) {
-		memmove_movnt16x64b(dest, src);
-		dest += 16 * 64;
-		src += 16 * 64;
-		len -= 16 * 64;
-	}
-
-	if (len >= 8 * 64) {
-		memmove_movnt8x64b(dest, src);
-		dest += 8 * 64;
-		src += 8 * 64;
-		len -= 8 * 64;
-	}
-
-	if (len >= 4 * 64) {
+	/* the tail, one XPLine at a time */
+	while (len >= 4 * 64) {
 		memmove_movnt4x64b(dest, src);
 		dest += 4 * 64;
 		src += 4 * 64;
@@ -354,28 +300,27 @@ memmove_movnt_avx512f_bw(char *dest, const char *src, size_t len)
 		memmove_small_avx512f(dest, src, cnt);
 	}
 
+	/* write only whole, aligned XPLines once there is more than one */
+	if (len >= 2 * XPLINE_SIZE) {
+		while ((uint64_t)dest & (XPLINE_SIZE - 1)) {
+			dest -= 64;
+			src -= 64;
+			len -= 64;
+			memmove_movnt1x64b(dest, src);
+		}
+	}
+
 	while (len >= 32 * 64) {
 		dest -= 32 * 64;
 		src -= 32 * 64;
 		len -= 32 * 64;
+		if (len >= 32 * 64)
+			memmove_prefetch32x64b(src - 32 * 64);
 		memmove_movnt32x64b(dest, src);
 	}
 
-	if (len >= 16 * 64) {
-		dest -= 16 * 64;
-		src -= 16 * 64;
-		len -= 16 * 64;
-		memmove_movnt16x64b(dest, src);
-	}
-
-	if (len >= 8 * 64) {
-		dest -= 8 * 64;
-		src -= 8 * 64;
-		len -= 8 * 64;
-		memmove_movnt8x64b(dest, src);
-	}
-
-	if (len >= 4 * 64) {
+	/* the tail, one XPLine at a time */
+	while (len >= 4 * 64) {
 		dest -= 4 * 64;
 		src -= 4 * 64;
 		len -= 4 * 64;
@@ -37,6 +37,13 @@
 #include <xmmintrin.h>
 #include "pmem2_arch.h"
 
+/*
+ * Size of the internal write unit of the persistent memory media (XPLine).
+ * Large non-temporal stores are issued in whole, aligned units of this size,
+ * so that the media controller does not have to merge partial writes.
+ */
+#define XPLINE_SIZE 256
+
 static inline void
 barrier_after_ntstores(void)
 {
@@ -1,5 +1,5 @@
 /*
- * Copyright 2017-2019, Intel Corporation
+ * Copyright 2017-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -82,44 +82,6 @@ memset_movnt32x64b(char *dest, __m512i zmm)
 	VALGRIND_DO_FLUSH(dest, 32 * 64);
 }
 
-static force_inline void
-memset_movnt16x64b(char *dest, __m512i zmm)
-{
-	_mm512_stream_si512((__m512i *)dest + 0, zmm);
-	_mm512_stream_si512((__m512i *)dest + 1, zmm);
-	_mm512_stream_si512((__m512i *)dest + 2, zmm);
-	_mm512_stream_si512((__m512i *)dest + 3, zmm);
-	_mm512_stream_si512((__m512i *)dest + 4, zmm);
-	_mm512_stream_si512((__m512i *)dest + 5, zmm);
-	_mm512_stream_si512((__m512i *)dest + 6, zmm);
-	_mm512_stream_si512((__m512i *)dest + 7, zmm);
-	_mm512_stream_si512((__m512i *)dest + 8, zmm);
-	_mm512_stream_si512((__m512i *)dest + 9, zmm);
-	_mm512_stream_si512((__m512i *)dest + 10, zmm);
-	_mm512_stream_si512((__m512i *)dest + 11, zmm);
-	_mm512_stream_si512((__m512i *)dest + 12, zmm);
-	_mm512_stream_si512((__m512i *)dest + 13, zmm);
-	_mm512_stream_si512((__m512i *)dest + 14, zmm);
-	_mm512_stream_si512((__m512i *)dest + 15, zmm);
-
-	VALGRIND_DO_FLUSH(dest, 16 * 64);
-}
-
-static force_inline void
-memset_movnt8x64b(char *dest, __m512i zmm)
-{
-	_mm512_stream_si512((__m512i *)dest + 0, zmm);
-	_mm512_stream_si512((__m512i *)dest + 1, zmm);
-	_mm512_stream_si512((__m512i *)dest + 2, zmm);
-	_mm512_stream_si512((__m512i *)dest + 3, zmm);
-	_mm512_stream_si512((__m512i *)dest + 4, zmm);
-	_mm512_stream_si512((__m512i *)dest + 5, zmm);
-	_mm512_stream_si512((__m512i *)dest + 6, zmm);
-	_mm512_stream_si512((__m512i *)dest + 7, zmm);
-
-	VALGRIND_DO_FLUSH(dest, 8 * 64);
-}
-
 static force_inline void
 memset_movnt4x64b(char *dest, __m512i zmm)
 {
@@ -209,25 +171,23 @@ EXPORTED_SYMBOL(char *dest, int c, size_t len)
 		len -= cnt;
 	}
 
+	/* write only whole, aligned XPLines once there is more than one */
+	if (len >= 2 * XPLINE_SIZE) {
+		while ((uint64_t)dest & (XPLINE_SIZE - 1)) {
+			memset_movnt1x64b(dest, zmm);
+			dest += 64;
+			len -= 64;
+		}
+	}
+
 	while (len >= 32 * 64) {
 		memset_movnt32x64b(dest, zmm);
 		dest += 32 * 64;
 		len -= 32 * 64;
 	}
 
-	if (len >= 16 * 64) {
-		memset_movnt16x64b(dest, zmm);
-		dest += 16 * 64;
-		len -= 16 * 64;
-	}
-
-	if (len >= 8 * 64) {
-		memset_movnt8x64b(dest, zmm);
-		dest += 8 * 64;
-		len -= 8 * 64;
-	}
-
-	if (len >= 4 * 64) {
+	/* the tail, one XPLine at a time */
+	while (len >= 4 * 64) {
 		memset_movnt4x64b(dest, zmm);
 		dest += 4 * 64;
 		len -= 4 * 64;
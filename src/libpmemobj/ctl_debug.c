@@ -1,5 +1,5 @@
 /*
- * Copyright 2018-2019, Intel Corporation
+ * Copyright 2018-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -76,6 +76,7 @@ static const struct ctl_node CTL_NODE(heap)[] = {
 
 static const struct ctl_node CTL_NODE(debug)[] = {
 	CTL_CHILD(heap),
+	CTL_CHILD(flush_profile),
 
 	CTL_NODE_END
 };
@@ -0,0 +1,636 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * flush_prof.c -- sampling profiler of flushes and fences issued through
+ * pmem_ops
+ *
+ * Every sampled persist, flush, drain, memcpy, memmove and memset call is
+ * attributed to its call site (the return address of the pmem_ops
+ * function). For each site the profiler counts the cache lines flushed and
+ * the fences issued. A line is counted as clean when its content did not
+ * change since it was last flushed by the same thread, which means the
+ * flush was redundant. Lines are tracked in a small, direct-mapped,
+ * per-thread table of line content hashes, so this is an estimate that can
+ * only miss redundant flushes, not report false ones (barring hash
+ * collisions).
+ */
+
+#define _GNU_SOURCE
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(USE_LIBDL) && !defined(_WIN32)
+#include <dlfcn.h>
+#endif
+
+#include "alloc.h"
+#include "flush_prof.h"
+#include "libpmem.h"
+#include "obj.h"
+#include "os.h"
+#include "os_thread.h"
+#include "out.h"
+#include "util.h"
+
+#define FLUSH_PROF_LINES 4096 /* must be a power of two */
+#define FLUSH_PROF_PROBES 16
+
+/* per-thread state of the profiler, shared by all pools */
+struct flush_prof_tls {
+	unsigned tick;
+	struct {
+		uintptr_t addr;
+		uint64_t hash;
+	} lines[FLUSH_PROF_LINES];
+};
+
+static os_tls_key_t Flush_prof_key;
+
+/* call site of the public function which issued the current pmem_ops call */
+static __thread const void *Flush_prof_api_site;
+
+/*
+ * flush_prof_tls_destructor -- (internal) frees per-thread profiler state
+ */
+static void
+flush_prof_tls_destructor(void *arg)
+{
+	Free(arg);
+}
+
+/*
+ * flush_prof_boot -- initializes global state of the profiler
+ */
+void
+flush_prof_boot(void)
+{
+	int ret = os_tls_key_create(&Flush_prof_key,
+		flush_prof_tls_destructor);
+	if (ret)
+		FATAL("!os_tls_key_create");
+}
+
+/*
+ * flush_prof_fini -- cleans up global state of the profiler
+ */
+void
+flush_prof_fini(void)
+{
+	Free(os_tls_get(Flush_prof_key));
+	(void) os_tls_key_delete(Flush_prof_key);
+}
+
+/*
+ * flush_prof_new -- allocates a disabled profiler instance
+ */
+struct flush_prof *
+flush_prof_new(void)
+{
+	struct flush_prof *fp = Zalloc(sizeof(*fp));
+	if (fp == NULL) {
+		ERR("!Zalloc");
+		return NULL;
+	}
+
+	fp->enabled = 0;
+	fp->sample_rate = 1;
+
+	return fp;
+}
+
+/*
+ * flush_prof_delete -- writes the final report, if an output was set, and
+ *	deletes the profiler instance
+ */
+void
+flush_prof_delete(struct flush_prof *fp)
+{
+	if (fp == NULL)
+		return;
+
+	if (fp->output[0] != '\0')
+		(void) flush_prof_report(fp, fp->output);
+
+	Free(fp);
+}
+
+/*
+ * flush_prof_api_site -- sets the call site to which the next recorded call
+ *	is attributed, used by the public functions so that calls are
+ *	attributed to the application and not to libpmemobj
+ */
+void
+flush_prof_api_site(const void *site)
+{
+	Flush_prof_api_site = site;
+}
+
+/*
+ * flush_prof_site_resolve -- (internal) returns the call site of the
+ *	current call
+ */
+static const void *
+flush_prof_site_resolve(const void *site)
+{
+	const void *api_site = Flush_prof_api_site;
+	if (api_site == NULL)
+		return site;
+
+	Flush_prof_api_site = NULL;
+	return api_site;
+}
+
+/*
+ * flush_prof_tls_get -- (internal) returns per-thread state if the current
+ *	call should be sampled, NULL otherwise
+ */
+static struct flush_prof_tls *
+flush_prof_tls_get(struct flush_prof *fp)
+{
+	struct flush_prof_tls *t = os_tls_get(Flush_prof_key);
+	if (t == NULL) {
+		t = Zalloc(sizeof(*t));
+		if (t == NULL)
+			return NULL;
+		os_tls_set(Flush_prof_key, t);
+	}
+
+	int rate = fp->sample_rate;
+	if (rate > 1 && ++t->tick % (unsigned)rate != 0)
+		return NULL;
+
+	return t;
+}
+
+/*
+ * flush_prof_site_get -- (internal) returns the counters of the call site
+ */
+static struct flush_prof_site *
+flush_prof_site_get(struct flush_prof *fp, const void *site)
+{
+	uint64_t s = (uint64_t)(uintptr_t)site;
+	uint64_t h = (s >> 4) ^ (s >> 16);
+
+	for (unsigned i = 0; i < FLUSH_PROF_PROBES; ++i) {
+		struct flush_prof_site *e =
+			&fp->sites[(h + i) & (FLUSH_PROF_MAX_SITES - 1)];
+
+		uint64_t cur;
+		util_atomic_load_explicit64(&e->site, &cur,
+			memory_order_acquire);
+		if (cur == 0 &&
+		    util_bool_compare_and_swap64(&e->site, 0, s))
+			return e;
+
+		util_atomic_load_explicit64(&e->site, &cur,
+			memory_order_acquire);
+		if (cur == s)
+			return e;
+	}
+
+	return &fp->other;
+}
+
+/*
+ * flush_prof_line_hash -- (internal) hashes the content of a cache line
+ */
+static uint64_t
+flush_prof_line_hash(uintptr_t line)
+{
+	const uint64_t *w = (const uint64_t *)line;
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (unsigned i = 0; i < CACHELINE_SIZE / sizeof(*w); ++i)
+		h = (h ^ w[i]) * 0x100000001b3ULL;
+
+	return h;
+}
+
+/*
+ * flush_prof_lines -- (internal) records the lines of the range in the
+ *	per-thread table and returns their number, lines which did not change
+ *	since they were last recorded are counted in *clean
+ */
+static uint64_t
+flush_prof_lines(struct flush_prof_tls *t, const void *addr, size_t len,
+	uint64_t *clean)
+{
+	if (len == 0)
+		return 0;
+
+	uintptr_t start = ALIGN_DOWN((uintptr_t)addr, CACHELINE_SIZE);
+	uintptr_t end = ALIGN_UP((uintptr_t)addr + len, CACHELINE_SIZE);
+	uint64_t nlines = 0;
+
+	for (uintptr_t line = start; line < end; line += CACHELINE_SIZE) {
+		uint64_t h = flush_prof_line_hash(line);
+		unsigned slot = (unsigned)(line / CACHELINE_SIZE) &
+			(FLUSH_PROF_LINES - 1);
+
+		if (t->lines[slot].addr == line && t->lines[slot].hash == h)
+			(*clean)++;
+
+		t->lines[slot].addr = line;
+		t->lines[slot].hash = h;
+		nlines++;
+	}
+
+	return nlines;
+}
+
+/*
+ * flush_prof_lines_forget -- (internal) removes the lines of the range from
+ *	the per-thread table, so that flushing them later is not counted as
+ *	clean
+ */
+static void
+flush_prof_lines_forget(struct flush_prof_tls *t, const void *addr,
+	size_t len)
+{
+	if (len == 0)
+		return;
+
+	uintptr_t start = ALIGN_DOWN((uintptr_t)addr, CACHELINE_SIZE);
+	uintptr_t end = ALIGN_UP((uintptr_t)addr + len, CACHELINE_SIZE);
+
+	for (uintptr_t line = start; line < end; line += CACHELINE_SIZE) {
+		unsigned slot = (unsigned)(line / CACHELINE_SIZE) &
+			(FLUSH_PROF_LINES - 1);
+
+		if (t->lines[slot].addr == line)
+			t->lines[slot].addr = 0;
+	}
+}
+
+/*
+ * flush_prof_flush -- records a flush of the range (which may be empty),
+ *	followed by a fence if 'fence' is set
+ */
+void
+flush_prof_flush(struct flush_prof *fp, const void *site,
+	const void *addr, size_t len, int fence)
+{
+	site = flush_prof_site_resolve(site);
+
+	struct flush_prof_tls *t = flush_prof_tls_get(fp);
+	if (t == NULL)
+		return;
+
+	uint64_t clean = 0;
+	uint64_t lines = flush_prof_lines(t, addr, len, &clean);
+
+	struct flush_prof_site *e = flush_prof_site_get(fp, site);
+	util_fetch_and_add64(&e->calls, 1);
+	util_fetch_and_add64(&e->lines, lines);
+	util_fetch_and_add64(&e->clean_lines, clean);
+	if (fence)
+		util_fetch_and_add64(&e->fences, 1);
+}
+
+/*
+ * flush_prof_store -- records a memcpy, memmove or memset of the range,
+ *	performed with the given flags
+ *
+ * Stores always modify the lines, so none of them is counted as clean, but
+ * flushed stores are recorded so that flushing the lines again is. Lines
+ * stored with PMEM_F_MEM_NOFLUSH are still dirty, so they are forgotten
+ * instead, and such stores issue no fence either.
+ */
+void
+flush_prof_store(struct flush_prof *fp, const void *site,
+	const void *addr, size_t len, unsigned flags)
+{
+	site = flush_prof_site_resolve(site);
+
+	struct flush_prof_tls *t = flush_prof_tls_get(fp);
+	if (t == NULL)
+		return;
+
+	struct flush_prof_site *e = flush_prof_site_get(fp, site);
+	util_fetch_and_add64(&e->calls, 1);
+
+	if (flags & PMEM_F_MEM_NOFLUSH) {
+		flush_prof_lines_forget(t, addr, len);
+		return;
+	}
+
+	uint64_t clean = 0;
+	uint64_t lines = flush_prof_lines(t, addr, len, &clean);
+
+	util_fetch_and_add64(&e->lines, lines);
+	if (!(flags & PMEM_F_MEM_NODRAIN))
+		util_fetch_and_add64(&e->fences, 1);
+}
+
+/*
+ * flush_prof_total -- (internal) sums the counters of all call sites
+ */
+static void
+flush_prof_total(struct flush_prof *fp, struct flush_prof_site *total)
+{
+	*total = fp->other;
+
+	for (unsigned i = 0; i < FLUSH_PROF_MAX_SITES; ++i) {
+		struct flush_prof_site *e = &fp->sites[i];
+		total->calls += e->calls;
+		total->lines += e->lines;
+		total->clean_lines += e->clean_lines;
+		total->fences += e->fences;
+	}
+}
+
+/*
+ * flush_prof_site_cmp -- (internal) orders call sites by the number of
+ *	flushed lines, descending
+ */
+static int
+flush_prof_site_cmp(const void *a, const void *b)
+{
+	const struct flush_prof_site *sa = a;
+	const struct flush_prof_site *sb = b;
+
+	if (sa->lines != sb->lines)
+		return sa->lines < sb->lines ? 1 : -1;
+	if (sa->fences != sb->fences)
+		return sa->fences < sb->fences ? 1 : -1;
+
+	return 0;
+}
+
+/*
+ * flush_prof_print_site -- (internal) prints one line of the report
+ */
+static void
+flush_prof_print_site(FILE *f, const struct flush_prof_site *e,
+	const char *name)
+{
+	char location[256] = "";
+
+	if (name != NULL) {
+		snprintf(location, sizeof(location), "%s", name);
+	} else {
+#if defined(USE_LIBDL) && !defined(_WIN32)
+		Dl_info info;
+		void *addr = (void *)(uintptr_t)e->site;
+		if (dladdr(addr, &info) != 0) {
+			if (info.dli_sname != NULL)
+				snprintf(location, sizeof(location),
+					"%s+0x%" PRIxPTR, info.dli_sname,
+					(uintptr_t)addr -
+					(uintptr_t)info.dli_saddr);
+			else if (info.dli_fname != NULL)
+				snprintf(location, sizeof(location),
+					"%s+0x%" PRIxPTR, info.dli_fname,
+					(uintptr_t)addr -
+					(uintptr_t)info.dli_fbase);
+		}
+#endif
+	}
+
+	fprintf(f, "0x%016" PRIx64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+		" %12" PRIu64 "  %s\n", e->site, e->calls, e->lines,
+		e->clean_lines, e->fences, location);
+}
+
+/*
+ * flush_prof_report -- writes the report to the file at 'path', or to
+ *	stderr if 'path' is NULL or empty
+ */
+int
+flush_prof_report(struct flush_prof *fp, const char *path)
+{
+	FILE *f = stderr;
+	if (path != NULL && path[0] != '\0') {
+		f = os_fopen(path, "w");
+		if (f == NULL) {
+			ERR("!%s", path);
+			return -1;
+		}
+	}
+
+	struct flush_prof_site *sites =
+		Malloc(sizeof(*sites) * FLUSH_PROF_MAX_SITES);
+	if (sites == NULL) {
+		ERR("!Malloc");
+		if (f != stderr)
+			os_fclose(f);
+		return -1;
+	}
+
+	unsigned nsites = 0;
+	for (unsigned i = 0; i < FLUSH_PROF_MAX_SITES; ++i) {
+		if (fp->sites[i].site != 0)
+			sites[nsites++] = fp->sites[i];
+	}
+	qsort(sites, nsites, sizeof(*sites), flush_prof_site_cmp);
+
+	struct flush_prof_site total;
+	flush_prof_total(fp, &total);
+
+	fprintf(f, "flush profile, 1 in %d calls sampled\n",
+		fp->sample_rate);
+	fprintf(f, "%-18s %12s %12s %12s %12s  %s\n", "site", "calls",
+		"lines", "clean", "fences", "location");
+	for (unsigned i = 0; i < nsites; ++i)
+		flush_prof_print_site(f, &sites[i], NULL);
+	if (fp->other.calls != 0)
+		flush_prof_print_site(f, &fp->other, "<other>");
+	flush_prof_print_site(f, &total, "<total>");
+
+	Free(sites);
+
+	if (f != stderr)
+		os_fclose(f);
+	else
+		fflush(f);
+
+	return 0;
+}
+
+/*
+ * CTL_READ_HANDLER(enabled) -- returns whether the profiler is enabled
+ */
+static int
+CTL_READ_HANDLER(enabled)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	int *arg_out = arg;
+
+	*arg_out = pop->flush_prof->enabled;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(enabled) -- enables or disables the profiler
+ */
+static int
+CTL_WRITE_HANDLER(enabled)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	pop->flush_prof->enabled = *(int *)arg;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(enabled) = CTL_ARG_BOOLEAN;
+
+/*
+ * CTL_READ_HANDLER(sample_rate) -- returns the sampling rate
+ */
+static int
+CTL_READ_HANDLER(sample_rate)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	int *arg_out = arg;
+
+	*arg_out = pop->flush_prof->sample_rate;
+
+	return 0;
+}
+
+/*
+ * CTL_WRITE_HANDLER(sample_rate) -- sets the sampling rate, one in every
+ *	'sample_rate' calls is recorded
+ */
+static int
+CTL_WRITE_HANDLER(sample_rate)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	int arg_in = *(int *)arg;
+
+	if (arg_in < 1) {
+		ERR("invalid sample rate %d", arg_in);
+		errno = EINVAL;
+		return -1;
+	}
+
+	pop->flush_prof->sample_rate = arg_in;
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(sample_rate) = CTL_ARG_INT;
+
+/*
+ * CTL_WRITE_HANDLER(output) -- sets the path of the report written when
+ *	the pool is closed
+ */
+static int
+CTL_WRITE_HANDLER(output)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	const char *arg_in = arg;
+
+	if (strnlen(arg_in, FLUSH_PROF_OUTPUT_MAX) == FLUSH_PROF_OUTPUT_MAX) {
+		ERR("output path too long");
+		errno = EINVAL;
+		return -1;
+	}
+
+	strcpy(pop->flush_prof->output, arg_in);
+
+	return 0;
+}
+
+static const struct ctl_argument CTL_ARG(output) =
+	CTL_ARG_STRING(FLUSH_PROF_OUTPUT_MAX);
+
+/*
+ * CTL_RUNNABLE_HANDLER(dump) -- writes the report to the output, or to
+ *	stderr if no output was set
+ */
+static int
+CTL_RUNNABLE_HANDLER(dump)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+
+	return flush_prof_report(pop->flush_prof, pop->flush_prof->output);
+}
+
+/*
+ * CTL_RUNNABLE_HANDLER(reset) -- zeroes all the counters
+ */
+static int
+CTL_RUNNABLE_HANDLER(reset)(void *ctx,
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)
+{
+	PMEMobjpool *pop = ctx;
+	struct flush_prof *fp = pop->flush_prof;
+
+	memset(&fp->other, 0, sizeof(fp->other));
+	memset(fp->sites, 0, sizeof(fp->sites));
+
+	return 0;
+}
+
+#define FLUSH_PROF_TOTAL_HANDLER(name)\
+static int CTL_READ_HANDLER(name)(void *ctx,\
+	enum ctl_query_source source, void *arg, struct ctl_indexes *indexes)\
+{\
+	PMEMobjpool *pop = ctx;\
+	struct flush_prof_site total;\
+	flush_prof_total(pop->flush_prof, &total);\
+	*(uint64_t *)arg = total.name;\
+	return 0;\
+}
+
+FLUSH_PROF_TOTAL_HANDLER(calls)
+FLUSH_PROF_TOTAL_HANDLER(lines)
+FLUSH_PROF_TOTAL_HANDLER(clean_lines)
+FLUSH_PROF_TOTAL_HANDLER(fences)
+
+const struct ctl_node CTL_NODE(flush_profile)[] = {
+	CTL_LEAF_RW(enabled),
+	CTL_LEAF_RW(sample_rate),
+	CTL_LEAF_WO(output),
+	CTL_LEAF_RUNNABLE(dump),
+	CTL_LEAF_RUNNABLE(reset),
+	CTL_LEAF_RO(calls),
+	CTL_LEAF_RO(lines),
+	CTL_LEAF_RO(clean_lines),
+	CTL_LEAF_RO(fences),
+
+	CTL_NODE_END
+};
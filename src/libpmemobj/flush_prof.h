@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * flush_prof.h -- sampling profiler of flushes and fences issued through
+ * pmem_ops
+ */
+
+#ifndef LIBPMEMOBJ_FLUSH_PROF_H
+#define LIBPMEMOBJ_FLUSH_PROF_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ctl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _WIN32
+#include <intrin.h>
+#define FLUSH_PROF_CALLER() _ReturnAddress()
+#else
+#define FLUSH_PROF_CALLER() __builtin_return_address(0)
+#endif
+
+#define FLUSH_PROF_MAX_SITES 512 /* must be a power of two */
+#define FLUSH_PROF_OUTPUT_MAX 1024
+
+struct flush_prof_site {
+	uint64_t site;		/* return address of the call, 0 if unused */
+	uint64_t calls;		/* number of sampled calls */
+	uint64_t lines;		/* cache lines flushed */
+	uint64_t clean_lines;	/* lines flushed without being modified */
+	uint64_t fences;	/* fences (drains) issued */
+};
+
+struct flush_prof {
+	int enabled;
+	int sample_rate;	/* one in every sample_rate calls is recorded */
+	char output[FLUSH_PROF_OUTPUT_MAX]; /* report path, empty if none */
+
+	struct flush_prof_site other; /* calls that did not fit in sites */
+	struct flush_prof_site sites[FLUSH_PROF_MAX_SITES];
+};
+
+void flush_prof_boot(void);
+void flush_prof_fini(void);
+
+struct flush_prof *flush_prof_new(void);
+void flush_prof_delete(struct flush_prof *fp);
+
+void flush_prof_api_site(const void *site);
+void flush_prof_flush(struct flush_prof *fp, const void *site,
+	const void *addr, size_t len, int fence);
+void flush_prof_store(struct flush_prof *fp, const void *site,
+	const void *addr, size_t len, unsigned flags);
+
+int flush_prof_report(struct flush_prof *fp, const char *path);
+
+extern const struct ctl_node CTL_NODE(flush_profile)[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
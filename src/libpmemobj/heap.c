@@ -1598,18 +1598,25 @@ heap_init(void *heap_start, uint64_t heap_size, uint64_t *sizep,
 	heap_write_header(&layout->header);
 	pmemops_persist(p_ops, &layout->header, sizeof(struct heap_header));
 
+	/*
+	 * The zone headers are independent of each other, so they are all
+	 * flushed first and drained once, instead of once per zone.
+	 */
 	unsigned zones = heap_max_zone(heap_size);
 	for (unsigned i = 0; i < zones; ++i) {
 		struct zone *zone = ZID_TO_ZONE(layout, i);
 		pmemops_memset(p_ops, &zone->header, 0,
-				sizeof(struct zone_header), 0);
+				sizeof(struct zone_header),
+				PMEMOBJ_F_MEM_NODRAIN);
 		pmemops_memset(p_ops, &zone->chunk_headers, 0,
-				sizeof(struct chunk_header), 0);
+				sizeof(struct chunk_header),
+				PMEMOBJ_F_MEM_NODRAIN);
 
 		/* only explicitly allocated chunks should be accessible */
 		VALGRIND_DO_MAKE_MEM_NOACCESS(&zone->chunk_headers,
 			sizeof(struct chunk_header));
 	}
+	pmemops_drain(p_ops);
 
 	*sizep = heap_size;
 	pmemops_persist(p_ops, sizep, sizeof(*sizep));
@@ -1824,17 +1831,20 @@ out:
 }
 
 /*
- * heap_zone_foreach_object -- (internal) iterates through objects in a zone
+ * heap_zone_foreach_object -- (internal) iterates through objects in a zone,
+ *	stops at the block which starts at or after the chunk_end
  */
 static int
 heap_zone_foreach_object(struct palloc_heap *heap, object_callback cb,
-	void *arg, struct memory_block *m)
+	void *arg, struct memory_block *m, uint32_t chunk_end)
 {
 	struct zone *zone = ZID_TO_ZONE(heap->layout, m->zone_id);
 	if (zone->header.magic == 0)
 		return 0;
 
-	for (; m->chunk_id < zone->header.size_idx; ) {
+	uint32_t end = MIN(chunk_end, zone->header.size_idx);
+
+	for (; m->chunk_id < end; ) {
 		struct chunk_header *hdr = heap_get_chunk_hdr(heap, m);
 		memblock_rebuild_state(heap, m);
 		m->size_idx = hdr->size_idx;
@@ -1857,13 +1867,93 @@ heap_foreach_object(struct palloc_heap *heap, object_callback cb, void *arg,
 	struct memory_block m)
 {
 	for (; m.zone_id < heap->rt->nzones; ++m.zone_id) {
-		if (heap_zone_foreach_object(heap, cb, arg, &m) != 0)
+		if (heap_zone_foreach_object(heap, cb, arg, &m,
+				UINT32_MAX) != 0)
 			break;
 
 		m.chunk_id = 0;
 	}
 }
 
+/*
+ * heap_foreach_object_range -- iterates through objects in the range of
+ *	chunks, returns 1 if the iteration was stopped by the callback
+ */
+int
+heap_foreach_object_range(struct palloc_heap *heap, object_callback cb,
+	void *arg, const struct heap_range *range)
+{
+	struct memory_block m = MEMORY_BLOCK_NONE;
+	m.zone_id = range->zone_id;
+	m.chunk_id = range->chunk_begin;
+
+	return heap_zone_foreach_object(heap, cb, arg, &m, range->chunk_end);
+}
+
+/*
+ * heap_split -- divides the heap into ranges of chunks which can be iterated
+ *	through independently
+ *
+ * Every range begins at a chunk header and, except for the last range of
+ * a zone, spans at least nchunks chunks. The array of ranges is allocated
+ * by this function and has to be freed by the caller.
+ */
+int
+heap_split(struct palloc_heap *heap, uint32_t nchunks,
+	struct heap_range **ranges, size_t *nranges)
+{
+	ASSERTne(nchunks, 0);
+
+	size_t max = 0;
+	for (uint32_t z = 0; z < heap->rt->nzones; ++z) {
+		struct zone *zone = ZID_TO_ZONE(heap->layout, z);
+		if (zone->header.magic == 0)
+			continue;
+
+		max += zone->header.size_idx / nchunks + 1;
+	}
+
+	*nranges = 0;
+	*ranges = NULL;
+	if (max == 0)
+		return 0;
+
+	struct heap_range *r = Malloc(max * sizeof(*r));
+	if (r == NULL) {
+		ERR("!Malloc");
+		return -1;
+	}
+
+	size_t n = 0;
+	for (uint32_t z = 0; z < heap->rt->nzones; ++z) {
+		struct zone *zone = ZID_TO_ZONE(heap->layout, z);
+		if (zone->header.magic == 0)
+			continue;
+
+		uint32_t begin = 0;
+		uint32_t c = 0;
+		while (c < zone->header.size_idx) {
+			ASSERTne(zone->chunk_headers[c].size_idx, 0);
+			c += zone->chunk_headers[c].size_idx;
+
+			if (c - begin >= nchunks ||
+					c >= zone->header.size_idx) {
+				ASSERT(n < max);
+				r[n].zone_id = z;
+				r[n].chunk_begin = begin;
+				r[n].chunk_end = c;
+				n++;
+				begin = c;
+			}
+		}
+	}
+
+	*ranges = r;
+	*nranges = n;
+
+	return 0;
+}
+
 #if VG_MEMCHECK_ENABLED
 
 /*
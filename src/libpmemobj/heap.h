@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2019, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -107,6 +107,18 @@ heap_free_chunk_reuse(struct palloc_heap *heap,
 void heap_foreach_object(struct palloc_heap *heap, object_callback cb,
 	void *arg, struct memory_block start);
 
+/* range of chunks of a single zone */
+struct heap_range {
+	uint32_t zone_id;
+	uint32_t chunk_begin;
+	uint32_t chunk_end;
+};
+
+int heap_split(struct palloc_heap *heap, uint32_t nchunks,
+	struct heap_range **ranges, size_t *nranges);
+int heap_foreach_object_range(struct palloc_heap *heap, object_callback cb,
+	void *arg, const struct heap_range *range);
+
 struct alloc_class_collection *heap_alloc_classes(struct palloc_heap *heap);
 
 void *heap_end(struct palloc_heap *heap);
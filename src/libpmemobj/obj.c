@@ -310,6 +310,7 @@ obj_init(void)
 		FATAL("error: %s", pmemobj_errormsg());
 
 	lane_info_boot();
+	flush_prof_boot();
 
 	util_remote_init();
 }
@@ -329,6 +330,7 @@ obj_fini(void)
 	if (pools_tree)
 		critnib_delete(pools_tree);
 	lane_info_destroy();
+	flush_prof_fini();
 	util_remote_fini();
 
 #ifdef _WIN32
@@ -427,6 +429,27 @@ obj_remote_persist(PMEMobjpool *pop, const void *addr, size_t len,
  * if there are no replicas.  Verify the performance penalty.
  */
 
+/*
+ * OBJ_FLUSH_PROF -- (internal) records the call in the flush profiler, if
+ * it is enabled; must be used directly in the pmem_ops functions, because
+ * their return address identifies the call site
+ */
+#define OBJ_FLUSH_PROF(pop, fn, ...) do {\
+	struct flush_prof *_fp = (pop)->flush_prof;\
+	if (unlikely(_fp != NULL && _fp->enabled))\
+		flush_prof_##fn(_fp, FLUSH_PROF_CALLER(), __VA_ARGS__);\
+} while (0)
+
+/*
+ * OBJ_FLUSH_PROF_API -- (internal) makes the flush profiler attribute the
+ * next pmem_ops call to the caller of the public function
+ */
+#define OBJ_FLUSH_PROF_API(pop) do {\
+	struct flush_prof *_fp = (pop)->flush_prof;\
+	if (unlikely(_fp != NULL && _fp->enabled))\
+		flush_prof_api_site(FLUSH_PROF_CALLER());\
+} while (0)
+
 /*
  * obj_norep_memcpy -- (internal) memcpy w/o replication
  */
@@ -438,8 +461,12 @@ obj_norep_memcpy(void *ctx, void *dest, const void *src, size_t len,
 	LOG(15, "pop %p dest %p src %p len %zu flags 0x%x", pop, dest, src, len,
 			flags);
 
-	return pop->memcpy_local(dest, src, len,
+	void *ret = pop->memcpy_local(dest, src, len,
 					flags & PMEM_F_MEM_VALID_FLAGS);
+
+	OBJ_FLUSH_PROF(pop, store, dest, len, flags);
+
+	return ret;
 }
 
 /*
@@ -453,8 +480,12 @@ obj_norep_memmove(void *ctx, void *dest, const void *src, size_t len,
 	LOG(15, "pop %p dest %p src %p len %zu flags 0x%x", pop, dest, src, len,
 			flags);
 
-	return pop->memmove_local(dest, src, len,
+	void *ret = pop->memmove_local(dest, src, len,
 					flags & PMEM_F_MEM_VALID_FLAGS);
+
+	OBJ_FLUSH_PROF(pop, store, dest, len, flags);
+
+	return ret;
 }
 
 /*
@@ -467,7 +498,12 @@ obj_norep_memset(void *ctx, void *dest, int c, size_t len, unsigned flags)
 	LOG(15, "pop %p dest %p c 0x%02x len %zu flags 0x%x", pop, dest, c, len,
 			flags);
 
-	return pop->memset_local(dest, c, len, flags & PMEM_F_MEM_VALID_FLAGS);
+	void *ret = pop->memset_local(dest, c, len,
+					flags & PMEM_F_MEM_VALID_FLAGS);
+
+	OBJ_FLUSH_PROF(pop, store, dest, len, flags);
+
+	return ret;
 }
 
 /*
@@ -481,6 +517,8 @@ obj_norep_persist(void *ctx, const void *addr, size_t len, unsigned flags)
 
 	pop->persist_local(addr, len);
 
+	OBJ_FLUSH_PROF(pop, flush, addr, len, 1);
+
 	return 0;
 }
 
@@ -495,6 +533,8 @@ obj_norep_flush(void *ctx, const void *addr, size_t len, unsigned flags)
 
 	pop->flush_local(addr, len);
 
+	OBJ_FLUSH_PROF(pop, flush, addr, len, 0);
+
 	return 0;
 }
 
@@ -508,6 +548,8 @@ obj_norep_drain(void *ctx)
 	LOG(15, "pop %p", pop);
 
 	pop->drain_local();
+
+	OBJ_FLUSH_PROF(pop, flush, NULL, 0, 1);
 }
 
 static void obj_pool_cleanup(PMEMobjpool *pop);
@@ -561,6 +603,8 @@ obj_rep_memcpy(void *ctx, void *dest, const void *src, size_t len,
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
+	OBJ_FLUSH_PROF(pop, store, dest, len, flags);
+
 	return ret;
 }
 
@@ -598,6 +642,8 @@ obj_rep_memmove(void *ctx, void *dest, const void *src, size_t len,
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
+	OBJ_FLUSH_PROF(pop, store, dest, len, flags);
+
 	return ret;
 }
 
@@ -634,6 +680,8 @@ obj_rep_memset(void *ctx, void *dest, int c, size_t len, unsigned flags)
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
+	OBJ_FLUSH_PROF(pop, store, dest, len, flags);
+
 	return ret;
 }
 
@@ -668,6 +716,8 @@ obj_rep_persist(void *ctx, const void *addr, size_t len, unsigned flags)
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
+	OBJ_FLUSH_PROF(pop, flush, addr, len, 1);
+
 	return 0;
 }
 
@@ -703,6 +753,8 @@ obj_rep_flush(void *ctx, const void *addr, size_t len, unsigned flags)
 	if (pop->has_remote_replicas)
 		lane_release(pop);
 
+	OBJ_FLUSH_PROF(pop, flush, addr, len, 0);
+
 	return 0;
 }
 
@@ -723,6 +775,8 @@ obj_rep_drain(void *ctx)
 			rep->drain_local();
 		rep = rep->replica;
 	}
+
+	OBJ_FLUSH_PROF(pop, flush, NULL, 0, 1);
 }
 
 #if VG_MEMCHECK_ENABLED
@@ -1144,6 +1198,7 @@ obj_replica_init(PMEMobjpool *rep, struct pool_set *set, unsigned repidx,
 			rep->p_ops.memset = obj_norep_memset;
 		}
 		rep->p_ops.base = rep;
+		rep->flush_prof = NULL;
 	} else {
 		/* non-master replicas */
 		rep->is_master_replica = 0;
@@ -1219,6 +1274,10 @@ obj_runtime_init(PMEMobjpool *pop, int rdonly, int boot, unsigned nlanes)
 	if (pop->stats == NULL)
 		goto err_stat;
 
+	pop->flush_prof = flush_prof_new();
+	if (pop->flush_prof == NULL)
+		goto err_flush_prof;
+
 	pop->user_data = NULL;
 
 	VALGRIND_REMOVE_PMEM_MAPPING(&pop->mutex_head,
@@ -1293,6 +1352,9 @@ err_tree_insert:
 err_critnib_insert:
 	obj_runtime_cleanup_common(pop);
 err_boot:
+	flush_prof_delete(pop->flush_prof);
+	pop->flush_prof = NULL;
+err_flush_prof:
 	stats_delete(pop, pop->stats);
 err_stat:
 	tx_params_delete(pop->tx_params);
@@ -1947,6 +2009,7 @@ obj_pool_cleanup(PMEMobjpool *pop)
 	ravl_delete(pop->ulog_user_buffers.map);
 	util_mutex_destroy(&pop->ulog_user_buffers.lock);
 
+	flush_prof_delete(pop->flush_prof);
 	stats_delete(pop, pop->stats);
 	tx_params_delete(pop->tx_params);
 	ctl_delete(pop->ctl);
@@ -2034,6 +2097,7 @@ pmemobj_checkU(const char *path, const char *layout)
 	if (consistent) {
 		obj_pool_cleanup(pop);
 	} else {
+		flush_prof_delete(pop->flush_prof);
 		stats_delete(pop, pop->stats);
 		tx_params_delete(pop->tx_params);
 		ctl_delete(pop->ctl);
@@ -2668,6 +2732,7 @@ pmemobj_memcpy_persist(PMEMobjpool *pop, void *dest, const void *src,
 	LOG(15, "pop %p dest %p src %p len %zu", pop, dest, src, len);
 	PMEMOBJ_API_START();
 
+	OBJ_FLUSH_PROF_API(pop);
 	void *ptr = pmemops_memcpy(&pop->p_ops, dest, src, len, 0);
 
 	PMEMOBJ_API_END();
@@ -2683,6 +2748,7 @@ pmemobj_memset_persist(PMEMobjpool *pop, void *dest, int c, size_t len)
 	LOG(15, "pop %p dest %p c 0x%02x len %zu", pop, dest, c, len);
 	PMEMOBJ_API_START();
 
+	OBJ_FLUSH_PROF_API(pop);
 	void *ptr = pmemops_memset(&pop->p_ops, dest, c, len, 0);
 
 	PMEMOBJ_API_END();
@@ -2701,6 +2767,7 @@ pmemobj_memcpy(PMEMobjpool *pop, void *dest, const void *src, size_t len,
 
 	PMEMOBJ_API_START();
 
+	OBJ_FLUSH_PROF_API(pop);
 	void *ptr = pmemops_memcpy(&pop->p_ops, dest, src, len, flags);
 
 	PMEMOBJ_API_END();
@@ -2719,6 +2786,7 @@ pmemobj_memmove(PMEMobjpool *pop, void *dest, const void *src, size_t len,
 
 	PMEMOBJ_API_START();
 
+	OBJ_FLUSH_PROF_API(pop);
 	void *ptr = pmemops_memmove(&pop->p_ops, dest, src, len, flags);
 
 	PMEMOBJ_API_END();
@@ -2736,6 +2804,7 @@ pmemobj_memset(PMEMobjpool *pop, void *dest, int c, size_t len, unsigned flags)
 
 	PMEMOBJ_API_START();
 
+	OBJ_FLUSH_PROF_API(pop);
 	void *ptr = pmemops_memset(&pop->p_ops, dest, c, len, flags);
 
 	PMEMOBJ_API_END();
@@ -2750,6 +2819,7 @@ pmemobj_persist(PMEMobjpool *pop, const void *addr, size_t len)
 {
 	LOG(15, "pop %p addr %p len %zu", pop, addr, len);
 
+	OBJ_FLUSH_PROF_API(pop);
 	pmemops_persist(&pop->p_ops, addr, len);
 }
 
@@ -2761,6 +2831,7 @@ pmemobj_flush(PMEMobjpool *pop, const void *addr, size_t len)
 {
 	LOG(15, "pop %p addr %p len %zu", pop, addr, len);
 
+	OBJ_FLUSH_PROF_API(pop);
 	pmemops_flush(&pop->p_ops, addr, len);
 }
 
@@ -2779,6 +2850,7 @@ pmemobj_xpersist(PMEMobjpool *pop, const void *addr, size_t len, unsigned flags)
 		return -1;
 	}
 
+	OBJ_FLUSH_PROF_API(pop);
 	return pmemops_xpersist(&pop->p_ops, addr, len, flags);
 }
 
@@ -2797,6 +2869,7 @@ pmemobj_xflush(PMEMobjpool *pop, const void *addr, size_t len, unsigned flags)
 		return -1;
 	}
 
+	OBJ_FLUSH_PROF_API(pop);
 	return pmemops_xflush(&pop->p_ops, addr, len, flags);
 }
 
@@ -2808,6 +2881,7 @@ pmemobj_drain(PMEMobjpool *pop)
 {
 	LOG(15, "pop %p", pop);
 
+	OBJ_FLUSH_PROF_API(pop);
 	pmemops_drain(&pop->p_ops);
 }
 
@@ -2996,6 +3070,79 @@ pmemobj_next(PMEMoid oid)
 	return curr;
 }
 
+/*
+ * pmemobj_foreach_parallel_arg -- state of the parallel object iteration
+ */
+struct pmemobj_foreach_parallel_arg {
+	PMEMobjpool *pop;
+	uint64_t type_num;
+	uint64_t flags;
+	int (*cb)(PMEMoid oid, void *arg);
+	void *arg;
+};
+
+/*
+ * pmemobj_foreach_parallel_cb -- (internal) filters out internal objects
+ *	and objects of other types, passes the rest to the user callback
+ */
+static int
+pmemobj_foreach_parallel_cb(uint64_t off, uint64_t extra, uint16_t flags,
+	void *arg)
+{
+	struct pmemobj_foreach_parallel_arg *a = arg;
+
+	if (flags & OBJ_INTERNAL_OBJECT_MASK)
+		return 0;
+
+	if ((a->flags & POBJ_ITER_TYPE_NUM) && extra != a->type_num)
+		return 0;
+
+	PMEMoid oid = {a->pop->uuid_lo, off};
+
+	return a->cb(oid, a->arg);
+}
+
+/*
+ * pmemobj_foreach_parallel -- calls cb for every object in the pool using
+ *	nthreads threads
+ */
+int
+pmemobj_foreach_parallel(PMEMobjpool *pop, unsigned nthreads,
+	uint64_t type_num, uint64_t flags,
+	int (*cb)(PMEMoid oid, void *arg), void *arg)
+{
+	LOG(3, "pop %p nthreads %u type_num %" PRIu64 " flags 0x%" PRIx64
+		" cb %p arg %p", pop, nthreads, type_num, flags, cb, arg);
+
+	if (nthreads == 0) {
+		ERR("invalid number of threads");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (flags & ~POBJ_ITER_VALID_FLAGS) {
+		ERR("unknown flags 0x%" PRIx64,
+			flags & ~POBJ_ITER_VALID_FLAGS);
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct pmemobj_foreach_parallel_arg a = {
+		.pop = pop,
+		.type_num = type_num,
+		.flags = flags,
+		.cb = cb,
+		.arg = arg,
+	};
+
+	PMEMOBJ_API_START();
+	int ret = palloc_foreach_parallel(&pop->heap, nthreads,
+		pmemobj_foreach_parallel_cb, &a);
+	PMEMOBJ_API_END();
+
+	return ret;
+}
+
 /*
  * pmemobj_reserve -- reserves a single object
  */
@@ -46,6 +46,7 @@
 #include "ctl.h"
 #include "sync.h"
 #include "stats.h"
+#include "flush_prof.h"
 #include "ctl_debug.h"
 #include "page_size.h"
 
@@ -124,7 +125,7 @@ typedef uint64_t type_num_t;
 #define CONVERSION_FLAG_OLD_SET_CACHE ((1ULL) << 0)
 
 /* PMEM_OBJ_POOL_HEAD_SIZE Without the unused and unused2 arrays */
-#define PMEM_OBJ_POOL_HEAD_SIZE 2196
+#define PMEM_OBJ_POOL_HEAD_SIZE 2204
 #define PMEM_OBJ_POOL_UNUSED2_SIZE (PMEM_PAGESIZE \
 					- OBJ_DSC_P_UNUSED\
 					- PMEM_OBJ_POOL_HEAD_SIZE)
@@ -171,6 +172,7 @@ struct pmemobjpool {
 
 	struct ctl *ctl;	/* top level node of the ctl tree structure */
 	struct stats *stats;
+	struct flush_prof *flush_prof; /* flush profiler */
 
 	struct pool_set *set;		/* pool set info */
 	struct pmemobjpool *replica;	/* next replica */
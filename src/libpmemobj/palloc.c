@@ -71,6 +71,7 @@
 #include "palloc.h"
 #include "ravl.h"
 #include "vec.h"
+#include "os_thread.h"
 
 struct pobj_action_internal {
 	/* type of operation (alloc/free vs set) */
@@ -1250,6 +1251,132 @@ palloc_next(struct palloc_heap *heap, uint64_t off)
 	return HEAP_PTR_TO_OFF(heap, uptr);
 }
 
+/* number of chunks iterated through by a single step of parallel foreach */
+#define PALLOC_FOREACH_RANGE_CHUNKS 256
+
+struct palloc_foreach_ctx {
+	struct palloc_heap *heap;
+	palloc_foreach_cb cb;
+	void *arg;
+
+	struct heap_range *ranges;
+	size_t nranges;
+
+	/* index of the next range to be taken by a worker */
+	uint64_t next;
+
+	/* first non-zero value returned by the callback */
+	int ret;
+};
+
+/*
+ * palloc_foreach_object_cb -- (internal) calls the user callback for a single
+ *	object
+ */
+static int
+palloc_foreach_object_cb(const struct memory_block *m, void *arg)
+{
+	struct palloc_foreach_ctx *ctx = arg;
+
+	int stop;
+	util_atomic_load_explicit32(&ctx->ret, &stop, memory_order_relaxed);
+	if (stop)
+		return 1;
+
+	void *uptr = m->m_ops->get_user_data(m);
+	int ret = ctx->cb(HEAP_PTR_TO_OFF(ctx->heap, uptr),
+		m->m_ops->get_extra(m), m->m_ops->get_flags(m), ctx->arg);
+	if (ret == 0)
+		return 0;
+
+	util_bool_compare_and_swap32(&ctx->ret, 0, ret);
+
+	return 1;
+}
+
+/*
+ * palloc_foreach_worker -- (internal) takes the ranges of the heap one by one
+ *	and iterates through their objects
+ */
+static void *
+palloc_foreach_worker(void *arg)
+{
+	struct palloc_foreach_ctx *ctx = arg;
+
+	for (;;) {
+		uint64_t idx = util_fetch_and_add64(&ctx->next, 1);
+		if (idx >= ctx->nranges)
+			break;
+
+		if (heap_foreach_object_range(ctx->heap,
+				palloc_foreach_object_cb, ctx,
+				&ctx->ranges[idx]) != 0)
+			break;
+	}
+
+	return NULL;
+}
+
+/*
+ * palloc_foreach_parallel -- calls the callback for every object in the heap,
+ *	the heap is split into ranges of chunks which are processed by nthreads
+ *	threads (including the calling one)
+ *
+ * The order of the objects is unspecified. Returns 0 if all objects were
+ * visited, the first non-zero value returned by the callback if the
+ * iteration was stopped or -1 on error.
+ */
+int
+palloc_foreach_parallel(struct palloc_heap *heap, unsigned nthreads,
+	palloc_foreach_cb cb, void *arg)
+{
+	ASSERTne(nthreads, 0);
+
+	struct palloc_foreach_ctx ctx;
+	ctx.heap = heap;
+	ctx.cb = cb;
+	ctx.arg = arg;
+	ctx.next = 0;
+	ctx.ret = 0;
+
+	if (heap_split(heap, PALLOC_FOREACH_RANGE_CHUNKS,
+			&ctx.ranges, &ctx.nranges) != 0)
+		return -1;
+
+	unsigned nworkers = (unsigned)MIN(nthreads - 1, ctx.nranges);
+	os_thread_t *workers = NULL;
+	unsigned started = 0;
+
+	if (nworkers != 0) {
+		workers = Malloc(nworkers * sizeof(*workers));
+		if (workers == NULL) {
+			LOG(2, "!Malloc, running on a single thread");
+			nworkers = 0;
+		}
+	}
+
+	for (; started < nworkers; ++started) {
+		int err = os_thread_create(&workers[started], NULL,
+			palloc_foreach_worker, &ctx);
+		if (err != 0) {
+			errno = err;
+			LOG(2, "!os_thread_create, continuing with %u threads",
+				started + 1);
+			break;
+		}
+	}
+
+	palloc_foreach_worker(&ctx);
+
+	for (unsigned i = 0; i < started; ++i)
+		os_thread_join(&workers[i], NULL);
+
+	Free(workers);
+	Free(ctx.ranges);
+
+	return ctx.ret;
+}
+
 /*
  * palloc_boot -- initializes allocator section
  */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2019, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -105,6 +105,12 @@ palloc_set_value(struct palloc_heap *heap, struct pobj_action *act,
 uint64_t palloc_first(struct palloc_heap *heap);
 uint64_t palloc_next(struct palloc_heap *heap, uint64_t off);
 
+typedef int (*palloc_foreach_cb)(uint64_t off, uint64_t extra,
+	uint16_t flags, void *arg);
+
+int palloc_foreach_parallel(struct palloc_heap *heap, unsigned nthreads,
+	palloc_foreach_cb cb, void *arg);
+
 size_t palloc_usable_size(struct palloc_heap *heap, uint64_t off);
 uint64_t palloc_extra(struct palloc_heap *heap, uint64_t off);
 uint16_t palloc_flags(struct palloc_heap *heap, uint64_t off);
@@ -44,15 +44,6 @@
 #include "util.h"
 #include "valgrind_internal.h"
 
-/*
- * Operation flag at the three most significant bits
- */
-#define ULOG_OPERATION(op)		((uint64_t)(op))
-#define ULOG_OPERATION_MASK		((uint64_t)(0b111ULL << 61ULL))
-#define ULOG_OPERATION_FROM_OFFSET(off)	(ulog_operation_type)\
-	((off) & ULOG_OPERATION_MASK)
-#define ULOG_OFFSET_MASK		(~(ULOG_OPERATION_MASK))
-
 #define CACHELINE_ALIGN(size) ALIGN_UP(size, CACHELINE_SIZE)
 #define IS_CACHELINE_ALIGNED(ptr)\
 	(((uintptr_t)(ptr) & (CACHELINE_SIZE - 1)) == 0)
@@ -110,6 +110,15 @@ typedef uint64_t ulog_operation_type;
 
 #define ULOG_BIT_OPERATIONS (ULOG_OPERATION_AND | ULOG_OPERATION_OR)
 
+/*
+ * Operation flag at the three most significant bits
+ */
+#define ULOG_OPERATION(op)		((uint64_t)(op))
+#define ULOG_OPERATION_MASK		((uint64_t)(0b111ULL << 61ULL))
+#define ULOG_OPERATION_FROM_OFFSET(off)	(ulog_operation_type)\
+	((off) & ULOG_OPERATION_MASK)
+#define ULOG_OFFSET_MASK		(~(ULOG_OPERATION_MASK))
+
 /* immediately frees all associated ulog structures */
 #define ULOG_FREE_AFTER_FIRST (1U << 0)
 /* increments gen_num of the first, preallocated, ulog */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2018, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -91,6 +91,11 @@ static const struct step steps[] = {
 		.func		= check_log,
 		.part		= false,
 	},
+	{
+		.type		= POOL_TYPE_OBJ,
+		.func		= check_obj,
+		.part		= false,
+	},
 	{
 		.type		= POOL_TYPE_BLK,
 		.func		= check_blk,
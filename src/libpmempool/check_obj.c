@@ -0,0 +1,1068 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * check_obj.c -- check pmemobj descriptor, lanes and heap
+ */
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "out.h"
+#include "os_thread.h"
+#include "libpmempool.h"
+#include "pmempool.h"
+#include "pool.h"
+#include "check_util.h"
+#include "obj.h"
+#include "heap_layout.h"
+#include "vec.h"
+
+enum question {
+	Q_OBJ_DSC_CHECKSUM,
+	Q_OBJ_ULOG_RESET,
+	Q_OBJ_CHUNK_HEADERS,
+};
+
+#define OBJ_MSG_SIZE 128
+
+/* run data header which has to be rewritten */
+struct chunk_fix {
+	uint32_t zone_id;
+	uint32_t chunk_id;
+	struct chunk_header hdr;
+};
+
+VEC(chunk_fix_vec, struct chunk_fix);
+
+/* ulog which metadata has to be reset */
+struct ulog_fix {
+	uint64_t offset;
+	uint64_t capacity;
+};
+
+VEC(ulog_fix_vec, struct ulog_fix);
+
+/* result of checking a single zone */
+struct zone_result {
+	char msg[OBJ_MSG_SIZE]; /* the first error found, empty if none */
+	uint64_t nobjects;
+	uint64_t nfooters; /* number of stale huge chunk footers */
+	struct chunk_fix_vec fixes;
+};
+
+struct check_obj {
+	char *base;
+	uint64_t size;
+	uint64_t lanes_offset;
+	uint64_t nlanes;
+	uint64_t heap_offset;
+	uint64_t heap_size;
+
+	struct ulog_fix_vec ulog_fixes;
+	struct chunk_fix_vec chunk_fixes;
+
+	/* zones checked by the worker threads */
+	struct heap_layout *layout;
+	unsigned nzones;
+	unsigned next_zone;
+	struct zone_result *zones;
+};
+
+/*
+ * obj_dsc -- (internal) returns pointer to the pmemobj pool descriptor
+ */
+static inline struct pmemobjpool *
+obj_dsc(struct check_obj *obj)
+{
+	return (struct pmemobjpool *)obj->base;
+}
+
+/*
+ * obj_cleanup -- (internal) release the resources of the pmemobj check
+ */
+static int
+obj_cleanup(PMEMpoolcheck *ppc, location *loc)
+{
+	LOG(3, NULL);
+
+	struct check_obj *obj = loc->obj;
+	if (obj == NULL)
+		return 0;
+
+	VEC_DELETE(&obj->ulog_fixes);
+	VEC_DELETE(&obj->chunk_fixes);
+	free(obj);
+	loc->obj = NULL;
+
+	return 0;
+}
+
+/*
+ * obj_dsc_check -- (internal) check pmemobj descriptor
+ */
+static int
+obj_dsc_check(PMEMpoolcheck *ppc, location *loc)
+{
+	LOG(3, NULL);
+
+	CHECK_INFO(ppc, "checking pmemobj descriptor");
+
+	struct check_obj *obj = calloc(1, sizeof(*obj));
+	if (obj == NULL) {
+		ERR("!calloc");
+		ppc->result = CHECK_RESULT_ERROR;
+		return CHECK_ERR(ppc, "cannot allocate memory for pmemobj "
+			"check");
+	}
+
+	VEC_INIT(&obj->ulog_fixes);
+	VEC_INIT(&obj->chunk_fixes);
+	loc->obj = obj;
+
+	obj->base = pool_set_file_map(ppc->pool->set_file, 0);
+	obj->size = ppc->pool->set_file->size;
+	if (obj->base == NULL || obj->size < sizeof(struct pmemobjpool)) {
+		CHECK_ERR(ppc, "cannot read pmemobj descriptor");
+		ppc->result = CHECK_RESULT_ERROR;
+		goto error;
+	}
+
+	struct pmemobjpool *pop = obj_dsc(obj);
+	obj->lanes_offset = pop->lanes_offset;
+	obj->nlanes = pop->nlanes;
+	obj->heap_offset = pop->heap_offset;
+
+	uint64_t lanes_end = obj->lanes_offset +
+		obj->nlanes * sizeof(struct lane_layout);
+
+	if (obj->lanes_offset < sizeof(struct pmemobjpool) ||
+			obj->nlanes == 0 || obj->nlanes > obj->size ||
+			lanes_end > obj->heap_offset) {
+		CHECK_ERR(ppc, "invalid pmemobj lanes: offset 0x%" PRIx64
+			", number %" PRIu64, obj->lanes_offset, obj->nlanes);
+		goto error_not_consistent;
+	}
+
+	if (obj->heap_offset % Pagesize ||
+			obj->heap_offset >= obj->size ||
+			obj->size - obj->heap_offset < HEAP_MIN_SIZE) {
+		CHECK_ERR(ppc, "invalid pmemobj heap offset: 0x%" PRIx64,
+			obj->heap_offset);
+		goto error_not_consistent;
+	}
+
+	obj->heap_size = obj->size - obj->heap_offset;
+
+	void *dscp = obj->base + sizeof(struct pool_hdr);
+	if (!util_checksum(dscp, OBJ_DSC_P_SIZE, &pop->checksum, 0, 0)) {
+		if (CHECK_ASK(ppc, Q_OBJ_DSC_CHECKSUM,
+				"invalid pmemobj descriptor checksum.|Do you "
+				"want to regenerate checksum?"))
+			goto error_not_consistent;
+	}
+
+	if (ppc->result == CHECK_RESULT_CONSISTENT ||
+		ppc->result == CHECK_RESULT_REPAIRED)
+		CHECK_INFO(ppc, "pmemobj descriptor correct");
+
+	return check_questions_sequence_validate(ppc);
+
+error_not_consistent:
+	ppc->result = CHECK_RESULT_NOT_CONSISTENT;
+	check_end(ppc->data);
+error:
+	obj_cleanup(ppc, loc);
+	return -1;
+}
+
+/*
+ * obj_dsc_fix -- (internal) fix pmemobj descriptor
+ */
+static int
+obj_dsc_fix(PMEMpoolcheck *ppc, location *loc, uint32_t question, void *ctx)
+{
+	LOG(3, NULL);
+
+	struct check_obj *obj = loc->obj;
+	struct pmemobjpool *pop = obj_dsc(obj);
+	uint8_t dsc[OBJ_DSC_P_SIZE];
+	uint64_t *csump;
+
+	switch (question) {
+	case Q_OBJ_DSC_CHECKSUM:
+		memcpy(dsc, obj->base + sizeof(struct pool_hdr), sizeof(dsc));
+		csump = (uint64_t *)(dsc + offsetof(struct pmemobjpool,
+			checksum) - sizeof(struct pool_hdr));
+		util_checksum(dsc, sizeof(dsc), csump, 1, 0);
+
+		CHECK_INFO(ppc, "setting pmemobj.checksum to 0x%jx", *csump);
+		if (pool_write(ppc->pool, csump, sizeof(*csump),
+				offsetof(struct pmemobjpool, checksum))) {
+			ppc->result = CHECK_RESULT_ERROR;
+			return CHECK_ERR(ppc, "writing pmemobj descriptor "
+				"failed");
+		}
+		ASSERTeq(pop->checksum, *csump);
+		break;
+	default:
+		ERR("not implemented question id: %u", question);
+	}
+
+	return 0;
+}
+
+/*
+ * obj_off_is_valid -- (internal) check whether the offset points to the pool
+ */
+static inline int
+obj_off_is_valid(struct check_obj *obj, uint64_t off, size_t size)
+{
+	return off < obj->size && size <= obj->size - off;
+}
+
+/*
+ * obj_ulog_entry_size -- (internal) returns the size of a ulog entry or 0 if
+ *                        its type is unknown
+ */
+static size_t
+obj_ulog_entry_size(const struct ulog_entry_base *e)
+{
+	const struct ulog_entry_buf *eb;
+
+	switch (ULOG_OPERATION_FROM_OFFSET(e->offset)) {
+	case ULOG_OPERATION_AND:
+	case ULOG_OPERATION_OR:
+	case ULOG_OPERATION_SET:
+		return sizeof(struct ulog_entry_val);
+	case ULOG_OPERATION_BUF_SET:
+	case ULOG_OPERATION_BUF_CPY:
+		eb = (const struct ulog_entry_buf *)e;
+		return ALIGN_UP(sizeof(struct ulog_entry_buf) + eb->size,
+			CACHELINE_SIZE);
+	default:
+		return 0;
+	}
+}
+
+/*
+ * obj_ulog_check -- (internal) check metadata and entries of the first ulog
+ *                   of a lane
+ *
+ * Returns NULL if the ulog is valid or a description of the problem.
+ */
+static const char *
+obj_ulog_check(struct check_obj *obj, struct ulog *ulog, size_t capacity,
+	int redo, int *pending)
+{
+	*pending = 0;
+
+	/* ulog_store shrinks the capacity of a redo log to what it stored */
+	if (ulog->capacity > capacity || ulog->capacity % CACHELINE_SIZE)
+		return "invalid capacity";
+
+	if (ulog->next != 0 && (ulog->next < obj->heap_offset ||
+			ulog->next % CACHELINE_SIZE ||
+			!obj_off_is_valid(obj, ulog->next,
+				sizeof(struct ulog))))
+		return "invalid next ulog offset";
+
+	/*
+	 * Walk the entries the same way recovery does -- every entry of
+	 * a known type has to fit in the ulog and point to the pool.
+	 */
+	size_t nbytes = 0;
+	while (nbytes < ulog->capacity) {
+		struct ulog_entry_base *e =
+			(struct ulog_entry_base *)(ulog->data + nbytes);
+		if (e->offset == 0)
+			break;
+
+		size_t esize = obj_ulog_entry_size(e);
+		if (esize == 0)
+			return "invalid entry type";
+
+		if (esize > ulog->capacity - nbytes)
+			break;
+
+		uint64_t type = ULOG_OPERATION_FROM_OFFSET(e->offset);
+		if (type == ULOG_OPERATION_BUF_SET ||
+				type == ULOG_OPERATION_BUF_CPY) {
+			struct ulog_entry_buf *eb =
+				(struct ulog_entry_buf *)e;
+			uint64_t csum = util_checksum_compute(eb, esize,
+				&eb->checksum, 0);
+			csum = util_checksum_seq(&ulog->gen_num,
+				sizeof(ulog->gen_num), csum);
+			/* a torn entry ends the log */
+			if (eb->checksum != csum)
+				break;
+		}
+
+		if (!obj_off_is_valid(obj, e->offset & ULOG_OFFSET_MASK, 1))
+			return "invalid entry offset";
+
+		nbytes += esize;
+	}
+
+	if (nbytes == 0)
+		return NULL;
+
+	/* a redo log with a valid checksum will be applied on open */
+	*pending = !redo || util_checksum(ulog, SIZEOF_ULOG(nbytes),
+			&ulog->checksum, 0, 0);
+
+	return NULL;
+}
+
+/*
+ * obj_lanes_check -- (internal) check ulogs of all lanes
+ */
+static int
+obj_lanes_check(PMEMpoolcheck *ppc, location *loc)
+{
+	LOG(3, NULL);
+
+	CHECK_INFO(ppc, "checking pmemobj lanes");
+
+	struct check_obj *obj = loc->obj;
+	struct {
+		const char *name;
+		size_t offset;
+		size_t capacity;
+		int redo;
+	} ulogs[] = {
+		{"internal redo log", offsetof(struct lane_layout, internal),
+			LANE_REDO_INTERNAL_SIZE, 1},
+		{"external redo log", offsetof(struct lane_layout, external),
+			LANE_REDO_EXTERNAL_SIZE, 1},
+		{"undo log", offsetof(struct lane_layout, undo),
+			LANE_UNDO_SIZE, 0},
+	};
+
+	uint64_t npending = 0;
+	for (uint64_t l = 0; l < obj->nlanes; l++) {
+		uint64_t lane_off = obj->lanes_offset +
+			l * sizeof(struct lane_layout);
+
+		for (unsigned u = 0; u < ARRAY_SIZE(ulogs); u++) {
+			uint64_t off = lane_off + ulogs[u].offset;
+			struct ulog *ulog = (struct ulog *)(obj->base + off);
+			int pending;
+
+			const char *msg = obj_ulog_check(obj, ulog,
+				ulogs[u].capacity, ulogs[u].redo, &pending);
+			if (msg != NULL) {
+				CHECK_INFO(ppc, "lane %" PRIu64 ": %s: %s", l,
+					ulogs[u].name, msg);
+				struct ulog_fix fix = {off, ulogs[u].capacity};
+				if (VEC_PUSH_BACK(&obj->ulog_fixes, fix)) {
+					ppc->result = CHECK_RESULT_ERROR;
+					CHECK_ERR(ppc, "cannot allocate memory "
+						"for invalid ulogs list");
+					goto error;
+				}
+			} else if (pending) {
+				npending++;
+			}
+		}
+	}
+
+	if (npending)
+		CHECK_INFO(ppc, "number of ulogs to be recovered on the next "
+			"open: %" PRIu64, npending);
+
+	size_t ninval = VEC_SIZE(&obj->ulog_fixes);
+	if (ninval == 0) {
+		CHECK_INFO(ppc, "pmemobj lanes correct");
+		return 0;
+	}
+
+	if (CHECK_IS(ppc, REPAIR) && CHECK_IS_NOT(ppc, ADVANCED)) {
+		ppc->result = CHECK_RESULT_CANNOT_REPAIR;
+		CHECK_INFO(ppc, REQUIRE_ADVANCED);
+		CHECK_ERR(ppc, "number of invalid ulogs: %zu", ninval);
+		check_end(ppc->data);
+		goto error;
+	}
+
+	if (CHECK_ASK(ppc, Q_OBJ_ULOG_RESET, "number of invalid ulogs: %zu.|"
+			"Do you want to reset them, discarding their "
+			"contents?", ninval)) {
+		ppc->result = CHECK_RESULT_NOT_CONSISTENT;
+		check_end(ppc->data);
+		goto error;
+	}
+
+	return check_questions_sequence_validate(ppc);
+
+error:
+	obj_cleanup(ppc, loc);
+	return -1;
+}
+
+/*
+ * obj_lanes_fix -- (internal) reset invalid ulogs
+ */
+static int
+obj_lanes_fix(PMEMpoolcheck *ppc, location *loc, uint32_t question, void *ctx)
+{
+	LOG(3, NULL);
+
+	struct check_obj *obj = loc->obj;
+	struct ulog_fix *fix;
+
+	switch (question) {
+	case Q_OBJ_ULOG_RESET:
+		VEC_FOREACH_BY_PTR(fix, &obj->ulog_fixes) {
+			struct ulog *ulog =
+				(struct ulog *)(obj->base + fix->offset);
+
+			/* keep the generation number of the entries */
+			struct ulog hdr;
+			memset(&hdr, 0, sizeof(hdr));
+			hdr.capacity = fix->capacity;
+			hdr.gen_num = ulog->gen_num;
+
+			uint64_t zero = 0;
+			if (pool_write(ppc->pool, &zero, sizeof(zero),
+					fix->offset + sizeof(hdr)) ||
+				pool_write(ppc->pool, &hdr, sizeof(hdr),
+					fix->offset)) {
+				ppc->result = CHECK_RESULT_ERROR;
+				return CHECK_ERR(ppc, "writing ulog at offset "
+					"0x%" PRIx64 " failed", fix->offset);
+			}
+
+			CHECK_INFO(ppc, "resetting ulog at offset 0x%" PRIx64,
+				fix->offset);
+		}
+		VEC_CLEAR(&obj->ulog_fixes);
+		break;
+	default:
+		ERR("not implemented question id: %u", question);
+	}
+
+	return 0;
+}
+
+/*
+ * obj_max_zone -- (internal) returns the number of zones in the heap
+ */
+static unsigned
+obj_max_zone(size_t size)
+{
+	unsigned max_zone = 0;
+	size -= sizeof(struct heap_header);
+
+	while (size >= ZONE_MIN_SIZE) {
+		max_zone++;
+		size -= size <= ZONE_MAX_SIZE ? size : ZONE_MAX_SIZE;
+	}
+
+	return max_zone;
+}
+
+/*
+ * obj_zone_size_idx -- (internal) returns the maximum size index of the zone
+ */
+static uint32_t
+obj_zone_size_idx(uint32_t zone_id, unsigned max_zone, size_t heap_size)
+{
+	if (zone_id < max_zone - 1)
+		return MAX_CHUNK;
+
+	size_t zone_raw_size = heap_size - zone_id * ZONE_MAX_SIZE;
+	zone_raw_size -= sizeof(struct zone_header) +
+		sizeof(struct chunk_header) * MAX_CHUNK;
+
+	return (uint32_t)(zone_raw_size / CHUNKSIZE);
+}
+
+/*
+ * obj_run_bitmap -- (internal) calculates the number of bits and the size of
+ *                   the run bitmap, see memblock_run_bitmap()
+ */
+static void
+obj_run_bitmap(uint32_t size_idx, uint16_t flags, uint64_t unit_size,
+	uint64_t alignment, unsigned *nbits, size_t *size)
+{
+	if (flags & CHUNK_FLAG_FLEX_BITMAP) {
+		size_t content_size = RUN_CONTENT_SIZE_BYTES(size_idx);
+		unsigned n = (unsigned)(content_size / unit_size);
+		unsigned nvalues = util_div_ceil(n, RUN_BITS_PER_VALUE);
+
+		nvalues = ALIGN_UP(nvalues + RUN_BASE_METADATA_VALUES,
+			(unsigned)(CACHELINE_SIZE / sizeof(uint64_t)))
+			- RUN_BASE_METADATA_VALUES;
+
+		*size = nvalues * sizeof(uint64_t);
+		*nbits = (unsigned)((content_size - *size) / unit_size)
+			- (alignment ? 1U : 0U);
+		return;
+	}
+
+	uint64_t nallocs = RUN_DEFAULT_SIZE_BYTES(size_idx) / unit_size;
+	if (nallocs > RUN_DEFAULT_BITMAP_NBITS)
+		nallocs = RUN_DEFAULT_BITMAP_NBITS;
+
+	*size = RUN_DEFAULT_BITMAP_SIZE;
+	*nbits = (unsigned)nallocs - (alignment ? 1U : 0U);
+}
+
+/*
+ * obj_alloc_size -- (internal) returns the size stored in the allocation
+ *                   header
+ */
+static uint64_t
+obj_alloc_size(const void *hdr, enum header_type type)
+{
+	switch (type) {
+	case HEADER_LEGACY:
+		return ((const struct allocation_header_legacy *)hdr)->size;
+	case HEADER_COMPACT:
+		return ((const struct allocation_header_compact *)hdr)->size &
+			ALLOC_HDR_FLAGS_MASK;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * obj_chunk_header_type -- (internal) returns the type of the allocation
+ *                          headers in the chunk
+ */
+static enum header_type
+obj_chunk_header_type(const struct chunk_header *hdr)
+{
+	if (hdr->flags & CHUNK_FLAG_COMPACT_HEADER)
+		return HEADER_COMPACT;
+	if (hdr->flags & CHUNK_FLAG_HEADER_NONE)
+		return HEADER_NONE;
+	return HEADER_LEGACY;
+}
+
+/*
+ * zone_err -- (internal) record the problem found in the zone
+ */
+static int FORMAT_PRINTF(2, 3)
+zone_err(struct zone_result *res, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	int ret = vsnprintf(res->msg, OBJ_MSG_SIZE, fmt, ap);
+	va_end(ap);
+
+	/* make sure the zone is reported even if the message is lost */
+	if (ret < 0 || res->msg[0] == '\0')
+		snprintf(res->msg, OBJ_MSG_SIZE, "invalid zone");
+
+	return -1;
+}
+
+/*
+ * obj_run_check -- (internal) check the run bitmap against the allocation
+ *                  headers of the objects in the run
+ */
+static int
+obj_run_check(struct zone_result *res, struct zone *z, uint32_t c)
+{
+	struct chunk_header *hdr = &z->chunk_headers[c];
+	struct chunk_run *run = (struct chunk_run *)&z->chunks[c];
+	uint64_t unit = run->hdr.block_size;
+
+	if (unit == 0 || unit > RUN_CONTENT_SIZE_BYTES(hdr->size_idx))
+		return zone_err(res, "chunk %u: invalid run block size %"
+			PRIu64, c, unit);
+
+	/* a larger alignment would overflow ALIGN_UP() below */
+	if ((hdr->flags & CHUNK_FLAG_ALIGNED) &&
+			(!util_is_pow2(run->hdr.alignment) ||
+			run->hdr.alignment >
+			RUN_CONTENT_SIZE_BYTES(hdr->size_idx)))
+		return zone_err(res, "chunk %u: invalid run alignment %"
+			PRIu64, c, run->hdr.alignment);
+
+	unsigned nbits;
+	size_t bsize;
+	obj_run_bitmap(hdr->size_idx, hdr->flags, unit, run->hdr.alignment,
+		&nbits, &bsize);
+
+	enum header_type htype = obj_chunk_header_type(hdr);
+	size_t hsize = header_type_to_size[htype];
+	uintptr_t data = (uintptr_t)run->content + bsize;
+	if (hdr->flags & CHUNK_FLAG_ALIGNED)
+		data = ALIGN_UP(data + hsize, run->hdr.alignment) - hsize;
+
+	uintptr_t run_end = (uintptr_t)run +
+		(uintptr_t)hdr->size_idx * CHUNKSIZE;
+	/* compare the sizes with the space left, the sums could overflow */
+	if (nbits == 0 || data > run_end || nbits > (run_end - data) / unit)
+		return zone_err(res, "chunk %u: invalid run bitmap", c);
+
+	const uint64_t *values = (const uint64_t *)run->content;
+
+	for (unsigned bit = 0; bit < nbits; ) {
+		uint64_t v = values[bit / RUN_BITS_PER_VALUE];
+		unsigned shift = bit % RUN_BITS_PER_VALUE;
+
+		if (shift == 0 && v == 0) {
+			bit += RUN_BITS_PER_VALUE;
+			continue;
+		}
+
+		if (!(v & (1ULL << shift))) {
+			bit++;
+			continue;
+		}
+
+		uint64_t units = 1;
+		if (htype != HEADER_NONE) {
+			uint64_t size = obj_alloc_size(
+				(void *)(data + bit * unit), htype);
+			if (size <= hsize)
+				return zone_err(res, "chunk %u: block %u: "
+					"invalid allocation header size %"
+					PRIu64, c, bit, size);
+
+			if (size > (uint64_t)(nbits - bit) * unit)
+				return zone_err(res, "chunk %u: block %u: "
+					"object exceeds the run", c, bit);
+
+			units = (size + unit - 1) / unit;
+		}
+
+		for (uint64_t u = 1; u < units; u++) {
+			unsigned b = bit + (unsigned)u;
+			uint64_t bv = values[b / RUN_BITS_PER_VALUE];
+			if (!(bv & (1ULL << (b % RUN_BITS_PER_VALUE))))
+				return zone_err(res, "chunk %u: block %u: "
+					"run bitmap does not match allocation "
+					"header", c, bit);
+		}
+
+		res->nobjects++;
+		bit += (unsigned)units;
+	}
+
+	/* data chunks of the run point back to its first chunk */
+	for (uint32_t i = 1; i < hdr->size_idx; i++) {
+		struct chunk_header *d = &z->chunk_headers[c + i];
+		if (d->type == CHUNK_TYPE_RUN_DATA && d->size_idx == i)
+			continue;
+
+		struct chunk_fix fix = {0, c + i,
+			{CHUNK_TYPE_RUN_DATA, 0, i}};
+		if (VEC_PUSH_BACK(&res->fixes, fix))
+			return zone_err(res, "out of memory");
+	}
+
+	return 0;
+}
+
+/*
+ * obj_huge_check -- (internal) check the allocation header and the footer of
+ *                   a used huge chunk
+ *
+ * Footers are not persisted by libpmemobj but recreated on every heap boot,
+ * so a stale one is only counted.
+ */
+static int
+obj_huge_check(struct zone_result *res, struct zone *z, uint32_t c)
+{
+	struct chunk_header *hdr = &z->chunk_headers[c];
+	enum header_type htype = obj_chunk_header_type(hdr);
+
+	if (htype != HEADER_NONE) {
+		uint64_t size = obj_alloc_size(z->chunks[c].data, htype);
+		if (size <= header_type_to_size[htype] ||
+				size > (uint64_t)hdr->size_idx * CHUNKSIZE)
+			return zone_err(res, "chunk %u: invalid allocation "
+				"header size %" PRIu64, c, size);
+	}
+
+	res->nobjects++;
+
+	if (hdr->size_idx == 1)
+		return 0;
+
+	struct chunk_header *footer =
+		&z->chunk_headers[c + hdr->size_idx - 1];
+	if (footer->type != CHUNK_TYPE_FOOTER ||
+			footer->size_idx != hdr->size_idx)
+		res->nfooters++;
+
+	return 0;
+}
+
+/*
+ * obj_zone_check -- (internal) check zone and chunk headers of the zone
+ */
+static void
+obj_zone_check(struct check_obj *obj, uint32_t zone_id)
+{
+	struct zone_result *res = &obj->zones[zone_id];
+	struct zone *z = ZID_TO_ZONE(obj->layout, zone_id);
+
+	if (z->header.magic == 0)
+		return; /* not initialized, and that is OK */
+
+	if (z->header.magic != ZONE_HEADER_MAGIC) {
+		zone_err(res, "invalid zone magic 0x%x", z->header.magic);
+		return;
+	}
+
+	uint32_t size_idx = obj_zone_size_idx(zone_id, obj->nzones,
+		obj->heap_size);
+	if (z->header.size_idx == 0 || z->header.size_idx > size_idx) {
+		zone_err(res, "invalid zone size %u", z->header.size_idx);
+		return;
+	}
+
+	size_idx = z->header.size_idx;
+	for (uint32_t c = 0; c < size_idx; ) {
+		struct chunk_header *hdr = &z->chunk_headers[c];
+
+		if (hdr->type == CHUNK_TYPE_UNKNOWN ||
+				hdr->type == CHUNK_TYPE_FOOTER ||
+				hdr->type == CHUNK_TYPE_RUN_DATA ||
+				hdr->type >= MAX_CHUNK_TYPE) {
+			zone_err(res, "chunk %u: invalid type %u", c,
+				hdr->type);
+			return;
+		}
+
+		if (hdr->flags & ~CHUNK_FLAGS_ALL_VALID) {
+			zone_err(res, "chunk %u: invalid flags 0x%x", c,
+				hdr->flags);
+			return;
+		}
+
+		if (hdr->size_idx == 0 || hdr->size_idx > size_idx - c) {
+			zone_err(res, "chunk %u: invalid size %u", c,
+				hdr->size_idx);
+			return;
+		}
+
+		int ret = 0;
+		if (hdr->type == CHUNK_TYPE_RUN)
+			ret = obj_run_check(res, z, c);
+		else if (hdr->type == CHUNK_TYPE_USED)
+			ret = obj_huge_check(res, z, c);
+		if (ret)
+			return;
+
+		c += hdr->size_idx;
+	}
+
+	struct chunk_fix *fix;
+	VEC_FOREACH_BY_PTR(fix, &res->fixes)
+		fix->zone_id = zone_id;
+}
+
+/*
+ * obj_zone_worker -- (internal) check zones until none is left
+ */
+static void *
+obj_zone_worker(void *arg)
+{
+	struct check_obj *obj = arg;
+
+	uint32_t zone_id;
+	while ((zone_id = util_fetch_and_add32(&obj->next_zone, 1)) <
+			obj->nzones)
+		obj_zone_check(obj, zone_id);
+
+	return NULL;
+}
+
+/*
+ * obj_zones_check -- (internal) check all zones using a pool of threads
+ */
+static void
+obj_zones_check(struct check_obj *obj)
+{
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned nthreads = ncpus < 1 ? 1 : (unsigned)ncpus;
+	if (nthreads > obj->nzones)
+		nthreads = obj->nzones;
+
+	LOG(4, "nzones %u nthreads %u", obj->nzones, nthreads);
+
+	os_thread_t *threads = NULL;
+	if (nthreads > 1) {
+		threads = malloc(nthreads * sizeof(*threads));
+		if (threads == NULL) {
+			LOG(2, "!malloc");
+			nthreads = 1;
+		}
+	}
+
+	/* the calling thread is one of the workers */
+	unsigned created = 1;
+	for (; created < nthreads; created++) {
+		if (os_thread_create(&threads[created], NULL,
+				obj_zone_worker, obj) != 0) {
+			LOG(2, "!os_thread_create");
+			break;
+		}
+	}
+
+	obj_zone_worker(obj);
+
+	for (unsigned i = 1; i < created; i++)
+		os_thread_join(&threads[i], NULL);
+
+	free(threads);
+}
+
+/*
+ * obj_heap_check -- (internal) check pmemobj heap
+ */
+static int
+obj_heap_check(PMEMpoolcheck *ppc, location *loc)
+{
+	LOG(3, NULL);
+
+	CHECK_INFO(ppc, "checking pmemobj heap");
+
+	struct check_obj *obj = loc->obj;
+	obj->layout = (struct heap_layout *)(obj->base + obj->heap_offset);
+	struct heap_header *hdr = &obj->layout->header;
+
+	if (memcmp(hdr->signature, HEAP_SIGNATURE, HEAP_SIGNATURE_LEN) != 0) {
+		CHECK_ERR(ppc, "invalid heap signature");
+		goto error_not_consistent;
+	}
+
+	if (!util_checksum(hdr, sizeof(*hdr), &hdr->checksum, 0, 0)) {
+		CHECK_ERR(ppc, "invalid heap header checksum");
+		goto error_not_consistent;
+	}
+
+	if (hdr->major != HEAP_MAJOR || hdr->chunksize != CHUNKSIZE ||
+			hdr->chunks_per_zone != MAX_CHUNK) {
+		CHECK_ERR(ppc, "unsupported heap: major %" PRIu64 ", chunk "
+			"size %" PRIu64 ", chunks per zone %" PRIu64,
+			hdr->major, hdr->chunksize, hdr->chunks_per_zone);
+		goto error_not_consistent;
+	}
+
+	obj->nzones = obj_max_zone(obj->heap_size);
+	obj->zones = calloc(obj->nzones, sizeof(*obj->zones));
+	if (obj->zones == NULL) {
+		ERR("!calloc");
+		ppc->result = CHECK_RESULT_ERROR;
+		CHECK_ERR(ppc, "cannot allocate memory for heap zones");
+		goto error;
+	}
+
+	obj_zones_check(obj);
+
+	unsigned ninval = 0;
+	unsigned first_inval = 0;
+	uint64_t nobjects = 0;
+	uint64_t nfooters = 0;
+	int nomem = 0;
+
+	for (unsigned i = 0; i < obj->nzones; i++) {
+		struct zone_result *res = &obj->zones[i];
+		nobjects += res->nobjects;
+		nfooters += res->nfooters;
+
+		if (res->msg[0] != '\0') {
+			CHECK_INFO(ppc, "zone %u: %s", i, res->msg);
+			if (ninval++ == 0)
+				first_inval = i;
+		}
+
+		struct chunk_fix *fix;
+		VEC_FOREACH_BY_PTR(fix, &res->fixes) {
+			CHECK_INFO(ppc, "zone %u: chunk %u: invalid run "
+				"data header", i, fix->chunk_id);
+			if (VEC_PUSH_BACK(&obj->chunk_fixes, *fix))
+				nomem = 1;
+		}
+		VEC_DELETE(&res->fixes);
+	}
+
+	free(obj->zones);
+	obj->zones = NULL;
+
+	if (nomem) {
+		ppc->result = CHECK_RESULT_ERROR;
+		CHECK_ERR(ppc, "cannot allocate memory for invalid chunk "
+			"headers list");
+		goto error;
+	}
+
+	if (ninval) {
+		CHECK_ERR(ppc, "number of invalid heap zones: %u, the first "
+			"one: %u", ninval, first_inval);
+		goto error_not_consistent;
+	}
+
+	CHECK_INFO(ppc, "number of zones: %u, number of objects: %" PRIu64,
+		obj->nzones, nobjects);
+
+	if (nfooters)
+		CHECK_INFO(ppc, "number of huge chunk footers to be recreated "
+			"on the next open: %" PRIu64, nfooters);
+
+	size_t nfixes = VEC_SIZE(&obj->chunk_fixes);
+	if (nfixes == 0) {
+		CHECK_INFO(ppc, "pmemobj heap correct");
+		return 0;
+	}
+
+	if (CHECK_ASK(ppc, Q_OBJ_CHUNK_HEADERS, "number of invalid run data "
+			"headers: %zu.|Do you want to recreate them?", nfixes))
+		goto error_not_consistent;
+
+	return check_questions_sequence_validate(ppc);
+
+error_not_consistent:
+	ppc->result = CHECK_RESULT_NOT_CONSISTENT;
+	check_end(ppc->data);
+error:
+	obj_cleanup(ppc, loc);
+	return -1;
+}
+
+/*
+ * obj_heap_fix -- (internal) recreate invalid run data headers
+ */
+static int
+obj_heap_fix(PMEMpoolcheck *ppc, location *loc, uint32_t question, void *ctx)
+{
+	LOG(3, NULL);
+
+	struct check_obj *obj = loc->obj;
+	struct chunk_fix *fix;
+
+	switch (question) {
+	case Q_OBJ_CHUNK_HEADERS:
+		VEC_FOREACH_BY_PTR(fix, &obj->chunk_fixes) {
+			struct chunk_header *hdr = GET_CHUNK_HDR(obj->layout,
+				fix->zone_id, fix->chunk_id);
+			uint64_t off = (uint64_t)((char *)hdr - obj->base);
+
+			if (pool_write(ppc->pool, &fix->hdr, sizeof(fix->hdr),
+					off)) {
+				ppc->result = CHECK_RESULT_ERROR;
+				return CHECK_ERR(ppc, "writing chunk header "
+					"at offset 0x%" PRIx64 " failed", off);
+			}
+		}
+		CHECK_INFO(ppc, "recreated %zu run data headers",
+			VEC_SIZE(&obj->chunk_fixes));
+		VEC_CLEAR(&obj->chunk_fixes);
+		break;
+	default:
+		ERR("not implemented question id: %u", question);
+	}
+
+	return 0;
+}
+
+struct step {
+	int (*check)(PMEMpoolcheck *, location *);
+	int (*fix)(PMEMpoolcheck *, location *, uint32_t, void *);
+};
+
+static const struct step steps[] = {
+	{
+		.check	= obj_dsc_check,
+	},
+	{
+		.fix	= obj_dsc_fix,
+	},
+	{
+		.check	= obj_lanes_check,
+	},
+	{
+		.fix	= obj_lanes_fix,
+	},
+	{
+		.check	= obj_heap_check,
+	},
+	{
+		.fix	= obj_heap_fix,
+	},
+	{
+		.check	= obj_cleanup,
+	},
+	{
+		.check	= NULL,
+		.fix	= NULL,
+	},
+};
+
+/*
+ * step_exe -- (internal) perform single step according to its parameters
+ */
+static inline int
+step_exe(PMEMpoolcheck *ppc, location *loc)
+{
+	ASSERT(loc->step < ARRAY_SIZE(steps));
+	ASSERTeq(ppc->pool->params.type, POOL_TYPE_OBJ);
+
+	const struct step *step = &steps[loc->step++];
+
+	if (!step->fix)
+		return step->check(ppc, loc);
+
+	if (!check_answer_loop(ppc, loc, NULL, 1, step->fix))
+		return 0;
+
+	obj_cleanup(ppc, loc);
+	return -1;
+}
+
+/*
+ * check_obj -- entry point for pmemobj checks
+ */
+void
+check_obj(PMEMpoolcheck *ppc)
+{
+	LOG(3, NULL);
+
+	location *loc = check_get_step_data(ppc->data);
+
+	/* do all checks */
+	while (CHECK_NOT_COMPLETE(loc, steps)) {
+		if (step_exe(ppc, loc))
+			break;
+	}
+}
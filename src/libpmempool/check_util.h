@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2018, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -57,6 +57,7 @@ extern "C" {
 /* check control context */
 struct check_data;
 struct arena;
+struct check_obj;
 
 /* queue of check statuses */
 struct check_status;
@@ -131,6 +132,9 @@ typedef struct {
 		struct btt_info btti;
 		uint64_t btti_offset;
 	} pool_valid;
+
+	/* state of pmemobj descriptor, lanes and heap check */
+	struct check_obj *obj;
 } location;
 
 /* check steps */
@@ -143,6 +147,7 @@ void check_log(PMEMpoolcheck *ppc);
 void check_blk(PMEMpoolcheck *ppc);
 void check_btt_info(PMEMpoolcheck *ppc);
 void check_btt_map_flog(PMEMpoolcheck *ppc);
+void check_obj(PMEMpoolcheck *ppc);
 void check_write(PMEMpoolcheck *ppc);
 
 struct check_data *check_data_alloc(void);
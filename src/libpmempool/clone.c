@@ -0,0 +1,829 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * clone.c -- implementation of pmempool_clone() function
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+
+#include "libpmempool.h"
+#include "pool.h"
+#include "out.h"
+#include "os.h"
+#include "os_thread.h"
+#include "file.h"
+#include "set.h"
+#include "shutdown_state.h"
+#include "util.h"
+#include "util_pmem.h"
+
+#define PMEMPOOL_CLONE_ALL_FLAGS (PMEMPOOL_CLONE_NO_REFLINK)
+
+/*
+ * The parts which cannot be reflinked are copied by a pool of threads, each
+ * of which claims CLONE_CHUNK_SIZE chunks of the parts until all of them are
+ * copied. Holes of the source files are skipped, so the clone is as sparse
+ * as the source. When copy_file_range(2) is not supported and the data is
+ * copied through a buffer, the all-zero CLONE_BUF_SIZE blocks are skipped
+ * as well.
+ */
+#define CLONE_CHUNK_SIZE ((size_t)16 << 20) /* 16 MiB */
+#define CLONE_BUF_SIZE ((size_t)1 << 20) /* 1 MiB */
+#define CLONE_MAX_THREADS 64
+
+struct clone_part {
+	char *path;		/* path of the clone part */
+	int sfd;
+	int dfd;
+	size_t size;
+	uint64_t first;		/* index of the first chunk of the part */
+	int reflinked;
+};
+
+struct clone_copy {
+	struct clone_part *parts;
+	unsigned nparts;
+	uint64_t nchunks;
+
+	uint64_t next;		/* index of the first not claimed chunk */
+	unsigned copy_range;	/* copy_file_range(2) may be used */
+	unsigned error;		/* set by the first thread which failed */
+};
+
+/*
+ * clone_reflink -- (internal) makes the destination file share all extents
+ *                  of the source file
+ */
+static int
+clone_reflink(int sfd, int dfd)
+{
+#ifdef FICLONE
+	return ioctl(dfd, FICLONE, sfd);
+#else
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+/*
+ * clone_copy_file_range -- (internal) copies the range of the source file
+ *                          in the kernel, returns 1 if it is not supported
+ */
+static int
+clone_copy_file_range(struct clone_copy *cc, struct clone_part *cp,
+	uint64_t off, size_t len)
+{
+#ifdef SYS_copy_file_range
+	while (len > 0) {
+		loff_t soff = (loff_t)off;
+		loff_t doff = (loff_t)off;
+		ssize_t n = syscall(SYS_copy_file_range, cp->sfd, &soff,
+				cp->dfd, &doff, len, 0);
+		if (n > 0) {
+			off += (uint64_t)n;
+			len -= (size_t)n;
+			continue;
+		}
+
+		if (n < 0 && errno != ENOSYS && errno != EXDEV &&
+				errno != EINVAL && errno != EOPNOTSUPP) {
+			ERR("!copy_file_range %s", cp->path);
+			return -1;
+		}
+
+		/* fall back to read()/write() for this and all other ranges */
+		LOG(3, "copy_file_range not supported");
+		util_atomic_store_explicit32(&cc->copy_range, 0,
+			memory_order_relaxed);
+		return 1;
+	}
+
+	return 0;
+#else
+	util_atomic_store_explicit32(&cc->copy_range, 0, memory_order_relaxed);
+	return 1;
+#endif
+}
+
+/*
+ * clone_copy_range -- (internal) copies the range of the source file which
+ *                     contains data
+ */
+static int
+clone_copy_range(struct clone_copy *cc, struct clone_part *cp,
+	uint64_t off, size_t len, char *buf)
+{
+	unsigned copy_range;
+	util_atomic_load_explicit32(&cc->copy_range, &copy_range,
+		memory_order_relaxed);
+	if (copy_range) {
+		int ret = clone_copy_file_range(cc, cp, off, len);
+		if (ret <= 0)
+			return ret;
+	}
+
+	while (len > 0) {
+		size_t n = len < CLONE_BUF_SIZE ? len : CLONE_BUF_SIZE;
+		ssize_t nread = pread(cp->sfd, buf, n, (os_off_t)off);
+		if (nread <= 0) {
+			if (nread == 0)
+				errno = EIO;
+			ERR("!pread %s", cp->path);
+			return -1;
+		}
+
+		n = (size_t)nread;
+
+		/* the destination is truncated, so it reads as zeros */
+		if (!util_is_zeroed(buf, n) &&
+				pwrite(cp->dfd, buf, n, (os_off_t)off) !=
+				(ssize_t)n) {
+			ERR("!pwrite %s", cp->path);
+			return -1;
+		}
+
+		off += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * clone_copy_chunk -- (internal) copies all data extents of the chunk
+ */
+static int
+clone_copy_chunk(struct clone_copy *cc, struct clone_part *cp,
+	uint64_t off, size_t len, char *buf)
+{
+	uint64_t end = off + len;
+
+	while (off < end) {
+		uint64_t data = off;
+		uint64_t hole = end;
+#ifdef SEEK_DATA
+		os_off_t ret = os_lseek(cp->sfd, (os_off_t)off, SEEK_DATA);
+		if (ret < 0 && errno == ENXIO)
+			break; /* there is no more data in the file */
+
+		/* if holes cannot be found the whole chunk is copied */
+		if (ret >= 0) {
+			data = (uint64_t)ret;
+			if (data >= end)
+				break;
+
+			ret = os_lseek(cp->sfd, (os_off_t)data, SEEK_HOLE);
+			if (ret >= 0 && (uint64_t)ret < end)
+				hole = (uint64_t)ret;
+		}
+#endif
+		if (clone_copy_range(cc, cp, data, (size_t)(hole - data), buf))
+			return -1;
+
+		off = hole;
+	}
+
+	return 0;
+}
+
+/*
+ * clone_copy_worker -- (internal) copies the chunks of the parts until none
+ *                      is left
+ */
+static void *
+clone_copy_worker(void *arg)
+{
+	struct clone_copy *cc = arg;
+
+	char *buf = Malloc(CLONE_BUF_SIZE);
+	if (buf == NULL) {
+		ERR("!Malloc");
+		util_atomic_store_explicit32(&cc->error, 1,
+			memory_order_relaxed);
+		return NULL;
+	}
+
+	while (1) {
+		unsigned error;
+		util_atomic_load_explicit32(&cc->error, &error,
+			memory_order_relaxed);
+		if (error)
+			break;
+
+		uint64_t idx = util_fetch_and_add64(&cc->next, 1);
+		if (idx >= cc->nchunks)
+			break;
+
+		/* the part of the chunk is the last one which starts before */
+		unsigned p = 0;
+		while (p + 1 < cc->nparts && cc->parts[p + 1].first <= idx)
+			p++;
+
+		struct clone_part *cp = &cc->parts[p];
+		uint64_t off = (idx - cp->first) * CLONE_CHUNK_SIZE;
+		size_t len = cp->size - off;
+		if (len > CLONE_CHUNK_SIZE)
+			len = CLONE_CHUNK_SIZE;
+
+		if (clone_copy_chunk(cc, cp, off, len, buf)) {
+			util_atomic_store_explicit32(&cc->error, 1,
+				memory_order_relaxed);
+			break;
+		}
+	}
+
+	Free(buf);
+
+	return NULL;
+}
+
+/*
+ * clone_copy_nthreads -- (internal) returns the number of threads to copy
+ *                        nchunks chunks with
+ */
+static unsigned
+clone_copy_nthreads(uint64_t nchunks)
+{
+#ifdef _WIN32
+	/* pread() and pwrite() move the shared file offset on Windows */
+	return 1;
+#else
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus < 1)
+		ncpus = 1;
+
+	uint64_t nthreads = nchunks;
+	if (nthreads > (uint64_t)ncpus)
+		nthreads = (uint64_t)ncpus;
+	if (nthreads > CLONE_MAX_THREADS)
+		nthreads = CLONE_MAX_THREADS;
+
+	return nthreads == 0 ? 1 : (unsigned)nthreads;
+#endif
+}
+
+/*
+ * clone_copy_parts -- (internal) copies the parts which were not reflinked
+ *                     using a pool of threads
+ */
+static int
+clone_copy_parts(struct clone_part *parts, unsigned nparts)
+{
+	struct clone_copy cc;
+	memset(&cc, 0, sizeof(cc));
+	cc.parts = parts;
+	cc.nparts = nparts;
+	cc.copy_range = 1;
+
+	/* the reflinked parts do not have any chunks */
+	for (unsigned p = 0; p < nparts; p++) {
+		parts[p].first = cc.nchunks;
+		if (parts[p].reflinked)
+			continue;
+
+		if (os_ftruncate(parts[p].dfd, (os_off_t)parts[p].size)) {
+			ERR("!ftruncate %s", parts[p].path);
+			return -1;
+		}
+
+		cc.nchunks += (parts[p].size + CLONE_CHUNK_SIZE - 1) /
+				CLONE_CHUNK_SIZE;
+	}
+
+	if (cc.nchunks == 0)
+		return 0;
+
+	unsigned nthreads = clone_copy_nthreads(cc.nchunks);
+	LOG(4, "nparts %u nchunks %" PRIu64 " nthreads %u", cc.nparts,
+		cc.nchunks, nthreads);
+
+	os_thread_t *threads = NULL;
+	if (nthreads > 1) {
+		threads = Malloc(nthreads * sizeof(*threads));
+		if (threads == NULL) {
+			LOG(2, "!Malloc");
+			nthreads = 1;
+		}
+	}
+
+	/* the calling thread is one of the workers */
+	unsigned created = 1;
+	for (; created < nthreads; created++) {
+		if (os_thread_create(&threads[created], NULL,
+				clone_copy_worker, &cc) != 0) {
+			LOG(2, "!os_thread_create");
+			break;
+		}
+	}
+
+	clone_copy_worker(&cc);
+
+	for (unsigned i = 1; i < created; i++)
+		os_thread_join(&threads[i], NULL);
+
+	Free(threads);
+
+	return cc.error ? -1 : 0;
+}
+
+/*
+ * clone_btt_update -- (internal) sets the new parent UUID in all BTT Info
+ *                     blocks of the blk pool
+ */
+static void
+clone_btt_update(struct pool_replica *rep, const uuid_t uuid)
+{
+	uint64_t dataoff = roundup(sizeof(struct pmemblk),
+			BLK_FORMAT_DATA_ALIGN);
+	if (rep->repsize <= dataoff)
+		return;
+
+	char *data = (char *)rep->part[0].addr + dataoff;
+	size_t datasize = rep->repsize - dataoff;
+	uint64_t off = 0;
+
+	/* the BTT layout is written on the first write to the pool */
+	while (off + sizeof(struct btt_info) <= datasize) {
+		struct btt_info *infop = (struct btt_info *)(data + off);
+		if (!pool_btt_info_valid(infop))
+			break;
+
+		uint64_t infooff = off + le64toh(infop->infooff);
+		uint64_t nextoff = le64toh(infop->nextoff);
+
+		memcpy(infop->parent_uuid, uuid, BTTINFO_UUID_LEN);
+		util_checksum(infop, sizeof(*infop), &infop->checksum, 1, 0);
+		util_persist_auto(rep->is_pmem, infop, sizeof(*infop));
+
+		/* the backup BTT Info is the copy of the primary one */
+		if (infooff + sizeof(struct btt_info) <= datasize) {
+			struct btt_info *backup =
+				(struct btt_info *)(data + infooff);
+			memcpy(backup, infop, sizeof(*backup));
+			util_persist_auto(rep->is_pmem, backup,
+					sizeof(*backup));
+		}
+
+		if (nextoff == 0)
+			break;
+
+		off += nextoff;
+	}
+}
+
+/*
+ * clone_update_headers -- (internal) gives the clone its own part UUIDs and,
+ *                         unless the pool is a pmemobj pool, its own pool set
+ *                         UUID
+ *
+ * The pool set UUID of a pmemobj pool is kept, because the persistent object
+ * identifiers stored in the pool are derived from it.
+ */
+static int
+clone_update_headers(struct pool_set *set, struct pool_hdr *src_hdr)
+{
+	LOG(3, "set %p src_hdr %p", set, src_hdr);
+
+	struct pool_replica *rep = REP(set, 0);
+	enum pool_type type = pool_hdr_get_type(src_hdr);
+
+	if (type == POOL_TYPE_OBJ) {
+		memcpy(set->uuid, src_hdr->poolset_uuid, POOL_HDR_UUID_LEN);
+	} else if (util_uuid_generate(set->uuid) < 0) {
+		ERR("cannot generate pool set UUID");
+		return -1;
+	}
+
+	for (unsigned p = 0; p < rep->nhdrs; p++) {
+		if (util_uuid_generate(PART(rep, p)->uuid) < 0) {
+			ERR("cannot generate part UUID");
+			return -1;
+		}
+	}
+
+	struct pool_attr attr;
+	util_pool_hdr2attr(&attr, src_hdr);
+
+	for (unsigned p = 0; p < rep->nhdrs; p++) {
+		struct pool_set_part *part = PART(rep, p);
+		if (util_map_hdr(part, MAP_SHARED, 0))
+			return -1;
+
+		/* the shutdown state belongs to the source files */
+		if (p == 0)
+			shutdown_state_init(&HDR(rep, 0)->sds, NULL);
+
+		int ret = util_header_create(set, 0, p, &attr, 1);
+		util_unmap_hdr(part);
+		if (ret)
+			return -1;
+	}
+
+	if (type == POOL_TYPE_BLK)
+		clone_btt_update(rep, set->uuid);
+
+	return 0;
+}
+
+/*
+ * clone_read_header -- (internal) reads and validates the header of the first
+ *                      part of the source pool
+ */
+static int
+clone_read_header(int fd, struct pool_hdr *hdr)
+{
+	if (pread(fd, hdr, sizeof(*hdr), 0) != sizeof(*hdr)) {
+		ERR("!cannot read pool header");
+		return -1;
+	}
+
+	util_convert2h_hdr_nocheck(hdr);
+
+	if (hdr->major == 0 || !util_checksum(hdr, sizeof(*hdr),
+			&hdr->checksum, 0, POOL_HDR_CSUM_END_OFF(hdr))) {
+		ERR("invalid pool header");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (pool_hdr_get_type(hdr) == POOL_TYPE_UNKNOWN) {
+		ERR("cannot determine pool type");
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * clone_check_sets -- (internal) checks whether the destination pool set
+ *                     matches the master replica of the source one
+ */
+static int
+clone_check_sets(struct pool_set *set_src, struct pool_set *set_dst,
+	struct clone_part *parts)
+{
+	struct pool_replica *rep_src = REP(set_src, 0);
+	struct pool_replica *rep_dst = REP(set_dst, 0);
+
+	if (set_dst->nreplicas != 1 || rep_dst->remote) {
+		ERR("destination pool set must have a single local replica");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (set_dst->options != set_src->options) {
+		ERR("pool set options do not match");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (rep_dst->nparts != rep_src->nparts) {
+		ERR("number of parts does not match: %u != %u",
+			rep_dst->nparts, rep_src->nparts);
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (unsigned p = 0; p < rep_dst->nparts; p++) {
+		struct pool_set_part *part = PART(rep_dst, p);
+		if (part->is_dev_dax) {
+			ERR("%s: cloning to Device DAX is not supported",
+				part->path);
+			errno = ENOTSUP;
+			return -1;
+		}
+
+		if (part->filesize != parts[p].size) {
+			ERR("%s: part size does not match: %zu != %zu",
+				part->path, part->filesize, parts[p].size);
+			errno = EINVAL;
+			return -1;
+		}
+
+		parts[p].path = Strdup(part->path);
+		if (parts[p].path == NULL) {
+			ERR("!Strdup");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * clone_open_src -- (internal) opens and locks all parts of the master
+ *                   replica of the source pool
+ *
+ * The exclusive locks make sure the source pool is not open.
+ */
+static int
+clone_open_src(struct pool_replica *rep, struct clone_part *parts)
+{
+	for (unsigned p = 0; p < rep->nparts; p++) {
+		struct pool_set_part *part = PART(rep, p);
+		if (part->is_dev_dax) {
+			ERR("%s: cloning Device DAX is not supported",
+				part->path);
+			errno = ENOTSUP;
+			return -1;
+		}
+
+		parts[p].sfd = util_file_open(part->path, &parts[p].size, 0,
+				O_RDONLY);
+		if (parts[p].sfd < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * clone_create_parts -- (internal) creates the parts of the clone and tries
+ *                       to reflink them to the source parts
+ */
+static int
+clone_create_parts(struct clone_part *parts, unsigned nparts, unsigned flags)
+{
+	int oflags = O_RDWR | O_CREAT | O_EXCL;
+	mode_t mode;
+#ifndef _WIN32
+	mode = 0;
+#else
+	mode = S_IWRITE | S_IREAD;
+	oflags |= O_BINARY;
+#endif
+
+	/*
+	 * Create the parts without any permission. They will be granted once
+	 * the clone is complete.
+	 */
+	for (unsigned p = 0; p < nparts; p++) {
+		parts[p].dfd = os_open(parts[p].path, oflags, mode);
+		if (parts[p].dfd < 0) {
+			ERR("!open \"%s\"", parts[p].path);
+			return -1;
+		}
+
+		if (flags & PMEMPOOL_CLONE_NO_REFLINK)
+			continue;
+
+		if (clone_reflink(parts[p].sfd, parts[p].dfd) == 0) {
+			LOG(3, "%s: reflinked", parts[p].path);
+			parts[p].reflinked = 1;
+		} else {
+			LOG(3, "!%s: cannot reflink", parts[p].path);
+		}
+	}
+
+	if (clone_copy_parts(parts, nparts))
+		return -1;
+
+	for (unsigned p = 0; p < nparts; p++) {
+		if (os_fsync(parts[p].dfd)) {
+			ERR("!fsync %s", parts[p].path);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * clone_grant_perm -- (internal) grants the permissions of the source pool to
+ *                     all parts of the clone
+ */
+static int
+clone_grant_perm(struct clone_part *parts, unsigned nparts)
+{
+	os_stat_t stbuf;
+	if (os_fstat(parts[0].sfd, &stbuf)) {
+		ERR("!fstat");
+		return -1;
+	}
+
+	mode_t mode = stbuf.st_mode & ~(unsigned)S_IFMT;
+	for (unsigned p = 0; p < nparts; p++) {
+		if (os_chmod(parts[p].path, mode)) {
+			ERR("!chmod %s", parts[p].path);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * pmempool_cloneU -- make a copy of a pool with its own identity
+ */
+#ifndef _WIN32
+static inline
+#endif
+int
+pmempool_cloneU(const char *src, const char *dst, unsigned flags)
+{
+	LOG(3, "src %s dst %s flags %x", src, dst, flags);
+	ASSERTne(src, NULL);
+	ASSERTne(dst, NULL);
+
+	struct pool_set *set_src = NULL;
+	struct pool_set *set_dst = NULL;
+	struct clone_part *parts = NULL;
+	struct pool_hdr hdr;
+	int ret = -1;
+	int oerrno;
+
+	if (flags & ~PMEMPOOL_CLONE_ALL_FLAGS) {
+		ERR("invalid flags specified");
+		errno = EINVAL;
+		return -1;
+	}
+
+	int is_poolset = util_is_poolset_file(src);
+	if (is_poolset < 0)
+		return -1;
+
+	if (util_poolset_create_set(&set_src, src, 0, 0, true)) {
+		ERR("cannot open source pool -- '%s'", src);
+		return -1;
+	}
+
+	struct pool_replica *rep_src = REP(set_src, 0);
+	unsigned nparts = rep_src->nparts;
+
+	parts = Zalloc(nparts * sizeof(*parts));
+	if (parts == NULL) {
+		ERR("!Zalloc");
+		goto out;
+	}
+
+	for (unsigned p = 0; p < nparts; p++) {
+		parts[p].sfd = -1;
+		parts[p].dfd = -1;
+	}
+
+	if (clone_open_src(rep_src, parts))
+		goto out;
+
+	if (rep_src->nhdrs && clone_read_header(parts[0].sfd, &hdr))
+		goto out;
+
+	/* the clone of a single file pool can be a single file as well */
+	int exists = util_file_exists(dst);
+	if (exists < 0)
+		goto out;
+
+	if (exists) {
+		if (util_is_poolset_file(dst) != 1) {
+			ERR("destination file exists and is not a pool set");
+			errno = EEXIST;
+			goto out;
+		}
+
+		if (util_poolset_create_set(&set_dst, dst, 0, 0, true)) {
+			ERR("parsing destination pool set failed");
+			goto out;
+		}
+
+		if (clone_check_sets(set_src, set_dst, parts))
+			goto out;
+	} else if (!is_poolset) {
+		parts[0].path = Strdup(dst);
+		if (parts[0].path == NULL) {
+			ERR("!Strdup");
+			goto out;
+		}
+	} else {
+		ERR("destination pool set file does not exist");
+		errno = ENOENT;
+		goto out;
+	}
+
+	if (clone_create_parts(parts, nparts, flags))
+		goto out;
+
+	if (set_dst == NULL &&
+			util_poolset_create_set(&set_dst, dst, 0, 0, true))
+		goto out;
+
+	if (rep_src->nhdrs) {
+		/* on failure the pool set is closed and freed */
+		int uret = util_pool_open_nocheck(set_dst,
+				POOL_OPEN_IGNORE_BAD_BLOCKS);
+		if (uret == 0) {
+			uret = clone_update_headers(set_dst, &hdr);
+			oerrno = errno;
+			util_poolset_close(set_dst, DO_NOT_DELETE_PARTS);
+			errno = oerrno;
+		}
+
+		set_dst = NULL;
+		if (uret)
+			goto out;
+	}
+
+	ret = clone_grant_perm(parts, nparts);
+
+out:
+	oerrno = errno;
+	if (set_dst)
+		util_poolset_free(set_dst);
+
+	for (unsigned p = 0; parts && p < nparts; p++) {
+		if (parts[p].dfd >= 0) {
+			(void) os_close(parts[p].dfd);
+			if (ret)
+				(void) os_unlink(parts[p].path);
+		}
+		if (parts[p].sfd >= 0)
+			(void) os_close(parts[p].sfd);
+		Free(parts[p].path);
+	}
+	Free(parts);
+	util_poolset_free(set_src);
+	errno = oerrno;
+
+	if (ret && errno == 0)
+		errno = EINVAL;
+
+	return ret;
+}
+
+#ifndef _WIN32
+/*
+ * pmempool_clone -- make a copy of a pool with its own identity
+ */
+int
+pmempool_clone(const char *src, const char *dst, unsigned flags)
+{
+	return pmempool_cloneU(src, dst, flags);
+}
+#else
+/*
+ * pmempool_cloneW -- make a copy of a pool with its own identity in widechar
+ */
+int
+pmempool_cloneW(const wchar_t *src, const wchar_t *dst, unsigned flags)
+{
+	char *path_src = util_toUTF8(src);
+	if (path_src == NULL) {
+		ERR("Invalid source pool file path.");
+		return -1;
+	}
+
+	char *path_dst = util_toUTF8(dst);
+	if (path_dst == NULL) {
+		ERR("Invalid destination pool file path.");
+		util_free_UTF8(path_src);
+		return -1;
+	}
+
+	int ret = pmempool_cloneU(path_src, path_dst, flags);
+
+	util_free_UTF8(path_src);
+	util_free_UTF8(path_dst);
+	return ret;
+}
+#endif
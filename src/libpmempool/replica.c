@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2019, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -65,7 +65,8 @@
 static int
 check_flags_sync(unsigned flags)
 {
-	flags &= ~(PMEMPOOL_SYNC_DRY_RUN | PMEMPOOL_SYNC_FIX_BAD_BLOCKS);
+	flags &= ~(PMEMPOOL_SYNC_DRY_RUN | PMEMPOOL_SYNC_FIX_BAD_BLOCKS |
+			PMEMPOOL_SYNC_INCREMENTAL);
 	return flags > 0;
 }
 
@@ -2286,17 +2287,31 @@ err:
 }
 
 /*
- * pmempool_syncU -- synchronize replicas within a poolset
+ * pmempool_sync_with_argsU -- synchronize replicas within a poolset
+ *                             with the given copying parameters
  */
 #ifndef _WIN32
 static inline
 #endif
 int
-pmempool_syncU(const char *poolset, unsigned flags)
+pmempool_sync_with_argsU(const char *poolset,
+		const struct pmempool_sync_args *args, size_t args_size)
 {
-	LOG(3, "poolset %s, flags %u", poolset, flags);
+	LOG(3, "poolset %s, args %p, args_size %zu", poolset, args, args_size);
 	ASSERTne(poolset, NULL);
 
+	/*
+	 * Only the current version of the arguments is supported, newer
+	 * ones would be larger.
+	 */
+	if (args == NULL || args_size < sizeof(*args)) {
+		ERR("provided args_size is not supported");
+		errno = EINVAL;
+		return -1;
+	}
+
+	unsigned flags = args->flags;
+
 	/* check if poolset has correct signature */
 	if (util_is_poolset_file(poolset) != 1) {
 		ERR("file is not a poolset file");
@@ -2337,7 +2352,7 @@ pmempool_syncU(const char *poolset, unsigned flags)
 	}
 
 	/* sync all replicas */
-	if (replica_sync(set, NULL, flags)) {
+	if (replica_sync(set, NULL, flags, args)) {
 		LOG(1, "synchronization failed");
 		goto err_close_all;
 	}
@@ -2359,6 +2374,22 @@ err:
 	return -1;
 }
 
+/*
+ * pmempool_syncU -- synchronize replicas within a poolset
+ */
+#ifndef _WIN32
+static inline
+#endif
+int
+pmempool_syncU(const char *poolset, unsigned flags)
+{
+	struct pmempool_sync_args args;
+	memset(&args, 0, sizeof(args));
+	args.flags = flags;
+
+	return pmempool_sync_with_argsU(poolset, &args, sizeof(args));
+}
+
 #ifndef _WIN32
 /*
  * pmempool_sync -- synchronize replicas within a poolset
@@ -2368,6 +2399,17 @@ pmempool_sync(const char *poolset, unsigned flags)
 {
 	return pmempool_syncU(poolset, flags);
 }
+
+/*
+ * pmempool_sync_with_args -- synchronize replicas within a poolset
+ *                            with the given copying parameters
+ */
+int
+pmempool_sync_with_args(const char *poolset,
+		const struct pmempool_sync_args *args, size_t args_size)
+{
+	return pmempool_sync_with_argsU(poolset, args, args_size);
+}
 #else
 /*
  * pmempool_syncW -- synchronize replicas within a poolset in widechar
@@ -2386,6 +2428,26 @@ pmempool_syncW(const wchar_t *poolset, unsigned flags)
 	util_free_UTF8(path);
 	return ret;
 }
+
+/*
+ * pmempool_sync_with_argsW -- synchronize replicas within a poolset
+ *                             with the given copying parameters in widechar
+ */
+int
+pmempool_sync_with_argsW(const wchar_t *poolset,
+		const struct pmempool_sync_args *args, size_t args_size)
+{
+	char *path = util_toUTF8(poolset);
+	if (path == NULL) {
+		ERR("Invalid poolest file path.");
+		return -1;
+	}
+
+	int ret = pmempool_sync_with_argsU(path, args, args_size);
+
+	util_free_UTF8(path);
+	return ret;
+}
 #endif
 
 /*
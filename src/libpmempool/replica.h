@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2019, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -188,6 +188,16 @@ fix_bad_blocks(unsigned flags)
 	return flags & PMEMPOOL_SYNC_FIX_BAD_BLOCKS;
 }
 
+/*
+ * is_incremental -- (internal) check whether only the regions which differ
+ *                              from the healthy replica should be copied
+ */
+static inline bool
+is_incremental(unsigned flags)
+{
+	return flags & PMEMPOOL_SYNC_INCREMENTAL;
+}
+
 int replica_remove_all_recovery_files(struct poolset_health_status *set_hs);
 int replica_remove_part(struct pool_set *set, unsigned repn, unsigned partn,
 		int fix_bad_blocks);
@@ -229,7 +239,7 @@ int replica_open_replica_part_files(struct pool_set *set, unsigned repn);
 int replica_open_poolset_part_files(struct pool_set *set);
 
 int replica_sync(struct pool_set *set_in, struct poolset_health_status *set_hs,
-		unsigned flags);
+		unsigned flags, const struct pmempool_sync_args *args);
 int replica_transform(struct pool_set *set_in, struct pool_set *set_out,
 		unsigned flags);
 
@@ -41,11 +41,15 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include "libpmem.h"
 #include "replica.h"
 #include "out.h"
 #include "os.h"
+#include "os_thread.h"
+#include "sys_util.h"
 #include "util_pmem.h"
 #include "util.h"
 
@@ -95,6 +99,306 @@ err:
 	return -1;
 }
 
+/*
+ * Local replicas are copied by a pool of threads, each of which claims
+ * SYNC_CHUNK_SIZE chunks of the range until the whole range is copied.
+ * The number of threads, the bandwidth limit and the progress reporting
+ * are set by pmempool_sync_with_args().
+ *
+ * In the incremental mode every SYNC_REGION_SIZE region of a chunk is
+ * compared with the destination first and only the differing ones are copied.
+ */
+#define SYNC_CHUNK_SIZE ((size_t)16 << 20) /* 16 MiB */
+#define SYNC_REGION_SIZE ((size_t)2 << 20) /* 2 MiB */
+#define SYNC_MIN_PER_THREAD ((size_t)64 << 20) /* 64 MiB */
+#define SYNC_MAX_THREADS 64
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+
+struct sync_copy {
+	char *src;
+	char *dst;
+	size_t len;
+	int is_pmem;
+	int incremental;
+
+	uint64_t next;		/* offset of the first not claimed chunk */
+	uint64_t done;		/* number of bytes already processed */
+	uint64_t skipped;	/* number of bytes found identical */
+	unsigned error;		/* set by the first thread which failed */
+	int oerrno;		/* errno of the first failure */
+
+	uint64_t bandwidth;	/* bytes per second, 0 means unlimited */
+	uint64_t start;		/* start time in ns */
+
+	pmempool_sync_progress_fn progress; /* NULL means disabled */
+	void *progress_arg;
+	uint64_t progress_interval; /* report interval in ns */
+
+	os_mutex_t lock;	/* serializes the progress reports */
+	uint64_t last_report;	/* time of the last report in ns */
+	uint64_t reported;	/* number of bytes in the last report */
+};
+
+/*
+ * sync_time_ns -- (internal) returns the monotonic time in nanoseconds
+ */
+static uint64_t
+sync_time_ns(void)
+{
+	struct timespec ts;
+	os_clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * sync_copy_nthreads -- (internal) returns the number of threads to copy
+ *                       len bytes with
+ */
+static unsigned
+sync_copy_nthreads(size_t len, unsigned requested)
+{
+	if (requested > 0)
+		return requested > SYNC_MAX_THREADS ?
+			SYNC_MAX_THREADS : requested;
+
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus < 1)
+		ncpus = 1;
+
+	size_t nthreads = len / SYNC_MIN_PER_THREAD;
+	if (nthreads > (size_t)ncpus)
+		nthreads = (size_t)ncpus;
+	if (nthreads > SYNC_MAX_THREADS)
+		nthreads = SYNC_MAX_THREADS;
+
+	return nthreads == 0 ? 1 : (unsigned)nthreads;
+}
+
+/*
+ * sync_copy_throttle -- (internal) sleeps until copying the chunk at
+ *                       the offset off does not exceed the bandwidth limit
+ */
+static void
+sync_copy_throttle(struct sync_copy *sc, uint64_t off)
+{
+	uint64_t due = sc->start + (uint64_t)((double)off /
+			(double)sc->bandwidth * (double)NSEC_PER_SEC);
+
+	/* a signal may end the sleep early */
+	uint64_t now;
+	while ((now = sync_time_ns()) < due) {
+		struct timespec ts;
+		ts.tv_sec = (time_t)((due - now) / NSEC_PER_SEC);
+		ts.tv_nsec = (long)((due - now) % NSEC_PER_SEC);
+		os_nanosleep(&ts);
+	}
+}
+
+/*
+ * sync_copy_report -- (internal) reports the progress of copying, at most
+ *                     once per the report interval and always at the end
+ */
+static void
+sync_copy_report(struct sync_copy *sc, uint64_t done)
+{
+	uint64_t now = sync_time_ns();
+
+	util_mutex_lock(&sc->lock);
+
+	/* a thread which finished an earlier chunk may come in late */
+	if (done > sc->reported && (done == sc->len ||
+			now - sc->last_report >= sc->progress_interval)) {
+		uint64_t skipped;
+		util_atomic_load_explicit64(&sc->skipped, &skipped,
+			memory_order_relaxed);
+
+		sc->last_report = now;
+		sc->reported = done;
+		sc->progress(done, skipped, sc->len, sc->progress_arg);
+	}
+
+	util_mutex_unlock(&sc->lock);
+}
+
+/*
+ * sync_copy_range -- (internal) copies the range of the chunk, without
+ *                    draining the stores to pmem
+ */
+static int
+sync_copy_range(struct sync_copy *sc, size_t off, size_t len)
+{
+	char *dst = sc->dst + off;
+	pmem_memcpy_nodrain(dst, sc->src + off, len);
+
+	if (!sc->is_pmem && pmem_msync(dst, len))
+		return -1;
+
+	return 0;
+}
+
+/*
+ * sync_copy_diff -- (internal) copies only the regions of the chunk which
+ *                   differ from the destination, returns the number of bytes
+ *                   skipped or -1 on error
+ */
+static ssize_t
+sync_copy_diff(struct sync_copy *sc, size_t off, size_t len)
+{
+	size_t skipped = 0;
+	size_t end = off + len;
+
+	for (; off < end; off += SYNC_REGION_SIZE) {
+		size_t rlen = end - off;
+		if (rlen > SYNC_REGION_SIZE)
+			rlen = SYNC_REGION_SIZE;
+
+		if (memcmp(sc->dst + off, sc->src + off, rlen) == 0) {
+			skipped += rlen;
+			continue;
+		}
+
+		if (sync_copy_range(sc, off, rlen))
+			return -1;
+	}
+
+	return (ssize_t)skipped;
+}
+
+/*
+ * sync_copy_worker -- (internal) copies the chunks of the range until
+ *                     none is left
+ */
+static void *
+sync_copy_worker(void *arg)
+{
+	struct sync_copy *sc = arg;
+
+	while (1) {
+		unsigned error;
+		util_atomic_load_explicit32(&sc->error, &error,
+			memory_order_relaxed);
+		if (error)
+			break;
+
+		uint64_t off = util_fetch_and_add64(&sc->next,
+				SYNC_CHUNK_SIZE);
+		if (off >= sc->len)
+			break;
+
+		size_t len = sc->len - off;
+		if (len > SYNC_CHUNK_SIZE)
+			len = SYNC_CHUNK_SIZE;
+
+		if (sc->bandwidth)
+			sync_copy_throttle(sc, off);
+
+		ssize_t skipped = 0;
+		if (sc->incremental)
+			skipped = sync_copy_diff(sc, off, len);
+		else if (sync_copy_range(sc, off, len))
+			skipped = -1;
+
+		if (skipped < 0) {
+			/* errno is thread-local, keep the first one */
+			int oerrno = errno;
+			if (util_bool_compare_and_swap32(&sc->error, 0, 1))
+				sc->oerrno = oerrno;
+			break;
+		}
+
+		if (sc->is_pmem && (size_t)skipped != len)
+			pmem_drain();
+
+		if (skipped)
+			util_fetch_and_add64(&sc->skipped, (uint64_t)skipped);
+
+		uint64_t done = util_fetch_and_add64(&sc->done, len) + len;
+		if (sc->progress)
+			sync_copy_report(sc, done);
+	}
+
+	return NULL;
+}
+
+/*
+ * sync_copy_local -- (internal) copies len bytes of a local replica
+ *                    using a pool of threads
+ */
+static int
+sync_copy_local(void *src_addr, void *dst_addr, size_t len, int is_pmem,
+		int incremental, const struct pmempool_sync_args *args)
+{
+	LOG(3, "src_addr %p dst_addr %p len %zu is_pmem %d incremental %d "
+		"args %p", src_addr, dst_addr, len, is_pmem, incremental,
+		args);
+
+	struct sync_copy sc;
+	memset(&sc, 0, sizeof(sc));
+	sc.src = src_addr;
+	sc.dst = dst_addr;
+	sc.len = len;
+	sc.is_pmem = is_pmem;
+	sc.incremental = incremental;
+
+	unsigned nthreads = sync_copy_nthreads(len, args ? args->nthreads : 0);
+	if (args) {
+		sc.bandwidth = args->bandwidth;
+		sc.progress = args->progress;
+		sc.progress_arg = args->progress_arg;
+		sc.progress_interval =
+			(uint64_t)args->progress_interval * NSEC_PER_MSEC;
+	}
+
+	LOG(4, "nthreads %u bandwidth %" PRIu64 " progress interval %" PRIu64,
+		nthreads, sc.bandwidth, sc.progress_interval);
+
+	os_thread_t *threads = NULL;
+	if (nthreads > 1) {
+		threads = Malloc(nthreads * sizeof(*threads));
+		if (threads == NULL) {
+			LOG(2, "!Malloc");
+			nthreads = 1;
+		}
+	}
+
+	util_mutex_init(&sc.lock);
+
+	sc.start = sync_time_ns();
+	sc.last_report = sc.start;
+
+	/* the calling thread is one of the workers */
+	unsigned created = 1;
+	for (; created < nthreads; created++) {
+		if (os_thread_create(&threads[created], NULL,
+				sync_copy_worker, &sc) != 0) {
+			LOG(2, "!os_thread_create");
+			break;
+		}
+	}
+
+	sync_copy_worker(&sc);
+
+	for (unsigned i = 1; i < created; i++)
+		os_thread_join(&threads[i], NULL);
+
+	util_mutex_destroy(&sc.lock);
+
+	Free(threads);
+
+	if (sc.error) {
+		errno = sc.oerrno;
+		ERR("!copying data to the replica failed");
+		return -1;
+	}
+
+	if (incremental)
+		LOG(3, "skipped %" PRIu64 " of %zu bytes", sc.skipped, len);
+
+	return 0;
+}
+
 /*
  * sync_copy_data -- (internal) copy data from the healthy replica
  *                   to the broken one
@@ -102,11 +406,13 @@ err:
 static int
 sync_copy_data(void *src_addr, void *dst_addr, size_t off, size_t len,
 		struct pool_replica *rep_h,
-		struct pool_replica *rep, const struct pool_set_part *part)
+		struct pool_replica *rep, const struct pool_set_part *part,
+		int incremental, const struct pmempool_sync_args *args)
 {
 	LOG(3, "src_addr %p dst_addr %p off %zu len %zu "
-		"rep_h %p rep %p part %p",
-		src_addr, dst_addr, off, len, rep_h, rep, part);
+		"rep_h %p rep %p part %p incremental %d args %p",
+		src_addr, dst_addr, off, len, rep_h, rep, part, incremental,
+		args);
 
 	int ret;
 
@@ -146,8 +452,10 @@ sync_copy_data(void *src_addr, void *dst_addr, size_t off, size_t len,
 			off, len, rep_h->part[0].path);
 
 		/* copy all data */
-		memcpy(dst_addr, src_addr, len);
-		util_persist(part->is_dev_dax, dst_addr, len);
+		if (sync_copy_local(src_addr, dst_addr, len,
+				part->is_dev_dax || part->map_sync,
+				incremental, args))
+			return -1;
 	}
 
 	return 0;
@@ -828,9 +1136,10 @@ exit:
  * sync_badblocks_data -- (internal) clear bad blocks in replica
  */
 static int
-sync_badblocks_data(struct pool_set *set, struct poolset_health_status *set_hs)
+sync_badblocks_data(struct pool_set *set, struct poolset_health_status *set_hs,
+		const struct pmempool_sync_args *args)
 {
-	LOG(3, "set %p, set_hs %p", set, set_hs);
+	LOG(3, "set %p, set_hs %p, args %p", set, set_hs, args);
 
 	struct pool_replica *rep_h;
 
@@ -868,7 +1177,8 @@ sync_badblocks_data(struct pool_set *set, struct poolset_health_status *set_hs)
 
 				if (sync_copy_data(src_addr, dst_addr,
 							part_off + off, len,
-							rep_h, rep, part))
+							rep_h, rep, part, 0,
+							args))
 					return -1;
 			}
 
@@ -1113,10 +1423,11 @@ create_headers_for_broken_parts(struct pool_set *set, unsigned src_replica,
  */
 static int
 copy_data_to_broken_parts(struct pool_set *set, unsigned healthy_replica,
-		unsigned flags, struct poolset_health_status *set_hs)
+		unsigned flags, struct poolset_health_status *set_hs,
+		const struct pmempool_sync_args *args)
 {
-	LOG(3, "set %p, healthy_replica %u, flags %u, set_hs %p", set,
-			healthy_replica, flags, set_hs);
+	LOG(3, "set %p, healthy_replica %u, flags %u, set_hs %p, args %p",
+			set, healthy_replica, flags, set_hs, args);
 
 	/* get pool size from healthy replica */
 	size_t poolsize = set->poolsize;
@@ -1156,7 +1467,8 @@ copy_data_to_broken_parts(struct pool_set *set, unsigned healthy_replica,
 			void *dst_addr = ADDR_SUM(part->addr, fpoff);
 
 			if (sync_copy_data(src_addr, dst_addr, off, len,
-						rep_h, rep, part))
+						rep_h, rep, part,
+						is_incremental(flags), args))
 				return -1;
 		}
 	}
@@ -1501,9 +1813,9 @@ create_remote_replicas(struct pool_set *set,
  */
 int
 replica_sync(struct pool_set *set, struct poolset_health_status *s_hs,
-		unsigned flags)
+		unsigned flags, const struct pmempool_sync_args *args)
 {
-	LOG(3, "set %p, flags %u", set, flags);
+	LOG(3, "set %p, flags %u, args %p", set, flags, args);
 	int ret = 0;
 	struct poolset_health_status *set_hs = NULL;
 
@@ -1611,7 +1923,7 @@ replica_sync(struct pool_set *set, struct poolset_health_status *s_hs,
 	LOG(3, "bad blocks do not overlap");
 
 	/* sync data in bad blocks */
-	if (sync_badblocks_data(set, set_hs)) {
+	if (sync_badblocks_data(set, set_hs, args)) {
 		LOG(1, "syncing bad blocks data failed");
 		ret = -1;
 		goto out;
@@ -1649,7 +1961,7 @@ replica_sync(struct pool_set *set, struct poolset_health_status *s_hs,
 
 	/* check and copy data if possible */
 	if (copy_data_to_broken_parts(set, healthy_replica,
-			flags, set_hs)) {
+			flags, set_hs, args)) {
 		ERR("copying data to broken parts failed");
 		ret = -1;
 		goto out;
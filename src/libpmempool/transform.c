@@ -982,7 +982,7 @@ replica_transform(struct pool_set *set_in, struct pool_set *set_out,
 			ERR("removing headers failed; falling back to the "
 					"input poolset");
 			if (replica_sync(set_in, set_in_hs,
-					flags | IS_TRANSFORMED)) {
+					flags | IS_TRANSFORMED, NULL)) {
 				LOG(1, "falling back to the input poolset "
 						"failed");
 			} else {
@@ -1000,7 +1000,7 @@ replica_transform(struct pool_set *set_in, struct pool_set *set_out,
 			ERR("adding headers failed; falling back to the "
 					"input poolset");
 			if (replica_sync(set_in, set_in_hs,
-					flags | IS_TRANSFORMED)) {
+					flags | IS_TRANSFORMED, NULL)) {
 				LOG(1, "falling back to the input poolset "
 						"failed");
 			} else {
@@ -1025,7 +1025,8 @@ replica_transform(struct pool_set *set_in, struct pool_set *set_out,
 	}
 
 	/* signal that sync is called by transform */
-	if (replica_sync(set_out, set_out_hs, flags | IS_TRANSFORMED)) {
+	if (replica_sync(set_out, set_out_hs, flags | IS_TRANSFORMED,
+			NULL)) {
 		ret = -1;
 		goto free_cs;
 	}
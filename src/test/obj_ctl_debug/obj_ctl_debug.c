@@ -1,5 +1,5 @@
 /*
- * Copyright 2018, Intel Corporation
+ * Copyright 2018-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -72,13 +72,126 @@ test_alloc_pattern(PMEMobjpool *pop)
 	pmemobj_free(&oid);
 }
 
+#define FLUSH_PROF(name) "debug.flush_profile." name
+
+/*
+ * prof_get -- returns the value of a flush profile counter
+ */
+static uint64_t
+prof_get(PMEMobjpool *pop, const char *name)
+{
+	uint64_t value;
+	int ret = pmemobj_ctl_get(pop, name, &value);
+	UT_ASSERTeq(ret, 0);
+
+	return value;
+}
+
+static void
+test_flush_profile(PMEMobjpool *pop, const char *report)
+{
+	int ret;
+	int arg;
+
+	/* check defaults */
+	ret = pmemobj_ctl_get(pop, FLUSH_PROF("enabled"), &arg);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(arg, 0);
+
+	ret = pmemobj_ctl_get(pop, FLUSH_PROF("sample_rate"), &arg);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(arg, 1);
+
+	/* invalid sample rate */
+	arg = 0;
+	ret = pmemobj_ctl_set(pop, FLUSH_PROF("sample_rate"), &arg);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	PMEMoid root = pmemobj_root(pop, 4 * CACHELINE_SIZE);
+	UT_ASSERT(!OID_IS_NULL(root));
+	char *line = (char *)ALIGN_UP((uintptr_t)pmemobj_direct(root),
+		CACHELINE_SIZE);
+	char src[CACHELINE_SIZE];
+	memset(src, 3, sizeof(src));
+
+	/* nothing is recorded while disabled */
+	pmemobj_persist(pop, line, CACHELINE_SIZE);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("calls")), 0);
+
+	arg = 1;
+	ret = pmemobj_ctl_set(pop, FLUSH_PROF("enabled"), &arg);
+	UT_ASSERTeq(ret, 0);
+
+	memset(line, 1, CACHELINE_SIZE);
+	pmemobj_persist(pop, line, CACHELINE_SIZE);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("lines")), 1);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("clean_lines")), 0);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("fences")), 1);
+
+	/* the line did not change, this persist is redundant */
+	pmemobj_persist(pop, line, CACHELINE_SIZE);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("lines")), 2);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("clean_lines")), 1);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("fences")), 2);
+
+	line[0] = 2;
+	pmemobj_flush(pop, line, CACHELINE_SIZE);
+	pmemobj_drain(pop);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("lines")), 3);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("clean_lines")), 1);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("fences")), 3);
+
+	/* flushing a line just written by memcpy is redundant */
+	pmemobj_memcpy(pop, line, src, CACHELINE_SIZE,
+		PMEMOBJ_F_MEM_NODRAIN);
+	pmemobj_persist(pop, line, CACHELINE_SIZE);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("lines")), 5);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("clean_lines")), 2);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("fences")), 4);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("calls")), 6);
+
+	/* a line written by memcpy without a flush is dirty, not clean */
+	memset(src, 4, sizeof(src));
+	pmemobj_memcpy(pop, line, src, CACHELINE_SIZE,
+		PMEMOBJ_F_MEM_NOFLUSH);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("fences")), 4);
+	pmemobj_persist(pop, line, CACHELINE_SIZE);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("lines")), 6);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("clean_lines")), 2);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("fences")), 5);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("calls")), 8);
+
+	/* with sampling only every second call is recorded */
+	arg = 2;
+	ret = pmemobj_ctl_set(pop, FLUSH_PROF("sample_rate"), &arg);
+	UT_ASSERTeq(ret, 0);
+	ret = pmemobj_ctl_exec(pop, FLUSH_PROF("reset"), NULL);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("calls")), 0);
+
+	for (int i = 0; i < 4; ++i)
+		pmemobj_drain(pop);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("calls")), 2);
+	UT_ASSERTeq(prof_get(pop, FLUSH_PROF("fences")), 2);
+
+	ret = pmemobj_ctl_set(pop, FLUSH_PROF("output"), (void *)report);
+	UT_ASSERTeq(ret, 0);
+	ret = pmemobj_ctl_exec(pop, FLUSH_PROF("dump"), NULL);
+	UT_ASSERTeq(ret, 0);
+
+	os_stat_t st;
+	UT_ASSERTeq(os_stat(report, &st), 0);
+	UT_ASSERTne(st.st_size, 0);
+}
+
 int
 main(int argc, char *argv[])
 {
 	START(argc, argv, "obj_ctl_debug");
 
 	if (argc < 2)
-		UT_FATAL("usage: %s filename", argv[0]);
+		UT_FATAL("usage: %s filename [report]", argv[0]);
 
 	const char *path = argv[1];
 
@@ -88,7 +201,10 @@ main(int argc, char *argv[])
 		S_IWUSR | S_IRUSR)) == NULL)
 		UT_FATAL("!pmemobj_open: %s", path);
 
-	test_alloc_pattern(pop);
+	if (argc > 2)
+		test_flush_profile(pop, argv[2]);
+	else
+		test_alloc_pattern(pop);
 
 	pmemobj_close(pop);
 
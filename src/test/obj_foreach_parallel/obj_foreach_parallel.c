@@ -0,0 +1,211 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_foreach_parallel.c -- unit test for pmemobj_foreach_parallel
+ */
+
+#include "libpmemobj.h"
+#include "unittest.h"
+#include "util.h"
+
+#define LAYOUT_NAME "obj_foreach_parallel"
+
+#define POOL_SIZE (PMEMOBJ_MIN_POOL * 32)
+
+#define TYPE_SMALL 1
+#define TYPE_MEDIUM 2
+#define TYPE_HUGE 3
+
+#define NSMALL 20000
+#define NMEDIUM 2000
+#define NHUGE 150
+
+#define STOP_AFTER 10
+#define STOP_RET 7
+
+struct visit_ctx {
+	uint64_t count;
+	uint64_t off_sum;
+	uint64_t uuid_lo;
+	int ret;
+};
+
+/*
+ * visit_cb -- counts the visited objects
+ */
+static int
+visit_cb(PMEMoid oid, void *arg)
+{
+	struct visit_ctx *ctx = arg;
+
+	UT_ASSERTeq(oid.pool_uuid_lo, ctx->uuid_lo);
+
+	util_fetch_and_add64(&ctx->off_sum, oid.off);
+	uint64_t n = util_fetch_and_add64(&ctx->count, 1);
+
+	if (ctx->ret != 0 && n + 1 == STOP_AFTER)
+		return ctx->ret;
+
+	return 0;
+}
+
+/*
+ * alloc_objects -- allocates n objects of the given size and type
+ */
+static void
+alloc_objects(PMEMobjpool *pop, unsigned n, size_t size, uint64_t type_num)
+{
+	for (unsigned i = 0; i < n; ++i) {
+		if (pmemobj_alloc(pop, NULL, size, type_num, NULL, NULL))
+			UT_FATAL("!pmemobj_alloc");
+	}
+}
+
+/*
+ * test_foreach -- compares parallel iteration with POBJ_FOREACH
+ */
+static void
+test_foreach(PMEMobjpool *pop, unsigned nthreads)
+{
+	PMEMoid oid;
+	uint64_t count = 0;
+	uint64_t off_sum = 0;
+	uint64_t count_huge = 0;
+
+	POBJ_FOREACH(pop, oid) {
+		count++;
+		off_sum += oid.off;
+		if (pmemobj_type_num(oid) == TYPE_HUGE)
+			count_huge++;
+	}
+
+	struct visit_ctx ctx = {0, 0, pmemobj_first(pop).pool_uuid_lo, 0};
+
+	int ret = pmemobj_foreach_parallel(pop, nthreads, 0, 0,
+		visit_cb, &ctx);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(ctx.count, count);
+	UT_ASSERTeq(ctx.off_sum, off_sum);
+
+	ctx.count = 0;
+	ctx.off_sum = 0;
+	ret = pmemobj_foreach_parallel(pop, nthreads, TYPE_HUGE,
+		POBJ_ITER_TYPE_NUM, visit_cb, &ctx);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(ctx.count, count_huge);
+}
+
+/*
+ * test_stop -- checks that non-zero value returned by the callback ends
+ *	the iteration
+ */
+static void
+test_stop(PMEMobjpool *pop, unsigned nthreads)
+{
+	struct visit_ctx ctx = {0, 0, pmemobj_first(pop).pool_uuid_lo,
+		STOP_RET};
+
+	int ret = pmemobj_foreach_parallel(pop, nthreads, 0, 0,
+		visit_cb, &ctx);
+	UT_ASSERTeq(ret, STOP_RET);
+	UT_ASSERT(ctx.count < NSMALL + NMEDIUM + NHUGE);
+}
+
+/*
+ * test_invalid -- checks invalid arguments
+ */
+static void
+test_invalid(PMEMobjpool *pop)
+{
+	struct visit_ctx ctx = {0, 0, 0, 0};
+
+	errno = 0;
+	int ret = pmemobj_foreach_parallel(pop, 0, 0, 0, visit_cb, &ctx);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	errno = 0;
+	ret = pmemobj_foreach_parallel(pop, 1, 0, ~POBJ_ITER_VALID_FLAGS,
+		visit_cb, &ctx);
+	UT_ASSERTeq(ret, -1);
+	UT_ASSERTeq(errno, EINVAL);
+
+	UT_ASSERTeq(ctx.count, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_foreach_parallel");
+
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	PMEMobjpool *pop = pmemobj_create(path, LAYOUT_NAME, POOL_SIZE,
+		S_IWUSR | S_IRUSR);
+	if (pop == NULL)
+		UT_FATAL("!pmemobj_create: %s", path);
+
+	test_invalid(pop);
+
+	alloc_objects(pop, NSMALL, 64, TYPE_SMALL);
+	alloc_objects(pop, NMEDIUM, 10 * 1024, TYPE_MEDIUM);
+	alloc_objects(pop, NHUGE, 600 * 1024, TYPE_HUGE);
+
+	test_foreach(pop, 1);
+	test_foreach(pop, 4);
+
+	/* free every other object to leave holes in the heap */
+	PMEMoid oid = pmemobj_first(pop);
+	while (!OID_IS_NULL(oid)) {
+		PMEMoid next = pmemobj_next(oid);
+		if (!OID_IS_NULL(next)) {
+			PMEMoid tmp = next;
+			next = pmemobj_next(next);
+			pmemobj_free(&tmp);
+		}
+		oid = next;
+	}
+
+	test_foreach(pop, 1);
+	test_foreach(pop, 4);
+
+	test_stop(pop, 1);
+	test_stop(pop, 4);
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -163,3 +163,13 @@ class TEST18(PMEM2_CONFIG_NO_DIR):
 class TEST19(PMEM2_CONFIG_NO_DIR):
     """setting maximum possible offset"""
     test_case = "test_set_offset_max"
+
+
+class TEST20(PMEM2_CONFIG_NO_DIR):
+    """setting the non-temporal stores threshold"""
+    test_case = "test_set_movnt_threshold"
+
+
+class TEST21(PMEM2_CONFIG_NO_DIR):
+    """setting the page size policy and access hints"""
+    test_case = "test_set_page_size_and_hints"
@@ -1,5 +1,5 @@
 /*
- * Copyright 2019, Intel Corporation
+ * Copyright 2019-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -481,6 +481,66 @@ test_set_offset_max(const struct test_case *tc, int argc, char *argv[])
 	return 0;
 }
 
+/*
+ * test_set_movnt_threshold - setting the non-temporal stores threshold
+ */
+static int
+test_set_movnt_threshold(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_config cfg;
+	pmem2_config_init(&cfg);
+	UT_ASSERTeq(cfg.movnt_threshold, PMEM2_MOVNT_THRESHOLD_DEFAULT);
+
+	int ret = pmem2_config_set_movnt_threshold(&cfg, 4096);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(cfg.movnt_threshold, 4096);
+
+	ret = pmem2_config_set_movnt_threshold(&cfg,
+		PMEM2_MOVNT_THRESHOLD_CALIBRATE);
+	UT_ASSERTeq(ret, 0);
+	UT_ASSERTeq(cfg.movnt_threshold, PMEM2_MOVNT_THRESHOLD_CALIBRATE);
+
+	return 0;
+}
+
+/*
+ * test_set_page_size_and_hints - setting the page size policy and access
+ * hints
+ */
+static int
+test_set_page_size_and_hints(const struct test_case *tc, int argc,
+		char *argv[])
+{
+	struct pmem2_config cfg;
+	pmem2_config_init(&cfg);
+	UT_ASSERTeq(cfg.page_size, PMEM2_PAGE_SIZE_DEFAULT);
+	UT_ASSERTeq(cfg.map_hints, 0);
+
+	int ret = pmem2_config_set_page_size(&cfg, 2 << 20);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(cfg.page_size, 2 << 20);
+
+	ret = pmem2_config_set_page_size(&cfg, (2 << 20) + 1);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+	ret = pmem2_config_set_page_size(&cfg, Ut_pagesize / 2);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+	UT_ASSERTeq(cfg.page_size, 2 << 20);
+
+	ret = pmem2_config_set_map_hints(&cfg,
+		PMEM2_MAP_HINT_POPULATE | PMEM2_MAP_HINT_WILLNEED);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(cfg.map_hints,
+		PMEM2_MAP_HINT_POPULATE | PMEM2_MAP_HINT_WILLNEED);
+
+	ret = pmem2_config_set_map_hints(&cfg,
+		PMEM2_MAP_HINT_SEQUENTIAL | PMEM2_MAP_HINT_RANDOM);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+	ret = pmem2_config_set_map_hints(&cfg, 1U << 31);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+
+	return 0;
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -508,6 +568,8 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_set_offset_success),
 	TEST_CASE(test_set_length_success),
 	TEST_CASE(test_set_offset_max),
+	TEST_CASE(test_set_movnt_threshold),
+	TEST_CASE(test_set_page_size_and_hints),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * pmem2_flush_set.c -- pmem2_flush_set unittests
+ */
+
+#include "unittest.h"
+#include "ut_pmem2_utils.h"
+
+#define NRANGES 1000
+
+/*
+ * map_file -- map the whole file with the given granularity
+ */
+static struct pmem2_map *
+map_file(int fd, enum pmem2_granularity granularity)
+{
+	struct pmem2_config *cfg;
+	int ret = pmem2_config_new(&cfg);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_fd(cfg, fd);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_required_store_granularity(cfg, granularity);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	struct pmem2_map *map;
+	ret = pmem2_map(cfg, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	pmem2_config_delete(&cfg);
+
+	return map;
+}
+
+/*
+ * test_flush_set_persist -- add overlapping and scattered ranges and
+ * persist them
+ */
+static int
+test_flush_set_persist(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_flush_set_persist <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_map *map = map_file(fd, PMEM2_GRANULARITY_PAGE);
+	char *addr = pmem2_map_get_address(map);
+	size_t size = pmem2_map_get_size(map);
+
+	struct pmem2_flush_set *set;
+	int ret = pmem2_flush_set_new(&set, map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	/* persisting an empty set is a no-op */
+	ret = pmem2_flush_set_persist(set);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	/* overlapping, adjacent and empty ranges */
+	memset(addr, 1, 4096);
+	ret = pmem2_flush_set_add(set, addr, 100);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_flush_set_add(set, addr + 50, 100);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_flush_set_add(set, addr + 150, 3946);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_flush_set_add(set, addr + 10, 0);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_flush_set_persist(set);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	/* scattered ranges, added in a descending order */
+	for (size_t i = NRANGES; i > 0; --i) {
+		size_t off = (i * 7919 * 64) % (size - 256);
+		memset(addr + off, (int)i, 256);
+		ret = pmem2_flush_set_add(set, addr + off, 256);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+	}
+	ret = pmem2_flush_set_persist(set);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	/* the last byte of the mapping */
+	addr[size - 1] = 1;
+	ret = pmem2_flush_set_add(set, addr + size - 1, 1);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_flush_set_persist(set);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_flush_set_delete(&set);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(set, NULL);
+
+	pmem2_unmap(&map);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_flush_set_out_of_range -- add ranges outside of the mapping
+ */
+static int
+test_flush_set_out_of_range(const struct test_case *tc, int argc,
+		char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_flush_set_out_of_range <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_map *map = map_file(fd, PMEM2_GRANULARITY_PAGE);
+	char *addr = pmem2_map_get_address(map);
+	size_t size = pmem2_map_get_size(map);
+
+	struct pmem2_flush_set *set;
+	int ret = pmem2_flush_set_new(&set, map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_flush_set_add(set, addr - 1, 2);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+
+	ret = pmem2_flush_set_add(set, addr + size - 1, 2);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+
+	ret = pmem2_flush_set_add(set, addr + size + 1, 1);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+
+	ret = pmem2_flush_set_add(set, addr, SIZE_MAX);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+
+	pmem2_flush_set_delete(&set);
+	pmem2_unmap(&map);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_cases -- available test cases
+ */
+static struct test_case test_cases[] = {
+	TEST_CASE(test_flush_set_persist),
+	TEST_CASE(test_flush_set_out_of_range),
+};
+
+#define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "pmem2_flush_set");
+	TEST_CASE_PROCESS(argc, argv, test_cases, NTESTS);
+	DONE(NULL);
+}
@@ -244,3 +244,18 @@ class TEST22(PMEM2_INTEGRATION):
 class TEST23(PMEM2_INTEGRATION_DEV_DAXES):
     """test unaligned offset"""
     test_case = "test_offset_aligned"
+
+
+class TEST24(PMEM2_INTEGRATION):
+    """test fixed and calibrated non-temporal stores threshold"""
+    test_case = "test_movnt_threshold"
+
+
+class TEST25(PMEM2_INTEGRATION):
+    """test background flushing of page granularity mappings"""
+    test_case = "test_async_flush"
+
+
+class TEST26(PMEM2_INTEGRATION):
+    """copy scattered fragments with a single call"""
+    test_case = "test_memcpy_v"
@@ -561,6 +561,266 @@ test_offset_aligned(const struct test_case *tc, int argc, char *argv[])
 	return 1;
 }
 
+/*
+ * test_movnt_threshold -- map with a fixed and a calibrated non-temporal
+ * stores threshold and use memmove/memset functions of the mappings
+ */
+static int
+test_movnt_threshold(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_movnt_threshold <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	prepare_config(&cfg, fd, PMEM2_GRANULARITY_PAGE);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_config_get_file_size(cfg, &size), 0);
+
+	/* default threshold */
+	struct pmem2_map *map = map_valid(cfg, size);
+	UT_ASSERTeq(pmem2_map_get_movnt_threshold(map), 0);
+	pmem2_unmap(&map);
+
+	/* fixed threshold */
+	int ret = pmem2_config_set_movnt_threshold(cfg, 4096);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	map = map_valid(cfg, size);
+	UT_ASSERTeq(pmem2_map_get_movnt_threshold(map), 4096);
+
+	char *addr = pmem2_map_get_address(map);
+	pmem2_memset_fn memset_fn = pmem2_get_memset_fn(map);
+	pmem2_memcpy_fn memcpy_fn = pmem2_get_memcpy_fn(map);
+	pmem2_memmove_fn memmove_fn = pmem2_get_memmove_fn(map);
+
+	/* below and above the threshold */
+	memset_fn(addr, 0xab, 1024, 0);
+	memset_fn(addr + 1024, 0xcd, 8192, 0);
+	memcpy_fn(addr + 16384, addr, 1024 + 8192, 0);
+	memmove_fn(addr + 512, addr, 1024, PMEM2_F_MEM_NODRAIN);
+
+	for (size_t i = 0; i < 512; ++i)
+		UT_ASSERTeq((unsigned char)addr[i], 0xab);
+	for (size_t i = 512; i < 1536; ++i)
+		UT_ASSERTeq((unsigned char)addr[i], 0xab);
+	for (size_t i = 1536; i < 1024 + 8192; ++i)
+		UT_ASSERTeq((unsigned char)addr[i], 0xcd);
+	for (size_t i = 0; i < 1024; ++i)
+		UT_ASSERTeq((unsigned char)addr[16384 + i], 0xab);
+	for (size_t i = 1024; i < 1024 + 8192; ++i)
+		UT_ASSERTeq((unsigned char)addr[16384 + i], 0xcd);
+
+	pmem2_unmap(&map);
+
+	/* calibration must not change the content of the mapping */
+	ret = pmem2_config_set_movnt_threshold(cfg,
+		PMEM2_MOVNT_THRESHOLD_CALIBRATE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	map = map_valid(cfg, size);
+	UT_ASSERTne(pmem2_map_get_movnt_threshold(map), 0);
+	UT_ASSERTne(pmem2_map_get_movnt_threshold(map),
+		PMEM2_MOVNT_THRESHOLD_CALIBRATE);
+
+	addr = pmem2_map_get_address(map);
+	for (size_t i = 0; i < 1024; ++i)
+		UT_ASSERTeq((unsigned char)addr[16384 + i], 0xab);
+	for (size_t i = 1024; i < 1024 + 8192; ++i)
+		UT_ASSERTeq((unsigned char)addr[16384 + i], 0xcd);
+
+	pmem2_unmap(&map);
+
+	/* each distinct threshold takes a slot, equal ones share it */
+	struct pmem2_map *maps[16];
+	for (size_t i = 0; i < ARRAY_SIZE(maps); ++i) {
+		ret = pmem2_config_set_movnt_threshold(cfg, 256 * (i + 1));
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+		maps[i] = map_valid(cfg, size);
+	}
+	UT_ASSERTne(pmem2_get_memmove_fn(maps[0]),
+		pmem2_get_memmove_fn(maps[1]));
+
+	ret = pmem2_config_set_movnt_threshold(cfg, 256);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	map = map_valid(cfg, size);
+	UT_ASSERTeq(pmem2_get_memmove_fn(map), pmem2_get_memmove_fn(maps[0]));
+	pmem2_unmap(&map);
+
+	ret = pmem2_config_set_movnt_threshold(cfg, 100000);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_map(cfg, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_NOSUPP);
+
+	/* the slot is released on unmap */
+	pmem2_unmap(&maps[15]);
+	map = map_valid(cfg, size);
+	UT_ASSERTeq(pmem2_map_get_movnt_threshold(map), 100000);
+	pmem2_unmap(&map);
+
+	for (size_t i = 0; i < ARRAY_SIZE(maps) - 1; ++i)
+		pmem2_unmap(&maps[i]);
+
+	pmem2_config_delete(&cfg);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_async_flush -- flush and drain two mappings with background flushing
+ * enabled and unmap one of them while the other one is still in use
+ */
+static int
+test_async_flush(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_async_flush <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_config *cfg;
+	prepare_config(&cfg, fd, PMEM2_GRANULARITY_PAGE);
+
+	int ret = pmem2_config_set_async_flush(cfg, 1);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	size_t size;
+	UT_ASSERTeq(pmem2_config_get_file_size(cfg, &size), 0);
+
+	struct pmem2_map *map1 = map_valid(cfg, size);
+	struct pmem2_map *map2 = map_valid(cfg, size);
+
+	char *addr1 = pmem2_map_get_address(map1);
+	char *addr2 = pmem2_map_get_address(map2);
+	pmem2_flush_fn flush1 = pmem2_get_flush_fn(map1);
+	pmem2_flush_fn flush2 = pmem2_get_flush_fn(map2);
+	pmem2_drain_fn drain1 = pmem2_get_drain_fn(map1);
+
+	/* small, overlapping and scattered ranges */
+	size_t half = size / 2;
+	for (size_t i = 0; i < half; i += 1000) {
+		memset(addr1 + i, 0xab, 100);
+		flush1(addr1 + i, 100);
+		memset(addr2 + half + i, 0xcd, 100);
+		flush2(addr2 + half + i, 100);
+	}
+
+	/* map2 has to be synced before it is gone */
+	pmem2_unmap(&map2);
+
+	for (size_t i = 0; i < half; i += 4096) {
+		addr1[i] = 0x12;
+		flush1(addr1 + i, 1);
+	}
+	drain1();
+
+	for (size_t i = 0; i < half; i += 1000)
+		UT_ASSERTeq((unsigned char)addr1[half + i], 0xcd);
+
+	pmem2_unmap(&map1);
+
+	/* the content has to survive the worker thread restart */
+	ret = pmem2_config_set_async_flush(cfg, 0);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	map1 = map_valid(cfg, size);
+	addr1 = pmem2_map_get_address(map1);
+
+	for (size_t i = 0; i < half; i += 1000) {
+		unsigned char c = i % 4096 == 0 ? 0x12 : 0xab;
+		UT_ASSERTeq((unsigned char)addr1[i], c);
+		UT_ASSERTeq((unsigned char)addr1[half + i], 0xcd);
+	}
+
+	pmem2_unmap(&map1);
+	pmem2_config_delete(&cfg);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_memcpy_v -- copy scattered fragments with a single call for every
+ * granularity
+ */
+static int
+test_memcpy_v(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_memcpy_v <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	enum pmem2_granularity granularities[] = {
+		PMEM2_GRANULARITY_BYTE,
+		PMEM2_GRANULARITY_CACHE_LINE,
+		PMEM2_GRANULARITY_PAGE,
+	};
+
+	char src[256];
+	for (size_t i = 0; i < sizeof(src); ++i)
+		src[i] = (char)i;
+
+	for (size_t g = 0; g < ARRAY_SIZE(granularities); ++g) {
+		struct pmem2_config *cfg;
+		prepare_config(&cfg, fd, granularities[g]);
+
+		struct pmem2_map *map;
+		int ret = pmem2_map(cfg, &map);
+		if (ret == PMEM2_E_GRANULARITY_NOT_SUPPORTED) {
+			pmem2_config_delete(&cfg);
+			continue;
+		}
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+		char *addr = pmem2_map_get_address(map);
+		pmem2_memcpy_v_fn memcpy_v_fn = pmem2_get_memcpy_v_fn(map);
+
+		/* unaligned fragments of various lengths, one per page */
+		struct pmem2_vec vec[30];
+		for (size_t i = 0; i < ARRAY_SIZE(vec); ++i) {
+			vec[i].pmemdest = addr + i * 4096 + i;
+			vec[i].src = src + i;
+			vec[i].len = sizeof(src) - i * 7;
+		}
+
+		memset(addr, 0, ARRAY_SIZE(vec) * 4096);
+		memcpy_v_fn(vec, ARRAY_SIZE(vec), 0);
+		memcpy_v_fn(vec, 0, 0);
+
+		for (size_t i = 0; i < ARRAY_SIZE(vec); ++i) {
+			UT_ASSERTeq(memcmp(vec[i].pmemdest, vec[i].src,
+				vec[i].len), 0);
+			UT_ASSERTeq(addr[i * 4096 + i + vec[i].len], 0);
+		}
+
+		/* many fragments sharing pages, in reverse order */
+		struct pmem2_vec many[100];
+		for (size_t i = 0; i < ARRAY_SIZE(many); ++i) {
+			size_t off = (ARRAY_SIZE(many) - 1 - i) * 100;
+			many[i].pmemdest = addr + off;
+			many[i].src = src + i;
+			many[i].len = 100;
+		}
+
+		memcpy_v_fn(many, ARRAY_SIZE(many), 0);
+
+		for (size_t i = 0; i < ARRAY_SIZE(many); ++i)
+			UT_ASSERTeq(memcmp(many[i].pmemdest, many[i].src,
+				many[i].len), 0);
+
+		pmem2_unmap(&map);
+		pmem2_config_delete(&cfg);
+	}
+
+	CLOSE(fd);
+
+	return 1;
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -576,6 +836,9 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_len_aligned),
 	TEST_CASE(test_offset_not_aligned),
 	TEST_CASE(test_offset_aligned),
+	TEST_CASE(test_movnt_threshold),
+	TEST_CASE(test_async_flush),
+	TEST_CASE(test_memcpy_v),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
@@ -214,3 +214,9 @@ class TEST25(PMEM2_MAP):
     """map a file which size is not aligned"""
     test_case = "test_map_larger_than_unaligned_file_size"
     filesize = 16 * t.MiB - 1
+
+
+class TEST26(PMEM2_MAP):
+    """map a file with the page size policy and access hints"""
+    test_case = "test_map_page_size"
+    with_size = False
@@ -105,6 +105,7 @@ prepare_map(struct pmem2_map **map_ptr, struct pmem2_config *cfg)
 
 	map->reserved_length = map->content_length = cfg->length;
 	map->effective_granularity = PMEM2_GRANULARITY_PAGE;
+	map->reserv = NULL;
 
 	*map_ptr = map;
 
@@ -137,6 +138,7 @@ prepare_map(struct pmem2_map **map_ptr, struct pmem2_config *cfg)
 
 	map->reserved_length = map->content_length = cfg->length;
 	map->effective_granularity = PMEM2_GRANULARITY_PAGE;
+	map->reserv = NULL;
 
 	*map_ptr = map;
 
@@ -623,6 +625,57 @@ test_map_larger_than_unaligned_file_size(const struct test_case *tc, int argc,
 	return 2;
 }
 
+/*
+ * test_map_page_size -- map a file with the page size policy and access
+ * hints set and check the page size reported for the mapping
+ */
+static int
+test_map_page_size(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_map_page_size <file>");
+
+	char *file = argv[0];
+	struct pmem2_config cfg;
+	int fd;
+	prepare_config(&cfg, &fd, file, 0, 0, O_RDWR);
+
+	/* huge pages, the mapping is aligned accordingly */
+	int ret = pmem2_config_set_page_size(&cfg, 2 * MEGABYTE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_config_set_map_hints(&cfg,
+		PMEM2_MAP_HINT_POPULATE | PMEM2_MAP_HINT_SEQUENTIAL);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	struct pmem2_map *map;
+	ret = pmem2_map(&cfg, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+#ifndef _WIN32
+	UT_ASSERTeq((uintptr_t)pmem2_map_get_address(map) % (2 * MEGABYTE), 0);
+#endif
+	size_t page_size = pmem2_map_get_page_size(map);
+	UT_ASSERT(page_size == Ut_pagesize || page_size == 2 * MEGABYTE);
+	ret = pmem2_unmap(&map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	/* base pages only */
+	ret = pmem2_config_set_page_size(&cfg, Ut_pagesize);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_config_set_map_hints(&cfg,
+		PMEM2_MAP_HINT_WILLNEED | PMEM2_MAP_HINT_RANDOM);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_map(&cfg, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_map_get_page_size(map), Ut_pagesize);
+	ret = pmem2_unmap(&map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	CLOSE(fd);
+
+	return 1;
+}
+
 /*
  * test_cases -- available test cases
  */
@@ -644,6 +697,7 @@ static struct test_case test_cases[] = {
 	TEST_CASE(test_map_get_size),
 	TEST_CASE(test_get_granularity_simple),
 	TEST_CASE(test_map_larger_than_unaligned_file_size),
+	TEST_CASE(test_map_page_size),
 };
 
 #define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
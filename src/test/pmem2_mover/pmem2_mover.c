@@ -0,0 +1,217 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * pmem2_mover.c -- pmem2_mover unittests
+ */
+
+#include "unittest.h"
+#include "ut_pmem2_utils.h"
+
+#define NTHREADS 4
+#define NSMALL 100
+#define SMALL_SIZE 4000
+
+/*
+ * map_file -- map the whole file with the given granularity
+ */
+static struct pmem2_map *
+map_file(int fd, enum pmem2_granularity granularity)
+{
+	struct pmem2_config *cfg;
+	int ret = pmem2_config_new(&cfg);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_fd(cfg, fd);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_required_store_granularity(cfg, granularity);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	struct pmem2_map *map;
+	ret = pmem2_map(cfg, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	pmem2_config_delete(&cfg);
+
+	return map;
+}
+
+/*
+ * test_mover_memcpy -- copy a buffer split between all the threads and
+ * many small buffers at the same time
+ */
+static int
+test_mover_memcpy(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_mover_memcpy <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_map *map = map_file(fd, PMEM2_GRANULARITY_PAGE);
+	char *addr = pmem2_map_get_address(map);
+	size_t size = pmem2_map_get_size(map);
+	size_t half = size / 2;
+
+	struct pmem2_mover *mover;
+	int ret = pmem2_mover_new(&mover, map, NTHREADS);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	char *src = MALLOC(half);
+	for (size_t i = 0; i < half; ++i)
+		src[i] = (char)(i * 31 + 7);
+
+	/* the large copy is split into chunks, unaligned on purpose */
+	struct pmem2_future *large;
+	ret = pmem2_memcpy_async(mover, addr + 1, src, half - 1, 0, &large);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	struct pmem2_future *small[NSMALL];
+	for (size_t i = 0; i < NSMALL; ++i) {
+		ret = pmem2_memcpy_async(mover, addr + half + i * SMALL_SIZE,
+			src + i, SMALL_SIZE, PMEM2_F_MEM_NONTEMPORAL,
+			&small[i]);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+	}
+
+	/* an empty copy is completed right away */
+	struct pmem2_future *empty;
+	ret = pmem2_memcpy_async(mover, addr, src, 0, 0, &empty);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_future_poll(empty), 1);
+	ret = pmem2_future_wait(&empty);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(empty, NULL);
+
+	while (!pmem2_future_poll(large))
+		;
+	ret = pmem2_future_wait(&large);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(large, NULL);
+
+	for (size_t i = 0; i < NSMALL; ++i) {
+		ret = pmem2_future_wait(&small[i]);
+		UT_PMEM2_EXPECT_RETURN(ret, 0);
+	}
+
+	UT_ASSERTeq(memcmp(addr + 1, src, half - 1), 0);
+	for (size_t i = 0; i < NSMALL; ++i)
+		UT_ASSERTeq(memcmp(addr + half + i * SMALL_SIZE, src + i,
+			SMALL_SIZE), 0);
+
+	ret = pmem2_mover_delete(&mover);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(mover, NULL);
+
+	FREE(src);
+	pmem2_unmap(&map);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_mover_invalid -- create a mover without threads, copy outside
+ * of the mapping and with invalid flags and delete a busy mover
+ */
+static int
+test_mover_invalid(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_mover_invalid <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_map *map = map_file(fd, PMEM2_GRANULARITY_PAGE);
+	char *addr = pmem2_map_get_address(map);
+	size_t size = pmem2_map_get_size(map);
+
+	struct pmem2_mover *mover = (struct pmem2_mover *)0x1;
+	int ret = pmem2_mover_new(&mover, map, 0);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+	UT_ASSERTeq(mover, NULL);
+
+	ret = pmem2_mover_new(&mover, map, 1);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	char buf[2] = {0};
+	struct pmem2_future *future = (struct pmem2_future *)0x1;
+
+	ret = pmem2_memcpy_async(mover, addr - 1, buf, 2, 0, &future);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+	UT_ASSERTeq(future, NULL);
+
+	ret = pmem2_memcpy_async(mover, addr + size - 1, buf, 2, 0, &future);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+
+	ret = pmem2_memcpy_async(mover, addr, buf, 2,
+		PMEM2_F_MEM_VALID_FLAGS + 1, &future);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_INVALID_ARG);
+
+	/* the mover cannot be deleted before its futures are waited for */
+	ret = pmem2_memcpy_async(mover, addr, buf, 2, 0, &future);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_mover_delete(&mover);
+	UT_PMEM2_EXPECT_RETURN(ret, -EBUSY);
+	UT_ASSERTne(mover, NULL);
+
+	ret = pmem2_future_wait(&future);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = pmem2_mover_delete(&mover);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	pmem2_unmap(&map);
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_cases -- available test cases
+ */
+static struct test_case test_cases[] = {
+	TEST_CASE(test_mover_memcpy),
+	TEST_CASE(test_mover_invalid),
+};
+
+#define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "pmem2_mover");
+	TEST_CASE_PROCESS(argc, argv, test_cases, NTESTS);
+	DONE(NULL);
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * pmem2_vm_reservation.c -- pmem2_vm_reservation unittests
+ */
+
+#include "unittest.h"
+#include "ut_pmem2_utils.h"
+
+#define PART_SIZE ((size_t)4 << 20) /* 4 MiB */
+
+/*
+ * map_part -- map the given part of the file at the offset of
+ * the reservation
+ */
+static int
+map_part(int fd, size_t offset, struct pmem2_vm_reservation *rsv,
+	size_t rsv_offset, struct pmem2_map **map)
+{
+	struct pmem2_config *cfg;
+	int ret = pmem2_config_new(&cfg);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_fd(cfg, fd);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_required_store_granularity(cfg,
+		PMEM2_GRANULARITY_PAGE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_offset(cfg, offset);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_length(cfg, PART_SIZE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_config_set_vm_reservation(cfg, rsv, rsv_offset);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_map(cfg, map);
+
+	pmem2_config_delete(&cfg);
+
+	return ret;
+}
+
+/*
+ * test_vm_reserv_map -- map two parts of the file next to each other in
+ * reverse order, remap one of them and try to map over an occupied range
+ */
+static int
+test_vm_reserv_map(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_vm_reserv_map <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	struct pmem2_vm_reservation *rsv;
+	int ret = pmem2_vm_reservation_new(&rsv, NULL, 2 * PART_SIZE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	char *addr = pmem2_vm_reservation_get_address(rsv);
+	UT_ASSERTne(addr, NULL);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), 2 * PART_SIZE);
+
+	struct pmem2_map *first;
+	struct pmem2_map *second;
+	ret = map_part(fd, PART_SIZE, rsv, 0, &second);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = map_part(fd, 0, rsv, PART_SIZE, &first);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	UT_ASSERTeq(pmem2_map_get_address(second), addr);
+	UT_ASSERTeq(pmem2_map_get_address(first), addr + PART_SIZE);
+
+	pmem2_memset_fn memset_fn = pmem2_get_memset_fn(first);
+	memset_fn(addr, 0xA, 2 * PART_SIZE, 0);
+
+	/* the range is occupied by the first part */
+	struct pmem2_map *map;
+	ret = map_part(fd, 0, rsv, PART_SIZE, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_MAPPING_EXISTS);
+	ret = map_part(fd, 0, rsv, PART_SIZE / 2, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_MAPPING_EXISTS);
+
+	/* the range exceeds the reservation */
+	ret = map_part(fd, 0, rsv, 2 * PART_SIZE, &map);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_MAP_RANGE);
+
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_VM_RESERVATION_NOT_EMPTY);
+
+	/* the unmapped range can be used again */
+	ret = pmem2_unmap(&second);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	ret = map_part(fd, PART_SIZE, rsv, 0, &second);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_map_get_address(second), addr);
+
+	for (size_t i = 0; i < 2 * PART_SIZE; ++i)
+		UT_ASSERTeq(addr[i], 0xA);
+
+	pmem2_unmap(&first);
+	pmem2_unmap(&second);
+
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(rsv, NULL);
+
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_vm_reserv_extend -- extend the reservation and map the next part of
+ * the file without moving the first one
+ */
+static int
+test_vm_reserv_extend(const struct test_case *tc, int argc, char *argv[])
+{
+	if (argc < 1)
+		UT_FATAL("usage: test_vm_reserv_extend <file>");
+
+	char *file = argv[0];
+	int fd = OPEN(file, O_RDWR);
+
+	/*
+	 * The system usually places new mappings right below the existing
+	 * ones, so find a range with free space after it first.
+	 */
+	struct pmem2_vm_reservation *rsv;
+	int ret = pmem2_vm_reservation_new(&rsv, NULL, 2 * PART_SIZE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	char *addr = pmem2_vm_reservation_get_address(rsv);
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_vm_reservation_new(&rsv, addr, PART_SIZE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_vm_reservation_get_address(rsv), addr);
+
+	struct pmem2_map *first;
+	ret = map_part(fd, 0, rsv, 0, &first);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	struct pmem2_map *second;
+	ret = map_part(fd, PART_SIZE, rsv, PART_SIZE, &second);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_MAP_RANGE);
+
+	/* the address space after the reservation is taken by another one */
+	struct pmem2_vm_reservation *next;
+	ret = pmem2_vm_reservation_new(&next, addr + PART_SIZE, PART_SIZE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_vm_reservation_extend(rsv, PART_SIZE);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_MAPPING_EXISTS);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), PART_SIZE);
+
+	ret = pmem2_vm_reservation_delete(&next);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_vm_reservation_extend(rsv, PART_SIZE);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_vm_reservation_get_address(rsv), addr);
+	UT_ASSERTeq(pmem2_vm_reservation_get_size(rsv), 2 * PART_SIZE);
+
+	ret = map_part(fd, PART_SIZE, rsv, PART_SIZE, &second);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+	UT_ASSERTeq(pmem2_map_get_address(first), addr);
+	UT_ASSERTeq(pmem2_map_get_address(second), addr + PART_SIZE);
+
+	/* both parts are accessible as one contiguous range */
+	pmem2_memset_fn memset_fn = pmem2_get_memset_fn(first);
+	memset_fn(addr, 0xB, 2 * PART_SIZE, 0);
+	for (size_t i = 0; i < 2 * PART_SIZE; ++i)
+		UT_ASSERTeq(addr[i], 0xB);
+
+	pmem2_unmap(&first);
+	pmem2_unmap(&second);
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	CLOSE(fd);
+
+	return 1;
+}
+
+/*
+ * test_vm_reserv_invalid -- create reservations with unaligned arguments
+ */
+static int
+test_vm_reserv_invalid(const struct test_case *tc, int argc, char *argv[])
+{
+	struct pmem2_vm_reservation *rsv;
+
+	int ret = pmem2_vm_reservation_new(&rsv, NULL, 0);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_LENGTH_UNALIGNED);
+	UT_ASSERTeq(rsv, NULL);
+
+	ret = pmem2_vm_reservation_new(&rsv, NULL, Ut_mmap_align - 1);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_LENGTH_UNALIGNED);
+
+	ret = pmem2_vm_reservation_new(&rsv, (void *)(Ut_mmap_align + 1),
+		Ut_mmap_align);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_ADDRESS_UNALIGNED);
+
+	ret = pmem2_vm_reservation_new(&rsv, NULL, Ut_mmap_align);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	ret = pmem2_vm_reservation_extend(rsv, 1);
+	UT_PMEM2_EXPECT_RETURN(ret, PMEM2_E_LENGTH_UNALIGNED);
+
+	ret = pmem2_vm_reservation_delete(&rsv);
+	UT_PMEM2_EXPECT_RETURN(ret, 0);
+
+	return 0;
+}
+
+/*
+ * test_cases -- available test cases
+ */
+static struct test_case test_cases[] = {
+	TEST_CASE(test_vm_reserv_map),
+	TEST_CASE(test_vm_reserv_extend),
+	TEST_CASE(test_vm_reserv_invalid),
+};
+
+#define NTESTS (sizeof(test_cases) / sizeof(test_cases[0]))
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "pmem2_vm_reservation");
+	TEST_CASE_PROCESS(argc, argv, test_cases, NTESTS);
+	DONE(NULL);
+}
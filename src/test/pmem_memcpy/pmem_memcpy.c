@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2019, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -60,6 +60,48 @@ pmem_memcpy_nodrain_wrapper(void *pmemdest, const void *src, size_t len,
 	return pmem_memcpy_nodrain(pmemdest, src, len);
 }
 
+/*
+ * split_vec -- split the copy into three segments of different lengths
+ */
+static size_t
+split_vec(struct pmem_vec *vec, void *pmemdest, const void *src, size_t len)
+{
+	size_t lens[3] = {len / 8, len / 2, len - len / 8 - len / 2};
+	size_t off = 0;
+
+	for (int i = 0; i < 3; ++i) {
+		vec[i].pmemdest = (char *)pmemdest + off;
+		vec[i].src = (const char *)src + off;
+		vec[i].len = lens[i];
+		off += lens[i];
+	}
+
+	return 3;
+}
+
+static void *
+pmem_memcpy_v_wrapper(void *pmemdest, const void *src, size_t len,
+		unsigned flags)
+{
+	struct pmem_vec vec[3];
+	size_t vcnt = split_vec(vec, pmemdest, src, len);
+
+	pmem_memcpy_v(vec, vcnt, flags);
+	return pmemdest;
+}
+
+static void *
+pmem_memcpy_persist_v_wrapper(void *pmemdest, const void *src, size_t len,
+		unsigned flags)
+{
+	(void) flags;
+	struct pmem_vec vec[3];
+	size_t vcnt = split_vec(vec, pmemdest, src, len);
+
+	pmem_memcpy_persist_v(vec, vcnt);
+	return pmemdest;
+}
+
 /*
  * swap_mappings - given to mmapped regions swap them.
  *
@@ -179,9 +221,14 @@ do_memcpy_variants(int fd, char *dest, int dest_off, char *src, int src_off,
 	do_memcpy(fd, dest, dest_off, src, src_off, bytes, file_name,
 			pmem_memcpy_nodrain_wrapper, 0);
 
+	do_memcpy(fd, dest, dest_off, src, src_off, bytes, file_name,
+			pmem_memcpy_persist_v_wrapper, 0);
+
 	for (int i = 0; i < ARRAY_SIZE(Flags); ++i) {
 		do_memcpy(fd, dest, dest_off, src, src_off, bytes, file_name,
 				pmem_memcpy, Flags[i]);
+		do_memcpy(fd, dest, dest_off, src, src_off, bytes, file_name,
+				pmem_memcpy_v_wrapper, Flags[i]);
 	}
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2015-2019, Intel Corporation
+ * Copyright 2015-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -33,12 +33,13 @@
 /*
  * pmem_movnt_align.c -- unit test for functions with non-temporal stores
  *
- * usage: pmem_movnt_align [C|F|B|S]
+ * usage: pmem_movnt_align [C|F|B|S|X]
  *
  * C - pmem_memcpy_persist()
  * B - pmem_memmove_persist() in backward direction
  * F - pmem_memmove_persist() in forward direction
  * S - pmem_memset_persist()
+ * X - all of the above around XPLine boundaries
  */
 
 #include <stdio.h>
@@ -49,6 +50,7 @@
 #include "unittest.h"
 
 #define CACHELINE 64
+#define XPLINE 256
 #define N_BYTES (Ut_pagesize * 2)
 
 typedef void *(*mem_fn)(void *, const void *, size_t);
@@ -218,6 +220,52 @@ check_memset_variants(size_t off, size_t len)
 		check_memset(off, len, pmem_memset, Flags[i]);
 }
 
+/*
+ * check_memmove_overlap -- move the range within one patterned buffer and
+ * compare the result with memmove from libc
+ */
+static void
+check_memmove_overlap(size_t doff, size_t soff, size_t len,
+		pmem_memmove_fn fn, unsigned flags)
+{
+	for (size_t i = 0; i < N_BYTES; ++i)
+		Dst[i] = (char)(i * 7 + 3);
+	memcpy(Scratch, Dst, N_BYTES);
+
+	memmove(Scratch + doff, Scratch + soff, len);
+	fn(Dst + doff, Dst + soff, len, flags);
+
+	if (memcmp(Dst, Scratch, N_BYTES))
+		UT_FATAL("memmove failed");
+}
+
+static void
+check_memmove_overlap_variants(size_t doff, size_t soff, size_t len)
+{
+	check_memmove_overlap(doff, soff, len, pmem_memmove_persist_wrapper,
+		0);
+	if (!Heavy)
+		return;
+
+	for (int i = 0; i < ARRAY_SIZE(Flags); ++i)
+		check_memmove_overlap(doff, soff, len, pmem_memmove, Flags[i]);
+}
+
+/*
+ * Lengths around the points at which non-temporal kernels start aligning
+ * the destination to XPLines, enter the main loop and write the tail.
+ */
+static const size_t Xpline_lens[] = {
+	XPLINE - 1,
+	XPLINE,
+	2 * XPLINE - 1,
+	2 * XPLINE,
+	2 * XPLINE + CACHELINE + 1,
+	32 * CACHELINE - 1,
+	32 * CACHELINE,
+	32 * CACHELINE + 3 * XPLINE + CACHELINE - 1,
+};
+
 int
 main(int argc, char *argv[])
 {
@@ -348,6 +396,33 @@ main(int argc, char *argv[])
 		MUNMAP_ANON_ALIGNED(Dst, N_BYTES);
 		FREE(Scratch);
 
+		break;
+	case 'X': /* XPLine alignment */
+		Src = MMAP_ANON_ALIGNED(N_BYTES, 0);
+		Dst = MMAP_ANON_ALIGNED(N_BYTES, 0);
+		if (Src == NULL || Dst == NULL)
+			UT_FATAL("!mmap");
+
+		Scratch = MALLOC(N_BYTES);
+
+		/* destinations at every 16 bytes of an XPLine */
+		for (s = 0; s < XPLINE; s += 16) {
+			for (int i = 0; i < ARRAY_SIZE(Xpline_lens); ++i) {
+				size_t len = Xpline_lens[i];
+
+				check_memcpy_variants(s, 0, len);
+				check_memset_variants(s, len);
+
+				/* overlapping, backward and forward */
+				check_memmove_overlap_variants(s + 96, s, len);
+				check_memmove_overlap_variants(s, s + 96, len);
+			}
+		}
+
+		MUNMAP_ANON_ALIGNED(Src, N_BYTES);
+		MUNMAP_ANON_ALIGNED(Dst, N_BYTES);
+		FREE(Scratch);
+
 		break;
 	default:
 		UT_FATAL("!wrong type of test");
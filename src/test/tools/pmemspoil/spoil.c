@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -1194,6 +1194,31 @@ pmemspoil_process_heap(struct pmemspoil *psp, struct pmemspoil_list *pfp,
 	return PROCESS_RET;
 }
 
+/*
+ * PMEMSPOIL_PROCESS_ULOG -- defines the function processing the ulog _name
+ * of a lane
+ */
+#define PMEMSPOIL_PROCESS_ULOG(_name, _size)\
+static int \
+pmemspoil_process_##_name(struct pmemspoil *psp, struct pmemspoil_list *pfp,\
+		struct lane_layout *lane)\
+{\
+	PROCESS_BEGIN(psp, pfp) {\
+		PROCESS_FIELD(&lane->_name, checksum, uint64_t);\
+		PROCESS_FIELD(&lane->_name, next, uint64_t);\
+		PROCESS_FIELD(&lane->_name, capacity, uint64_t);\
+		PROCESS_FIELD(&lane->_name, gen_num, uint64_t);\
+		PROCESS_FIELD(&lane->_name, flags, uint64_t);\
+		PROCESS_FIELD_ARRAY(&lane->_name, data, uint8_t, _size);\
+	} PROCESS_END\
+\
+	return PROCESS_RET;\
+}
+
+PMEMSPOIL_PROCESS_ULOG(undo, LANE_UNDO_SIZE)
+PMEMSPOIL_PROCESS_ULOG(internal, LANE_REDO_INTERNAL_SIZE)
+PMEMSPOIL_PROCESS_ULOG(external, LANE_REDO_EXTERNAL_SIZE)
+
 /*
  * pmemspoil_process_lane -- process pmemobj lanes
  */
@@ -1202,12 +1227,9 @@ pmemspoil_process_lane(struct pmemspoil *psp, struct pmemspoil_list *pfp,
 		struct lane_layout *lane)
 {
 	PROCESS_BEGIN(psp, pfp) {
-		PROCESS_FIELD_ARRAY(lane, undo.data,
-			uint8_t, LANE_UNDO_SIZE);
-		PROCESS_FIELD_ARRAY(lane, internal.data,
-			uint8_t, LANE_REDO_INTERNAL_SIZE);
-		PROCESS_FIELD_ARRAY(lane, external.data,
-			uint8_t, LANE_REDO_EXTERNAL_SIZE);
+		PROCESS(undo, lane, 1, struct lane_layout *);
+		PROCESS(internal, lane, 1, struct lane_layout *);
+		PROCESS(external, lane, 1, struct lane_layout *);
 	} PROCESS_END
 
 	return PROCESS_RET;
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * util_badblock_cache.c -- unit test for caching the devices found to
+ *                          contain no bad blocks
+ *
+ * usage: util_badblock_cache poolset
+ */
+
+#include "unittest.h"
+#include "pmemcommon.h"
+#include "set.h"
+#include "badblock.h"
+#include "os_badblock.h"
+#include "os_dimm.h"
+
+#define LOG_PREFIX "ut"
+#define LOG_LEVEL_VAR "TEST_LOG_LEVEL"
+#define LOG_FILE_VAR "TEST_LOG_FILE"
+#define MAJOR_VERSION 1
+#define MINOR_VERSION 0
+
+static uint64_t Usc;		/* unsafe shutdown count of the device */
+static unsigned Nbadblocks;	/* number of bad blocks of the device */
+static unsigned Nprobes;	/* number of times the device was probed */
+
+/*
+ * check_poolset -- checks the pool set for bad blocks and verifies
+ *                  the number of times the device was probed so far
+ */
+static void
+check_poolset(struct pool_set *set, int expected, unsigned nprobes)
+{
+	UT_ASSERTeq(badblocks_check_poolset(set, 0), expected);
+	UT_ASSERTeq(Nprobes, nprobes);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "util_badblock_cache");
+
+	common_init(LOG_PREFIX, LOG_LEVEL_VAR, LOG_FILE_VAR,
+		MAJOR_VERSION, MINOR_VERSION);
+
+	if (argc != 2)
+		UT_FATAL("usage: %s poolset", argv[0]);
+
+	struct pool_set *set;
+	if (util_poolset_create_set(&set, argv[1], 0, 0, 1))
+		UT_FATAL("!util_poolset_create_set: %s", argv[1]);
+
+	/* all the parts are on one device, which is probed once */
+	check_poolset(set, 0, 1);
+
+	/* the device is found in the cache */
+	check_poolset(set, 0, 1);
+
+	/* a new bad block does not change the unsafe shutdown count */
+	Nbadblocks = 1;
+	check_poolset(set, 1, 2);
+
+	/* the device with bad blocks is not cached */
+	check_poolset(set, 1, 3);
+
+	UT_ASSERTeq(badblocks_clear_poolset(set, 0), 0);
+	UT_ASSERTeq(Nbadblocks, 0);
+	check_poolset(set, 0, 4);
+	check_poolset(set, 0, 4);
+
+	/* a new unsafe shutdown count invalidates the cached device */
+	Usc++;
+	check_poolset(set, 0, 5);
+	check_poolset(set, 0, 5);
+
+	/* clearing bad blocks drops the cached devices */
+	UT_ASSERTeq(badblocks_clear_poolset(set, 0), 0);
+	check_poolset(set, 0, 6);
+
+	util_poolset_free(set);
+
+	common_fini();
+	DONE(NULL);
+}
+
+FUNC_MOCK(os_dimm_usc, int, const char *path, uint64_t *usc)
+FUNC_MOCK_RUN_DEFAULT {
+	*usc = Usc;
+	return 0;
+}
+FUNC_MOCK_END
+
+FUNC_MOCK(os_dimm_files_namespace_badblocks, int, const char *path,
+	struct badblocks *bbs)
+FUNC_MOCK_RUN_DEFAULT {
+	util_fetch_and_add32(&Nprobes, 1);
+	/* only the number of bad blocks is checked */
+	bbs->bb_cnt = Nbadblocks;
+	return 0;
+}
+FUNC_MOCK_END
+
+FUNC_MOCK(os_dimm_badblocks_empty, int, const char *path)
+FUNC_MOCK_RUN_DEFAULT {
+	return Nbadblocks == 0;
+}
+FUNC_MOCK_END
+
+FUNC_MOCK(os_badblocks_check_file, int, const char *path)
+FUNC_MOCK_RUN_DEFAULT {
+	return Nbadblocks != 0;
+}
+FUNC_MOCK_END
+
+FUNC_MOCK(os_badblocks_clear_all, int, const char *path)
+FUNC_MOCK_RUN_DEFAULT {
+	Nbadblocks = 0;
+	return 0;
+}
+FUNC_MOCK_END
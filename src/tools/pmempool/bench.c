@@ -0,0 +1,895 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * bench.c -- pmempool bench command source file
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <errno.h>
+#include <err.h>
+#include "common.h"
+#include "file.h"
+#include "output.h"
+#include "bench.h"
+#include "os.h"
+#include "os_thread.h"
+#include "rand.h"
+#include "set.h"
+#include "util.h"
+#include "libpmem.h"
+
+#define BENCH_DEFAULT_SIZE	(1ULL << 30)
+#define BENCH_MIN_SIZE		(1ULL << 24)
+#define BENCH_MIN_BSIZE		((size_t)64)
+#define BENCH_MAX_BSIZE		((size_t)1 << 20)
+#define BENCH_SCALING_BSIZE	((size_t)4096)
+#define BENCH_CACHELINE		((size_t)64)
+
+/* maximal number of operations of a single thread in one run */
+#define BENCH_MAX_OPS		((size_t)1 << 16)
+/* maximal number of cache lines in the pointer chase */
+#define BENCH_MAX_LINES		((size_t)1 << 20)
+/* minimal size of the buffer which evicts the pointer chase from caches */
+#define BENCH_EVICT_SIZE	((size_t)1 << 28)
+
+#define BENCH_MAX_THREADS	1024
+#define BENCH_MAX_NODES		64
+#define BENCH_PATH_MAX		64
+#define BENCH_NBSIZES		15	/* 64 B - 1 MiB */
+
+/* part of the peak bandwidth at which the media is considered saturated */
+#define BENCH_SATURATION	0.9
+
+#define MEBIBYTE		(1024.0 * 1024.0)
+#define NSEC_IN_SEC		1000000000ULL
+
+/*
+ * bench_op -- operations performed by the benchmark threads
+ */
+enum bench_op {
+	BENCH_OP_WRITE,
+	BENCH_OP_READ,
+	BENCH_OP_CHASE,
+};
+
+/*
+ * bench_mode -- kinds of stores used by the write operation
+ */
+enum bench_mode {
+	BENCH_TEMPORAL,
+	BENCH_NONTEMPORAL,
+
+	MAX_BENCH_MODE
+};
+
+/*
+ * pmempool_bench_context -- context and arguments for bench command
+ */
+struct pmempool_bench_context {
+	char *fname;		/* a path to the benchmarked file */
+	size_t size;		/* size of the benchmarked region */
+	unsigned nthreads;	/* maximal number of threads */
+	int force;		/* run on a file which contains a pool */
+
+	char *addr;		/* the mapping of the file */
+	size_t mapped_len;
+	int is_pmem;
+	int created;		/* the file was created by the command */
+
+	uint64_t chase_start;	/* offset of the first pointer to chase */
+	size_t nlines;		/* number of pointers to chase */
+
+	os_mutex_t lock;	/* protects go */
+	os_cond_t cond;
+	int go;			/* all the threads of a run may start */
+};
+
+/*
+ * bench_thread -- a single thread of a benchmark run
+ */
+struct bench_thread {
+	struct pmempool_bench_context *ctx;
+	os_thread_t thread;
+	enum bench_op op;
+	enum bench_mode mode;
+	char *addr;		/* the region of the thread */
+	size_t bsize;		/* size of a single operation */
+	size_t nops;		/* number of operations to perform */
+	int cpu;		/* the CPU to run on, -1 for any */
+	uint64_t nsecs;		/* duration of the run */
+	uint64_t sink;		/* keeps the loaded data alive */
+};
+
+/*
+ * bench_result -- results of a benchmark run
+ */
+struct bench_result {
+	double bw;		/* MiB/s of all the threads together */
+	double lat;		/* ns per operation of a single thread */
+};
+
+/*
+ * pmempool_bench_default -- default arguments for bench command
+ */
+static const struct pmempool_bench_context pmempool_bench_default = {
+	.fname		= NULL,
+	.size		= 0,
+	.nthreads	= 0,
+	.force		= 0,
+};
+
+/*
+ * Environment variables which change the code paths of libpmem
+ */
+static const char * const bench_env[] = {
+	"PMEM_NO_CLWB",
+	"PMEM_NO_CLFLUSHOPT",
+	"PMEM_NO_FLUSH",
+	"PMEM_NO_MOVNT",
+	"PMEM_MOVNT_THRESHOLD",
+	"PMEM_NO_GENERIC_MEMCPY",
+	"PMEM_AVX",
+	"PMEM_AVX512F",
+	"PMEM_IS_PMEM_FORCE",
+};
+
+/*
+ * help_str -- string for help message
+ */
+static const char * const help_str =
+"Measure the performance of the media a file is located on\n"
+"\n"
+"The contents of the file are destroyed.\n"
+"\n"
+"Common options:\n"
+"  -s, --size <size>    size of the benchmarked region, the size of the\n"
+"                       file to create if it does not exist\n"
+"  -t, --threads <num>  maximal number of threads\n"
+"  -f, --force          run even if the file contains a pool\n"
+"  -v, --verbose        increase verbosity level\n"
+"  -h, --help           display this help and exit\n"
+"\n"
+"For complete documentation see %s-bench(1) manual page.\n"
+;
+
+/*
+ * long_options -- command line options
+ */
+static const struct option long_options[] = {
+	{"size",	required_argument,	NULL,	's'},
+	{"threads",	required_argument,	NULL,	't'},
+	{"force",	no_argument,		NULL,	'f'},
+	{"help",	no_argument,		NULL,	'h'},
+	{"verbose",	no_argument,		NULL,	'v'},
+	{NULL,		0,			NULL,	 0 },
+};
+
+/*
+ * print_usage -- print application usage short description
+ */
+static void
+print_usage(const char *appname)
+{
+	printf("usage: %s bench [<options>] <file>\n", appname);
+}
+
+/*
+ * print_version -- print version string
+ */
+static void
+print_version(const char *appname)
+{
+	printf("%s %s\n", appname, SRCVERSION);
+}
+
+/*
+ * pmempool_bench_help -- print help message for the bench command
+ */
+void
+pmempool_bench_help(const char *appname)
+{
+	print_usage(appname);
+	print_version(appname);
+	printf(help_str, appname);
+}
+
+/*
+ * pmempool_bench_parse_args -- parse command line arguments
+ */
+static int
+pmempool_bench_parse_args(struct pmempool_bench_context *ctx,
+		const char *appname, int argc, char *argv[])
+{
+	int opt;
+	long long nthreads;
+	while ((opt = getopt_long(argc, argv, "s:t:fhv",
+			long_options, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			if (util_parse_size(optarg, &ctx->size) ||
+					ctx->size < BENCH_MIN_SIZE) {
+				outv_err("invalid size specified '%s', "
+					"the minimum is %s\n", optarg,
+					out_get_size_str(BENCH_MIN_SIZE, 1));
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			nthreads = atoll(optarg);
+			if (nthreads <= 0 || nthreads > BENCH_MAX_THREADS) {
+				outv_err("invalid number of threads specified "
+					"'%s'\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			ctx->nthreads = (unsigned)nthreads;
+			break;
+		case 'f':
+			ctx->force = 1;
+			break;
+		case 'h':
+			pmempool_bench_help(appname);
+			exit(EXIT_SUCCESS);
+		case 'v':
+			out_set_vlevel(1);
+			break;
+		default:
+			print_usage(appname);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind < argc) {
+		ctx->fname = argv[optind];
+	} else {
+		print_usage(appname);
+		exit(EXIT_FAILURE);
+	}
+
+	if (ctx->nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		ctx->nthreads = ncpus > 0 ? (unsigned)ncpus : 1;
+		if (ctx->nthreads > BENCH_MAX_THREADS)
+			ctx->nthreads = BENCH_MAX_THREADS;
+	}
+
+	return 0;
+}
+
+/*
+ * bench_nsecs -- (internal) current time in nanoseconds
+ */
+static uint64_t
+bench_nsecs(void)
+{
+	struct timespec ts;
+	os_clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_IN_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * bench_write -- (internal) copy the buffer to the file and persist it
+ *
+ * The data is flushed with msync if the file is not persistent memory,
+ * the way the libraries do it for the page granularity.
+ */
+static void
+bench_write(struct pmempool_bench_context *ctx, void *dst, const void *src,
+		size_t len, enum bench_mode mode)
+{
+	unsigned flags = mode == BENCH_NONTEMPORAL ?
+			PMEM_F_MEM_NONTEMPORAL : PMEM_F_MEM_TEMPORAL;
+
+	if (ctx->is_pmem) {
+		pmem_memcpy(dst, src, len, flags);
+	} else {
+		pmem_memcpy(dst, src, len, flags | PMEM_F_MEM_NOFLUSH);
+		pmem_msync(dst, len);
+	}
+}
+
+/*
+ * bench_worker -- (internal) perform the operations of a single thread
+ */
+static void *
+bench_worker(void *arg)
+{
+	struct bench_thread *bt = arg;
+	struct pmempool_bench_context *ctx = bt->ctx;
+
+	char *buf = NULL;
+	if (bt->op != BENCH_OP_CHASE) {
+		buf = malloc(bt->bsize);
+		if (buf == NULL)
+			err(1, "Cannot allocate memory for bench buffer");
+		memset(buf, 0xc5, bt->bsize);
+	}
+
+	/* wait until all the threads are created and bound to their CPUs */
+	os_mutex_lock(&ctx->lock);
+	while (!ctx->go)
+		os_cond_wait(&ctx->cond, &ctx->lock);
+	os_mutex_unlock(&ctx->lock);
+
+	uint64_t start = bench_nsecs();
+
+	switch (bt->op) {
+	case BENCH_OP_WRITE:
+		for (size_t i = 0; i < bt->nops; i++)
+			bench_write(ctx, bt->addr + i * bt->bsize, buf,
+				bt->bsize, bt->mode);
+		break;
+	case BENCH_OP_READ:
+		for (size_t i = 0; i < bt->nops; i++) {
+			memcpy(buf, bt->addr + i * bt->bsize, bt->bsize);
+			bt->sink += (uint64_t)buf[0];
+		}
+		break;
+	case BENCH_OP_CHASE: {
+		uint64_t off = ctx->chase_start;
+		for (size_t i = 0; i < bt->nops; i++)
+			off = *(volatile uint64_t *)(bt->addr + off);
+		bt->sink = off;
+		break;
+	}
+	default:
+		assert(0);
+	}
+
+	bt->nsecs = bench_nsecs() - start;
+
+	free(buf);
+
+	return NULL;
+}
+
+/*
+ * bench_run -- (internal) run the threads and sum up the results
+ */
+static struct bench_result
+bench_run(struct pmempool_bench_context *ctx, struct bench_thread *threads,
+		unsigned nthreads)
+{
+	ctx->go = 0;
+
+	for (unsigned t = 0; t < nthreads; t++) {
+		if (os_thread_create(&threads[t].thread, NULL,
+				bench_worker, &threads[t]))
+			err(1, "Cannot create bench thread");
+	}
+
+	for (unsigned t = 0; t < nthreads; t++) {
+		if (threads[t].cpu < 0)
+			continue;
+
+		os_cpu_set_t set;
+		memset(&set, 0, sizeof(set));
+		os_cpu_zero(&set);
+		os_cpu_set((size_t)threads[t].cpu, &set);
+		if (os_thread_setaffinity_np(&threads[t].thread, sizeof(set),
+				&set))
+			outv(1, "cannot bind thread to CPU %d\n",
+				threads[t].cpu);
+	}
+
+	os_mutex_lock(&ctx->lock);
+	ctx->go = 1;
+	os_cond_broadcast(&ctx->cond);
+	os_mutex_unlock(&ctx->lock);
+
+	uint64_t nsecs = 1;
+	uint64_t nsecs_sum = 0;
+	size_t nops = 0;
+	double bytes = 0;
+	for (unsigned t = 0; t < nthreads; t++) {
+		os_thread_join(&threads[t].thread, NULL);
+
+		if (threads[t].nsecs > nsecs)
+			nsecs = threads[t].nsecs;
+		nsecs_sum += threads[t].nsecs;
+		nops += threads[t].nops;
+		bytes += (double)threads[t].nops * (double)threads[t].bsize;
+	}
+
+	struct bench_result res;
+	res.bw = bytes / MEBIBYTE / ((double)nsecs / (double)NSEC_IN_SEC);
+	res.lat = nops ? (double)nsecs_sum / (double)nops : 0;
+
+	return res;
+}
+
+/*
+ * bench_io -- (internal) measure writes or reads of blocks of the given
+ *	size, each thread works on its own slice of the region
+ */
+static struct bench_result
+bench_io(struct pmempool_bench_context *ctx, enum bench_op op,
+		enum bench_mode mode, size_t bsize, unsigned nthreads,
+		int cpu)
+{
+	struct bench_thread *threads = calloc(nthreads, sizeof(*threads));
+	if (threads == NULL)
+		err(1, "Cannot allocate memory for threads");
+
+	size_t slice = ALIGN_DOWN(ctx->size / nthreads, bsize);
+	size_t nops = slice / bsize;
+	if (nops > BENCH_MAX_OPS)
+		nops = BENCH_MAX_OPS;
+
+	for (unsigned t = 0; t < nthreads; t++) {
+		threads[t].ctx = ctx;
+		threads[t].op = op;
+		threads[t].mode = mode;
+		threads[t].addr = ctx->addr + t * slice;
+		threads[t].bsize = bsize;
+		threads[t].nops = nops;
+		threads[t].cpu = cpu;
+	}
+
+	struct bench_result res = bench_run(ctx, threads, nthreads);
+
+	free(threads);
+
+	return res;
+}
+
+/*
+ * bench_evict -- (internal) evict the lines of the file from the caches of
+ *	the current CPU
+ *
+ * The lines are replaced by the lines of a buffer several times larger
+ * than the last level cache. Each line of the buffer is modified, so it is
+ * not written with non-temporal stores the way memset may do it.
+ */
+static void
+bench_evict(void)
+{
+	size_t size = BENCH_EVICT_SIZE;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (llc > 0 && 4 * (size_t)llc > size)
+		size = 4 * (size_t)llc;
+#endif
+
+	volatile char *buf = malloc(size);
+	if (buf == NULL)
+		err(1, "Cannot allocate memory for cache eviction");
+
+	for (size_t i = 0; i < size; i += BENCH_CACHELINE)
+		buf[i] = (char)i;
+
+	free((void *)buf);
+}
+
+/*
+ * bench_chase_init -- (internal) write a random cycle of pointers over
+ *	the cache lines spread across the region
+ *
+ * Each load of the chase depends on the previous one, so the time of
+ * a single step is the latency of a random read. The pointers are persisted
+ * and evicted from the caches, so that the loads reach the media.
+ */
+static void
+bench_chase_init(struct pmempool_bench_context *ctx)
+{
+	size_t nlines = ctx->size / BENCH_CACHELINE;
+	if (nlines > BENCH_MAX_LINES)
+		nlines = BENCH_MAX_LINES;
+	size_t stride = ALIGN_DOWN(ctx->size / nlines, BENCH_CACHELINE);
+
+	uint64_t *perm = malloc(nlines * sizeof(*perm));
+	if (perm == NULL)
+		err(1, "Cannot allocate memory for pointer chase");
+
+	for (size_t i = 0; i < nlines; i++)
+		perm[i] = i;
+
+	rng_t rng;
+	randomize_r(&rng, 1);
+	for (size_t i = nlines - 1; i > 0; i--) {
+		size_t j = (size_t)(rnd64_r(&rng) % (i + 1));
+		uint64_t tmp = perm[i];
+		perm[i] = perm[j];
+		perm[j] = tmp;
+	}
+
+	for (size_t i = 0; i < nlines; i++) {
+		uint64_t *ptr = (uint64_t *)(ctx->addr + perm[i] * stride);
+		*ptr = perm[(i + 1) % nlines] * stride;
+		if (ctx->is_pmem)
+			pmem_flush(ptr, sizeof(*ptr));
+	}
+
+	if (ctx->is_pmem)
+		pmem_drain();
+	else
+		pmem_msync(ctx->addr, ctx->size);
+
+	/* CLWB may leave the flushed lines in the caches */
+	bench_evict();
+
+	ctx->chase_start = perm[0] * stride;
+	ctx->nlines = nlines;
+
+	free(perm);
+}
+
+/*
+ * bench_latency -- (internal) measure the latency of random reads
+ */
+static double
+bench_latency(struct pmempool_bench_context *ctx, int cpu)
+{
+	bench_chase_init(ctx);
+
+	struct bench_thread bt;
+	memset(&bt, 0, sizeof(bt));
+	bt.ctx = ctx;
+	bt.op = BENCH_OP_CHASE;
+	bt.addr = ctx->addr;
+	bt.bsize = BENCH_CACHELINE;
+	bt.nops = ctx->nlines;
+	bt.cpu = cpu;
+
+	return bench_run(ctx, &bt, 1).lat;
+}
+
+/*
+ * bench_numa_cpus -- (internal) find the first CPU of each NUMA node
+ *
+ * Returns the number of the nodes with any CPU, 0 if the topology is not
+ * available.
+ */
+static unsigned
+bench_numa_cpus(int *cpus, int *nodes)
+{
+	unsigned n = 0;
+	for (int node = 0; node < BENCH_MAX_NODES; node++) {
+		char path[BENCH_PATH_MAX];
+		snprintf(path, sizeof(path),
+			"/sys/devices/system/node/node%d/cpulist", node);
+
+		FILE *f = os_fopen(path, "r");
+		if (f == NULL)
+			continue;
+
+		int cpu;
+		if (fscanf(f, "%d", &cpu) == 1) {
+			cpus[n] = cpu;
+			nodes[n] = node;
+			n++;
+		}
+
+		fclose(f);
+	}
+
+	return n;
+}
+
+/*
+ * bench_granularity -- (internal) the store granularity of the mapping,
+ *	determined the same way libpmem2 does it
+ */
+static const char *
+bench_granularity(struct pmempool_bench_context *ctx)
+{
+	if (!ctx->is_pmem)
+		return "page";
+	if (pmem_has_auto_flush() == 1)
+		return "byte";
+
+	return "cache line";
+}
+
+/*
+ * bench_print_info -- (internal) print the benchmarked file and setup
+ */
+static void
+bench_print_info(struct pmempool_bench_context *ctx)
+{
+	printf("File:                %s\n", ctx->fname);
+	printf("Benchmarked size:    %s\n", out_get_size_str(ctx->size, 2));
+	printf("Store granularity:   %s\n", bench_granularity(ctx));
+	printf("Threads:             %u\n", ctx->nthreads);
+
+	int nenv = 0;
+	for (size_t i = 0; i < ARRAY_SIZE(bench_env); i++) {
+		char *val = os_getenv(bench_env[i]);
+		if (val == NULL)
+			continue;
+		printf("%s %s=%s\n", nenv ? "                    " :
+			"Environment:        ", bench_env[i], val);
+		nenv++;
+	}
+	if (nenv == 0)
+		printf("Environment:         -\n");
+}
+
+/*
+ * bench_movnt_threshold -- (internal) the smallest block size from which
+ *	the non-temporal stores are never slower than the temporal ones,
+ *	0 if the temporal stores are faster for the largest block
+ */
+static size_t
+bench_movnt_threshold(struct bench_result res[][MAX_BENCH_MODE],
+		const size_t *bsizes, unsigned nbsizes)
+{
+	size_t threshold = 0;
+	for (unsigned i = nbsizes; i > 0; i--) {
+		if (res[i - 1][BENCH_NONTEMPORAL].bw <
+				res[i - 1][BENCH_TEMPORAL].bw)
+			break;
+		threshold = bsizes[i - 1];
+	}
+
+	return threshold;
+}
+
+/*
+ * bench_next_nthreads -- (internal) the next number of threads of the
+ *	scaling runs - the powers of two and the maximum
+ */
+static unsigned
+bench_next_nthreads(unsigned n, unsigned max)
+{
+	if (n < max && n * 2 > max)
+		return max;
+
+	return n * 2;
+}
+
+/*
+ * bench_all -- (internal) run all the benchmarks and print the results
+ */
+static void
+bench_all(struct pmempool_bench_context *ctx)
+{
+	bench_print_info(ctx);
+
+	size_t bsizes[BENCH_NBSIZES];
+	struct bench_result wres[BENCH_NBSIZES][MAX_BENCH_MODE];
+	unsigned nbsizes = 0;
+	for (size_t bs = BENCH_MIN_BSIZE;
+			bs <= BENCH_MAX_BSIZE && bs <= ctx->size; bs *= 2)
+		bsizes[nbsizes++] = bs;
+
+	printf("\nPersistent writes, 1 thread:\n");
+	printf("%12s %29s %29s\n", "block size", "temporal",
+		"non-temporal");
+	for (unsigned i = 0; i < nbsizes; i++) {
+		printf("%12zu", bsizes[i]);
+		for (int m = 0; m < MAX_BENCH_MODE; m++) {
+			wres[i][m] = bench_io(ctx, BENCH_OP_WRITE,
+				(enum bench_mode)m, bsizes[i], 1, -1);
+			printf(" %9.0f MiB/s %9.0f ns", wres[i][m].bw,
+				wres[i][m].lat);
+		}
+		printf("\n");
+	}
+
+	printf("\nRandom reads, 1 thread:\n");
+	printf("%12s %9.0f ns\n", "latency", bench_latency(ctx, -1));
+
+	unsigned sat_threads = 1;
+	double peak = 0;
+	double wbw[BENCH_MAX_THREADS + 1];
+
+	printf("\nThread scaling, %zu B blocks:\n", BENCH_SCALING_BSIZE);
+	printf("%12s %22s %22s\n", "threads", "non-temporal writes",
+		"reads");
+	for (unsigned n = 1; n <= ctx->nthreads;
+			n = bench_next_nthreads(n, ctx->nthreads)) {
+		wbw[n] = bench_io(ctx, BENCH_OP_WRITE, BENCH_NONTEMPORAL,
+			BENCH_SCALING_BSIZE, n, -1).bw;
+		double rbw = bench_io(ctx, BENCH_OP_READ, BENCH_TEMPORAL,
+			BENCH_SCALING_BSIZE, n, -1).bw;
+		printf("%12u %16.0f MiB/s %16.0f MiB/s\n", n, wbw[n], rbw);
+
+		if (wbw[n] > peak)
+			peak = wbw[n];
+	}
+	for (unsigned n = 1; n <= ctx->nthreads;
+			n = bench_next_nthreads(n, ctx->nthreads)) {
+		if (wbw[n] >= peak * BENCH_SATURATION) {
+			sat_threads = n;
+			break;
+		}
+	}
+
+	int cpus[BENCH_MAX_NODES];
+	int nodes[BENCH_MAX_NODES];
+	unsigned nnodes = bench_numa_cpus(cpus, nodes);
+	int local_node = -1;
+
+	printf("\nNUMA locality, 1 thread per node:\n");
+	if (nnodes < 2) {
+		printf("  skipped, a single NUMA node\n");
+	} else {
+		printf("%12s %6s %22s %22s\n", "node", "cpu",
+			"random read latency", "non-temporal writes");
+		double best = 0;
+		for (unsigned i = 0; i < nnodes; i++) {
+			double lat = bench_latency(ctx, cpus[i]);
+			double bw = bench_io(ctx, BENCH_OP_WRITE,
+				BENCH_NONTEMPORAL, BENCH_SCALING_BSIZE, 1,
+				cpus[i]).bw;
+			printf("%12d %6d %19.0f ns %16.0f MiB/s\n", nodes[i],
+				cpus[i], lat, bw);
+
+			if (bw > best) {
+				best = bw;
+				local_node = nodes[i];
+			}
+		}
+	}
+
+	size_t threshold = bench_movnt_threshold(wres, bsizes, nbsizes);
+
+	printf("\nRecommendations:\n");
+	if (threshold)
+		printf("  PMEM_MOVNT_THRESHOLD: %zu\n", threshold);
+	else
+		printf("  PMEM_NO_MOVNT:        1\n");
+
+	/*
+	 * libpmemobj schedules the threads over one automatic arena per CPU,
+	 * the arenas above the saturation point are made manual
+	 */
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus > 0 && sat_threads < (unsigned)ncpus) {
+		printf("  PMEMOBJ_CONF:         ");
+		for (unsigned id = sat_threads + 1; id <= (unsigned)ncpus; id++)
+			printf("%sheap.arena.%u.automatic=0",
+				id > sat_threads + 1 ? ";" : "", id);
+		printf("\n");
+	}
+	if (local_node >= 0)
+		printf("  NUMA node:            %d\n", local_node);
+}
+
+/*
+ * bench_map -- (internal) map the file, create it if it does not exist
+ */
+static int
+bench_map(struct pmempool_bench_context *ctx)
+{
+	int exists = util_file_exists(ctx->fname);
+	if (exists < 0) {
+		outv_err("%s: %s\n", ctx->fname, strerror(errno));
+		return -1;
+	}
+
+	if (exists) {
+		if (util_is_poolset_file(ctx->fname) == 1) {
+			outv_err("%s: pool set files are not supported\n",
+				ctx->fname);
+			return -1;
+		}
+
+		struct pmem_pool_params params;
+		if (!ctx->force && pmem_pool_parse_params(ctx->fname,
+				&params, 0) == 0 &&
+				params.type != PMEM_POOL_TYPE_UNKNOWN) {
+			outv_err("%s: the file contains a pool, "
+				"use -f to overwrite it\n", ctx->fname);
+			return -1;
+		}
+
+		ctx->addr = pmem_map_file(ctx->fname, 0, 0, 0,
+			&ctx->mapped_len, &ctx->is_pmem);
+	} else {
+		if (ctx->size == 0)
+			ctx->size = BENCH_DEFAULT_SIZE;
+		ctx->addr = pmem_map_file(ctx->fname, ctx->size,
+			PMEM_FILE_CREATE | PMEM_FILE_EXCL, 0600,
+			&ctx->mapped_len, &ctx->is_pmem);
+		ctx->created = ctx->addr != NULL;
+	}
+
+	if (ctx->addr == NULL) {
+		outv_err("%s: %s\n", ctx->fname, pmem_errormsg());
+		return -1;
+	}
+
+	if (ctx->size == 0)
+		ctx->size = ctx->mapped_len < BENCH_DEFAULT_SIZE ?
+			ctx->mapped_len : BENCH_DEFAULT_SIZE;
+	else if (ctx->size > ctx->mapped_len)
+		ctx->size = ctx->mapped_len;
+
+	if (ctx->size < BENCH_MIN_SIZE) {
+		outv_err("%s: the file is too small, the minimum is %s\n",
+			ctx->fname, out_get_size_str(BENCH_MIN_SIZE, 1));
+		return -1;
+	}
+
+	/* allocate the blocks and fault the pages in before any run */
+	outv(1, "preparing %s\n", ctx->fname);
+	if (ctx->is_pmem) {
+		pmem_memset_persist(ctx->addr, 0, ctx->size);
+	} else {
+		memset(ctx->addr, 0, ctx->size);
+		pmem_msync(ctx->addr, ctx->size);
+	}
+
+	return 0;
+}
+
+/*
+ * bench_unmap -- (internal) unmap the file, remove it if it was created
+ */
+static void
+bench_unmap(struct pmempool_bench_context *ctx)
+{
+	if (ctx->addr)
+		pmem_unmap(ctx->addr, ctx->mapped_len);
+
+	if (ctx->created && util_unlink(ctx->fname))
+		outv_err("%s: %s\n", ctx->fname, strerror(errno));
+}
+
+/*
+ * pmempool_bench_func -- main function for the bench command
+ */
+int
+pmempool_bench_func(const char *appname, int argc, char *argv[])
+{
+	int ret;
+	struct pmempool_bench_context ctx = pmempool_bench_default;
+
+	/* parse command line arguments */
+	if ((ret = pmempool_bench_parse_args(&ctx, appname, argc, argv)))
+		return ret;
+
+	if (os_mutex_init(&ctx.lock) || os_cond_init(&ctx.cond)) {
+		outv_err("cannot initialize the lock\n");
+		return -1;
+	}
+
+	ret = bench_map(&ctx);
+	if (ret == 0)
+		bench_all(&ctx);
+
+	bench_unmap(&ctx);
+
+	os_cond_destroy(&ctx.cond);
+	os_mutex_destroy(&ctx.lock);
+
+	return ret;
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2020, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * clone.c -- pmempool clone command source file
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <errno.h>
+#include "common.h"
+#include "output.h"
+#include "clone.h"
+#include "libpmempool.h"
+
+/*
+ * pmempool_clone_context -- context and arguments for clone command
+ */
+struct pmempool_clone_context {
+	unsigned flags;		/* flags which modify the command execution */
+	char *src;		/* a path to a source pool or poolset file */
+	char *dst;		/* a path to a clone or its poolset file */
+};
+
+/*
+ * pmempool_clone_default -- default arguments for clone command
+ */
+static const struct pmempool_clone_context pmempool_clone_default = {
+	.flags		= 0,
+	.src		= NULL,
+	.dst		= NULL,
+};
+
+/*
+ * help_str -- string for help message
+ */
+static const char * const help_str =
+"Make a point-in-time copy of a closed pool\n"
+"\n"
+"Common options:\n"
+"  -n, --no-reflink     always copy the data, do not share the extents of\n"
+"                       the source files\n"
+"  -v, --verbose        increase verbosity level\n"
+"  -h, --help           display this help and exit\n"
+"\n"
+"For complete documentation see %s-clone(1) manual page.\n"
+;
+
+/*
+ * long_options -- command line options
+ */
+static const struct option long_options[] = {
+	{"no-reflink",	no_argument,		NULL,	'n'},
+	{"help",	no_argument,		NULL,	'h'},
+	{"verbose",	no_argument,		NULL,	'v'},
+	{NULL,		0,			NULL,	 0 },
+};
+
+/*
+ * print_usage -- print application usage short description
+ */
+static void
+print_usage(const char *appname)
+{
+	printf("usage: %s clone [<options>] <source> <destination>\n",
+			appname);
+}
+
+/*
+ * print_version -- print version string
+ */
+static void
+print_version(const char *appname)
+{
+	printf("%s %s\n", appname, SRCVERSION);
+}
+
+/*
+ * pmempool_clone_help -- print help message for the clone command
+ */
+void
+pmempool_clone_help(const char *appname)
+{
+	print_usage(appname);
+	print_version(appname);
+	printf(help_str, appname);
+}
+
+/*
+ * pmempool_clone_parse_args -- parse command line arguments
+ */
+static int
+pmempool_clone_parse_args(struct pmempool_clone_context *ctx,
+		const char *appname, int argc, char *argv[])
+{
+	int opt;
+	while ((opt = getopt_long(argc, argv, "nhv",
+			long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			ctx->flags |= PMEMPOOL_CLONE_NO_REFLINK;
+			break;
+		case 'h':
+			pmempool_clone_help(appname);
+			exit(EXIT_SUCCESS);
+		case 'v':
+			out_set_vlevel(1);
+			break;
+		default:
+			print_usage(appname);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind + 1 < argc) {
+		ctx->src = argv[optind];
+		ctx->dst = argv[optind + 1];
+	} else {
+		print_usage(appname);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+/*
+ * pmempool_clone_func -- main function for the clone command
+ */
+int
+pmempool_clone_func(const char *appname, int argc, char *argv[])
+{
+	int ret;
+	struct pmempool_clone_context ctx = pmempool_clone_default;
+
+	/* parse command line arguments */
+	if ((ret = pmempool_clone_parse_args(&ctx, appname, argc, argv)))
+		return ret;
+
+	ret = pmempool_clone(ctx.src, ctx.dst, ctx.flags);
+
+	if (ret) {
+		if (errno)
+			outv_err("%s\n", strerror(errno));
+		outv_err("failed to clone %s -> %s: %s\n", ctx.src, ctx.dst,
+				pmempool_errormsg());
+		return -1;
+	} else {
+		outv(1, "%s -> %s: cloned\n", ctx.src, ctx.dst);
+		return 0;
+	}
+}
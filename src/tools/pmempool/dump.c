@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -42,15 +42,24 @@
 #include <unistd.h>
 #include <string.h>
 #include <err.h>
+#include <limits.h>
 #include "common.h"
 #include "dump.h"
 #include "output.h"
 #include "os.h"
+#include "os_thread.h"
+#include "util.h"
 #include "libpmemblk.h"
 #include "libpmemlog.h"
 
 #define VERBOSE_DEFAULT	1
 
+/* number of output bytes processed by a single work item of sharded dump */
+#define DUMP_SHARD_SIZE ((size_t)4 << 20)
+
+/* granularity of skipping zeroed data in sparse dump of pmemlog pool */
+#define DUMP_SPARSE_LOG_SIZE ((size_t)4096)
+
 /*
  * pmempool_dump -- context and arguments for dump command
  */
@@ -64,6 +73,8 @@ struct pmempool_dump {
 	struct ranges ranges;
 	size_t chunksize;
 	uint64_t chunkcnt;
+	unsigned jobs;
+	int sparse;
 };
 
 /*
@@ -78,6 +89,8 @@ static const struct pmempool_dump pmempool_dump_default = {
 	.bsize		= 0,
 	.chunksize	= 0,
 	.chunkcnt	= 0,
+	.jobs		= 1,
+	.sparse		= 0,
 };
 
 /*
@@ -88,6 +101,8 @@ static const struct option long_options[] = {
 	{"binary",	no_argument,		NULL,	'b' | OPT_ALL},
 	{"range",	required_argument,	NULL,	'r' | OPT_ALL},
 	{"chunk",	required_argument,	NULL,	'c' | OPT_LOG},
+	{"jobs",	required_argument,	NULL,	'j' | OPT_ALL},
+	{"sparse",	no_argument,		NULL,	's' | OPT_ALL},
 	{"help",	no_argument,		NULL,	'h' | OPT_ALL},
 	{NULL,		0,			NULL,	 0 },
 };
@@ -103,6 +118,8 @@ static const char * const help_str =
 "  -b, --binary         dump data in binary format\n"
 "  -r, --range <range>  range of bytes/blocks/data chunks\n"
 "  -c, --chunk <size>   size of chunk for PMEMLOG pool\n"
+"  -j, --jobs <num>     number of threads writing the output file\n"
+"  -s, --sparse         do not write zeroed blocks/chunks to the output file\n"
 "  -h, --help           display this help and exit\n"
 "\n"
 "For complete documentation see %s-dump(1) manual page.\n"
@@ -211,6 +228,344 @@ pmempool_dump_parse_range(struct pmempool_dump *pdp, size_t max)
 	return 0;
 }
 
+/*
+ * dump_segment -- contiguous range of units dumped to the output file
+ */
+struct dump_segment {
+	uint64_t first;		/* first unit in the pool */
+	uint64_t count;		/* number of units */
+	uint64_t pos;		/* position of the first unit in the output */
+};
+
+/*
+ * dump_shards -- context of sharded dump
+ *
+ * The output file is split into work items of DUMP_SHARD_SIZE bytes which
+ * are picked by the threads one by one and written with pwrite, so they
+ * may complete in any order.
+ */
+struct dump_shards {
+	struct pmempool_dump *pdp;
+	PMEMblkpool *pbp;		/* source pmemblk pool */
+	const uint8_t *data;		/* source pmemlog data */
+	size_t unit;			/* size of a single unit */
+	size_t zsize;			/* granularity of sparse writes */
+	struct dump_segment *segs;
+	size_t nsegs;
+	uint64_t nunits;		/* number of units in the output */
+	uint64_t shard_units;		/* number of units in a work item */
+	uint64_t nshards;
+	uint64_t next_shard;		/* next work item to pick */
+	int fd;
+	int error;
+};
+
+/*
+ * pmempool_dump_segs_add -- (internal) append a range of units to the dump
+ */
+static void
+pmempool_dump_segs_add(struct dump_shards *ds, uint64_t first,
+	uint64_t count)
+{
+	ds->segs = realloc(ds->segs, (ds->nsegs + 1) * sizeof(*ds->segs));
+	if (!ds->segs)
+		err(1, "Cannot allocate memory for dump segments");
+
+	struct dump_segment *seg = &ds->segs[ds->nsegs++];
+	seg->first = first;
+	seg->count = count;
+	seg->pos = ds->nunits;
+
+	ds->nunits += count;
+}
+
+/*
+ * pmempool_dump_segs_find -- (internal) find segment containing given
+ *	position in the output
+ */
+static size_t
+pmempool_dump_segs_find(struct dump_shards *ds, uint64_t pos)
+{
+	size_t l = 0;
+	size_t r = ds->nsegs;
+
+	while (r - l > 1) {
+		size_t m = l + (r - l) / 2;
+		if (ds->segs[m].pos <= pos)
+			l = m;
+		else
+			r = m;
+	}
+
+	return l;
+}
+
+/*
+ * pmempool_dump_pwrite -- (internal) write the whole buffer at given offset
+ */
+static int
+pmempool_dump_pwrite(struct dump_shards *ds, const uint8_t *buf, size_t len,
+	uint64_t off)
+{
+	while (len) {
+		ssize_t n = pwrite(ds->fd, buf, len, (os_off_t)off);
+		if (n < 0) {
+			warn("%s", ds->pdp->ofname);
+			return -1;
+		}
+
+		buf += n;
+		len -= (size_t)n;
+		off += (uint64_t)n;
+	}
+
+	return 0;
+}
+
+/*
+ * pmempool_dump_write -- (internal) write data to the output, skipping
+ *	zeroed pieces of it in sparse dump
+ */
+static int
+pmempool_dump_write(struct dump_shards *ds, const uint8_t *buf, size_t len,
+	uint64_t off)
+{
+	if (!ds->pdp->sparse)
+		return pmempool_dump_pwrite(ds, buf, len, off);
+
+	size_t i = 0;
+	while (i < len) {
+		/* skip zeroed pieces, the output file is already zeroed */
+		while (i < len && util_is_zeroed(buf + i,
+				MIN(ds->zsize, len - i)))
+			i += MIN(ds->zsize, len - i);
+
+		size_t j = i;
+		while (j < len && !util_is_zeroed(buf + j,
+				MIN(ds->zsize, len - j)))
+			j += MIN(ds->zsize, len - j);
+
+		if (j > i && pmempool_dump_pwrite(ds, buf + i, j - i,
+				off + i))
+			return -1;
+
+		i = j;
+	}
+
+	return 0;
+}
+
+/*
+ * pmempool_dump_copy -- (internal) copy units from the pool to the output
+ */
+static int
+pmempool_dump_copy(struct dump_shards *ds, uint8_t *buf, uint64_t first,
+	uint64_t count, uint64_t pos)
+{
+	const uint8_t *data;
+
+	if (ds->pbp) {
+		for (uint64_t i = 0; i < count; i++) {
+			if (pmemblk_read(ds->pbp, buf + i * ds->unit,
+					(os_off_t)(first + i))) {
+				outv_err("reading block number %lu "
+					"failed\n", first + i);
+				return -1;
+			}
+		}
+		data = buf;
+	} else {
+		data = ds->data + first * ds->unit;
+	}
+
+	return pmempool_dump_write(ds, data, count * ds->unit,
+			pos * ds->unit);
+}
+
+/*
+ * pmempool_dump_worker -- (internal) dump work items picked one by one
+ *	from the shared counter
+ */
+static void *
+pmempool_dump_worker(void *arg)
+{
+	struct dump_shards *ds = arg;
+
+	uint8_t *buf = NULL;
+	if (ds->pbp) {
+		buf = malloc(ds->shard_units * ds->unit);
+		if (!buf) {
+			outv_err("Cannot allocate memory for dump buffer\n");
+			ds->error = 1;
+			return NULL;
+		}
+	}
+
+	uint64_t s;
+	while (!ds->error &&
+		(s = util_fetch_and_add64(&ds->next_shard, 1)) < ds->nshards) {
+		uint64_t pos = s * ds->shard_units;
+		uint64_t end = MIN(pos + ds->shard_units, ds->nunits);
+		size_t i = pmempool_dump_segs_find(ds, pos);
+
+		while (pos < end) {
+			struct dump_segment *seg = &ds->segs[i++];
+			uint64_t count = MIN(end, seg->pos + seg->count) - pos;
+
+			if (pmempool_dump_copy(ds, buf,
+					seg->first + (pos - seg->pos),
+					count, pos)) {
+				ds->error = 1;
+				break;
+			}
+
+			pos += count;
+		}
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+/*
+ * pmempool_dump_shards -- (internal) dump segments using multiple threads
+ *
+ * The output file is preallocated, or only resized in sparse dump to keep
+ * the skipped data as holes.
+ */
+static int
+pmempool_dump_shards(struct dump_shards *ds)
+{
+	struct pmempool_dump *pdp = ds->pdp;
+
+	ds->fd = fileno(pdp->ofh);
+
+	os_off_t size = (os_off_t)(ds->nunits * ds->unit);
+	if (size) {
+		int ret = pdp->sparse ? os_ftruncate(ds->fd, size) :
+			os_posix_fallocate(ds->fd, 0, size);
+		if (ret) {
+			if (!pdp->sparse)
+				errno = ret;
+			warn("%s", pdp->ofname);
+			return -1;
+		}
+	}
+
+	ds->shard_units = DUMP_SHARD_SIZE / ds->unit;
+	if (ds->shard_units == 0)
+		ds->shard_units = 1;
+	ds->nshards = (ds->nunits + ds->shard_units - 1) / ds->shard_units;
+	ds->next_shard = 0;
+	ds->error = 0;
+
+	unsigned nthreads = pdp->jobs;
+	if (nthreads > ds->nshards)
+		nthreads = (unsigned)ds->nshards;
+
+	if (nthreads <= 1) {
+		pmempool_dump_worker(ds);
+		return ds->error ? -1 : 0;
+	}
+
+	os_thread_t *threads = malloc(nthreads * sizeof(*threads));
+	if (!threads)
+		err(1, "Cannot allocate memory for dump threads");
+
+	unsigned started = 0;
+	for (; started < nthreads; started++) {
+		if (os_thread_create(&threads[started], NULL,
+				pmempool_dump_worker, ds))
+			break;
+	}
+
+	/* dump in the current thread if no thread could be started */
+	if (started == 0)
+		pmempool_dump_worker(ds);
+
+	for (unsigned t = 0; t < started; t++)
+		os_thread_join(&threads[t], NULL);
+
+	free(threads);
+
+	return ds->error ? -1 : 0;
+}
+
+/*
+ * pmempool_dump_range_cmp -- (internal) compare ranges by the first unit
+ */
+static int
+pmempool_dump_range_cmp(const void *a, const void *b)
+{
+	const struct range *ra = *(const struct range * const *)a;
+	const struct range *rb = *(const struct range * const *)b;
+
+	if (ra->first < rb->first)
+		return -1;
+
+	return ra->first > rb->first;
+}
+
+/*
+ * pmempool_dump_log_shards -- callback for pmemlog_walk, dumps the whole log
+ *	using multiple threads
+ */
+static int
+pmempool_dump_log_shards(const void *buf, size_t len, void *arg)
+{
+	struct dump_shards *ds = arg;
+	struct pmempool_dump *pdp = ds->pdp;
+
+	ds->data = buf;
+
+	struct range *curp = NULL;
+	if (pdp->chunksize) {
+		/*
+		 * Chunks are dumped in ascending order and only the complete
+		 * ones, the same as in the sequential dump.
+		 */
+		uint64_t nchunks = len / pdp->chunksize;
+		size_t nranges = 0;
+		PMDK_LIST_FOREACH(curp, &pdp->ranges.head, next)
+			nranges++;
+
+		struct range **ranges = malloc(nranges * sizeof(*ranges));
+		if (!ranges)
+			err(1, "Cannot allocate memory for ranges");
+
+		nranges = 0;
+		PMDK_LIST_FOREACH(curp, &pdp->ranges.head, next)
+			ranges[nranges++] = curp;
+
+		qsort(ranges, nranges, sizeof(*ranges),
+			pmempool_dump_range_cmp);
+
+		for (size_t i = 0; i < nranges; i++) {
+			if (ranges[i]->first >= nchunks)
+				continue;
+			uint64_t last = MIN(ranges[i]->last, nchunks - 1);
+			pmempool_dump_segs_add(ds, ranges[i]->first,
+				last - ranges[i]->first + 1);
+		}
+
+		free(ranges);
+	} else {
+		PMDK_LIST_FOREACH(curp, &pdp->ranges.head, next) {
+			if (curp->first >= len)
+				continue;
+			uint64_t last = MIN(curp->last, len - 1);
+			pmempool_dump_segs_add(ds, curp->first,
+				last - curp->first + 1);
+		}
+	}
+
+	if (pmempool_dump_shards(ds))
+		ds->error = 1;
+
+	return 0;
+}
+
 /*
  * pmempool_dump_log -- dump data from pmem log pool
  */
@@ -240,6 +595,24 @@ pmempool_dump_log(struct pmempool_dump *pdp)
 	if (pmempool_dump_parse_range(pdp, max))
 		return -1;
 
+	if (pdp->jobs > 1 || pdp->sparse) {
+		struct dump_shards ds = {
+			.pdp = pdp,
+			.unit = pdp->chunksize ? pdp->chunksize : 1,
+			.zsize = pdp->chunksize ? pdp->chunksize :
+				DUMP_SPARSE_LOG_SIZE,
+		};
+
+		pmemlog_walk(plp, 0, pmempool_dump_log_shards, &ds);
+		free(ds.segs);
+		if (ds.error) {
+			pmemlog_close(plp);
+			return -1;
+		}
+
+		goto end;
+	}
+
 	pdp->chunkcnt = 0;
 	pmemlog_walk(plp, pdp->chunksize, pmempool_dump_log_process_chunk, pdp);
 
@@ -264,6 +637,27 @@ pmempool_dump_blk(struct pmempool_dump *pdp)
 	if (pmempool_dump_parse_range(pdp, pmemblk_nblock(pbp) - 1))
 		return -1;
 
+	struct range *curp = NULL;
+	if (pdp->jobs > 1 || pdp->sparse) {
+		struct dump_shards ds = {
+			.pdp = pdp,
+			.pbp = pbp,
+			.unit = pdp->bsize,
+			.zsize = pdp->bsize,
+		};
+
+		PMDK_LIST_FOREACH(curp, &pdp->ranges.head, next)
+			pmempool_dump_segs_add(&ds, curp->first,
+				curp->last - curp->first + 1);
+
+		int ret = pmempool_dump_shards(&ds);
+
+		free(ds.segs);
+		pmemblk_close(pbp);
+
+		return ret;
+	}
+
 	uint8_t *buff = malloc(pdp->bsize);
 	if (!buff)
 		err(1, "Cannot allocate memory for pmemblk block buffer");
@@ -271,7 +665,6 @@ pmempool_dump_blk(struct pmempool_dump *pdp)
 	int ret = 0;
 
 	uint64_t i;
-	struct range *curp = NULL;
 	PMDK_LIST_FOREACH(curp, &pdp->ranges.head, next) {
 		assert((os_off_t)curp->last >= 0);
 		for (i = curp->first; i <= curp->last; i++) {
@@ -322,9 +715,10 @@ pmempool_dump_func(const char *appname, int argc, char *argv[])
 				option_requirements);
 	int ret = 0;
 	long long chunksize;
+	long long jobs;
 	int opt;
 	while ((opt = util_options_getopt(argc, argv,
-			"ho:br:c:", opts)) != -1) {
+			"ho:br:c:j:s", opts)) != -1) {
 		switch (opt) {
 		case 'o':
 			pd.ofname = optarg;
@@ -344,6 +738,18 @@ pmempool_dump_func(const char *appname, int argc, char *argv[])
 			}
 			pd.chunksize = (size_t)chunksize;
 			break;
+		case 'j':
+			jobs = atoll(optarg);
+			if (jobs <= 0 || jobs > UINT_MAX) {
+				outv_err("invalid number of jobs specified "
+					"'%s'\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			pd.jobs = (unsigned)jobs;
+			break;
+		case 's':
+			pd.sparse = 1;
+			break;
 		case 'h':
 			pmempool_dump_help(appname);
 			exit(EXIT_SUCCESS);
@@ -360,6 +766,12 @@ pmempool_dump_func(const char *appname, int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if ((pd.jobs > 1 || pd.sparse) && (pd.hex || pd.ofname == NULL)) {
+		outv_err("'-j' and '-s' options require binary dump "
+			"to a file\n");
+		exit(EXIT_FAILURE);
+	}
+
 	if (pd.ofname == NULL) {
 		/* use standard output by default */
 		pd.ofh = stdout;
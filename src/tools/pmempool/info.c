@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -109,6 +109,7 @@ static const struct pmempool_info_args pmempool_info_args_default = {
 		.vbitmap	= VERBOSE_SILENT,
 		.lanes_recovery	= false,
 		.ignore_empty_obj = false,
+		.json		= false,
 		.chunk_types	= DEFAULT_CHUNK_TYPES,
 		.replica	= 0,
 	},
@@ -150,6 +151,7 @@ static const struct option long_options[] = {
 	{"chunk-type",	required_argument,	NULL, 'T' | OPT_OBJ},
 	{"bitmap",	no_argument,		NULL, 'b' | OPT_OBJ},
 	{"replica",	required_argument,	NULL, 'p' | OPT_OBJ},
+	{"json",	no_argument,		NULL, 'j' | OPT_OBJ},
 	{NULL,		0,			NULL,  0 },
 };
 
@@ -245,6 +247,11 @@ static const struct option_requirement option_requirements[] = {
 		.type	= PMEM_POOL_TYPE_OBJ,
 		.req	= OPT_REQ0('O') | OPT_REQ1('o'),
 	},
+	{
+		.opt	= 'j',
+		.type	= PMEM_POOL_TYPE_OBJ,
+		.req	= OPT_REQ0('s'),
+	},
 	{ 0,  0, 0}
 };
 
@@ -301,6 +308,8 @@ static const char * const help_str =
 "  -b, --bitmap                    Print chunk run's bitmap in graphical\n"
 "                                  format. [requires --chunks|-C]\n"
 "  -p, --replica <num>             Print info from specified replica\n"
+"  -j, --json                      Print only statistics in JSON format.\n"
+"                                  [requires --stats|-s]\n"
 "For complete documentation see %s-info(1) manual page.\n"
 ;
 
@@ -355,7 +364,7 @@ parse_args(const char *appname, int argc, char *argv[],
 
 	struct ranges *rangesp = &argsp->ranges;
 	while ((opt = util_options_getopt(argc, argv,
-			"vhnf:ezuF:L:c:dmxVw:gBsr:lRS:OECZHT:bot:aAp:k:",
+			"vhnf:ezuF:L:c:dmxVw:gBsr:lRS:OECZHT:bot:aAp:k:j",
 			opts)) != -1) {
 
 		switch (opt) {
@@ -494,6 +503,9 @@ parse_args(const char *appname, int argc, char *argv[],
 		case 'b':
 			argsp->obj.vbitmap = VERBOSE_DEFAULT;
 			break;
+		case 'j':
+			argsp->obj.json = true;
+			break;
 		case 'p':
 		{
 			char *endptr;
@@ -1050,8 +1062,12 @@ pmempool_info_func(const char *appname, int argc, char *argv[])
 	/* read command line arguments */
 	if ((ret = parse_args(appname, argc, argv, &pip->args,
 					pip->opts)) == 0) {
-		/* set some output format values */
-		out_set_vlevel(pip->args.vlevel);
+		/*
+		 * set some output format values, JSON statistics are
+		 * the only output in JSON mode
+		 */
+		out_set_vlevel(pip->args.obj.json ?
+				VERBOSE_SILENT : pip->args.vlevel);
 		out_set_col_width(pip->args.col_width);
 
 		ret = pmempool_info_file(pip, pip->args.file);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -107,6 +107,7 @@ struct pmempool_info_args {
 		int vbitmap;
 		bool lanes_recovery;
 		bool ignore_empty_obj;
+		bool json;		/* print statistics in JSON format */
 		uint64_t chunk_types;
 		size_t replica;
 		struct ranges lane_ranges;
@@ -180,7 +181,6 @@ struct pmem_info {
 		size_t size;
 		struct pmem_obj_stats stats;
 		uint64_t uuid_lo;
-		uint64_t objid;
 	} obj;
 };
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2019, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -49,9 +49,13 @@
 #include "output.h"
 #include "info.h"
 #include "util.h"
+#include "os_thread.h"
 
 #define BITMAP_BUFF_SIZE 1024
 
+/* upper limit of threads walking the heap for statistics */
+#define INFO_OBJ_MAX_THREADS 64
+
 #define OFF_TO_PTR(pop, off) ((void *)((uintptr_t)(pop) + (off)))
 
 #define PTR_TO_OFF(pop, ptr) ((uintptr_t)(ptr) - (uintptr_t)(pop))
@@ -120,6 +124,15 @@ pmem_obj_stats_get_type(struct pmem_obj_stats *stats, uint64_t type_num)
 	return type;
 }
 
+/*
+ * info_obj_walk -- context of a walk over the heap zones
+ */
+struct info_obj_walk {
+	struct pmem_info *pip;
+	struct pmem_obj_stats *stats;	/* objects' statistics */
+	uint64_t objid;			/* id of the next object */
+};
+
 struct info_obj_redo_args {
 	int v;
 	size_t i;
@@ -333,9 +346,11 @@ info_obj_zone_hdr(struct pmem_info *pip, int v, struct zone_header *zone)
  * info_obj_object -- print information about object
  */
 static void
-info_obj_object(struct pmem_info *pip, const struct memory_block *m,
-	uint64_t objid)
+info_obj_object(struct info_obj_walk *walk, const struct memory_block *m)
 {
+	struct pmem_info *pip = walk->pip;
+	uint64_t objid = walk->objid++;
+
 	if (!util_ranges_contain(&pip->args.ranges, objid))
 		return;
 
@@ -345,11 +360,11 @@ info_obj_object(struct pmem_info *pip, const struct memory_block *m,
 		return;
 
 	uint64_t real_size = m->m_ops->get_real_size(m);
-	pip->obj.stats.n_total_objects++;
-	pip->obj.stats.n_total_bytes += real_size;
+	walk->stats->n_total_objects++;
+	walk->stats->n_total_bytes += real_size;
 
 	struct pmem_obj_type_stats *type_stats =
-		pmem_obj_stats_get_type(&pip->obj.stats, type_num);
+		pmem_obj_stats_get_type(walk->stats, type_num);
 
 	type_stats->n_objects++;
 	type_stats->n_bytes += real_size;
@@ -357,6 +372,9 @@ info_obj_object(struct pmem_info *pip, const struct memory_block *m,
 	int vid = pip->args.obj.vobjects;
 	int v = pip->args.obj.vobjects;
 
+	if (!outv_check(v))
+		return;
+
 	outv_indent(v, 1);
 	info_obj_object_hdr(pip, v, vid, m, objid);
 	outv_indent(v, -1);
@@ -368,6 +386,10 @@ info_obj_object(struct pmem_info *pip, const struct memory_block *m,
 static void
 info_obj_run_bitmap(int v, struct run_bitmap *b)
 {
+	/* get_bitmap_str is not thread-safe, format only if needed */
+	if (!outv_check(v))
+		return;
+
 	/* print only used values for lower verbosity */
 	uint32_t i;
 	for (i = 0; i < b->nbits / RUN_BITS_PER_VALUE; i++)
@@ -401,12 +423,12 @@ info_obj_memblock_is_root(struct pmem_info *pip, const struct memory_block *m)
 static int
 info_obj_run_cb(const struct memory_block *m, void *arg)
 {
-	struct pmem_info *pip = arg;
+	struct info_obj_walk *walk = arg;
 
-	if (info_obj_memblock_is_root(pip, m))
+	if (info_obj_memblock_is_root(walk->pip, m))
 		return 0;
 
-	info_obj_object(pip, m, pip->obj.objid++);
+	info_obj_object(walk, m);
 
 	return 0;
 }
@@ -438,10 +460,11 @@ info_obj_class_stats_get_or_insert(struct pmem_obj_zone_stats *stats,
  * info_obj_chunk -- print chunk info
  */
 static void
-info_obj_chunk(struct pmem_info *pip, uint64_t c, uint64_t z,
+info_obj_chunk(struct info_obj_walk *walk, uint64_t c, uint64_t z,
 	struct chunk_header *chunk_hdr, struct chunk *chunk,
 	struct pmem_obj_zone_stats *stats)
 {
+	struct pmem_info *pip = walk->pip;
 	int v = pip->args.obj.vchunkhdr;
 	outv(v, "\n");
 	outv_field(v, "Chunk", "%lu", c);
@@ -473,7 +496,7 @@ info_obj_chunk(struct pmem_info *pip, uint64_t c, uint64_t z,
 
 			/* skip root object */
 			if (!info_obj_memblock_is_root(pip, &m)) {
-				info_obj_object(pip, &m, pip->obj.objid++);
+				info_obj_object(walk, &m);
 			}
 		}
 	} else if (chunk_hdr->type == CHUNK_TYPE_RUN) {
@@ -496,7 +519,9 @@ info_obj_chunk(struct pmem_info *pip, uint64_t c, uint64_t z,
 			return;
 		}
 
-		outv_field(v, "Block size", "%s",
+		/* out_get_size_str is not thread-safe, format only if needed */
+		if (outv_check(v))
+			outv_field(v, "Block size", "%s",
 				out_get_size_str(run->hdr.block_size,
 					pip->args.human));
 
@@ -513,7 +538,7 @@ info_obj_chunk(struct pmem_info *pip, uint64_t c, uint64_t z,
 
 		info_obj_run_bitmap(v && pip->args.obj.vbitmap, &bitmap);
 
-		m.m_ops->iterate_used(&m, info_obj_run_cb, pip);
+		m.m_ops->iterate_used(&m, info_obj_run_cb, walk);
 	}
 }
 
@@ -521,9 +546,11 @@ info_obj_chunk(struct pmem_info *pip, uint64_t c, uint64_t z,
  * info_obj_zone_chunks -- print chunk headers from specified zone
  */
 static void
-info_obj_zone_chunks(struct pmem_info *pip, struct zone *zone, uint64_t z,
-	struct pmem_obj_zone_stats *stats)
+info_obj_zone_chunks(struct info_obj_walk *walk, struct zone *zone,
+	uint64_t z, struct pmem_obj_zone_stats *stats)
 {
+	struct pmem_info *pip = walk->pip;
+
 	VEC_INIT(&stats->class_stats);
 
 	struct pmem_obj_class_stats default_class_stats = {0, 0,
@@ -542,7 +569,7 @@ info_obj_zone_chunks(struct pmem_info *pip, struct zone *zone, uint64_t z,
 				stats->size_chunks += size_idx;
 				stats->size_chunks_type[type] += size_idx;
 
-				info_obj_chunk(pip, c, z,
+				info_obj_chunk(walk, c, z,
 					&zone->chunk_headers[c],
 					&zone->chunks[c], stats);
 
@@ -552,7 +579,7 @@ info_obj_zone_chunks(struct pmem_info *pip, struct zone *zone, uint64_t z,
 				pip->args.obj.chunk_types &
 				(1 << CHUNK_TYPE_FOOTER)) {
 				size_t f = c + size_idx - 1;
-				info_obj_chunk(pip, f, z,
+				info_obj_chunk(walk, f, z,
 					&zone->chunk_headers[f],
 					&zone->chunks[f], stats);
 			}
@@ -589,6 +616,126 @@ info_obj_root_obj(struct pmem_info *pip)
 	info_obj_object_hdr(pip, v, VERBOSE_SILENT, &m, 0);
 }
 
+/*
+ * info_obj_zones_walk -- context of the parallel walk over the heap zones
+ */
+struct info_obj_zones_walk {
+	struct pmem_info *pip;
+	struct heap_layout *layout;
+	uint64_t nzones;
+	uint64_t next_zone;		/* next zone to pick by a worker */
+	struct pmem_obj_stats *zone_objs; /* objects' statistics per zone */
+};
+
+/*
+ * info_obj_zones_worker -- (internal) collect statistics of zones picked
+ *	one by one from the shared counter
+ */
+static void *
+info_obj_zones_worker(void *arg)
+{
+	struct info_obj_zones_walk *zw = arg;
+	struct pmem_info *pip = zw->pip;
+	uint64_t z;
+
+	while ((z = util_fetch_and_add64(&zw->next_zone, 1)) < zw->nzones) {
+		if (!util_ranges_contain(&pip->args.obj.zone_ranges, z))
+			continue;
+
+		struct info_obj_walk walk = {pip, &zw->zone_objs[z], 0};
+		info_obj_zone_chunks(&walk, ZID_TO_ZONE(zw->layout, z), z,
+				&pip->obj.stats.zone_stats[z]);
+	}
+
+	return NULL;
+}
+
+/*
+ * info_obj_zones_nthreads -- (internal) number of threads for the parallel
+ *	walk over the heap zones
+ */
+static unsigned
+info_obj_zones_nthreads(uint64_t nzones)
+{
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t n = ncpus > 0 ? (uint64_t)ncpus : 1;
+
+	if (n > INFO_OBJ_MAX_THREADS)
+		n = INFO_OBJ_MAX_THREADS;
+	if (n > nzones)
+		n = nzones;
+
+	return (unsigned)n;
+}
+
+/*
+ * info_obj_zones_stats -- (internal) collect statistics of all zones using
+ *	multiple threads
+ *
+ * Nothing is printed while walking, so the zones can be processed in any
+ * order, but the arguments of outv() are evaluated even if the output is
+ * silent, so the helpers which format into static buffers must be called
+ * only after checking the verbosity. The objects' statistics are collected
+ * per zone and merged in the zone order afterwards.
+ */
+static void
+info_obj_zones_stats(struct pmem_info *pip, struct heap_layout *layout,
+	uint64_t nzones)
+{
+	struct info_obj_zones_walk zw = {pip, layout, nzones, 0, NULL};
+
+	zw.zone_objs = calloc(nzones, sizeof(*zw.zone_objs));
+	if (zw.zone_objs == NULL)
+		err(1, "Cannot allocate memory for zone stats");
+
+	for (uint64_t z = 0; z < nzones; z++)
+		PMDK_TAILQ_INIT(&zw.zone_objs[z].type_stats);
+
+	unsigned nthreads = info_obj_zones_nthreads(nzones);
+	os_thread_t *threads = calloc(nthreads, sizeof(*threads));
+	if (threads == NULL)
+		err(1, "Cannot allocate memory for threads");
+
+	unsigned started = 0;
+	for (; started < nthreads; started++) {
+		if (os_thread_create(&threads[started], NULL,
+				info_obj_zones_worker, &zw))
+			break;
+	}
+
+	/* walk in the current thread too if no thread could be started */
+	if (started == 0)
+		info_obj_zones_worker(&zw);
+
+	for (unsigned t = 0; t < started; t++)
+		os_thread_join(&threads[t], NULL);
+
+	free(threads);
+
+	struct pmem_obj_stats *stats = &pip->obj.stats;
+	for (uint64_t z = 0; z < nzones; z++) {
+		struct pmem_obj_stats *zobjs = &zw.zone_objs[z];
+
+		stats->n_total_objects += zobjs->n_total_objects;
+		stats->n_total_bytes += zobjs->n_total_bytes;
+
+		while (!PMDK_TAILQ_EMPTY(&zobjs->type_stats)) {
+			struct pmem_obj_type_stats *type =
+				PMDK_TAILQ_FIRST(&zobjs->type_stats);
+			PMDK_TAILQ_REMOVE(&zobjs->type_stats, type, next);
+
+			struct pmem_obj_type_stats *total =
+				pmem_obj_stats_get_type(stats, type->type_num);
+			total->n_objects += type->n_objects;
+			total->n_bytes += type->n_bytes;
+
+			free(type);
+		}
+	}
+
+	free(zw.zone_objs);
+}
+
 /*
  * info_obj_zones -- print zones and chunks
  */
@@ -597,7 +744,8 @@ info_obj_zones_chunks(struct pmem_info *pip)
 {
 	if (!outv_check(pip->args.obj.vheap) &&
 		!outv_check(pip->args.vstats) &&
-		!outv_check(pip->args.obj.vobjects))
+		!outv_check(pip->args.obj.vobjects) &&
+		!pip->args.obj.json)
 		return;
 
 	struct pmemobjpool *pop = pip->obj.pop;
@@ -609,6 +757,17 @@ info_obj_zones_chunks(struct pmem_info *pip)
 	if (!pip->obj.stats.zone_stats)
 		err(1, "Cannot allocate memory for zone stats");
 
+	/*
+	 * Chunks and objects have to be printed in order and the object ids
+	 * selected by the range are counted across the zones, otherwise
+	 * the zones are walked in parallel.
+	 */
+	int parallel = !outv_check(pip->args.obj.vchunkhdr) &&
+		!outv_check(pip->args.obj.vobjects) &&
+		!pip->args.use_range;
+
+	struct info_obj_walk walk = {pip, &pip->obj.stats, 0};
+
 	for (size_t i = 0; i < maxzone; i++) {
 		struct zone *zone = ZID_TO_ZONE(layout, i);
 
@@ -626,12 +785,18 @@ info_obj_zones_chunks(struct pmem_info *pip)
 					pip->args.obj.vzonehdr,
 					&zone->header);
 
+			if (parallel)
+				continue;
+
 			outv_indent(vvv, 1);
-			info_obj_zone_chunks(pip, zone, i,
+			info_obj_zone_chunks(&walk, zone, i,
 					&pip->obj.stats.zone_stats[i]);
 			outv_indent(vvv, -1);
 		}
 	}
+
+	if (parallel)
+		info_obj_zones_stats(pip, layout, maxzone);
 }
 
 /*
@@ -878,6 +1043,104 @@ info_obj_stats_zones(struct pmem_info *pip, int v, struct pmem_obj_stats *stats,
 	outv_indent(v, -1);
 }
 
+/*
+ * info_obj_json_chunks -- (internal) print chunks' and allocation classes'
+ *	statistics as JSON object members
+ */
+static void
+info_obj_json_chunks(struct pmem_obj_zone_stats *stats, const char *indent)
+{
+	printf("%s\"chunks\": %" PRIu64 ",\n", indent, stats->n_chunks);
+	printf("%s\"chunks_bytes\": %" PRIu64 ",\n", indent,
+			stats->size_chunks * CHUNKSIZE);
+
+	printf("%s\"chunk_types\": [", indent);
+	const char *sep = "";
+	for (unsigned type = 0; type < MAX_CHUNK_TYPE; type++) {
+		if (!stats->n_chunks_type[type])
+			continue;
+
+		printf("%s\n%s\t{\"type\": \"%s\", \"chunks\": %" PRIu64
+			", \"bytes\": %" PRIu64 "}", sep, indent,
+			out_get_chunk_type_str(type),
+			stats->n_chunks_type[type],
+			stats->size_chunks_type[type] * CHUNKSIZE);
+		sep = ",";
+	}
+	printf("%s%s],\n", *sep ? "\n" : "", *sep ? indent : "");
+
+	printf("%s\"alloc_classes\": [", indent);
+	sep = "";
+	struct pmem_obj_class_stats *cstats;
+	VEC_FOREACH_BY_PTR(cstats, &stats->class_stats) {
+		if (cstats->n_units == 0)
+			continue;
+
+		printf("%s\n%s\t{\"unit_size\": %" PRIu64
+			", \"alignment\": %" PRIu64
+			", \"units\": %" PRIu64
+			", \"used_units\": %" PRIu64 "}", sep, indent,
+			cstats->unit_size, cstats->alignment,
+			cstats->n_units, cstats->n_used);
+		sep = ",";
+	}
+	printf("%s%s]\n", *sep ? "\n" : "", *sep ? indent : "");
+}
+
+/*
+ * info_obj_stats_json -- (internal) print statistics in JSON format
+ */
+static void
+info_obj_stats_json(struct pmem_info *pip)
+{
+	struct pmem_obj_stats *stats = &pip->obj.stats;
+	struct pmem_obj_zone_stats total;
+	memset(&total, 0, sizeof(total));
+
+	printf("{\n");
+	printf("\t\"objects\": %" PRIu64 ",\n", stats->n_total_objects);
+	printf("\t\"bytes\": %" PRIu64 ",\n", stats->n_total_bytes);
+
+	printf("\t\"types\": [");
+	const char *sep = "";
+	struct pmem_obj_type_stats *type_stats;
+	PMDK_TAILQ_FOREACH(type_stats, &stats->type_stats, next) {
+		if (!type_stats->n_objects)
+			continue;
+
+		printf("%s\n\t\t{\"type_num\": %" PRIu64
+			", \"objects\": %" PRIu64
+			", \"bytes\": %" PRIu64 "}", sep,
+			type_stats->type_num, type_stats->n_objects,
+			type_stats->n_bytes);
+		sep = ",";
+	}
+	printf("%s],\n", *sep ? "\n\t" : "");
+
+	printf("\t\"zones\": %" PRIu64 ",\n", stats->n_zones);
+	printf("\t\"zones_used\": %" PRIu64 ",\n", stats->n_zones_used);
+
+	printf("\t\"zone_stats\": [");
+	for (uint64_t i = 0; i < stats->n_zones_used; i++) {
+		struct pmem_obj_zone_stats *zstats = &stats->zone_stats[i];
+
+		printf("%s\n\t\t{\n", i ? "," : "");
+		printf("\t\t\t\"zone\": %" PRIu64 ",\n", i);
+		info_obj_json_chunks(zstats, "\t\t\t");
+		printf("\t\t}");
+
+		info_obj_add_zone_stats(&total, zstats);
+	}
+	printf("%s],\n", stats->n_zones_used ? "\n\t" : "");
+
+	printf("\t\"total\": {\n");
+	info_obj_json_chunks(&total, "\t\t");
+	printf("\t}\n");
+	printf("}\n");
+
+	VEC_DELETE(&total.class_stats);
+}
+
 /*
  * info_obj_stats -- print statistics
  */
@@ -886,6 +1149,11 @@ info_obj_stats(struct pmem_info *pip)
 {
 	int v = pip->args.vstats;
 
+	if (pip->args.obj.json) {
+		info_obj_stats_json(pip);
+		return;
+	}
+
 	if (!outv_check(v))
 		return;
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2018, Intel Corporation
+ * Copyright 2014-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -51,7 +51,9 @@
 #include "convert.h"
 #include "synchronize.h"
 #include "transform.h"
+#include "clone.h"
 #include "feature.h"
+#include "bench.h"
 #include "set.h"
 
 #ifndef _WIN32
@@ -173,6 +175,18 @@ static const struct command commands[] = {
 		.func = pmempool_feature_func,
 		.help = pmempool_feature_help,
 	},
+	{
+		.name = "clone",
+		.brief = "make a point-in-time copy of a pool",
+		.func = pmempool_clone_func,
+		.help = pmempool_clone_help,
+	},
+	{
+		.name = "bench",
+		.brief = "measure the performance of the media",
+		.func = pmempool_bench_func,
+		.help = pmempool_bench_help,
+	},
 	{
 		.name = "help",
 		.brief = "print help text about a command",
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2018, Intel Corporation
+ * Copyright 2016-2020, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -45,6 +45,8 @@
 #include <stdbool.h>
 #include <sys/mman.h>
 #include <endian.h>
+#include <errno.h>
+#include <limits.h>
 #include "common.h"
 #include "output.h"
 #include "libpmempool.h"
@@ -55,6 +57,10 @@
 struct pmempool_sync_context {
 	unsigned flags;		/* flags which modify the command execution */
 	char *poolset_file;	/* a path to a poolset file */
+	unsigned nthreads;	/* number of copying threads, 0 - default */
+	size_t bandwidth;	/* bytes per second, 0 - unlimited */
+	int progress;		/* report the progress of copying */
+	unsigned progress_interval; /* ms between progress reports */
 };
 
 /*
@@ -63,6 +69,10 @@ struct pmempool_sync_context {
 static const struct pmempool_sync_context pmempool_sync_default = {
 	.flags		= 0,
 	.poolset_file	= NULL,
+	.nthreads	= 0,
+	.bandwidth	= 0,
+	.progress	= 0,
+	.progress_interval = 0,
 };
 
 /*
@@ -74,6 +84,11 @@ static const char * const help_str =
 "Common options:\n"
 "  -b, --bad-blocks     fix bad blocks - it requires creating or reading special recovery files\n"
 "  -d, --dry-run        do not apply changes, only check for viability of synchronization\n"
+"  -i, --incremental    copy only the regions which differ from the healthy replica\n"
+"  -t, --threads <num>  number of threads copying the data\n"
+"  -B, --bandwidth <size>\n"
+"                       limit copying the data to <size> bytes per second\n"
+"  -p, --progress <ms>  report the progress of copying every <ms> milliseconds\n"
 "  -v, --verbose        increase verbosity level\n"
 "  -h, --help           display this help and exit\n"
 "\n"
@@ -86,6 +101,10 @@ static const char * const help_str =
 static const struct option long_options[] = {
 	{"bad-blocks",	no_argument,		NULL,	'b'},
 	{"dry-run",	no_argument,		NULL,	'd'},
+	{"incremental",	no_argument,		NULL,	'i'},
+	{"threads",	required_argument,	NULL,	't'},
+	{"bandwidth",	required_argument,	NULL,	'B'},
+	{"progress",	required_argument,	NULL,	'p'},
 	{"help",	no_argument,		NULL,	'h'},
 	{"verbose",	no_argument,		NULL,	'v'},
 	{NULL,		0,			NULL,	 0 },
@@ -128,7 +147,9 @@ pmempool_sync_parse_args(struct pmempool_sync_context *ctx, const char *appname,
 		int argc, char *argv[])
 {
 	int opt;
-	while ((opt = getopt_long(argc, argv, "bdhv",
+	char *endptr;
+	unsigned long ul;
+	while ((opt = getopt_long(argc, argv, "bdit:B:p:hv",
 			long_options, NULL)) != -1) {
 		switch (opt) {
 		case 'd':
@@ -137,6 +158,38 @@ pmempool_sync_parse_args(struct pmempool_sync_context *ctx, const char *appname,
 		case 'b':
 			ctx->flags |= PMEMPOOL_SYNC_FIX_BAD_BLOCKS;
 			break;
+		case 'i':
+			ctx->flags |= PMEMPOOL_SYNC_INCREMENTAL;
+			break;
+		case 't':
+			errno = 0;
+			ul = strtoul(optarg, &endptr, 10);
+			if (errno || *endptr != '\0' || ul == 0 ||
+					ul > UINT_MAX) {
+				outv_err("invalid number of threads '%s'\n",
+					optarg);
+				exit(EXIT_FAILURE);
+			}
+			ctx->nthreads = (unsigned)ul;
+			break;
+		case 'B':
+			if (util_parse_size(optarg, &ctx->bandwidth) ||
+					ctx->bandwidth == 0) {
+				outv_err("invalid bandwidth '%s'\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'p':
+			errno = 0;
+			ul = strtoul(optarg, &endptr, 10);
+			if (errno || *endptr != '\0' || ul > UINT_MAX) {
+				outv_err("invalid progress interval '%s'\n",
+					optarg);
+				exit(EXIT_FAILURE);
+			}
+			ctx->progress = 1;
+			ctx->progress_interval = (unsigned)ul;
+			break;
 		case 'h':
 			pmempool_sync_help(appname);
 			exit(EXIT_SUCCESS);
@@ -159,6 +212,20 @@ pmempool_sync_parse_args(struct pmempool_sync_context *ctx, const char *appname,
 	return 0;
 }
 
+/*
+ * pmempool_sync_progress -- (internal) print the progress of copying
+ */
+static void
+pmempool_sync_progress(size_t done, size_t skipped, size_t total, void *arg)
+{
+	const char *poolset_file = arg;
+
+	printf("%s: %zu/%zu MiB (%zu%%), %zu MiB skipped\n", poolset_file,
+		done >> 20, total >> 20, total ? done * 100 / total : 100,
+		skipped >> 20);
+	fflush(stdout);
+}
+
 /*
  * pmempool_sync_func -- main function for the sync command
  */
@@ -172,7 +239,18 @@ pmempool_sync_func(const char *appname, int argc, char *argv[])
 	if ((ret = pmempool_sync_parse_args(&ctx, appname, argc, argv)))
 		return ret;
 
-	ret = pmempool_sync(ctx.poolset_file, ctx.flags);
+	struct pmempool_sync_args args;
+	memset(&args, 0, sizeof(args));
+	args.flags = ctx.flags;
+	args.nthreads = ctx.nthreads;
+	args.bandwidth = ctx.bandwidth;
+	if (ctx.progress) {
+		args.progress_interval = ctx.progress_interval;
+		args.progress = pmempool_sync_progress;
+		args.progress_arg = ctx.poolset_file;
+	}
+
+	ret = pmempool_sync_with_args(ctx.poolset_file, &args, sizeof(args));
 
 	if (ret) {
 		outv_err("failed to synchronize: %s\n", pmempool_errormsg());